@@ -17,15 +17,26 @@ public:
   glm::mat4 GetProjectionMatrix() const;
 
   void MouseLook(int mouseX, int mouseY);
+  // Places the camera directly, for scripted paths
+  void LookAt(const glm::vec3 &eye, const glm::vec3 &target);
 
   void MoveForward(float speed);
   void MoveBackward(float speed);
   void MoveLeft(float speed);
   void MoveRight(float speed);
 
+  // Keeps the current position for interpolation, call before each fixed
+  // simulation step
+  void BeginStep();
+  // Copy placed alpha of the way from the previous step to the current one.
+  // The view direction is not interpolated since mouse look is applied
+  // once per frame.
+  Camera Interpolated(float alpha) const;
+
 private:
   glm::mat4 mProjectionMatrix;
   glm::vec3 mEye;
+  glm::vec3 mPrevEye;
   glm::vec3 mViewDirection;
   glm::vec3 mUpVector;
   glm::vec2 mOldMousePos;
@@ -0,0 +1,95 @@
+#ifndef DYNAMIC_BATCHER_HPP
+#define DYNAMIC_BATCHER_HPP
+
+#include "Mesh.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <map>
+#include <vector>
+
+// Transforms count packed xyz positions by model into out, advancing
+// outStride floats per vertex. Uses SSE when available.
+void TransformPositions(const glm::mat4 &model, const GLfloat *in,
+                        GLfloat *out, size_t count, size_t outStride = 3);
+
+struct DynamicBatchThresholds {
+  // Meshes with more vertices than this are drawn on their own
+  size_t mMaxBatchVertices = 256;
+  // Copies of one mesh needed before instancing beats batching
+  size_t mMinInstanceCount = 8;
+};
+
+// Collects small moving meshes every frame and picks the cheapest way to
+// submit them: CPU pre-transform into one streamed draw per pipeline,
+// instancing for many copies of one mesh, or plain individual draws for
+// meshes too big to be worth transforming. The vertex threshold follows the
+// measured cost of a draw call versus transforming a vertex.
+class DynamicBatcher {
+
+public:
+  DynamicBatcher();
+
+  // Sizes of the streaming buffers, every one must be above 0
+  bool Create(size_t maxVertices, size_t maxIndices, size_t maxInstances);
+  void Destroy();
+
+  // Program with an instanceModelMatrix attribute to use for pipeline's
+  // instanced draws, 0 disables instancing for it
+  void SetInstancedPipeline(GLuint pipeline, GLuint instancedPipeline);
+
+  // data is the CPU copy of mesh's geometry and must outlive Flush. The
+  // vertex arrays made to instance mesh live until Destroy.
+  void Submit(const Mesh3D *mesh, const MeshData *data,
+              const glm::mat4 &model);
+  // Draws everything submitted this frame, returns the draw calls issued
+  int Flush(const glm::mat4 &view, const glm::mat4 &projection);
+
+  DynamicBatchThresholds GetThresholds() const;
+  void SetThresholds(const DynamicBatchThresholds &thresholds);
+
+private:
+  struct Item {
+    const Mesh3D *mMesh;
+    const MeshData *mData;
+    glm::mat4 mModel;
+  };
+
+  void BindPipeline(GLuint pipeline, const glm::mat4 &view,
+                    const glm::mat4 &projection);
+  int DrawIndividual(const Item &item);
+  int DrawInstanced(const std::vector<const Item *> &items);
+  // mesh's buffers with the instance matrices at locations 2 to 5, so the
+  // mesh's own vertex array, which other meshes may share, is left alone
+  GLuint InstancedVertexArray(const Mesh3D *mesh);
+  int DrawBatch(const std::vector<const Item *> &items);
+  void DrawBatchRun(const Item *const *items, size_t count);
+  void UpdateThresholds();
+
+  GLuint mVertexArrayObj;
+  GLuint mVertexBufferObj;
+  GLuint mIndexBufferObj;
+  GLuint mInstanceBufferObj;
+  size_t mMaxVertices;
+  size_t mMaxIndices;
+  size_t mMaxInstances;
+  // Write cursors into the streaming buffers, reset when they are orphaned
+  size_t mVertexOffset;
+  size_t mIndexOffset;
+  size_t mInstanceOffset;
+
+  GLuint mBoundPipeline;
+  std::map<GLuint, GLuint> mInstancedPipelines;
+  // Mesh vertex array -> the one used to draw it instanced
+  std::map<GLuint, GLuint> mInstancedVertexArrays;
+  std::map<GLuint, std::vector<Item>> mItems;
+  std::vector<GLfloat> mVertexScratch;
+  std::vector<GLuint> mIndexScratch;
+
+  DynamicBatchThresholds mThresholds;
+  // Running averages of the measured CPU costs in nanoseconds
+  double mDrawCostNs;
+  double mVertexCostNs;
+};
+
+#endif // !DYNAMIC_BATCHER_HPP
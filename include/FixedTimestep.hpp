@@ -0,0 +1,33 @@
+#ifndef FIXED_TIMESTEP_HPP
+#define FIXED_TIMESTEP_HPP
+
+#include <cstdint>
+
+// Hands out real time in fixed simulation steps. The leftover fraction of
+// a step is used to interpolate between the last two simulation states
+// when rendering.
+class FixedTimestep {
+
+public:
+  explicit FixedTimestep(double stepSeconds = 1.0 / 60.0, int maxSteps = 8);
+
+  // Adds elapsed real time and returns how many steps to simulate. Time
+  // beyond maxSteps is dropped so a long stall does not snowball.
+  int Advance(double elapsedSeconds);
+  // How far between the previous and the current state to render, 0 to 1
+  float Alpha() const;
+
+  double StepSeconds() const { return mStepSeconds; }
+  uint64_t StepCount() const { return mStepCount; }
+  // Simulation time of the state being rendered, for analytic animation
+  double RenderSeconds() const;
+  double SecondsToNextStep() const { return mStepSeconds - mAccumulator; }
+
+private:
+  double mStepSeconds;
+  int mMaxSteps;
+  double mAccumulator = 0.0;
+  uint64_t mStepCount = 0;
+};
+
+#endif // !FIXED_TIMESTEP_HPP
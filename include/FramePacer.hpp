@@ -0,0 +1,78 @@
+#ifndef FRAME_PACER_HPP
+#define FRAME_PACER_HPP
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+
+#include "TimingSummary.hpp"
+
+enum VsyncMode { kVsyncOff, kVsyncOn, kVsyncAdaptive };
+
+// off, on or adaptive
+bool ParseVsyncMode(const char *name, VsyncMode *mode);
+
+struct FramePacerSettings {
+  VsyncMode mVsync = kVsyncOn;
+  // Frame rate cap, 0 for none. With vsync on and no cap the swap alone
+  // paces frames.
+  double mMaxFps = 0.0;
+  // Holds back the start of each frame so its work ends just before the
+  // next present, instead of finishing early and waiting in the swap queue.
+  // Needs vsync or a cap to know when that is, and is ignored without.
+  bool mJustInTime = false;
+};
+
+struct FramePacingStats {
+  // Present to present intervals
+  TimingSummary mFrameMs;
+  double mFrameStdDevMs = 0.0;
+  // Time spent waiting in the limiter per frame
+  double mMeanWaitMs = 0.0;
+  // How far past the target the waits woke up
+  TimingSummary mWakeErrorMs;
+};
+
+// Paces the main loop: BeginFrame waits for the frame's start time with a
+// sleep followed by a short spin, and EndFrame schedules the next one
+class FramePacer {
+
+public:
+  // Needs the window's context current to set the swap interval
+  void Initialize(SDL_Window *window, const FramePacerSettings &settings);
+  void BeginFrame();
+  // Call right before the swap, which may block on vsync and should not
+  // count as the frame's work
+  void BeforeSwap();
+  // Call right after the swap
+  void EndFrame();
+  // Call instead of BeforeSwap and EndFrame when nothing was drawn. The
+  // idle gap is left out of the frame times.
+  void FrameSkipped();
+
+  FramePacingStats GetStats() const;
+  void PrintStats() const;
+
+private:
+  void WaitUntil(uint64_t targetNs);
+
+  FramePacerSettings mSettings;
+  // 0 when frames are not limited
+  uint64_t mPeriodNs = 0;
+  // Set when mPeriodNs follows the measured vsync interval
+  bool mTrackRefresh = false;
+  uint64_t mDeadlineNs = 0;
+  uint64_t mWorkStartNs = 0;
+  uint64_t mLastPresentNs = 0;
+  // Worst recent frame work, decaying, for just-in-time starts
+  double mPredictedWorkNs = 0.0;
+  // How early sleeping stops to spin, grown when the OS oversleeps
+  double mSpinMarginNs = 1.0e6;
+
+  std::vector<double> mFrameMs;
+  std::vector<double> mWaitMs;
+  std::vector<double> mWakeErrorMs;
+  size_t mSamples = 0;
+};
+
+#endif // !FRAME_PACER_HPP
@@ -0,0 +1,18 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+// Six normalized planes (left, right, bottom, top, near, far) pointing inward
+struct Frustum {
+  glm::vec4 planes[6];
+};
+
+Frustum ExtractFrustum(const glm::mat4 &viewProjection);
+
+bool FrustumIntersectsSphere(const Frustum &frustum, const glm::vec3 &center,
+                             float radius);
+bool FrustumIntersectsAabb(const Frustum &frustum, const glm::vec3 &min,
+                           const glm::vec3 &max);
+
+#endif // !FRUSTUM_HPP
@@ -0,0 +1,71 @@
+#ifndef GL_CALL_HPP
+#define GL_CALL_HPP
+
+#include <glad/glad.h>
+
+// How much GL error checking gets compiled in. Every glGetError can force
+// the driver to sync, so release builds drop it entirely.
+//   OFF      no checks, a no-error context is requested
+//   SAMPLED  GLCheckPoint() drains errors once per frame or pass
+//   PER_CALL GLCheck(x) checks each wrapped call with file/line attribution
+//            and KHR_debug output is enabled when available
+#define GL_CHECK_MODE_OFF 0
+#define GL_CHECK_MODE_SAMPLED 1
+#define GL_CHECK_MODE_PER_CALL 2
+
+#ifndef GL_CHECK_MODE
+#ifdef NDEBUG
+#define GL_CHECK_MODE GL_CHECK_MODE_OFF
+#else
+#define GL_CHECK_MODE GL_CHECK_MODE_PER_CALL
+#endif
+#endif
+
+// Runtime mode, can only lower what was compiled in
+int GLGetCheckMode();
+void GLSetCheckMode(int mode);
+// Parses "off", "sampled" or "call", returns false for anything else
+bool GLParseCheckMode(const char *name, int *mode);
+
+// Context attributes for the runtime mode, call after GLSetCheckMode and
+// before creating the context
+void GLConfigureContext();
+// Hooks up KHR_debug output when running per call checks
+void GLInstallDebugOutput();
+
+void GLClearAllErrors();
+bool GLCheckErrorStatus(const char *function, const char *file, int line);
+
+#if GL_CHECK_MODE == GL_CHECK_MODE_OFF
+
+#define GLCheck(x)                                                             \
+  do {                                                                         \
+    x;                                                                         \
+  } while (0)
+#define GLCheckPoint(label)                                                    \
+  do {                                                                         \
+  } while (0)
+
+#else
+
+#define GLCheck(x)                                                             \
+  do {                                                                         \
+    if (GLGetCheckMode() == GL_CHECK_MODE_PER_CALL) {                          \
+      GLClearAllErrors();                                                      \
+    }                                                                          \
+    x;                                                                         \
+    if (GLGetCheckMode() == GL_CHECK_MODE_PER_CALL) {                          \
+      GLCheckErrorStatus(#x, __FILE__, __LINE__);                              \
+    }                                                                          \
+  } while (0)
+
+#define GLCheckPoint(label)                                                    \
+  do {                                                                         \
+    if (GLGetCheckMode() >= GL_CHECK_MODE_SAMPLED) {                           \
+      GLCheckErrorStatus(label, __FILE__, __LINE__);                           \
+    }                                                                          \
+  } while (0)
+
+#endif
+
+#endif // !GL_CALL_HPP
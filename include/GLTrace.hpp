@@ -0,0 +1,41 @@
+#ifndef GL_TRACE_HPP
+#define GL_TRACE_HPP
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+// Records the GL calls the renderer issues into a compact binary trace that
+// GLTraceReplay can reissue on its own. Recording hooks glad's function
+// pointers, so it must begin after gladLoadGLLoader and before any resources
+// are created. Frames before firstFrame only keep resource setup (draws and
+// clears are dropped), frames [firstFrame, firstFrame + frameCount) are kept
+// whole and the trace is written when the last one ends.
+//
+// Covered: buffers (including mapped writes), vertex arrays, shaders,
+// programs, program pipelines, uniforms, basic state, clears and draws.
+// Queries, transform feedback and textures are not recorded, so textured
+// draws replay sampling whatever the replay context has bound.
+bool GLTraceBegin(const std::string &path, int firstFrame, int frameCount);
+// Records the sources a program loaded through glProgramBinary was built
+// from. Replay relinks it from them when its driver rejects the binary.
+// Does nothing unless recording.
+void GLTraceProgramSources(GLuint program, const std::string &vertexShaderSrc,
+                           const std::string &fragmentShaderSrc);
+// Call once per frame right before swapping
+void GLTraceFrameEnd();
+bool GLTraceIsRecording();
+
+struct GLTraceReplayStats {
+  int mFrames = 0;
+  double mSetupMs = 0.0;
+  // CPU time to issue each replayed frame, including its final glFinish
+  std::vector<double> mFrameMs;
+};
+
+// Replays a trace against the current context. Setup runs once, the
+// captured frames run loops times back to back.
+bool GLTraceReplay(const std::string &path, int loops,
+                   GLTraceReplayStats *stats);
+
+#endif // !GL_TRACE_HPP
@@ -0,0 +1,63 @@
+#ifndef GEOMETRY_CACHE_HPP
+#define GEOMETRY_CACHE_HPP
+
+#include "Mesh.hpp"
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <unordered_map>
+#include <vector>
+
+struct GeometryCacheStats {
+  // Meshes holding a reference, and the distinct geometry they share
+  size_t mMeshes = 0;
+  size_t mGeometries = 0;
+  // GPU bytes of the shared buffers, and what copies would have added
+  size_t mBytes = 0;
+  size_t mBytesSaved = 0;
+};
+
+// Shares buffers and vertex arrays between meshes with identical vertex and
+// index data. Geometry is looked up by a hash of its contents and layout,
+// then compared in full, so equal meshes from anywhere collapse into one
+// upload. The last Release deletes the GL objects.
+//
+// Meshes whose vertex array gets per-mesh state attached, like the instance
+// buffer of a GpuCuller, need a MeshCreate of their own.
+class GeometryCache {
+
+public:
+  GeometryCache() = default;
+
+  // Fills in mesh's buffers, vertex array, index count and bounds from
+  // data, uploading it only if no identical geometry is alive
+  void Acquire(Mesh3D *mesh, const MeshData &data);
+  // Drops mesh's reference and clears its buffers
+  void Release(Mesh3D *mesh);
+  // Deletes everything still referenced
+  void Destroy();
+
+  GeometryCacheStats GetStats() const { return mStats; }
+
+private:
+  struct Geometry {
+    // Compared on a hash match; the hash alone could collide
+    MeshData mData;
+    uint64_t mHash = 0;
+    // Holds the GL names
+    Mesh3D mMesh;
+    size_t mBytes = 0;
+    int mReferences = 0;
+  };
+
+  std::vector<Geometry> mGeometries;
+  // Slots of released geometry, reused before growing mGeometries
+  std::vector<size_t> mFree;
+  // Content hash -> indices into mGeometries
+  std::unordered_multimap<uint64_t, size_t> mLookup;
+  // Vertex array -> index into mGeometries, for Release
+  std::unordered_map<GLuint, size_t> mByVertexArray;
+  GeometryCacheStats mStats;
+};
+
+#endif // !GEOMETRY_CACHE_HPP
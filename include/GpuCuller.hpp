@@ -0,0 +1,63 @@
+#ifndef GPU_CULLER_HPP
+#define GPU_CULLER_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Layout expected by glDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+  GLuint count;
+  GLuint instanceCount;
+  GLuint firstIndex;
+  GLint baseVertex;
+  GLuint baseInstance;
+};
+
+// Culls instances on the GPU and draws the survivors without reading anything
+// back. A rasterizer-discard pass tests each instance's bounding sphere
+// against the frustum, captures the visible ones with transform feedback,
+// and the number written becomes the instanceCount of an indirect draw.
+class GpuCuller {
+
+public:
+  GpuCuller();
+
+  // Builds the culling program and buffers for up to maxInstances
+  bool Create(GLuint maxInstances);
+  void Destroy();
+
+  // Instances are xyz = world position, w = uniform scale
+  void SetInstances(const std::vector<glm::vec4> &instances);
+  // Index count of the mesh drawn per instance and its unscaled radius
+  void SetMesh(GLuint indexCount, float boundingRadius);
+
+  // Sources the culled instances as a per-instance attribute of a VAO
+  void AttachInstanceAttribute(GLuint vertexArrayObj, GLuint location) const;
+
+  void Cull(const glm::mat4 &viewProjection);
+  // Caller binds the instanced program before drawing
+  void Draw(GLuint vertexArrayObj) const;
+
+  // The DrawElementsIndirectCommand filled in by Cull
+  GLuint GetIndirectBuffer() const { return mIndirectBuffer; }
+
+private:
+  GLuint mProgram;
+  GLuint mInstanceBuffer;
+  GLuint mCulledBuffer;
+  GLuint mIndirectBuffer;
+  GLuint mCullVertexArray;
+  GLuint mTransformFeedback;
+  GLuint mPrimitivesQuery;
+
+  GLuint mMaxInstances;
+  GLuint mInstanceCount;
+  float mBoundingRadius;
+
+  // Instances tested by the last Cull whose survivor count has not been
+  // read for the render stats yet
+  GLuint mPendingStats;
+};
+
+#endif // !GPU_CULLER_HPP
@@ -0,0 +1,20 @@
+#ifndef HASH_HPP
+#define HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+static const uint64_t kHashSeed = 0xcbf29ce484222325ull;
+
+// 64 bit FNV-1a, pass a previous result as seed to hash several pieces
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed = kHashSeed);
+uint64_t HashString(const std::string &text, uint64_t seed = kHashSeed);
+// Eight bytes a step, for large buffers such as vertex data. Gives other
+// values than HashBytes.
+uint64_t HashWords(const void *data, size_t size, uint64_t seed = kHashSeed);
+
+// Fixed width lowercase hex, handy for cache file names
+std::string HashToHex(uint64_t hash);
+
+#endif // !HASH_HPP
@@ -0,0 +1,33 @@
+#ifndef HEADLESS_CONTEXT_HPP
+#define HEADLESS_CONTEXT_HPP
+
+#include <glad/glad.h>
+
+// GL 4.1 core context with no window or display, rendering into an
+// offscreen framebuffer. Uses EGL on Linux (surfaceless where the driver
+// has it, a pbuffer otherwise), which also covers Mesa's llvmpipe on
+// machines without a GPU. Create returns false on other platforms.
+class HeadlessContext {
+
+public:
+  ~HeadlessContext();
+
+  // Creates the context, makes it current, loads glad and binds the
+  // offscreen framebuffer
+  bool Create(int width, int height);
+  void Destroy();
+
+  GLuint GetFramebuffer() const { return mFramebuffer; }
+
+private:
+  bool CreateFramebuffer(int width, int height);
+
+  void *mDisplay = nullptr;
+  void *mContext = nullptr;
+  void *mSurface = nullptr;
+  GLuint mFramebuffer = 0;
+  GLuint mColorBuffer = 0;
+  GLuint mDepthBuffer = 0;
+};
+
+#endif // !HEADLESS_CONTEXT_HPP
@@ -0,0 +1,62 @@
+#ifndef IMAGE_HPP
+#define IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum ImageFormat {
+  kImageRgba8,
+  kImageRgba16f,
+  // S3TC / BCn blocks of 4x4 pixels
+  kImageBc1,
+  kImageBc2,
+  kImageBc3
+};
+
+struct ImageLevel {
+  int mWidth = 0;
+  int mHeight = 0;
+  size_t mOffset = 0;
+  size_t mSize = 0;
+};
+
+// Decoded pixels, or compressed blocks, for every mip level the file
+// provides. Rows are stored top to bottom, as in the files.
+struct Image {
+  ImageFormat mFormat = kImageRgba8;
+  // Set when the container says the data is sRGB encoded
+  bool mSrgb = false;
+  std::vector<ImageLevel> mLevels;
+  std::vector<uint8_t> mData;
+
+  int Width() const { return mLevels.empty() ? 0 : mLevels[0].mWidth; }
+  int Height() const { return mLevels.empty() ? 0 : mLevels[0].mHeight; }
+};
+
+bool ImageFormatIsCompressed(ImageFormat format);
+// Bytes of a width x height level, whole blocks for compressed formats
+size_t ImageLevelSize(ImageFormat format, int width, int height);
+// Bytes of one row of pixels, or of one row of 4x4 blocks
+size_t ImageRowSize(ImageFormat format, int width);
+// Pixel rows covered by one row as counted by ImageRowSize
+int ImageRowHeight(ImageFormat format);
+
+// Widest and tallest image decoded unless the caller says otherwise
+const int kImageMaxSize = 1 << 14;
+
+// PNG, TGA and Radiance HDR decode to a single level; KTX (version 1) and
+// DDS keep the mips they were saved with. The format is taken from the
+// contents, not the name. Images wider or taller than maxSize are rejected
+// before their pixels are allocated.
+bool DecodeImage(const uint8_t *data, size_t size, Image *image,
+                 std::string *error, int maxSize = kImageMaxSize);
+bool LoadImage(const std::string &path, Image *image, std::string *error,
+               int maxSize = kImageMaxSize);
+
+// Writes every level as a KTX (version 1) file that LoadImage reads back
+// unchanged
+bool SaveKtx(const std::string &path, const Image &image, std::string *error);
+
+#endif // !IMAGE_HPP
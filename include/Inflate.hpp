@@ -0,0 +1,17 @@
+#ifndef INFLATE_HPP
+#define INFLATE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decompresses a raw DEFLATE stream (RFC 1951), appending to out
+bool Inflate(const uint8_t *data, size_t size, std::vector<uint8_t> *out);
+
+// Decompresses a zlib stream (RFC 1950) as found in PNG IDAT chunks and
+// checks its Adler-32. Fails once the stream would append more than maxSize
+// bytes.
+bool ZlibDecompress(const uint8_t *data, size_t size,
+                    std::vector<uint8_t> *out, size_t maxSize);
+
+#endif // !INFLATE_HPP
@@ -0,0 +1,41 @@
+#ifndef INPUT_QUEUE_HPP
+#define INPUT_QUEUE_HPP
+
+#include <SDL2/SDL.h>
+#include <cstdint>
+
+// Everything the user did since the previous latch
+struct InputFrame {
+  int mMouseDeltaX = 0;
+  int mMouseDeltaY = 0;
+  bool mQuit = false;
+  // The window was exposed, resized or otherwise needs a redraw
+  bool mWindowChanged = false;
+  int mEventCount = 0;
+  // Steady clock times in nanoseconds, see InputNowNs. mOldestEventNs is 0
+  // when no event arrived.
+  uint64_t mOldestEventNs = 0;
+  uint64_t mLatchNs = 0;
+  // SDL's keyboard state as of the latch
+  const Uint8 *mKeys = nullptr;
+};
+
+// Collects SDL events with the time they were queued, so the camera can be
+// latched from them as late as possible before the frame is submitted
+class InputQueue {
+
+public:
+  // Folds pending events into the current frame
+  void Pump();
+  // Pumps once more and returns everything since the last latch
+  InputFrame Latch();
+  // Sleeps until an event is queued or timeoutMs passes
+  void Wait(int timeoutMs);
+
+private:
+  InputFrame mPending;
+};
+
+uint64_t InputNowNs();
+
+#endif // !INPUT_QUEUE_HPP
@@ -0,0 +1,49 @@
+#ifndef LATENCY_TRACKER_HPP
+#define LATENCY_TRACKER_HPP
+
+#include <glad/glad.h>
+#include <vector>
+
+#include "InputQueue.hpp"
+#include "TimingSummary.hpp"
+
+struct LatencyStats {
+  // From the oldest input event of a frame to the GPU finishing that frame
+  TimingSummary mInputToPresentMs;
+  // From the oldest input event to the camera being latched
+  TimingSummary mInputToLatchMs;
+  // From the latch to the GPU finishing, which late latching keeps short
+  TimingSummary mLatchToPresentMs;
+};
+
+// Measures input-to-present latency with a GL timestamp written after each
+// swap. The GPU time is mapped onto the steady clock, and the queries are
+// read frames later without waiting on them. Scanout is not included.
+class LatencyTracker {
+
+public:
+  // Call right after the swap of the frame that used input
+  void FrameSwapped(const InputFrame &input);
+  LatencyStats GetStats() const;
+  void PrintStats() const;
+  void Destroy();
+
+private:
+  struct PendingFrame {
+    GLuint mQuery;
+    uint64_t mOldestEventNs;
+    uint64_t mLatchNs;
+  };
+
+  void Collect();
+
+  std::vector<PendingFrame> mPending;
+  std::vector<GLuint> mFreeQueries;
+  int64_t mGpuToCpuNs = 0;
+  bool mCalibrated = false;
+  std::vector<double> mInputToPresentMs;
+  std::vector<double> mInputToLatchMs;
+  std::vector<double> mLatchToPresentMs;
+};
+
+#endif // !LATENCY_TRACKER_HPP
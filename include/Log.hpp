@@ -0,0 +1,188 @@
+#ifndef LOG_HPP
+#define LOG_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Asynchronous logging. A call packs its arguments into a binary record in
+// a ring owned by the calling thread (no locks, no formatting, no I/O); a
+// writer thread formats and writes the records. A full ring drops records
+// instead of waiting. Messages use {} placeholders:
+//
+//   LOG_INFO(kLogShader, "Reloaded {} in {} ms", name, ms);
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO 2
+#define LOG_LEVEL_WARNING 3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_OFF 5
+
+// Calls below this level are compiled out
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+#endif
+
+enum LogCategory : uint8_t {
+  kLogCore,
+  kLogInput,
+  kLogRender,
+  kLogShader,
+  kLogGL,
+  kLogAsset,
+  kLogCategoryCount
+};
+
+// Also writes to path when given. Without a call the writer starts with
+// the first record and only writes to stdout.
+void LogStart(const std::string &path = "");
+// Writes out everything queued and joins the writer
+void LogStop();
+
+// Runtime filters, on top of LOG_MIN_LEVEL
+void LogSetLevel(int level);
+// trace, debug, info, warning, error or off
+bool LogParseLevel(const char *name, int *level);
+void LogSetCategoryEnabled(LogCategory category, bool enabled);
+bool LogEnabled(int level, LogCategory category);
+// Records lost to full rings
+uint64_t LogGetDroppedCount();
+
+class LogRecord {
+
+public:
+  LogRecord(int level, LogCategory category, uint32_t suppressed,
+            const char *format);
+
+  void AddSigned(int64_t value);
+  void AddUnsigned(uint64_t value);
+  void AddDouble(double value);
+  void AddBool(bool value);
+  void AddString(const char *value);
+  void AddPointer(const void *value);
+
+  // Copies the record into this thread's ring
+  void Commit();
+
+private:
+  void Append(char tag, const void *data, size_t size);
+
+  char mData[2048];
+  // End of the last argument that fit
+  size_t mSize;
+  bool mTruncated;
+};
+
+template <typename T> void LogAppend(LogRecord &record, const T &value) {
+  using Type = std::decay_t<T>;
+  if constexpr (std::is_same_v<Type, bool>) {
+    record.AddBool(value);
+  } else if constexpr (std::is_integral_v<Type> && std::is_signed_v<Type>) {
+    record.AddSigned(value);
+  } else if constexpr (std::is_integral_v<Type>) {
+    record.AddUnsigned(value);
+  } else if constexpr (std::is_enum_v<Type>) {
+    record.AddSigned((int64_t)value);
+  } else if constexpr (std::is_floating_point_v<Type>) {
+    record.AddDouble(value);
+  } else if constexpr (std::is_same_v<Type, std::string>) {
+    record.AddString(value.c_str());
+  } else if constexpr (std::is_convertible_v<Type, const char *>) {
+    record.AddString(value);
+  } else if constexpr (std::is_same_v<Type, const unsigned char *> ||
+                       std::is_same_v<Type, unsigned char *>) {
+    // glGetString results
+    record.AddString((const char *)value);
+  } else {
+    static_assert(std::is_pointer_v<Type>, "Type cannot be logged");
+    record.AddPointer(value);
+  }
+}
+
+template <typename... Args>
+void LogWrite(int level, LogCategory category, uint32_t suppressed,
+              const char *format, const Args &...args) {
+  LogRecord record(level, category, suppressed, format);
+  (LogAppend(record, args), ...);
+  record.Commit();
+}
+
+// Lets one record through per interval, counting the ones it holds back
+class LogRateLimit {
+
+public:
+  explicit LogRateLimit(uint32_t intervalMs) : mIntervalMs(intervalMs) {}
+
+  // On success suppressed gets how many were held back since the last one
+  bool Allow(uint32_t *suppressed);
+
+private:
+  uint32_t mIntervalMs;
+  std::atomic<uint64_t> mNextNs{0};
+  std::atomic<uint32_t> mSuppressed{0};
+};
+
+#define LOG_AT(level, category, ...)                                           \
+  do {                                                                         \
+    if (LogEnabled(level, category)) {                                         \
+      LogWrite(level, category, 0, __VA_ARGS__);                               \
+    }                                                                          \
+  } while (0)
+
+// At most one record per intervalMs from this call site
+#define LOG_RATE_LIMITED(level, category, intervalMs, ...)                     \
+  do {                                                                         \
+    static LogRateLimit logRateLimit(intervalMs);                              \
+    uint32_t logSuppressed = 0;                                                \
+    if ((level) >= LOG_MIN_LEVEL && LogEnabled(level, category) &&            \
+        logRateLimit.Allow(&logSuppressed)) {                                  \
+      LogWrite(level, category, logSuppressed, __VA_ARGS__);                   \
+    }                                                                          \
+  } while (0)
+
+// Arguments are still type checked but never evaluated, and the call is
+// dead code for the compiler to drop
+#define LOG_DISABLED(category, ...)                                            \
+  do {                                                                         \
+    if (false) {                                                               \
+      LogWrite(LOG_LEVEL_OFF, category, 0, __VA_ARGS__);                       \
+    }                                                                          \
+  } while (0)
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_TRACE
+#define LOG_TRACE(category, ...) LOG_AT(LOG_LEVEL_TRACE, category, __VA_ARGS__)
+#else
+#define LOG_TRACE(category, ...) LOG_DISABLED(category, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(category, ...) LOG_AT(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#else
+#define LOG_DEBUG(category, ...) LOG_DISABLED(category, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(category, ...) LOG_AT(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#else
+#define LOG_INFO(category, ...) LOG_DISABLED(category, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_WARNING
+#define LOG_WARNING(category, ...)                                             \
+  LOG_AT(LOG_LEVEL_WARNING, category, __VA_ARGS__)
+#else
+#define LOG_WARNING(category, ...) LOG_DISABLED(category, __VA_ARGS__)
+#endif
+
+#if LOG_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(category, ...) LOG_AT(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+#else
+#define LOG_ERROR(category, ...) LOG_DISABLED(category, __VA_ARGS__)
+#endif
+
+#endif // !LOG_HPP
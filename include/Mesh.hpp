@@ -0,0 +1,85 @@
+#ifndef MESH_HPP
+#define MESH_HPP
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+class TextureManager;
+
+struct Transform {
+  glm::vec3 translation;
+};
+
+// CPU side copy of a mesh: xyz positions, rgb colors and triangle indices
+struct MeshData {
+  std::vector<GLfloat> positions;
+  std::vector<GLfloat> colors;
+  std::vector<GLuint> indices;
+  // Optional uv per vertex
+  std::vector<GLfloat> texcoords;
+};
+
+struct Mesh3D {
+  // VAO
+  GLuint mVertexArrayObj = 0;
+  // VBO
+  GLuint mVertexBufferObj = 0;
+  GLuint mVertexBufferObj2 = 0;
+  GLuint mTexcoordBufferObj = 0;
+
+  GLuint mIndexBufferObj = 0;
+  GLuint mIndexBufferObj2 = 0;
+  GLsizei mIndexCount = 0;
+  // Farthest vertex from the origin, in model space
+  float mBoundsRadius = 0.0f;
+
+  GLuint mPipeline = 0;
+  // Program pipeline object and the vertex stage holding its uniforms, used
+  // instead of mPipeline when set
+  GLuint mProgramPipeline = 0;
+  GLuint mVertexStage = 0;
+
+  // Bound to unit 0 when set, for programs built with TEXTURED
+  GLuint mTexture = 0;
+  GLuint mSampler = 0;
+  // Streamed texture, mTexture is refreshed from it on every draw
+  TextureManager *mTextureManager = nullptr;
+  uint32_t mTextureHandle = 0;
+
+  Transform mTransform;
+  float m_uRotate = 0.0f;
+  float m_uScale = 0.5f;
+  // Spin about y, advanced by MeshSimulate
+  float mSpinDegreesPerSecond = -6.0f;
+
+  // State before the last simulation step, for interpolated drawing
+  Transform mPrevTransform;
+  float mPrevRotate = 0.0f;
+};
+
+// The two triangle quad used by the demo scene
+MeshData MeshQuadData();
+
+void MeshCreate(Mesh3D *mesh);
+void MeshCreate(Mesh3D *mesh, const MeshData &data);
+void MeshDelete(Mesh3D *mesh);
+void MeshSetPipeline(Mesh3D *mesh, GLuint pipeline);
+void MeshSetProgramPipeline(Mesh3D *mesh, GLuint programPipeline,
+                            GLuint vertexStage);
+// Draws with a texture of the manager, which streams the levels the
+// mesh's size on screen needs
+void MeshSetTexture(Mesh3D *mesh, TextureManager *textures, uint32_t handle,
+                    GLuint sampler);
+
+// Model tansformation from the mesh's translation, rotation and scale
+glm::mat4 MeshModelMatrix(const Mesh3D *mesh);
+// Same, alpha of the way from the previous simulation state to the current
+glm::mat4 MeshModelMatrix(const Mesh3D *mesh, float alpha);
+
+// Keeps the current state for interpolation and advances the mesh by one
+// fixed simulation step
+void MeshSimulate(Mesh3D *mesh, float seconds);
+
+#endif // !MESH_HPP
@@ -0,0 +1,90 @@
+#ifndef PIPELINE_COMPILER_HPP
+#define PIPELINE_COMPILER_HPP
+
+#include "ProgramBinaryCache.hpp"
+
+#include <SDL2/SDL.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <glad/glad.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compiles programs without stalling the frame. Every queued compile and
+// link is issued before any status is asked for, and with
+// GL_KHR_parallel_shader_compile only finished programs are checked. With a
+// worker started, compiles happen on a second context sharing objects with
+// the main one. Callers keep drawing with a fallback program until their
+// ready callback runs on the main thread from Poll().
+class PipelineCompiler {
+
+public:
+  // program is 0 when the build failed
+  using ReadyCallback = std::function<void(GLuint program)>;
+
+  // cache is also used from the worker thread, next to the main thread's
+  // own use of it
+  explicit PipelineCompiler(ProgramBinaryCache *cache = nullptr);
+  ~PipelineCompiler();
+
+  // Creates a hidden window and shared context and compiles on a thread.
+  // Call from the main thread with the main context current.
+  bool StartWorker(SDL_Window *window);
+  void StopWorker();
+
+  void Submit(const std::string &name, const std::string &vertexShaderSrc,
+              const std::string &fragmentShaderSrc, ReadyCallback onReady);
+
+  // Issues queued work and runs callbacks for finished programs, never waits
+  // on the driver when it can report completion. Returns the jobs pending.
+  size_t Poll();
+  // Blocks until every submitted program is done
+  void Finish();
+  // Programs handed to their callbacks so far, so callers can tell when
+  // something new arrived
+  uint64_t GetDeliveredCount() const { return mDelivered; }
+
+private:
+  struct Job {
+    std::string mName;
+    std::string mVertexShaderSrc;
+    std::string mFragmentShaderSrc;
+    ReadyCallback mOnReady;
+    GLuint mVertexShader = 0;
+    GLuint mFragmentShader = 0;
+    GLuint mProgram = 0;
+    bool mFromCache = false;
+    bool mLinked = false;
+    std::string mLog;
+  };
+
+  void Issue(std::vector<Job> &jobs);
+  bool IsComplete(const Job &job) const;
+  void Resolve(Job &job);
+  void Complete(Job &job);
+  void WorkerMain();
+
+  // Used from the worker thread too, the cache serializes itself
+  ProgramBinaryCache *mCache;
+
+  // Main thread only
+  std::vector<Job> mQueued;
+  std::vector<Job> mIssued;
+  uint64_t mDelivered = 0;
+
+  // Worker hand-off
+  std::thread mWorker;
+  SDL_Window *mWorkerWindow;
+  SDL_GLContext mWorkerContext;
+  std::mutex mMutex;
+  std::condition_variable mWake;
+  std::vector<Job> mWorkerQueue;
+  std::vector<Job> mWorkerDone;
+  size_t mWorkerPending;
+  bool mStopWorker;
+};
+
+#endif // !PIPELINE_COMPILER_HPP
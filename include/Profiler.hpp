@@ -0,0 +1,69 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Hierarchical CPU and GPU frame timing. CPU scopes are written to a buffer
+// owned by the calling thread, so markers never take a lock. GPU scopes
+// bracket their commands with GL_TIMESTAMP queries that sit in a ring a few
+// frames deep and are only read once the driver reports them available, so
+// reading never stalls. Off until ProfilerSetEnabled(true).
+
+void ProfilerSetEnabled(bool enabled);
+bool ProfilerIsEnabled();
+// Names the calling thread in traces, the string must outlive the profiler
+void ProfilerSetThreadName(const char *name);
+
+// Once per frame on the GL thread after swapping: collects finished GPU
+// queries and folds the frame into the rolling stats
+void ProfilerEndFrame();
+
+struct ProfileStat {
+  std::string mName;
+  // Per frame, over the last stats window
+  double mCalls = 0.0;
+  double mCpuMs = 0.0;
+  double mCpuMaxMs = 0.0;
+  double mGpuMs = 0.0;
+};
+
+// Published once every window of frames, sorted by name
+std::vector<ProfileStat> ProfilerGetStats();
+void ProfilerPrintStats();
+
+// Writes what the buffers still hold in the Chrome trace event format, for
+// chrome://tracing or Perfetto. Other threads should be idle while it runs.
+bool ProfilerWriteChromeTrace(const std::string &path);
+
+class ProfileScope {
+
+public:
+  explicit ProfileScope(const char *name);
+  ~ProfileScope();
+
+private:
+  const char *mName;
+  uint64_t mStartNs;
+};
+
+class GpuProfileScope {
+
+public:
+  explicit GpuProfileScope(const char *name);
+  ~GpuProfileScope();
+
+private:
+  bool mActive;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Names are kept by pointer, pass string literals
+#define PROFILE_SCOPE(name)                                                    \
+  ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_GPU_SCOPE(name)                                                \
+  GpuProfileScope PROFILE_CONCAT(gpuProfileScope, __LINE__)(name)
+
+#endif // !PROFILER_HPP
@@ -0,0 +1,60 @@
+#ifndef PROGRAM_BINARY_CACHE_HPP
+#define PROGRAM_BINARY_CACHE_HPP
+
+#include <glad/glad.h>
+#include <mutex>
+#include <string>
+
+// Keeps linked program binaries on disk so later launches skip the driver
+// compiler. Entries are keyed by the shader sources, defines and the driver's
+// vendor/renderer/version strings; a binary the driver rejects falls back to
+// compiling from source and replaces the stale entry.
+//
+// After Initialize, any thread with a current context may call it; the
+// main thread and the PipelineCompiler worker do at the same time. File
+// access and the counters are serialized, compiling and linking are not.
+class ProgramBinaryCache {
+
+public:
+  explicit ProgramBinaryCache(const std::string &directory);
+
+  // Must be called with a current context, before the first CreateProgram
+  // and before any other thread uses the cache
+  void Initialize();
+
+  // Returns a linked program, loaded from the cache when possible
+  GLuint CreateProgram(const std::string &vertexShaderSrc,
+                       const std::string &fragmentShaderSrc,
+                       const std::string &defines = "");
+
+  // Split halves of CreateProgram for callers that compile on their own.
+  // LoadProgram returns 0 on a miss; programs passed to StoreProgram must
+  // have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+  GLuint LoadProgram(const std::string &vertexShaderSrc,
+                     const std::string &fragmentShaderSrc,
+                     const std::string &defines = "");
+  void StoreProgram(GLuint program, const std::string &vertexShaderSrc,
+                    const std::string &fragmentShaderSrc,
+                    const std::string &defines = "");
+  bool IsEnabled() const;
+
+  int GetHits() const;
+  int GetMisses() const;
+
+private:
+  std::string EntryPath(const std::string &vertexShaderSrc,
+                        const std::string &fragmentShaderSrc,
+                        const std::string &defines) const;
+  bool LoadBinary(GLuint program, const std::string &path) const;
+  void StoreBinary(GLuint program, const std::string &path) const;
+
+  std::string mDirectory;
+  std::string mDriverId;
+  bool mSupported;
+  // Guards the cache files and the counters
+  mutable std::mutex mMutex;
+  int mHits;
+  int mMisses;
+};
+
+#endif // !PROGRAM_BINARY_CACHE_HPP
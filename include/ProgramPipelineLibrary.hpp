@@ -0,0 +1,49 @@
+#ifndef PROGRAM_PIPELINE_LIBRARY_HPP
+#define PROGRAM_PIPELINE_LIBRARY_HPP
+
+#include "ShaderLibrary.hpp"
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Mix-and-match alternative to monolithic programs. Each stage is linked once
+// as a separable program and stages are combined in program pipeline
+// objects, so N vertex by M fragment shaders cost N + M links instead of
+// N * M. Uniforms belong to the stage programs, set them with
+// glProgramUniform* on the stage that declares them.
+class ProgramPipelineLibrary {
+
+public:
+  ProgramPipelineLibrary();
+
+  // Separable program for one stage, shared by every identical expansion.
+  // Returns 0 if the stage failed to build, and builds it again next call.
+  GLuint GetStage(GLenum stage, const std::string &path,
+                  const ShaderDefines &defines = {});
+  // Pipeline object for a pair of stages, created on first use
+  GLuint GetPipeline(GLuint vertexStage, GLuint fragmentStage);
+  // Builds stage from path and swaps it into pipeline with
+  // glUseProgramStages, leaving the other stage attached as it is. Returns
+  // the new stage, or 0 with pipeline unchanged if it failed to build.
+  GLuint ReplaceStage(GLuint pipeline, GLenum stage, const std::string &path,
+                      const ShaderDefines &defines = {});
+
+  void Clear();
+
+  size_t GetStageCount() const;
+  size_t GetPipelineCount() const;
+
+private:
+  // Stage enum and expanded source hash -> separable program
+  std::unordered_map<uint64_t, GLuint> mStages;
+  std::map<std::pair<GLuint, GLuint>, GLuint> mPipelines;
+  // Pipelines a ReplaceStage left with the same stages as another one
+  std::vector<GLuint> mUnkeyedPipelines;
+};
+
+#endif // !PROGRAM_PIPELINE_LIBRARY_HPP
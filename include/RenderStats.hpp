@@ -0,0 +1,48 @@
+#ifndef RENDER_STATS_HPP
+#define RENDER_STATS_HPP
+
+#include <cstdint>
+#include <string>
+
+// What the renderer asked the driver to do each frame. GL calls are counted
+// by hooking glad's function pointers, so every path is covered without
+// touching call sites; culling results are reported by the cullers.
+enum RenderStat {
+  kRenderStatDrawCalls,
+  kRenderStatInstances,
+  // Known for direct draws only, indirect draws keep their counts on the GPU
+  kRenderStatTriangles,
+  kRenderStatProgramBinds,
+  kRenderStatVertexArrayBinds,
+  kRenderStatTextureBinds,
+  kRenderStatUniformUploads,
+  kRenderStatBufferBytes,
+  kRenderStatBufferAllocations,
+  kRenderStatTextureAllocations,
+  kRenderStatCulledIn,
+  kRenderStatCulledOut,
+  kRenderStatCount
+};
+
+struct RenderStatsFrame {
+  uint64_t mFrame = 0;
+  uint64_t mValues[kRenderStatCount] = {};
+};
+
+// Installs the hooks, after gladLoadGLLoader and before GLTraceBegin so a
+// capture can unhook itself without removing these
+void RenderStatsEnable();
+bool RenderStatsIsEnabled();
+
+// For counts that are not GL calls, no-op while disabled
+void RenderStatsAdd(RenderStat stat, uint64_t amount);
+
+// Closes the frame: the counters move into the history and restart at zero
+void RenderStatsEndFrame();
+RenderStatsFrame RenderStatsGetLastFrame();
+const char *RenderStatName(RenderStat stat);
+
+// One row per frame still in the history, one column per stat
+bool RenderStatsWriteCsv(const std::string &path);
+
+#endif // !RENDER_STATS_HPP
@@ -0,0 +1,23 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include <glad/glad.h>
+
+#include "Camera.hpp"
+#include "Mesh.hpp"
+
+// Frame state and clear shared by the app and the benchmark
+void RenderBeginFrame(int width, int height);
+
+// Diameter in pixels of the mesh's bounding sphere, from the model, view
+// and projection matrices it is drawn with. 0 when the sphere is entirely
+// behind the camera, the viewport height when the camera is inside it.
+float MeshScreenSize(const Mesh3D *mesh, const glm::mat4 &model,
+                     const glm::mat4 &view, const glm::mat4 &projection);
+
+// Draws a mesh with its program (or program pipeline) and the camera's
+// view and projection, alpha of the way between its last two simulation
+// states
+void MeshDraw(Mesh3D *mesh, const Camera &camera, float alpha);
+
+#endif // !RENDERER_HPP
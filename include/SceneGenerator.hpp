@@ -0,0 +1,73 @@
+#ifndef SCENE_GENERATOR_HPP
+#define SCENE_GENERATOR_HPP
+
+#include "Mesh.hpp"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+enum SceneDistribution : uint32_t {
+  kSceneUniform = 0,
+  // Gaussian-ish blobs around a few centers
+  kSceneClustered,
+  // Evenly spaced lattice
+  kSceneGrid,
+};
+
+// Everything that shapes a generated scene. The same parameters always
+// produce the same scene, on any platform.
+struct SceneParams {
+  uint32_t mSeed = 1;
+  uint32_t mObjectCount = 1000;
+  uint32_t mUniqueMeshes = 8;
+  // Share of the static objects drawn through GPU culled instancing
+  float mInstancedFraction = 0.5f;
+  // Share of all objects animated every frame
+  float mMovingFraction = 0.1f;
+  uint32_t mDistribution = kSceneUniform;
+  // Half width of the volume objects are spread over
+  float mExtent = 50.0f;
+  // Objects stacked behind each other at every spot, raises overdraw
+  uint32_t mDepthLayers = 1;
+  // Distinct programs objects are spread over
+  uint32_t mShaderVariants = 1;
+};
+
+enum SceneObjectFlags : uint32_t {
+  kSceneObjectInstanced = 1 << 0,
+  kSceneObjectMoving = 1 << 1,
+};
+
+struct SceneObject {
+  uint32_t mMesh;
+  uint32_t mVariant;
+  uint32_t mFlags;
+  glm::vec3 mPosition;
+  float mScale;
+};
+
+struct Scene {
+  SceneParams mParams;
+  std::vector<MeshData> mMeshes;
+  // Bounding radius of each mesh around its origin
+  std::vector<float> mMeshRadii;
+  std::vector<SceneObject> mObjects;
+};
+
+void GenerateScene(const SceneParams &params, Scene *scene);
+
+// Binary scene files written by PracticeSceneGen, read by the app and the
+// benchmark
+bool SceneSave(const std::string &path, const Scene &scene);
+bool SceneLoad(const std::string &path, Scene *scene);
+
+// Reads one --name=value generator option into params, returns false if arg
+// is not one of them
+bool ParseSceneOption(const char *arg, SceneParams *params);
+
+// Sphere around every object, for placing cameras and far planes
+void SceneBounds(const Scene &scene, glm::vec3 *center, float *radius);
+
+#endif // !SCENE_GENERATOR_HPP
@@ -0,0 +1,74 @@
+#ifndef SCENE_RENDERER_HPP
+#define SCENE_RENDERER_HPP
+
+#include "Camera.hpp"
+#include "DynamicBatcher.hpp"
+#include "GeometryCache.hpp"
+#include "GpuCuller.hpp"
+#include "Mesh.hpp"
+#include "SceneGenerator.hpp"
+#include "ShaderLibrary.hpp"
+#include "StaticBatcher.hpp"
+#include "TexturePacker.hpp"
+
+#include <glad/glad.h>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+struct SceneDrawStats {
+  int mStaticChunks = 0;
+  int mInstanceGroups = 0;
+  int mDynamicDraws = 0;
+};
+
+// Draws a generated scene through the paths built for each kind of object:
+// static objects are merged by the StaticBatcher, static instanced objects
+// are culled and drawn by a GpuCuller per (mesh, variant), and moving
+// objects go through the DynamicBatcher every frame.
+//
+// Given packed textures, each static object gets one of them as its
+// material, the i-th object the slot i modulo their count. Objects whose
+// textures share an array still share a chunk.
+class SceneRenderer {
+
+public:
+  SceneRenderer();
+
+  // scene and materials must outlive the renderer
+  bool Create(const Scene *scene, ShaderLibrary *library,
+              const TexturePacker *materials = nullptr);
+  void Destroy();
+
+  // Places the moving objects at time seconds
+  void Update(float seconds);
+  // Whether Update moves anything, so the scene changes without input
+  bool IsAnimated() const { return !mMovingObjects.empty(); }
+  SceneDrawStats Draw(const Camera &camera);
+
+private:
+  struct InstanceGroup {
+    Mesh3D mMesh;
+    GpuCuller mCuller;
+    GLuint mProgram = 0;
+  };
+
+  const Scene *mScene;
+  // Per shader variant
+  std::vector<GLuint> mPrograms;
+  std::vector<GLuint> mTexturedPrograms;
+  std::vector<GLuint> mInstancedPrograms;
+  // Meshes the DynamicBatcher draws from, per (mesh, variant). Variants of
+  // one mesh, and meshes a scene repeats, share their buffers through
+  // mGeometry.
+  std::map<std::pair<uint32_t, uint32_t>, Mesh3D> mDynamicMeshes;
+  GeometryCache mGeometry;
+  std::vector<std::unique_ptr<InstanceGroup>> mInstanceGroups;
+  std::vector<size_t> mMovingObjects;
+  std::vector<glm::mat4> mMovingModels;
+  StaticBatcher mStaticBatcher;
+  DynamicBatcher mDynamicBatcher;
+};
+
+#endif // !SCENE_RENDERER_HPP
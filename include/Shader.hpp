@@ -0,0 +1,21 @@
+#ifndef SHADER_HPP
+#define SHADER_HPP
+
+#include <glad/glad.h>
+#include <string>
+
+// Reads a whole shader file into a string
+std::string LoadShaderAsString(const std::string &filename);
+
+// Creates and compiles a shader object of the given stage
+GLuint CompileShader(GLuint type, const std::string &source);
+
+GLuint CreateShaderProgram(const std::string &vertexShaderSrc,
+                           const std::string &fragmentShaderSrc);
+
+// Status queries wait for the driver to finish the object, so issue every
+// compile and link first and only ask once all of them are in flight
+bool ShaderCompiled(GLuint shader, std::string *log = nullptr);
+bool ProgramLinked(GLuint program, std::string *log = nullptr);
+
+#endif // !SHADER_HPP
@@ -0,0 +1,89 @@
+#ifndef SHADER_HOT_RELOAD_HPP
+#define SHADER_HOT_RELOAD_HPP
+
+#include "PipelineCompiler.hpp"
+#include "ProgramPipelineLibrary.hpp"
+#include "ShaderLibrary.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <glad/glad.h>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Rebuilds programs when their shader files change on disk. A thread watches
+// the directories holding every watched file and its includes (inotify on
+// Linux, timestamp polling elsewhere). Update() resubmits only the programs
+// depending on a changed file to the pipeline compiler, whose Poll() swaps
+// them in at the start of a frame. Saves that leave both expanded stages
+// as they were are skipped. A program that fails to build is reported and
+// the old one stays in use.
+//
+// Program pipelines reload per stage instead: only a stage whose expanded
+// source changed is rebuilt, on the main thread, and swapped into the
+// pipeline object while the other stage stays attached.
+class ShaderHotReload {
+
+public:
+  explicit ShaderHotReload(PipelineCompiler *compiler);
+  ~ShaderHotReload();
+
+  bool Start();
+  void Stop();
+  // Stops watching and deletes the rebuilt programs, call while the
+  // context is still current
+  void Clear();
+
+  // onReload receives each rebuilt program, the previous rebuild is deleted
+  // once its replacement is handed over
+  void Watch(const std::string &vertexPath, const std::string &fragmentPath,
+             const ShaderDefines &defines,
+             PipelineCompiler::ReadyCallback onReload);
+
+  // onReload receives the vertex stage, which holds the uniforms, whenever
+  // it was replaced. Stages belong to library.
+  void WatchPipeline(ProgramPipelineLibrary *library, GLuint pipeline,
+                     const std::string &vertexPath,
+                     const std::string &fragmentPath,
+                     const ShaderDefines &defines,
+                     PipelineCompiler::ReadyCallback onReload);
+
+  // Main thread, once per frame before the compiler's Poll()
+  void Update();
+
+private:
+  struct Entry {
+    std::string mVertexPath;
+    std::string mFragmentPath;
+    ShaderDefines mDefines;
+    PipelineCompiler::ReadyCallback mOnReload;
+    std::set<std::string> mDependencies;
+    // Of the expanded sources last submitted
+    uint64_t mVertexHash = 0;
+    uint64_t mFragmentHash = 0;
+    GLuint mReloadedProgram = 0;
+    // Set for entries watched with WatchPipeline
+    ProgramPipelineLibrary *mPipelineLibrary = nullptr;
+    GLuint mPipeline = 0;
+  };
+
+  void Add(Entry &entry);
+  void Rebuild(size_t index);
+  void RebuildStages(Entry &entry, uint64_t vertexHash, uint64_t fragmentHash);
+  void WatcherMain();
+
+  PipelineCompiler *mCompiler;
+  std::vector<Entry> mEntries;
+
+  std::thread mWatcher;
+  std::atomic<bool> mStopWatcher;
+  std::mutex mMutex;
+  // Guarded by mMutex, shared with the watcher thread
+  std::set<std::string> mWatchedFiles;
+  std::set<std::string> mChanged;
+};
+
+#endif // !SHADER_HOT_RELOAD_HPP
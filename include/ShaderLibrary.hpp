@@ -0,0 +1,88 @@
+#ifndef SHADER_LIBRARY_HPP
+#define SHADER_LIBRARY_HPP
+
+#include "PipelineCompiler.hpp"
+#include "ProgramBinaryCache.hpp"
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// (name, value) pairs injected as #define right after #version
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Loads a shader file, resolving #include "file" relative to the including
+// file (each file is included once) and injecting defines. Every file read
+// is appended to dependencies when given.
+std::string PreprocessShader(const std::string &path,
+                             const ShaderDefines &defines,
+                             std::vector<std::string> *dependencies = nullptr);
+
+// Bakes a uniform as the define BAKED_<name> so the driver can constant fold
+// it. Shaders opt in with:
+//   #ifdef BAKED_uScale
+//   const float uScale = BAKED_uScale;
+//   #else
+//   uniform float uScale;
+//   #endif
+void BakeUniform(ShaderDefines &defines, const std::string &name, float value);
+void BakeUniform(ShaderDefines &defines, const std::string &name, int value);
+
+// Shader permutations built on first request. Variants are keyed by the hash
+// of their expanded sources, so duplicate files or define sets that expand to
+// the same code share one program.
+class ShaderLibrary {
+
+public:
+  ShaderLibrary(ProgramBinaryCache *cache, PipelineCompiler *compiler);
+
+  // Returns the program now, compiling it on this call if needed; 0 if it
+  // does not build
+  GLuint GetProgram(const std::string &vertexPath,
+                    const std::string &fragmentPath,
+                    const ShaderDefines &defines = {});
+  // Compiles through the pipeline compiler, onReady runs from its Poll() or
+  // right away when the variant already exists. It gets 0 if the build
+  // failed.
+  void RequestProgram(const std::string &vertexPath,
+                      const std::string &fragmentPath,
+                      const ShaderDefines &defines,
+                      PipelineCompiler::ReadyCallback onReady);
+
+  // Deletes every program and forgets all variants and waiting callbacks
+  void Clear();
+
+  size_t GetVariantCount() const;
+  size_t GetProgramCount() const;
+
+private:
+  struct Expanded {
+    uint64_t mHash;
+    std::string mVertexShaderSrc;
+    std::string mFragmentShaderSrc;
+  };
+
+  // Program of a variant seen before, 0 if unknown or still compiling
+  GLuint FindProgram(const std::string &vertexPath,
+                     const std::string &fragmentPath,
+                     const ShaderDefines &defines) const;
+  Expanded Expand(const std::string &vertexPath,
+                  const std::string &fragmentPath,
+                  const ShaderDefines &defines);
+
+  ProgramBinaryCache *mCache;
+  PipelineCompiler *mCompiler;
+
+  // Paths and defines -> hash of the expanded sources
+  std::unordered_map<std::string, uint64_t> mVariants;
+  // Expanded source hash -> linked program
+  std::unordered_map<uint64_t, GLuint> mPrograms;
+  // Callbacks waiting on programs that are still compiling
+  std::unordered_map<uint64_t, std::vector<PipelineCompiler::ReadyCallback>>
+      mPending;
+};
+
+#endif // !SHADER_LIBRARY_HPP
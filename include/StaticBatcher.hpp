@@ -0,0 +1,70 @@
+#ifndef STATIC_BATCHER_HPP
+#define STATIC_BATCHER_HPP
+
+#include "Mesh.hpp"
+#include "TexturePacker.hpp"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <map>
+#include <tuple>
+#include <vector>
+
+struct StaticBatchStats {
+  size_t mSourceMeshes = 0;
+  size_t mChunks = 0;
+  size_t mVertices = 0;
+  size_t mIndices = 0;
+};
+
+// Merges meshes that never move after load into world space buffers. Meshes
+// sharing a pipeline are grouped per grid cell so each chunk is one draw call
+// and can still be frustum culled on its own. Textured meshes only need to
+// share the array their texture was packed into, the layer and atlas
+// placement go into the vertices.
+class StaticBatcher {
+
+public:
+  explicit StaticBatcher(float chunkSize = 16.0f);
+
+  // Queues a mesh placed in the world by model, must be called before Build.
+  // texture, when given, is sampled by pipeline as a sampler2DArray with
+  // the vec3 texture coordinates at location 2. Meshes whose colors or
+  // indices do not match their positions are skipped with a warning.
+  void Add(const MeshData &data, const glm::mat4 &model, GLuint pipeline,
+           const TextureSlot *texture = nullptr);
+  // Uploads every chunk and reports the draw call reduction
+  void Build();
+  void Destroy();
+
+  // Returns the number of chunks that survived culling and were drawn
+  int Draw(const glm::mat4 &view, const glm::mat4 &projection) const;
+
+  StaticBatchStats GetStats() const;
+
+private:
+  struct Chunk {
+    GLuint mPipeline = 0;
+    GLuint mTexture = 0;
+    MeshData mData;
+    // u, v and layer per vertex, for textured chunks
+    std::vector<GLfloat> mTexcoords;
+    glm::vec3 mMin = glm::vec3(0.0f);
+    glm::vec3 mMax = glm::vec3(0.0f);
+
+    GLuint mVertexArrayObj = 0;
+    GLuint mVertexBufferObj = 0;
+    GLuint mVertexBufferObj2 = 0;
+    GLuint mTexcoordBufferObj = 0;
+    GLuint mIndexBufferObj = 0;
+    GLsizei mIndexCount = 0;
+  };
+
+  float mChunkSize;
+  std::vector<Chunk> mChunks;
+  // (pipeline, texture, cell x, cell y, cell z) -> index into mChunks
+  std::map<std::tuple<GLuint, GLuint, int, int, int>, size_t> mChunkLookup;
+  StaticBatchStats mStats;
+};
+
+#endif // !STATIC_BATCHER_HPP
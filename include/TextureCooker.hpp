@@ -0,0 +1,43 @@
+#ifndef TEXTURE_COOKER_HPP
+#define TEXTURE_COOKER_HPP
+
+#include <cstdint>
+#include <string>
+
+#include "Image.hpp"
+
+enum CookFormat {
+  // BC1 when every pixel is opaque, BC3 otherwise
+  kCookAuto,
+  kCookRgba8,
+  kCookBc1,
+  kCookBc3
+};
+
+bool ParseCookFormat(const char *name, CookFormat *format);
+
+struct CookOptions {
+  CookFormat mFormat = kCookAuto;
+  // Color data, filtered in linear light; off for normal maps and masks
+  bool mSrgb = true;
+  bool mMips = true;
+};
+
+// Appends the full mip chain to a single level RGBA8 or RGBA16F image. A 2x2
+// box filter, widened to 3 weighted taps along odd sizes so the last row and
+// column are kept, applied to linear light when srgb is set.
+bool BuildMipChain(Image *image, bool srgb);
+
+// Every level of an RGBA8 image as BC1 or BC3 blocks. BC1 keeps alpha as
+// a 1 bit cutout at 128.
+bool CompressImage(const Image &source, ImageFormat format, Image *out);
+// One block of 4x4 RGBA8 pixels, row by row
+void CompressBc1Block(const uint8_t pixels[64], uint8_t out[8]);
+void CompressBc3Block(const uint8_t pixels[64], uint8_t out[16]);
+
+// Mips and compression as options ask. HDR images keep RGBA16F and already
+// compressed images are left as they are.
+bool CookTexture(Image *image, const CookOptions &options,
+                 std::string *error);
+
+#endif // !TEXTURE_COOKER_HPP
@@ -0,0 +1,230 @@
+#ifndef TEXTURE_MANAGER_HPP
+#define TEXTURE_MANAGER_HPP
+
+#include <cstdint>
+#include <deque>
+#include <glad/glad.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "Image.hpp"
+#include "ThreadPool.hpp"
+
+// 0 is never a valid handle
+using TextureHandle = uint32_t;
+
+struct TextureOptions {
+  // Color data; off for normal maps and other data textures
+  bool mSrgb = true;
+  // Builds the mip chain on the decode thread for files that only have one
+  // level
+  bool mGenerateMips = true;
+  // Only keeps the levels recent draws asked for through UseTexture
+  // resident, and gives them up when the memory budget runs out. Other
+  // textures are fully resident for good.
+  bool mStream = false;
+};
+
+// GL formats images of format are uploaded with
+GLenum TextureInternalFormat(ImageFormat format, bool srgb);
+GLenum TexturePixelType(ImageFormat format);
+
+enum TextureState { kTextureLoading, kTextureReady, kTextureFailed };
+
+struct SamplerDesc {
+  GLenum mMinFilter = GL_LINEAR_MIPMAP_LINEAR;
+  GLenum mMagFilter = GL_LINEAR;
+  GLenum mWrap = GL_REPEAT;
+  float mAnisotropy = 1.0f;
+};
+
+struct TextureResidencyStats {
+  size_t mBudgetBytes = 0;
+  // Levels resident, or being streamed in to replace what is resident
+  size_t mCommittedBytes = 0;
+  // Decoded levels held in RAM to upload from, and the budget for them
+  size_t mImageBytes = 0;
+  size_t mImageBudgetBytes = 0;
+  // Textures with any level resident, and with every level
+  int mResidentTextures = 0;
+  int mCompleteTextures = 0;
+  // Replacements that added finer levels, and that dropped levels to stay
+  // in the budget
+  uint64_t mStreamedIn = 0;
+  uint64_t mEvicted = 0;
+  // Files read again for levels dropped from RAM
+  uint64_t mReloads = 0;
+};
+
+// Loads textures without stalling the frame. Files are read and decoded on a
+// thread pool. Update() then gives each decoded image immutable storage and
+// streams its levels through pixel unpack buffers, at most a set number of
+// bytes per frame. Until a texture is complete GetTexture returns a
+// placeholder.
+//
+// Streamed textures start with their small tail levels. Draws report their
+// projected size through UseTexture, and finer levels are uploaded into a
+// replacement texture that is swapped in once complete. When the budget is
+// exceeded, the textures drawn least recently drop back to their tail.
+//
+// Streamed textures also keep their decoded levels in RAM to upload from,
+// as much again as the GPU copy once complete: about 90 MB for a 4096x4096
+// RGBA8 image and its mips. Past the image budget, the textures drawn least
+// recently keep only the levels they have resident and read their file
+// again when finer levels are wanted.
+class TextureManager {
+
+public:
+  TextureManager();
+
+  // Needs the GL context current
+  void Initialize(int decodeThreads = 0,
+                  size_t uploadBytesPerFrame = 8 * 1024 * 1024);
+  void Destroy();
+
+  // Bytes of texture levels kept resident; textures that are not streamed
+  // can go over it
+  void SetMemoryBudget(size_t bytes) { mBudgetBytes = bytes; }
+  // Bytes of decoded levels streamed textures keep in RAM; levels being
+  // uploaded can go over it
+  void SetImageBudget(size_t bytes) { mImageBudgetBytes = bytes; }
+
+  // Starts loading path, or returns the handle it already has
+  TextureHandle Load(const std::string &path,
+                     const TextureOptions &options = TextureOptions());
+  // Main thread, once per frame
+  void Update();
+
+  // The texture, or the placeholder while it is loading or if it failed
+  GLuint GetTexture(TextureHandle handle) const;
+  // Same, for a draw covering screenSize pixels across. Marks the texture
+  // used this frame and asks for the levels that size needs.
+  GLuint UseTexture(TextureHandle handle, float screenSize);
+  TextureState GetState(TextureHandle handle) const;
+  // Shared sampler object for desc
+  GLuint GetSampler(const SamplerDesc &desc);
+
+  // Textures not ready or failed yet
+  size_t GetPendingCount() const { return mPending; }
+  // Textures that became ready so far
+  uint64_t GetReadyCount() const { return mReady; }
+  // Textures swapped for ones with other levels, so callers know to redraw
+  uint64_t GetChangeCount() const { return mChanges; }
+  // Loading or streaming still in progress
+  bool IsBusy() const {
+    return mPending > 0 || mReloading > 0 || !mUploadQueue.empty();
+  }
+  size_t GetUploadedBytes() const { return mUploadedBytes; }
+
+  TextureResidencyStats GetResidencyStats() const;
+  void PrintResidencyStats() const;
+
+private:
+  struct Texture {
+    std::string mPath;
+    TextureOptions mOptions;
+    TextureState mState = kTextureLoading;
+    GLenum mInternalFormat = 0;
+    // Decoded levels from mImageBase on; the level table always lists
+    // every level. Streamed textures keep it to upload other levels later,
+    // the rest drop it once they are resident.
+    Image mImage;
+    size_t mImageBase = 0;
+    // Reading the file again for the levels before mImageBase, and the
+    // finest level still wanted if that fails
+    bool mReloading = false;
+    size_t mFinestBase = 0;
+    int mWidth = 0;
+    int mHeight = 0;
+    size_t mLevelCount = 0;
+
+    // Drawn with, holding the image levels from mResidentBase on
+    GLuint mTexture = 0;
+    size_t mResidentBase = 0;
+    size_t mResidentBytes = 0;
+
+    // Replacement being uploaded, swapped in once complete
+    GLuint mBuildTexture = 0;
+    size_t mBuildBase = 0;
+    size_t mBuildBytes = 0;
+    // Next level and pixel row to upload
+    size_t mUploadLevel = 0;
+    int mUploadRow = 0;
+
+    // Coarsest level always resident, and the finest one the draws of
+    // mLastUsedFrame asked for
+    size_t mTailBase = 0;
+    size_t mWantedBase = 0;
+    uint64_t mLastUsedFrame = 0;
+  };
+
+  struct Decoded {
+    TextureHandle mHandle;
+    Image mImage;
+    std::string mError;
+  };
+
+  struct StagingBuffer {
+    GLuint mBuffer = 0;
+    GLsync mFence = nullptr;
+  };
+
+  // Reads and decodes the file on the pool
+  void SubmitDecode(TextureHandle handle);
+  void AcceptImage(TextureHandle handle, Image &&image);
+  void AcceptReload(Texture &texture, Decoded &decoded);
+  void UpdateResidency();
+  // Levels the texture should have given its use and options
+  size_t DesiredBase(const Texture &texture) const;
+  // Textures other than keep holding more levels than they need, least
+  // recently drawn first, and the bytes dropping those levels would free
+  std::vector<TextureHandle> EvictionCandidates(TextureHandle keep) const;
+  size_t EvictableBytes(TextureHandle keep) const;
+  // Makes room for bytes more, dropping levels of other textures
+  bool Evict(size_t bytes, TextureHandle keep);
+  // Starts uploading a replacement with the levels from base on
+  void StartBuild(TextureHandle handle, size_t base);
+  void Upload();
+  void FinishBuild(Texture &texture);
+  // Drops levels streamed textures do not have resident until the decoded
+  // images fit in the image budget
+  void TrimImages();
+
+  ThreadPool mPool;
+  std::mutex mDecodedMutex;
+  std::vector<Decoded> mDecoded;
+
+  std::vector<Texture> mTextures;
+  std::unordered_map<std::string, TextureHandle> mHandles;
+  std::deque<TextureHandle> mUploadQueue;
+  size_t mPending;
+  uint64_t mReady;
+  uint64_t mChanges;
+  size_t mUploadedBytes;
+  uint64_t mFrame;
+  GLint mMaxTextureSize;
+
+  size_t mBudgetBytes;
+  size_t mCommittedBytes;
+  uint64_t mStreamedIn;
+  uint64_t mEvicted;
+
+  size_t mImageBudgetBytes;
+  size_t mImageBytes;
+  size_t mReloading;
+  uint64_t mReloads;
+
+  std::vector<StagingBuffer> mStaging;
+  size_t mStagingIndex;
+  size_t mUploadBytesPerFrame;
+
+  GLuint mPlaceholder;
+  std::map<std::tuple<GLenum, GLenum, GLenum, float>, GLuint> mSamplers;
+};
+
+#endif // !TEXTURE_MANAGER_HPP
@@ -0,0 +1,79 @@
+#ifndef TEXTURE_PACKER_HPP
+#define TEXTURE_PACKER_HPP
+
+#include <cstddef>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "Image.hpp"
+
+// Where a packed texture ended up. Materials keep one of these instead of a
+// texture of their own.
+struct TextureSlot {
+  // GL_TEXTURE_2D_ARRAY, shared with other textures
+  GLuint mTexture = 0;
+  float mLayer = 0.0f;
+  // The texture's own coordinates map into the layer as uv * xy + zw
+  glm::vec4 mUvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+};
+
+struct TexturePackStats {
+  size_t mTextures = 0;
+  size_t mArrays = 0;
+  // Textures given a layer of their own
+  size_t mLayers = 0;
+  // Textures packed into atlas pages, and the pages
+  size_t mAtlased = 0;
+  size_t mAtlasPages = 0;
+  size_t mBytes = 0;
+};
+
+// Packs textures into array textures so draws using different ones can share
+// one bind. Textures of the same size, format and level count become layers
+// of one array. Small textures without a match are rectangle-packed into
+// atlas pages, which are layers of an array too. Everything is uploaded at
+// Build, with the levels each image has.
+class TexturePacker {
+
+public:
+  // Textures up to maxAtlasSize on both sides can go to atlas pages of up
+  // to pageSize
+  explicit TexturePacker(int pageSize = 2048, int maxAtlasSize = 256);
+
+  // Queues an image, must be called before Build. Returns the index of its
+  // slot. repeat keeps it out of atlases, where wrapping would read the
+  // neighbors.
+  size_t Add(Image &&image, bool srgb, bool repeat = false);
+  // Uploads every array and fills in the slots
+  void Build();
+  void Destroy();
+
+  const TextureSlot &GetSlot(size_t index) const { return mSlots[index]; }
+  size_t GetSlotCount() const { return mSlots.size(); }
+  TexturePackStats GetStats() const { return mStats; }
+
+private:
+  struct Pending {
+    Image mImage;
+    GLenum mInternalFormat = 0;
+    bool mRepeat = false;
+    size_t mSlot = 0;
+  };
+
+  bool CanAtlas(const Pending &pending) const;
+  // Layers of one array, all the same size, format and level count
+  void BuildArray(const std::vector<size_t> &pending);
+  // Pages beyond maxLayers go to further arrays
+  void BuildAtlas(const std::vector<size_t> &pending, GLenum internalFormat,
+                  int maxLayers);
+
+  int mPageSize;
+  int mMaxAtlasSize;
+  std::vector<Pending> mPending;
+  std::vector<TextureSlot> mSlots;
+  std::vector<GLuint> mArrays;
+  TexturePackStats mStats;
+};
+
+#endif // !TEXTURE_PACKER_HPP
@@ -0,0 +1,44 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running jobs in submission order. Jobs must
+// not touch GL; hand results back to the GL thread instead.
+class ThreadPool {
+
+public:
+  ThreadPool() = default;
+  ~ThreadPool();
+
+  // 0 threads picks one less than the hardware has, at least one. name
+  // labels the workers in profiles.
+  void Start(int threads, const char *name);
+  // Finishes the queued jobs and joins the workers
+  void Stop();
+  // Drops the jobs no worker has started, returning how many
+  size_t CancelQueued();
+
+  void Submit(std::function<void()> job);
+  // Jobs queued or running
+  size_t GetPendingCount();
+  int GetThreadCount() const { return (int)mThreads.size(); }
+
+private:
+  void WorkerMain();
+
+  const char *mName = "ThreadPool";
+  std::vector<std::thread> mThreads;
+  std::mutex mMutex;
+  std::condition_variable mWake;
+  std::deque<std::function<void()>> mJobs;
+  size_t mRunning = 0;
+  bool mStop = false;
+};
+
+#endif // !THREAD_POOL_HPP
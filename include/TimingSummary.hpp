@@ -0,0 +1,23 @@
+#ifndef TIMING_SUMMARY_HPP
+#define TIMING_SUMMARY_HPP
+
+#include <string>
+#include <vector>
+
+struct TimingSummary {
+  int mCount = 0;
+  double mMean = 0.0;
+  double mMin = 0.0;
+  double mMax = 0.0;
+  double mP50 = 0.0;
+  double mP95 = 0.0;
+  double mP99 = 0.0;
+};
+
+// Mean, extremes and nearest rank percentiles of a set of samples
+TimingSummary SummarizeTimings(std::vector<double> samples);
+
+// {"mean": ..., "p50": ..., ...} for benchmark reports
+std::string TimingSummaryJson(const TimingSummary &summary);
+
+#endif // !TIMING_SUMMARY_HPP
@@ -0,0 +1,10 @@
+// Included by every mesh vertex shader: the attributes all meshes have, the
+// camera and the color frag.glsl reads
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 vertexColors;
+
+uniform mat4 uProjection;
+uniform mat4 uViewMatrix;
+
+out vec3 v_vertexColors;
@@ -0,0 +1,20 @@
+#version 410 core
+
+// Vertex shaders can't drop primitives, so the visibility test result is
+// passed through here and only surviving instances are captured
+layout(points) in;
+layout(points, max_vertices = 1) out;
+
+in vec4 v_positionScale[];
+flat in int v_visible[];
+
+out vec4 culledPositionScale;
+
+void main()
+{
+   if (v_visible[0] != 0) {
+      culledPositionScale = v_positionScale[0];
+      EmitVertex();
+      EndPrimitive();
+   }
+}
@@ -0,0 +1,29 @@
+#version 410 core
+
+// Per-instance bounds: xyz = world position, w = uniform scale
+layout(location = 0) in vec4 instancePositionScale;
+
+uniform vec4 uFrustumPlanes[6];
+uniform float uBoundingRadius;
+
+out vec4 v_positionScale;
+flat out int v_visible;
+
+bool SphereInFrustum(vec3 center, float radius)
+{
+   for (int i = 0; i < 6; ++i) {
+      if (dot(uFrustumPlanes[i].xyz, center) + uFrustumPlanes[i].w < -radius) {
+         return false;
+      }
+   }
+   return true;
+}
+
+void main()
+{
+   vec3 center = instancePositionScale.xyz;
+   float radius = uBoundingRadius * instancePositionScale.w;
+
+   v_positionScale = instancePositionScale;
+   v_visible = SphereInFrustum(center, radius) ? 1 : 0;
+}
@@ -0,0 +1,11 @@
+#version 410 core
+
+in vec3 v_vertexColors;
+
+out vec4 color;
+
+// Flat grey drawn while the real program is still compiling
+void main()
+{
+    color = vec4(0.5f, 0.5f, 0.5f, 1.0f);
+}
@@ -1,6 +1,15 @@
 #version 410 core
 
 in vec3 v_vertexColors;
+#if defined(TEXTURE_ARRAY)
+in vec3 v_texcoord;
+
+uniform sampler2DArray uTexture;
+#elif defined(TEXTURED)
+in vec2 v_texcoord;
+
+uniform sampler2D uTexture;
+#endif
 
 out vec4 color;
 
@@ -8,4 +17,11 @@ out vec4 color;
 void main()
 {
     color = vec4(v_vertexColors.r, v_vertexColors.g, v_vertexColors.b, 1.0f);
+#if defined(TEXTURE_ARRAY) || defined(TEXTURED)
+    color *= texture(uTexture, v_texcoord);
+#endif
+#ifdef SCENE_VARIANT
+    // Generated scenes tint each variant so the programs differ
+    color.rgb *= 0.75f + 0.25f * fract(float(SCENE_VARIANT) * 0.618f);
+#endif
 }
@@ -0,0 +1,13 @@
+#version 410 core
+
+#include "common_vert.glsl"
+
+// Per-instance model matrix, occupies locations 2 to 5
+layout(location = 2) in mat4 instanceModelMatrix;
+
+void main()
+{
+   v_vertexColors = vertexColors;
+
+   gl_Position = uProjection * uViewMatrix * instanceModelMatrix * vec4(position, 1.0f);
+}
@@ -0,0 +1,15 @@
+#version 410 core
+
+#include "common_vert.glsl"
+
+// Written by the culling pass: xyz = world position, w = uniform scale
+layout(location = 2) in vec4 instancePositionScale;
+
+void main()
+{
+   v_vertexColors = vertexColors;
+
+   vec3 worldPosition = position * instancePositionScale.w + instancePositionScale.xyz;
+
+   gl_Position = uProjection * uViewMatrix * vec4(worldPosition, 1.0f);
+}
@@ -1,17 +1,34 @@
 #version 410 core
 
-layout(location = 0) in vec3 position;
-layout(location = 1) in vec3 vertexColors;
+#include "common_vert.glsl"
+
+#if defined(TEXTURE_ARRAY)
+// u, v and the layer of the material's texture
+layout(location = 2) in vec3 texcoord;
+#elif defined(TEXTURED)
+layout(location = 2) in vec2 texcoord;
+#endif
 
 uniform mat4 uModelMatrix;
-uniform mat4 uProjection;
-uniform mat4 uViewMatrix;
 
-out vec3 v_vertexColors;
+#if defined(TEXTURE_ARRAY)
+out vec3 v_texcoord;
+#elif defined(TEXTURED)
+out vec2 v_texcoord;
+#endif
+
+// Separable programs need the built-in output block redeclared
+out gl_PerVertex
+{
+   vec4 gl_Position;
+};
 
 void main()
 {
    v_vertexColors = vertexColors;
+#if defined(TEXTURE_ARRAY) || defined(TEXTURED)
+   v_texcoord = texcoord;
+#endif
 
    vec4 newPosition = uProjection * uViewMatrix * uModelMatrix * vec4(position, 1.0f);
 
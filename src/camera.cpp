@@ -1,8 +1,11 @@
 #include "Camera.hpp"
 
+#include "Log.hpp"
+
 Camera::Camera() {
   // Assume we are placed at origin
   mEye = glm::vec3(0.0f, 0.0f, 0.0f);
+  mPrevEye = mEye;
   // Assume we are looking out into the world
   mViewDirection = glm::vec3(0.0f, 0.0f, -1.0f);
   // Assume we start on perfect plane
@@ -20,8 +23,14 @@ void Camera::SetProjectionMatrix(float fovy, float aspect, float near,
 
 glm::mat4 Camera::GetProjectionMatrix() const { return mProjectionMatrix; }
 
+void Camera::LookAt(const glm::vec3 &eye, const glm::vec3 &target) {
+  mEye = eye;
+  mPrevEye = eye;
+  mViewDirection = glm::normalize(target - eye);
+}
+
 void Camera::MouseLook(int mouseX, int mouseY) {
-  std::cout << "mouse: " << mouseX << ", " << mouseY << std::endl;
+  LOG_TRACE(kLogInput, "mouse: {}, {}", mouseX, mouseY);
   static const float sensitivity = 0.05f;
   glm::vec2 currMouse = glm::vec2(mouseX, mouseY);
 
@@ -47,3 +56,11 @@ void Camera::MoveForward(float speed) {
 void Camera::MoveBackward(float speed) { mEye -= (mViewDirection * speed); }
 void Camera::MoveLeft(float speed) {}
 void Camera::MoveRight(float speed) {}
+
+void Camera::BeginStep() { mPrevEye = mEye; }
+
+Camera Camera::Interpolated(float alpha) const {
+  Camera camera = *this;
+  camera.mEye = glm::mix(mPrevEye, mEye, alpha);
+  return camera;
+}
@@ -0,0 +1,450 @@
+#include "DynamicBatcher.hpp"
+
+#include "Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86_FP)
+#include <xmmintrin.h>
+#define DYNAMIC_BATCHER_SSE
+#endif
+
+// Interleaved position and color
+static const size_t kVertexFloats = 6;
+static const size_t kVertexStride = kVertexFloats * sizeof(GLfloat);
+
+void TransformPositions(const glm::mat4 &model, const GLfloat *in,
+                        GLfloat *out, size_t count, size_t outStride) {
+  size_t i = 0;
+
+#ifdef DYNAMIC_BATCHER_SSE
+  const __m128 c0 = _mm_loadu_ps(&model[0][0]);
+  const __m128 c1 = _mm_loadu_ps(&model[1][0]);
+  const __m128 c2 = _mm_loadu_ps(&model[2][0]);
+  const __m128 c3 = _mm_loadu_ps(&model[3][0]);
+
+  // The 4 wide store spills one float past each vertex, which is fine for
+  // all but the last one since the caller writes after it anyway
+  for (; i + 1 < count; ++i) {
+    const GLfloat *p = in + i * 3;
+    __m128 r = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(p[0])),
+                   _mm_mul_ps(c1, _mm_set1_ps(p[1]))),
+        _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(p[2])), c3));
+    _mm_storeu_ps(out + i * outStride, r);
+  }
+#endif
+
+  for (; i < count; ++i) {
+    const GLfloat *p = in + i * 3;
+    glm::vec4 r = model * glm::vec4(p[0], p[1], p[2], 1.0f);
+    GLfloat *o = out + i * outStride;
+    o[0] = r.x;
+    o[1] = r.y;
+    o[2] = r.z;
+  }
+}
+
+// Nanoseconds since start
+static double ElapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Exponential moving average, seeded by the first sample
+static void Accumulate(double &average, double sample) {
+  average = average == 0.0 ? sample : average * 0.95 + sample * 0.05;
+}
+
+DynamicBatcher::DynamicBatcher()
+    : mVertexArrayObj(0), mVertexBufferObj(0), mIndexBufferObj(0),
+      mInstanceBufferObj(0), mMaxVertices(0), mMaxIndices(0),
+      mMaxInstances(0), mVertexOffset(0), mIndexOffset(0),
+      mInstanceOffset(0), mBoundPipeline(0), mDrawCostNs(0.0),
+      mVertexCostNs(0.0) {}
+
+bool DynamicBatcher::Create(size_t maxVertices, size_t maxIndices,
+                            size_t maxInstances) {
+  if (maxVertices == 0 || maxIndices == 0 || maxInstances == 0) {
+    LOG_ERROR(kLogRender, "Dynamic batcher buffers must not be empty");
+    return false;
+  }
+  mMaxVertices = maxVertices;
+  mMaxIndices = maxIndices;
+  mMaxInstances = maxInstances;
+
+  glGenVertexArrays(1, &mVertexArrayObj);
+  glBindVertexArray(mVertexArrayObj);
+
+  glGenBuffers(1, &mVertexBufferObj);
+  glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObj);
+  glBufferData(GL_ARRAY_BUFFER, maxVertices * kVertexStride, nullptr,
+               GL_STREAM_DRAW);
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, false, kVertexStride, (void *)0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, false, kVertexStride,
+                        (void *)(3 * sizeof(GLfloat)));
+
+  glGenBuffers(1, &mIndexBufferObj);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBufferObj);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, maxIndices * sizeof(GLuint), nullptr,
+               GL_STREAM_DRAW);
+
+  glBindVertexArray(0);
+
+  glGenBuffers(1, &mInstanceBufferObj);
+  glBindBuffer(GL_ARRAY_BUFFER, mInstanceBufferObj);
+  glBufferData(GL_ARRAY_BUFFER, maxInstances * sizeof(glm::mat4), nullptr,
+               GL_STREAM_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  return true;
+}
+
+void DynamicBatcher::Destroy() {
+  glDeleteVertexArrays(1, &mVertexArrayObj);
+  glDeleteBuffers(1, &mVertexBufferObj);
+  glDeleteBuffers(1, &mIndexBufferObj);
+  glDeleteBuffers(1, &mInstanceBufferObj);
+  for (auto &entry : mInstancedVertexArrays) {
+    glDeleteVertexArrays(1, &entry.second);
+  }
+  mInstancedVertexArrays.clear();
+  mVertexArrayObj = 0;
+  mVertexBufferObj = 0;
+  mIndexBufferObj = 0;
+  mInstanceBufferObj = 0;
+  mItems.clear();
+}
+
+void DynamicBatcher::SetInstancedPipeline(GLuint pipeline,
+                                          GLuint instancedPipeline) {
+  mInstancedPipelines[pipeline] = instancedPipeline;
+}
+
+void DynamicBatcher::Submit(const Mesh3D *mesh, const MeshData *data,
+                            const glm::mat4 &model) {
+  mItems[mesh->mPipeline].push_back(Item{mesh, data, model});
+}
+
+int DynamicBatcher::Flush(const glm::mat4 &view, const glm::mat4 &projection) {
+  int drawCalls = 0;
+  mBoundPipeline = 0;
+
+  for (auto &entry : mItems) {
+    GLuint pipeline = entry.first;
+    std::vector<Item> &items = entry.second;
+    if (items.empty()) {
+      continue;
+    }
+
+    std::map<const Mesh3D *, std::vector<const Item *>> byMesh;
+    for (const Item &item : items) {
+      byMesh[item.mMesh].push_back(&item);
+    }
+
+    auto instanced = mInstancedPipelines.find(pipeline);
+    GLuint instancedPipeline =
+        instanced != mInstancedPipelines.end() ? instanced->second : 0;
+
+    std::vector<const Item *> batch;
+    std::vector<const Item *> individual;
+    for (auto &meshItems : byMesh) {
+      const std::vector<const Item *> &list = meshItems.second;
+      size_t vertices = list[0]->mData->positions.size() / 3;
+      // A copy the streaming buffers cannot hold on its own
+      bool fits = vertices <= mMaxVertices &&
+                  list[0]->mData->indices.size() <= mMaxIndices;
+
+      bool batchable = fits && vertices <= mThresholds.mMaxBatchVertices;
+      bool instance = instancedPipeline != 0 &&
+                      list.size() >= mThresholds.mMinInstanceCount;
+      if (instance && batchable) {
+        // Instancing wins once transforming every copy costs more than a
+        // draw. Until both costs are measured the copies are batched, then
+        // drawn one by one, to sample them.
+        double batchCostNs =
+            (double)(list.size() * vertices) * mVertexCostNs;
+        if (mVertexCostNs <= 0.0) {
+          instance = false;
+        } else if (mDrawCostNs <= 0.0) {
+          instance = false;
+          batchable = false;
+        } else {
+          instance = batchCostNs >= mDrawCostNs;
+        }
+      }
+
+      if (instance) {
+        BindPipeline(instancedPipeline, view, projection);
+        drawCalls += DrawInstanced(list);
+      } else if (batchable) {
+        batch.insert(batch.end(), list.begin(), list.end());
+      } else {
+        individual.insert(individual.end(), list.begin(), list.end());
+      }
+    }
+
+    // Nothing to merge a lone mesh with
+    if (batch.size() == 1) {
+      individual.push_back(batch[0]);
+      batch.clear();
+    }
+
+    if (!batch.empty() || !individual.empty()) {
+      BindPipeline(pipeline, view, projection);
+    }
+    if (!batch.empty()) {
+      drawCalls += DrawBatch(batch);
+    }
+    for (const Item *item : individual) {
+      drawCalls += DrawIndividual(*item);
+    }
+
+    items.clear();
+  }
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+  UpdateThresholds();
+
+  return drawCalls;
+}
+
+DynamicBatchThresholds DynamicBatcher::GetThresholds() const {
+  return mThresholds;
+}
+
+void DynamicBatcher::SetThresholds(const DynamicBatchThresholds &thresholds) {
+  mThresholds = thresholds;
+}
+
+void DynamicBatcher::BindPipeline(GLuint pipeline, const glm::mat4 &view,
+                                  const glm::mat4 &projection) {
+  if (pipeline == mBoundPipeline) {
+    return;
+  }
+  mBoundPipeline = pipeline;
+
+  glUseProgram(pipeline);
+  glUniformMatrix4fv(glGetUniformLocation(pipeline, "uViewMatrix"), 1, false,
+                     &view[0][0]);
+  glUniformMatrix4fv(glGetUniformLocation(pipeline, "uProjection"), 1, false,
+                     &projection[0][0]);
+}
+
+int DynamicBatcher::DrawIndividual(const Item &item) {
+  auto start = std::chrono::steady_clock::now();
+
+  glUniformMatrix4fv(glGetUniformLocation(mBoundPipeline, "uModelMatrix"), 1,
+                     false, &item.mModel[0][0]);
+  glBindVertexArray(item.mMesh->mVertexArrayObj);
+  glDrawElements(GL_TRIANGLES, item.mMesh->mIndexCount, GL_UNSIGNED_INT, 0);
+
+  Accumulate(mDrawCostNs, ElapsedNs(start));
+  return 1;
+}
+
+int DynamicBatcher::DrawInstanced(const std::vector<const Item *> &items) {
+  const Mesh3D *mesh = items[0]->mMesh;
+  GLuint vertexArray = InstancedVertexArray(mesh);
+  int drawCalls = 0;
+
+  for (size_t first = 0; first < items.size(); first += mMaxInstances) {
+    size_t count = std::min(mMaxInstances, items.size() - first);
+
+    // Orphan the buffer instead of waiting on draws still reading it
+    glBindBuffer(GL_ARRAY_BUFFER, mInstanceBufferObj);
+    if (mInstanceOffset + count > mMaxInstances) {
+      glBufferData(GL_ARRAY_BUFFER, mMaxInstances * sizeof(glm::mat4), nullptr,
+                   GL_STREAM_DRAW);
+      mInstanceOffset = 0;
+    }
+
+    size_t offset = mInstanceOffset * sizeof(glm::mat4);
+    auto *matrices = (glm::mat4 *)glMapBufferRange(
+        GL_ARRAY_BUFFER, offset, count * sizeof(glm::mat4),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+            GL_MAP_UNSYNCHRONIZED_BIT);
+    if (matrices == nullptr) {
+      LOG_WARNING(kLogRender, "Could not map the instance buffer");
+      break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      matrices[i] = items[first + i]->mModel;
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    // A mat4 attribute takes four consecutive locations
+    glBindVertexArray(vertexArray);
+    for (GLuint column = 0; column < 4; ++column) {
+      glVertexAttribPointer(
+          2 + column, 4, GL_FLOAT, false, sizeof(glm::mat4),
+          (void *)(offset + column * sizeof(glm::vec4)));
+    }
+    glDrawElementsInstanced(GL_TRIANGLES, mesh->mIndexCount, GL_UNSIGNED_INT,
+                            0, (GLsizei)count);
+
+    mInstanceOffset += count;
+    drawCalls++;
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return drawCalls;
+}
+
+GLuint DynamicBatcher::InstancedVertexArray(const Mesh3D *mesh) {
+  GLuint &vertexArray = mInstancedVertexArrays[mesh->mVertexArrayObj];
+  if (vertexArray != 0) {
+    return vertexArray;
+  }
+
+  glGenVertexArrays(1, &vertexArray);
+  glBindVertexArray(vertexArray);
+
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->mVertexBufferObj);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, (void *)0);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->mVertexBufferObj2);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, GL_FLOAT, false, 0, (void *)0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->mIndexBufferObj);
+
+  // Pointed at this frame's matrices by every draw
+  glBindBuffer(GL_ARRAY_BUFFER, mInstanceBufferObj);
+  for (GLuint column = 0; column < 4; ++column) {
+    glEnableVertexAttribArray(2 + column);
+    glVertexAttribPointer(2 + column, 4, GL_FLOAT, false, sizeof(glm::mat4),
+                          (void *)(column * sizeof(glm::vec4)));
+    glVertexAttribDivisor(2 + column, 1);
+  }
+  return vertexArray;
+}
+
+int DynamicBatcher::DrawBatch(const std::vector<const Item *> &items) {
+  // Split into runs that fit the streaming buffers
+  int drawCalls = 0;
+  size_t first = 0;
+  size_t vertices = 0;
+  size_t indices = 0;
+  for (size_t i = 0; i < items.size(); ++i) {
+    size_t itemVertices = items[i]->mData->positions.size() / 3;
+    size_t itemIndices = items[i]->mData->indices.size();
+    if (i > first && (vertices + itemVertices > mMaxVertices ||
+                      indices + itemIndices > mMaxIndices)) {
+      DrawBatchRun(&items[first], i - first);
+      drawCalls++;
+      first = i;
+      vertices = 0;
+      indices = 0;
+    }
+    vertices += itemVertices;
+    indices += itemIndices;
+  }
+  DrawBatchRun(&items[first], items.size() - first);
+  drawCalls++;
+
+  return drawCalls;
+}
+
+void DynamicBatcher::DrawBatchRun(const Item *const *items, size_t count) {
+  auto start = std::chrono::steady_clock::now();
+
+  size_t vertices = 0;
+  size_t indices = 0;
+  for (size_t i = 0; i < count; ++i) {
+    vertices += items[i]->mData->positions.size() / 3;
+    indices += items[i]->mData->indices.size();
+  }
+  if (vertices == 0 || indices == 0) {
+    return;
+  }
+  // One float of slack for the kernel's 4 wide stores
+  mVertexScratch.resize(vertices * kVertexFloats + 1);
+  mIndexScratch.resize(indices);
+
+  size_t vertex = 0;
+  size_t index = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const MeshData &data = *items[i]->mData;
+    size_t n = data.positions.size() / 3;
+    GLfloat *out = &mVertexScratch[vertex * kVertexFloats];
+
+    TransformPositions(items[i]->mModel, data.positions.data(), out, n,
+                       kVertexFloats);
+    for (size_t v = 0; v < n; ++v) {
+      std::memcpy(out + v * kVertexFloats + 3, &data.colors[v * 3],
+                  3 * sizeof(GLfloat));
+    }
+    for (GLuint source : data.indices) {
+      mIndexScratch[index++] = (GLuint)vertex + source;
+    }
+    vertex += n;
+  }
+
+  Accumulate(mVertexCostNs, ElapsedNs(start) / (double)vertices);
+
+  glBindVertexArray(mVertexArrayObj);
+
+  glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObj);
+  if (mVertexOffset + vertices > mMaxVertices) {
+    glBufferData(GL_ARRAY_BUFFER, mMaxVertices * kVertexStride, nullptr,
+                 GL_STREAM_DRAW);
+    mVertexOffset = 0;
+  }
+  void *vertexDst = glMapBufferRange(
+      GL_ARRAY_BUFFER, mVertexOffset * kVertexStride, vertices * kVertexStride,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+          GL_MAP_UNSYNCHRONIZED_BIT);
+  if (vertexDst == nullptr) {
+    LOG_WARNING(kLogRender, "Could not map the batch vertex buffer");
+    return;
+  }
+  std::memcpy(vertexDst, mVertexScratch.data(), vertices * kVertexStride);
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+
+  // The element buffer binding belongs to the bound VAO
+  if (mIndexOffset + indices > mMaxIndices) {
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, mMaxIndices * sizeof(GLuint),
+                 nullptr, GL_STREAM_DRAW);
+    mIndexOffset = 0;
+  }
+  void *indexDst = glMapBufferRange(
+      GL_ELEMENT_ARRAY_BUFFER, mIndexOffset * sizeof(GLuint),
+      indices * sizeof(GLuint),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+          GL_MAP_UNSYNCHRONIZED_BIT);
+  if (indexDst == nullptr) {
+    LOG_WARNING(kLogRender, "Could not map the batch index buffer");
+    return;
+  }
+  std::memcpy(indexDst, mIndexScratch.data(), indices * sizeof(GLuint));
+  glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+
+  // Vertices are already in world space
+  const glm::mat4 identity(1.0f);
+  glUniformMatrix4fv(glGetUniformLocation(mBoundPipeline, "uModelMatrix"), 1,
+                     false, &identity[0][0]);
+  glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)indices, GL_UNSIGNED_INT,
+                           (void *)(mIndexOffset * sizeof(GLuint)),
+                           (GLint)mVertexOffset);
+
+  mVertexOffset += vertices;
+  mIndexOffset += indices;
+}
+
+void DynamicBatcher::UpdateThresholds() {
+  if (mDrawCostNs <= 0.0 || mVertexCostNs <= 0.0) {
+    return;
+  }
+
+  // Batch a mesh as long as transforming it is cheaper than drawing it
+  size_t breakEven = (size_t)(mDrawCostNs / mVertexCostNs);
+  mThresholds.mMaxBatchVertices =
+      std::clamp(breakEven, (size_t)16, std::max(mMaxVertices, (size_t)16));
+}
@@ -0,0 +1,30 @@
+#include "FixedTimestep.hpp"
+
+FixedTimestep::FixedTimestep(double stepSeconds, int maxSteps)
+    : mStepSeconds(stepSeconds), mMaxSteps(maxSteps) {}
+
+int FixedTimestep::Advance(double elapsedSeconds) {
+  mAccumulator += elapsedSeconds;
+  int steps = 0;
+  while (mAccumulator >= mStepSeconds && steps < mMaxSteps) {
+    mAccumulator -= mStepSeconds;
+    ++steps;
+  }
+  if (steps == mMaxSteps && mAccumulator >= mStepSeconds) {
+    mAccumulator = 0.0;
+  }
+  mStepCount += steps;
+  return steps;
+}
+
+float FixedTimestep::Alpha() const {
+  return (float)(mAccumulator / mStepSeconds);
+}
+
+double FixedTimestep::RenderSeconds() const {
+  if (mStepCount == 0) {
+    return 0.0;
+  }
+  // The current state is at StepCount, the previous one a step earlier
+  return ((double)mStepCount - 1.0 + Alpha()) * mStepSeconds;
+}
@@ -0,0 +1,195 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "Log.hpp"
+
+// Frames kept for the stats
+static const size_t kStatsFrames = 1024;
+// Bounds of the sleep-to-spin handover; timers on some systems round
+// sleeps up to whole milliseconds
+static const double kMinSpinMarginNs = 0.2e6;
+static const double kMaxSpinMarginNs = 4.0e6;
+// Slack on top of the predicted work for just-in-time starts
+static const double kJustInTimeSlackNs = 1.0e6;
+// Present intervals further than this from the tracked refresh period,
+// such as missed vblanks, are not averaged in
+static const double kRefreshTolerance = 0.25;
+
+static uint64_t NowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+bool ParseVsyncMode(const char *name, VsyncMode *mode) {
+  if (std::strcmp(name, "off") == 0) {
+    *mode = kVsyncOff;
+  } else if (std::strcmp(name, "on") == 0) {
+    *mode = kVsyncOn;
+  } else if (std::strcmp(name, "adaptive") == 0) {
+    *mode = kVsyncAdaptive;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void FramePacer::Initialize(SDL_Window *window,
+                            const FramePacerSettings &settings) {
+  mSettings = settings;
+
+  if (mSettings.mVsync == kVsyncAdaptive &&
+      SDL_GL_SetSwapInterval(-1) != 0) {
+    LOG_WARNING(kLogCore, "Adaptive vsync not supported, using vsync on: {}",
+                SDL_GetError());
+    mSettings.mVsync = kVsyncOn;
+  }
+  if (mSettings.mVsync != kVsyncAdaptive) {
+    SDL_GL_SetSwapInterval(mSettings.mVsync == kVsyncOn ? 1 : 0);
+  }
+
+  // Under vsync the swap already waits for the display, and a limiter at
+  // the mode's whole-Hz rate would drift against it. Just-in-time starts
+  // still need the period, so it is measured from the presents, starting
+  // from the mode's rate.
+  double fps = mSettings.mMaxFps;
+  mTrackRefresh = false;
+  if (fps <= 0.0 && mSettings.mVsync == kVsyncOff && mSettings.mJustInTime) {
+    // Neither a present rate nor a cap to start frames against
+    LOG_WARNING(kLogCore, "--just-in-time needs vsync or --max-fps; frames "
+                          "start as soon as the previous one is presented");
+    mSettings.mJustInTime = false;
+  }
+  if (fps <= 0.0 && mSettings.mVsync != kVsyncOff && mSettings.mJustInTime) {
+    SDL_DisplayMode mode;
+    fps = 60.0;
+    if (SDL_GetWindowDisplayMode(window, &mode) == 0 &&
+        mode.refresh_rate > 0) {
+      fps = mode.refresh_rate;
+    }
+    mTrackRefresh = true;
+  }
+  mPeriodNs = fps > 0.0 ? (uint64_t)(1.0e9 / fps) : 0;
+
+  mFrameMs.assign(kStatsFrames, 0.0);
+  mWaitMs.assign(kStatsFrames, 0.0);
+  mWakeErrorMs.assign(kStatsFrames, 0.0);
+  mSamples = 0;
+  mDeadlineNs = 0;
+  mLastPresentNs = 0;
+}
+
+void FramePacer::WaitUntil(uint64_t targetNs) {
+  uint64_t now = NowNs();
+  while (now + mSpinMarginNs < targetNs) {
+    uint64_t sleepNs = targetNs - now - (uint64_t)mSpinMarginNs;
+    std::this_thread::sleep_for(std::chrono::nanoseconds(sleepNs));
+    uint64_t woke = NowNs();
+    // Keep the margin a bit above the worst recent oversleep
+    double oversleepNs = (double)(woke - now) - (double)sleepNs;
+    mSpinMarginNs = std::clamp(std::max(mSpinMarginNs * 0.99,
+                                        oversleepNs * 1.25),
+                               kMinSpinMarginNs, kMaxSpinMarginNs);
+    now = woke;
+  }
+  // The last stretch is too short to trust to the scheduler
+  while (now < targetNs) {
+    std::this_thread::yield();
+    now = NowNs();
+  }
+}
+
+void FramePacer::BeginFrame() {
+  uint64_t now = NowNs();
+  uint64_t waitNs = 0;
+  mWakeErrorMs[mSamples % kStatsFrames] = 0.0;
+  if (mPeriodNs != 0 && mDeadlineNs != 0) {
+    // The deadline is when this frame should be presented
+    double leadNs = (double)mPeriodNs;
+    if (mSettings.mJustInTime) {
+      leadNs = std::min(leadNs, mPredictedWorkNs + kJustInTimeSlackNs);
+    }
+    uint64_t startNs = mDeadlineNs - (uint64_t)leadNs;
+    if (startNs > now) {
+      WaitUntil(startNs);
+      uint64_t woke = NowNs();
+      mWakeErrorMs[mSamples % kStatsFrames] = (woke - startNs) / 1e6;
+      waitNs = woke - now;
+      now = woke;
+    }
+  }
+  mWaitMs[mSamples % kStatsFrames] = waitNs / 1e6;
+  mWorkStartNs = now;
+}
+
+void FramePacer::BeforeSwap() {
+  double workNs = (double)(NowNs() - mWorkStartNs);
+  mPredictedWorkNs = std::max(workNs, mPredictedWorkNs * 0.95);
+}
+
+void FramePacer::EndFrame() {
+  uint64_t now = NowNs();
+
+  if (mLastPresentNs != 0) {
+    uint64_t intervalNs = now - mLastPresentNs;
+    mFrameMs[mSamples % kStatsFrames] = intervalNs / 1e6;
+    ++mSamples;
+    if (mTrackRefresh &&
+        std::fabs((double)intervalNs - (double)mPeriodNs) <
+            mPeriodNs * kRefreshTolerance) {
+      mPeriodNs = (uint64_t)(mPeriodNs * 0.95 + intervalNs * 0.05);
+    }
+  }
+  mLastPresentNs = now;
+
+  if (mPeriodNs != 0) {
+    // A late frame moves the schedule instead of rushing to catch up
+    if (mDeadlineNs < now) {
+      mDeadlineNs = now + mPeriodNs;
+    } else {
+      mDeadlineNs += mPeriodNs;
+    }
+  }
+}
+
+void FramePacer::FrameSkipped() { mLastPresentNs = 0; }
+
+FramePacingStats FramePacer::GetStats() const {
+  FramePacingStats stats;
+  size_t count = std::min(mSamples, kStatsFrames);
+  if (count == 0) {
+    return stats;
+  }
+
+  std::vector<double> frames(mFrameMs.begin(), mFrameMs.begin() + count);
+  std::vector<double> wakeErrors(mWakeErrorMs.begin(),
+                                 mWakeErrorMs.begin() + count);
+  stats.mFrameMs = SummarizeTimings(frames);
+  stats.mWakeErrorMs = SummarizeTimings(wakeErrors);
+
+  double variance = 0.0;
+  double totalWait = 0.0;
+  for (size_t i = 0; i < count; ++i) {
+    double delta = frames[i] - stats.mFrameMs.mMean;
+    variance += delta * delta;
+    totalWait += mWaitMs[i];
+  }
+  stats.mFrameStdDevMs = std::sqrt(variance / count);
+  stats.mMeanWaitMs = totalWait / count;
+  return stats;
+}
+
+void FramePacer::PrintStats() const {
+  FramePacingStats stats = GetStats();
+  LOG_INFO(kLogCore,
+           "Frame ms: mean {} stddev {} p50 {} p99 {} max {} over {} frames",
+           stats.mFrameMs.mMean, stats.mFrameStdDevMs, stats.mFrameMs.mP50,
+           stats.mFrameMs.mP99, stats.mFrameMs.mMax, stats.mFrameMs.mCount);
+  LOG_INFO(kLogCore, "Limiter: waited {} ms per frame, woke {} ms late at p99",
+           stats.mMeanWaitMs, stats.mWakeErrorMs.mP99);
+}
@@ -0,0 +1,49 @@
+#include "Frustum.hpp"
+
+// Gribb/Hartmann plane extraction from the combined matrix
+Frustum ExtractFrustum(const glm::mat4 &m) {
+  glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+  glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+  glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+  glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  Frustum frustum;
+  frustum.planes[0] = row3 + row0; // Left
+  frustum.planes[1] = row3 - row0; // Right
+  frustum.planes[2] = row3 + row1; // Bottom
+  frustum.planes[3] = row3 - row1; // Top
+  frustum.planes[4] = row3 + row2; // Near
+  frustum.planes[5] = row3 - row2; // Far
+
+  for (int i = 0; i < 6; ++i) {
+    frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+  }
+
+  return frustum;
+}
+
+bool FrustumIntersectsSphere(const Frustum &frustum, const glm::vec3 &center,
+                             float radius) {
+  for (int i = 0; i < 6; ++i) {
+    const glm::vec4 &plane = frustum.planes[i];
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool FrustumIntersectsAabb(const Frustum &frustum, const glm::vec3 &min,
+                           const glm::vec3 &max) {
+  for (int i = 0; i < 6; ++i) {
+    const glm::vec4 &plane = frustum.planes[i];
+    // Corner furthest along the plane normal
+    glm::vec3 positive(plane.x >= 0.0f ? max.x : min.x,
+                       plane.y >= 0.0f ? max.y : min.y,
+                       plane.z >= 0.0f ? max.z : min.z);
+    if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,125 @@
+#include "GeometryCache.hpp"
+
+#include "Hash.hpp"
+
+// Hashes one attribute with its length, so data moved between attributes
+// still changes the key
+template <typename T>
+static uint64_t HashArray(const std::vector<T> &values, uint64_t seed) {
+  uint64_t count = values.size();
+  seed = HashBytes(&count, sizeof(count), seed);
+  return HashWords(values.data(), values.size() * sizeof(T), seed);
+}
+
+static uint64_t HashMeshData(const MeshData &data) {
+  uint64_t hash = HashArray(data.positions, kHashSeed);
+  hash = HashArray(data.colors, hash);
+  hash = HashArray(data.texcoords, hash);
+  return HashArray(data.indices, hash);
+}
+
+static bool SameMeshData(const MeshData &a, const MeshData &b) {
+  return a.positions == b.positions && a.colors == b.colors &&
+         a.texcoords == b.texcoords && a.indices == b.indices;
+}
+
+static size_t MeshDataBytes(const MeshData &data) {
+  return (data.positions.size() + data.colors.size() +
+          data.texcoords.size()) *
+             sizeof(GLfloat) +
+         data.indices.size() * sizeof(GLuint);
+}
+
+// The geometry part of a mesh, its pipeline, texture and transform stay
+static void CopyGeometry(const Mesh3D &from, Mesh3D *to) {
+  to->mVertexArrayObj = from.mVertexArrayObj;
+  to->mVertexBufferObj = from.mVertexBufferObj;
+  to->mVertexBufferObj2 = from.mVertexBufferObj2;
+  to->mTexcoordBufferObj = from.mTexcoordBufferObj;
+  to->mIndexBufferObj = from.mIndexBufferObj;
+  to->mIndexCount = from.mIndexCount;
+  to->mBoundsRadius = from.mBoundsRadius;
+}
+
+void GeometryCache::Acquire(Mesh3D *mesh, const MeshData &data) {
+  uint64_t hash = HashMeshData(data);
+
+  auto range = mLookup.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    Geometry &geometry = mGeometries[it->second];
+    if (!SameMeshData(geometry.mData, data)) {
+      continue;
+    }
+    geometry.mReferences++;
+    CopyGeometry(geometry.mMesh, mesh);
+    mStats.mMeshes++;
+    mStats.mBytesSaved += geometry.mBytes;
+    return;
+  }
+
+  size_t index = mGeometries.size();
+  if (!mFree.empty()) {
+    index = mFree.back();
+    mFree.pop_back();
+  } else {
+    mGeometries.emplace_back();
+  }
+
+  Geometry &geometry = mGeometries[index];
+  geometry.mData = data;
+  geometry.mHash = hash;
+  geometry.mMesh = Mesh3D();
+  MeshCreate(&geometry.mMesh, data);
+  geometry.mBytes = MeshDataBytes(data);
+  geometry.mReferences = 1;
+  mLookup.emplace(hash, index);
+  mByVertexArray[geometry.mMesh.mVertexArrayObj] = index;
+  CopyGeometry(geometry.mMesh, mesh);
+
+  mStats.mMeshes++;
+  mStats.mGeometries++;
+  mStats.mBytes += geometry.mBytes;
+}
+
+void GeometryCache::Release(Mesh3D *mesh) {
+  auto found = mByVertexArray.find(mesh->mVertexArrayObj);
+  if (mesh->mVertexArrayObj == 0 || found == mByVertexArray.end()) {
+    return;
+  }
+
+  size_t index = found->second;
+  Geometry &geometry = mGeometries[index];
+  CopyGeometry(Mesh3D(), mesh);
+  mStats.mMeshes--;
+  if (--geometry.mReferences > 0) {
+    mStats.mBytesSaved -= geometry.mBytes;
+    return;
+  }
+
+  auto range = mLookup.equal_range(geometry.mHash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == index) {
+      mLookup.erase(it);
+      break;
+    }
+  }
+  mByVertexArray.erase(found);
+  MeshDelete(&geometry.mMesh);
+  mStats.mGeometries--;
+  mStats.mBytes -= geometry.mBytes;
+  geometry = Geometry();
+  mFree.push_back(index);
+}
+
+void GeometryCache::Destroy() {
+  for (Geometry &geometry : mGeometries) {
+    if (geometry.mReferences > 0) {
+      MeshDelete(&geometry.mMesh);
+    }
+  }
+  mGeometries.clear();
+  mFree.clear();
+  mLookup.clear();
+  mByVertexArray.clear();
+  mStats = GeometryCacheStats();
+}
@@ -0,0 +1,74 @@
+#include "GLCall.hpp"
+
+#include <SDL2/SDL.h>
+#include <cstring>
+
+#include "Log.hpp"
+
+static int gCheckMode = GL_CHECK_MODE;
+
+int GLGetCheckMode() { return gCheckMode; }
+
+void GLSetCheckMode(int mode) {
+  gCheckMode = mode < GL_CHECK_MODE ? mode : GL_CHECK_MODE;
+}
+
+bool GLParseCheckMode(const char *name, int *mode) {
+  if (std::strcmp(name, "off") == 0) {
+    *mode = GL_CHECK_MODE_OFF;
+  } else if (std::strcmp(name, "sampled") == 0) {
+    *mode = GL_CHECK_MODE_SAMPLED;
+  } else if (std::strcmp(name, "call") == 0) {
+    *mode = GL_CHECK_MODE_PER_CALL;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void GLConfigureContext() {
+  if (gCheckMode == GL_CHECK_MODE_OFF) {
+    // Lets the driver skip its own validation, errors become undefined
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_NO_ERROR, 1);
+  } else if (gCheckMode == GL_CHECK_MODE_PER_CALL) {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+  }
+}
+
+static void APIENTRY GLDebugOutput(GLenum /*source*/, GLenum /*type*/,
+                                   GLuint id, GLenum severity,
+                                   GLsizei /*length*/, const GLchar *message,
+                                   const void * /*userParam*/) {
+  // Notifications are mostly driver chatter about buffer placement
+  if (severity == GL_DEBUG_SEVERITY_NOTIFICATION) {
+    return;
+  }
+  LOG_RATE_LIMITED(LOG_LEVEL_WARNING, kLogGL, 1000, "OpenGL Debug: {}\tid: {}",
+                   message, id);
+}
+
+void GLInstallDebugOutput() {
+  if (gCheckMode != GL_CHECK_MODE_PER_CALL || !GLAD_GL_KHR_debug) {
+    return;
+  }
+  glEnable(GL_DEBUG_OUTPUT);
+  // Reports on the offending call's stack, at the cost of some speed
+  glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+  glDebugMessageCallback(GLDebugOutput, nullptr);
+}
+
+void GLClearAllErrors() {
+  while (glGetError() != GL_NO_ERROR) {
+  }
+}
+
+bool GLCheckErrorStatus(const char *function, const char *file, int line) {
+  bool failed = false;
+  while (GLenum error = glGetError()) {
+    LOG_ERROR(kLogGL, "OpenGL Error: {}\tFile: {}\tLine: {}\tfunction: {}",
+              error, file, line, function);
+    failed = true;
+  }
+
+  return failed;
+}
@@ -0,0 +1,1175 @@
+#include "GLTrace.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <glad/glad.h>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+#include "Log.hpp"
+
+// Trace layout: header, then records of [uint16 op][uint32 size][payload]
+static const uint32_t kTraceMagic = 0x52544c47; // "GLTR"
+static const uint32_t kTraceVersion = 1;
+
+enum TraceOp : uint16_t {
+  kCaptureStart = 1,
+  kFrameEnd,
+  kGenBuffers,
+  kDeleteBuffers,
+  kBindBuffer,
+  kBufferData,
+  kBufferSubData,
+  kBindBufferBase,
+  kGenVertexArrays,
+  kDeleteVertexArrays,
+  kBindVertexArray,
+  kEnableVertexAttribArray,
+  kDisableVertexAttribArray,
+  kVertexAttribPointer,
+  kVertexAttribDivisor,
+  kCreateShader,
+  kShaderSource,
+  kCompileShader,
+  kDeleteShader,
+  kCreateProgram,
+  kAttachShader,
+  kDetachShader,
+  kLinkProgram,
+  kDeleteProgram,
+  kUseProgram,
+  kProgramParameteri,
+  kProgramBinary,
+  kTransformFeedbackVaryings,
+  kCreateShaderProgramv,
+  kGenProgramPipelines,
+  kDeleteProgramPipelines,
+  kUseProgramStages,
+  kBindProgramPipeline,
+  kGetUniformLocation,
+  kUniform1i,
+  kUniform1f,
+  kUniform2f,
+  kUniform4fv,
+  kUniformMatrix4fv,
+  kProgramUniformMatrix4fv,
+  kEnable,
+  kDisable,
+  kViewport,
+  kClearColor,
+  kClear,
+  kDrawArrays,
+  kDrawElements,
+  kDrawElementsBaseVertex,
+  kDrawElementsInstanced,
+  kDrawElementsIndirect,
+  kProgramSources,
+};
+
+// Only worth keeping inside the captured frames
+static bool IsFrameOnly(uint16_t op) {
+  return op == kClear || op == kDrawArrays || op == kDrawElements ||
+         op == kDrawElementsBaseVertex || op == kDrawElementsInstanced ||
+         op == kDrawElementsIndirect;
+}
+
+struct TraceMapping {
+  void *mPointer;
+  GLintptr mOffset;
+  GLsizeiptr mLength;
+  bool mWrite;
+};
+
+struct TraceRecorder {
+  std::mutex mMutex;
+  std::ofstream mFile;
+  std::string mPath;
+  std::vector<char> mBuffer;
+  bool mRecording = false;
+  int mFrame = 0;
+  int mFirstFrame = 0;
+  int mEndFrame = 0;
+  uint64_t mRecords = 0;
+  // Mapped ranges by target, written out when they are unmapped
+  std::map<GLenum, TraceMapping> mMappings;
+};
+
+static TraceRecorder gRecorder;
+
+static void FlushRecorder() {
+  gRecorder.mFile.write(gRecorder.mBuffer.data(), gRecorder.mBuffer.size());
+  gRecorder.mBuffer.clear();
+}
+
+class TraceRecord {
+
+public:
+  explicit TraceRecord(uint16_t op) : mOp(op) {}
+
+  template <typename T> TraceRecord &Put(T value) {
+    const char *bytes = (const char *)&value;
+    mPayload.insert(mPayload.end(), bytes, bytes + sizeof(T));
+    return *this;
+  }
+
+  TraceRecord &PutBytes(const void *data, size_t size) {
+    Put<uint32_t>((uint32_t)size);
+    const char *bytes = (const char *)data;
+    mPayload.insert(mPayload.end(), bytes, bytes + size);
+    return *this;
+  }
+
+  TraceRecord &PutString(const char *text) {
+    return PutBytes(text, std::strlen(text));
+  }
+
+  void Commit() {
+    std::lock_guard<std::mutex> lock(gRecorder.mMutex);
+    if (!gRecorder.mRecording ||
+        (IsFrameOnly(mOp) && gRecorder.mFrame < gRecorder.mFirstFrame)) {
+      return;
+    }
+
+    uint32_t size = (uint32_t)mPayload.size();
+    const char *op = (const char *)&mOp;
+    const char *length = (const char *)&size;
+    std::vector<char> &buffer = gRecorder.mBuffer;
+    buffer.insert(buffer.end(), op, op + sizeof(mOp));
+    buffer.insert(buffer.end(), length, length + sizeof(size));
+    buffer.insert(buffer.end(), mPayload.begin(), mPayload.end());
+    gRecorder.mRecords++;
+
+    if (buffer.size() > (1 << 20)) {
+      FlushRecorder();
+    }
+  }
+
+private:
+  uint16_t mOp;
+  std::vector<char> mPayload;
+};
+
+// Every hooked entry point, X(name) without the gl prefix
+#define GL_TRACE_FUNCTIONS(X)                                                  \
+  X(GenBuffers)                                                                \
+  X(DeleteBuffers)                                                             \
+  X(BindBuffer)                                                                \
+  X(BufferData)                                                                \
+  X(BufferSubData)                                                             \
+  X(BindBufferBase)                                                            \
+  X(MapBufferRange)                                                            \
+  X(UnmapBuffer)                                                               \
+  X(GenVertexArrays)                                                           \
+  X(DeleteVertexArrays)                                                        \
+  X(BindVertexArray)                                                           \
+  X(EnableVertexAttribArray)                                                   \
+  X(DisableVertexAttribArray)                                                  \
+  X(VertexAttribPointer)                                                       \
+  X(VertexAttribDivisor)                                                       \
+  X(CreateShader)                                                              \
+  X(ShaderSource)                                                              \
+  X(CompileShader)                                                             \
+  X(DeleteShader)                                                              \
+  X(CreateProgram)                                                             \
+  X(AttachShader)                                                              \
+  X(DetachShader)                                                              \
+  X(LinkProgram)                                                               \
+  X(DeleteProgram)                                                             \
+  X(UseProgram)                                                                \
+  X(ProgramParameteri)                                                         \
+  X(ProgramBinary)                                                             \
+  X(TransformFeedbackVaryings)                                                 \
+  X(CreateShaderProgramv)                                                      \
+  X(GenProgramPipelines)                                                       \
+  X(DeleteProgramPipelines)                                                    \
+  X(UseProgramStages)                                                          \
+  X(BindProgramPipeline)                                                       \
+  X(GetUniformLocation)                                                        \
+  X(Uniform1i)                                                                 \
+  X(Uniform1f)                                                                 \
+  X(Uniform2f)                                                                 \
+  X(Uniform4fv)                                                                \
+  X(UniformMatrix4fv)                                                          \
+  X(ProgramUniformMatrix4fv)                                                   \
+  X(Enable)                                                                    \
+  X(Disable)                                                                   \
+  X(Viewport)                                                                  \
+  X(ClearColor)                                                                \
+  X(Clear)                                                                     \
+  X(DrawArrays)                                                                \
+  X(DrawElements)                                                              \
+  X(DrawElementsBaseVertex)                                                    \
+  X(DrawElementsInstanced)                                                     \
+  X(DrawElementsIndirect)
+
+#define GL_TRACE_DECLARE_REAL(name) static decltype(glad_gl##name) sReal##name;
+GL_TRACE_FUNCTIONS(GL_TRACE_DECLARE_REAL)
+
+static void APIENTRY TraceGenBuffers(GLsizei n, GLuint *buffers) {
+  sRealGenBuffers(n, buffers);
+  TraceRecord(kGenBuffers).PutBytes(buffers, n * sizeof(GLuint)).Commit();
+}
+
+static void APIENTRY TraceDeleteBuffers(GLsizei n, const GLuint *buffers) {
+  sRealDeleteBuffers(n, buffers);
+  TraceRecord(kDeleteBuffers).PutBytes(buffers, n * sizeof(GLuint)).Commit();
+}
+
+static void APIENTRY TraceBindBuffer(GLenum target, GLuint buffer) {
+  sRealBindBuffer(target, buffer);
+  TraceRecord(kBindBuffer).Put(target).Put(buffer).Commit();
+}
+
+static void APIENTRY TraceBufferData(GLenum target, GLsizeiptr size,
+                                     const void *data, GLenum usage) {
+  sRealBufferData(target, size, data, usage);
+  TraceRecord record(kBufferData);
+  record.Put(target).Put<int64_t>(size).Put(usage);
+  record.Put<uint8_t>(data != nullptr);
+  if (data != nullptr) {
+    record.PutBytes(data, size);
+  }
+  record.Commit();
+}
+
+static void APIENTRY TraceBufferSubData(GLenum target, GLintptr offset,
+                                        GLsizeiptr size, const void *data) {
+  sRealBufferSubData(target, offset, size, data);
+  TraceRecord(kBufferSubData)
+      .Put(target)
+      .Put<int64_t>(offset)
+      .PutBytes(data, size)
+      .Commit();
+}
+
+static void APIENTRY TraceBindBufferBase(GLenum target, GLuint index,
+                                         GLuint buffer) {
+  sRealBindBufferBase(target, index, buffer);
+  TraceRecord(kBindBufferBase).Put(target).Put(index).Put(buffer).Commit();
+}
+
+static void *APIENTRY TraceMapBufferRange(GLenum target, GLintptr offset,
+                                          GLsizeiptr length,
+                                          GLbitfield access) {
+  void *pointer = sRealMapBufferRange(target, offset, length, access);
+  std::lock_guard<std::mutex> lock(gRecorder.mMutex);
+  gRecorder.mMappings[target] = TraceMapping{
+      pointer, offset, length, (access & GL_MAP_WRITE_BIT) != 0};
+  return pointer;
+}
+
+static GLboolean APIENTRY TraceUnmapBuffer(GLenum target) {
+  // Whatever was written through the mapping replays as a sub data upload
+  TraceMapping mapping{nullptr, 0, 0, false};
+  {
+    std::lock_guard<std::mutex> lock(gRecorder.mMutex);
+    auto found = gRecorder.mMappings.find(target);
+    if (found != gRecorder.mMappings.end()) {
+      mapping = found->second;
+      gRecorder.mMappings.erase(found);
+    }
+  }
+  if (mapping.mWrite && mapping.mPointer != nullptr) {
+    TraceRecord(kBufferSubData)
+        .Put(target)
+        .Put<int64_t>(mapping.mOffset)
+        .PutBytes(mapping.mPointer, mapping.mLength)
+        .Commit();
+  }
+  return sRealUnmapBuffer(target);
+}
+
+static void APIENTRY TraceGenVertexArrays(GLsizei n, GLuint *arrays) {
+  sRealGenVertexArrays(n, arrays);
+  TraceRecord(kGenVertexArrays).PutBytes(arrays, n * sizeof(GLuint)).Commit();
+}
+
+static void APIENTRY TraceDeleteVertexArrays(GLsizei n, const GLuint *arrays) {
+  sRealDeleteVertexArrays(n, arrays);
+  TraceRecord(kDeleteVertexArrays)
+      .PutBytes(arrays, n * sizeof(GLuint))
+      .Commit();
+}
+
+static void APIENTRY TraceBindVertexArray(GLuint array) {
+  sRealBindVertexArray(array);
+  TraceRecord(kBindVertexArray).Put(array).Commit();
+}
+
+static void APIENTRY TraceEnableVertexAttribArray(GLuint index) {
+  sRealEnableVertexAttribArray(index);
+  TraceRecord(kEnableVertexAttribArray).Put(index).Commit();
+}
+
+static void APIENTRY TraceDisableVertexAttribArray(GLuint index) {
+  sRealDisableVertexAttribArray(index);
+  TraceRecord(kDisableVertexAttribArray).Put(index).Commit();
+}
+
+static void APIENTRY TraceVertexAttribPointer(GLuint index, GLint size,
+                                              GLenum type,
+                                              GLboolean normalized,
+                                              GLsizei stride,
+                                              const void *pointer) {
+  sRealVertexAttribPointer(index, size, type, normalized, stride, pointer);
+  // Core profile has no client arrays, pointer is a buffer offset
+  TraceRecord(kVertexAttribPointer)
+      .Put(index)
+      .Put(size)
+      .Put(type)
+      .Put(normalized)
+      .Put(stride)
+      .Put<uint64_t>((uintptr_t)pointer)
+      .Commit();
+}
+
+static void APIENTRY TraceVertexAttribDivisor(GLuint index, GLuint divisor) {
+  sRealVertexAttribDivisor(index, divisor);
+  TraceRecord(kVertexAttribDivisor).Put(index).Put(divisor).Commit();
+}
+
+static GLuint APIENTRY TraceCreateShader(GLenum type) {
+  GLuint shader = sRealCreateShader(type);
+  TraceRecord(kCreateShader).Put(type).Put(shader).Commit();
+  return shader;
+}
+
+static void APIENTRY TraceShaderSource(GLuint shader, GLsizei count,
+                                       const GLchar *const *string,
+                                       const GLint *length) {
+  sRealShaderSource(shader, count, string, length);
+  std::string source;
+  for (GLsizei i = 0; i < count; ++i) {
+    if (length != nullptr && length[i] >= 0) {
+      source.append(string[i], length[i]);
+    } else {
+      source.append(string[i]);
+    }
+  }
+  TraceRecord(kShaderSource)
+      .Put(shader)
+      .PutBytes(source.data(), source.size())
+      .Commit();
+}
+
+static void APIENTRY TraceCompileShader(GLuint shader) {
+  sRealCompileShader(shader);
+  TraceRecord(kCompileShader).Put(shader).Commit();
+}
+
+static void APIENTRY TraceDeleteShader(GLuint shader) {
+  sRealDeleteShader(shader);
+  TraceRecord(kDeleteShader).Put(shader).Commit();
+}
+
+static GLuint APIENTRY TraceCreateProgram() {
+  GLuint program = sRealCreateProgram();
+  TraceRecord(kCreateProgram).Put(program).Commit();
+  return program;
+}
+
+static void APIENTRY TraceAttachShader(GLuint program, GLuint shader) {
+  sRealAttachShader(program, shader);
+  TraceRecord(kAttachShader).Put(program).Put(shader).Commit();
+}
+
+static void APIENTRY TraceDetachShader(GLuint program, GLuint shader) {
+  sRealDetachShader(program, shader);
+  TraceRecord(kDetachShader).Put(program).Put(shader).Commit();
+}
+
+static void APIENTRY TraceLinkProgram(GLuint program) {
+  sRealLinkProgram(program);
+  TraceRecord(kLinkProgram).Put(program).Commit();
+}
+
+static void APIENTRY TraceDeleteProgram(GLuint program) {
+  sRealDeleteProgram(program);
+  TraceRecord(kDeleteProgram).Put(program).Commit();
+}
+
+static void APIENTRY TraceUseProgram(GLuint program) {
+  sRealUseProgram(program);
+  TraceRecord(kUseProgram).Put(program).Commit();
+}
+
+static void APIENTRY TraceProgramParameteri(GLuint program, GLenum pname,
+                                            GLint value) {
+  sRealProgramParameteri(program, pname, value);
+  TraceRecord(kProgramParameteri).Put(program).Put(pname).Put(value).Commit();
+}
+
+static void APIENTRY TraceProgramBinary(GLuint program, GLenum binaryFormat,
+                                        const void *binary, GLsizei length) {
+  sRealProgramBinary(program, binaryFormat, binary, length);
+  TraceRecord(kProgramBinary)
+      .Put(program)
+      .Put(binaryFormat)
+      .PutBytes(binary, length)
+      .Commit();
+}
+
+static void APIENTRY TraceTransformFeedbackVaryings(
+    GLuint program, GLsizei count, const GLchar *const *varyings,
+    GLenum bufferMode) {
+  sRealTransformFeedbackVaryings(program, count, varyings, bufferMode);
+  TraceRecord record(kTransformFeedbackVaryings);
+  record.Put(program).Put(bufferMode).Put(count);
+  for (GLsizei i = 0; i < count; ++i) {
+    record.PutString(varyings[i]);
+  }
+  record.Commit();
+}
+
+static GLuint APIENTRY TraceCreateShaderProgramv(GLenum type, GLsizei count,
+                                                 const GLchar *const *strings) {
+  GLuint program = sRealCreateShaderProgramv(type, count, strings);
+  std::string source;
+  for (GLsizei i = 0; i < count; ++i) {
+    source.append(strings[i]);
+  }
+  TraceRecord(kCreateShaderProgramv)
+      .Put(type)
+      .Put(program)
+      .PutBytes(source.data(), source.size())
+      .Commit();
+  return program;
+}
+
+static void APIENTRY TraceGenProgramPipelines(GLsizei n, GLuint *pipelines) {
+  sRealGenProgramPipelines(n, pipelines);
+  TraceRecord(kGenProgramPipelines)
+      .PutBytes(pipelines, n * sizeof(GLuint))
+      .Commit();
+}
+
+static void APIENTRY TraceDeleteProgramPipelines(GLsizei n,
+                                                 const GLuint *pipelines) {
+  sRealDeleteProgramPipelines(n, pipelines);
+  TraceRecord(kDeleteProgramPipelines)
+      .PutBytes(pipelines, n * sizeof(GLuint))
+      .Commit();
+}
+
+static void APIENTRY TraceUseProgramStages(GLuint pipeline, GLbitfield stages,
+                                           GLuint program) {
+  sRealUseProgramStages(pipeline, stages, program);
+  TraceRecord(kUseProgramStages)
+      .Put(pipeline)
+      .Put(stages)
+      .Put(program)
+      .Commit();
+}
+
+static void APIENTRY TraceBindProgramPipeline(GLuint pipeline) {
+  sRealBindProgramPipeline(pipeline);
+  TraceRecord(kBindProgramPipeline).Put(pipeline).Commit();
+}
+
+static GLint APIENTRY TraceGetUniformLocation(GLuint program,
+                                              const GLchar *name) {
+  GLint location = sRealGetUniformLocation(program, name);
+  // Replay looks the name up again, locations may differ between drivers
+  TraceRecord(kGetUniformLocation)
+      .Put(program)
+      .Put(location)
+      .PutString(name)
+      .Commit();
+  return location;
+}
+
+static void APIENTRY TraceUniform1i(GLint location, GLint v0) {
+  sRealUniform1i(location, v0);
+  TraceRecord(kUniform1i).Put(location).Put(v0).Commit();
+}
+
+static void APIENTRY TraceUniform1f(GLint location, GLfloat v0) {
+  sRealUniform1f(location, v0);
+  TraceRecord(kUniform1f).Put(location).Put(v0).Commit();
+}
+
+static void APIENTRY TraceUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+  sRealUniform2f(location, v0, v1);
+  TraceRecord(kUniform2f).Put(location).Put(v0).Put(v1).Commit();
+}
+
+static void APIENTRY TraceUniform4fv(GLint location, GLsizei count,
+                                     const GLfloat *value) {
+  sRealUniform4fv(location, count, value);
+  TraceRecord(kUniform4fv)
+      .Put(location)
+      .PutBytes(value, count * 4 * sizeof(GLfloat))
+      .Commit();
+}
+
+static void APIENTRY TraceUniformMatrix4fv(GLint location, GLsizei count,
+                                           GLboolean transpose,
+                                           const GLfloat *value) {
+  sRealUniformMatrix4fv(location, count, transpose, value);
+  TraceRecord(kUniformMatrix4fv)
+      .Put(location)
+      .Put(transpose)
+      .PutBytes(value, count * 16 * sizeof(GLfloat))
+      .Commit();
+}
+
+static void APIENTRY TraceProgramUniformMatrix4fv(GLuint program,
+                                                  GLint location,
+                                                  GLsizei count,
+                                                  GLboolean transpose,
+                                                  const GLfloat *value) {
+  sRealProgramUniformMatrix4fv(program, location, count, transpose, value);
+  TraceRecord(kProgramUniformMatrix4fv)
+      .Put(program)
+      .Put(location)
+      .Put(transpose)
+      .PutBytes(value, count * 16 * sizeof(GLfloat))
+      .Commit();
+}
+
+static void APIENTRY TraceEnable(GLenum cap) {
+  sRealEnable(cap);
+  TraceRecord(kEnable).Put(cap).Commit();
+}
+
+static void APIENTRY TraceDisable(GLenum cap) {
+  sRealDisable(cap);
+  TraceRecord(kDisable).Put(cap).Commit();
+}
+
+static void APIENTRY TraceViewport(GLint x, GLint y, GLsizei width,
+                                   GLsizei height) {
+  sRealViewport(x, y, width, height);
+  TraceRecord(kViewport).Put(x).Put(y).Put(width).Put(height).Commit();
+}
+
+static void APIENTRY TraceClearColor(GLfloat red, GLfloat green, GLfloat blue,
+                                     GLfloat alpha) {
+  sRealClearColor(red, green, blue, alpha);
+  TraceRecord(kClearColor).Put(red).Put(green).Put(blue).Put(alpha).Commit();
+}
+
+static void APIENTRY TraceClear(GLbitfield mask) {
+  sRealClear(mask);
+  TraceRecord(kClear).Put(mask).Commit();
+}
+
+static void APIENTRY TraceDrawArrays(GLenum mode, GLint first,
+                                     GLsizei count) {
+  sRealDrawArrays(mode, first, count);
+  TraceRecord(kDrawArrays).Put(mode).Put(first).Put(count).Commit();
+}
+
+static void APIENTRY TraceDrawElements(GLenum mode, GLsizei count,
+                                       GLenum type, const void *indices) {
+  sRealDrawElements(mode, count, type, indices);
+  TraceRecord(kDrawElements)
+      .Put(mode)
+      .Put(count)
+      .Put(type)
+      .Put<uint64_t>((uintptr_t)indices)
+      .Commit();
+}
+
+static void APIENTRY TraceDrawElementsBaseVertex(GLenum mode, GLsizei count,
+                                                 GLenum type,
+                                                 const void *indices,
+                                                 GLint basevertex) {
+  sRealDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+  TraceRecord(kDrawElementsBaseVertex)
+      .Put(mode)
+      .Put(count)
+      .Put(type)
+      .Put<uint64_t>((uintptr_t)indices)
+      .Put(basevertex)
+      .Commit();
+}
+
+static void APIENTRY TraceDrawElementsInstanced(GLenum mode, GLsizei count,
+                                                GLenum type,
+                                                const void *indices,
+                                                GLsizei instancecount) {
+  sRealDrawElementsInstanced(mode, count, type, indices, instancecount);
+  TraceRecord(kDrawElementsInstanced)
+      .Put(mode)
+      .Put(count)
+      .Put(type)
+      .Put<uint64_t>((uintptr_t)indices)
+      .Put(instancecount)
+      .Commit();
+}
+
+static void APIENTRY TraceDrawElementsIndirect(GLenum mode, GLenum type,
+                                               const void *indirect) {
+  sRealDrawElementsIndirect(mode, type, indirect);
+  TraceRecord(kDrawElementsIndirect)
+      .Put(mode)
+      .Put(type)
+      .Put<uint64_t>((uintptr_t)indirect)
+      .Commit();
+}
+
+#define GL_TRACE_INSTALL(name)                                                 \
+  sReal##name = glad_gl##name;                                                 \
+  glad_gl##name = Trace##name;
+#define GL_TRACE_UNINSTALL(name) glad_gl##name = sReal##name;
+
+static void InstallHooks() { GL_TRACE_FUNCTIONS(GL_TRACE_INSTALL) }
+
+static void UninstallHooks() { GL_TRACE_FUNCTIONS(GL_TRACE_UNINSTALL) }
+
+bool GLTraceBegin(const std::string &path, int firstFrame, int frameCount) {
+  std::lock_guard<std::mutex> lock(gRecorder.mMutex);
+  if (gRecorder.mRecording) {
+    return false;
+  }
+
+  gRecorder.mFile.open(path, std::ios::binary | std::ios::trunc);
+  if (!gRecorder.mFile.is_open()) {
+    LOG_ERROR(kLogGL, "Could not open trace {}", path);
+    return false;
+  }
+  gRecorder.mFile.write((const char *)&kTraceMagic, sizeof(kTraceMagic));
+  gRecorder.mFile.write((const char *)&kTraceVersion, sizeof(kTraceVersion));
+
+  gRecorder.mPath = path;
+  gRecorder.mFrame = 0;
+  gRecorder.mFirstFrame = firstFrame;
+  gRecorder.mEndFrame = firstFrame + frameCount;
+  gRecorder.mRecords = 0;
+  gRecorder.mRecording = true;
+
+  InstallHooks();
+
+  if (firstFrame == 0) {
+    uint16_t op = kCaptureStart;
+    uint32_t size = 0;
+    gRecorder.mBuffer.insert(gRecorder.mBuffer.end(), (const char *)&op,
+                             (const char *)&op + sizeof(op));
+    gRecorder.mBuffer.insert(gRecorder.mBuffer.end(), (const char *)&size,
+                             (const char *)&size + sizeof(size));
+  }
+  return true;
+}
+
+void GLTraceFrameEnd() {
+  if (!GLTraceIsRecording()) {
+    return;
+  }
+
+  if (gRecorder.mFrame >= gRecorder.mFirstFrame) {
+    TraceRecord(kFrameEnd).Commit();
+  }
+
+  std::lock_guard<std::mutex> lock(gRecorder.mMutex);
+  gRecorder.mFrame++;
+
+  if (gRecorder.mFrame == gRecorder.mFirstFrame) {
+    uint16_t op = kCaptureStart;
+    uint32_t size = 0;
+    gRecorder.mBuffer.insert(gRecorder.mBuffer.end(), (const char *)&op,
+                             (const char *)&op + sizeof(op));
+    gRecorder.mBuffer.insert(gRecorder.mBuffer.end(), (const char *)&size,
+                             (const char *)&size + sizeof(size));
+  }
+
+  if (gRecorder.mFrame >= gRecorder.mEndFrame) {
+    UninstallHooks();
+    FlushRecorder();
+    gRecorder.mFile.close();
+    gRecorder.mRecording = false;
+    LOG_INFO(kLogGL, "Wrote {} GL calls over {} frames to {}",
+             gRecorder.mRecords, gRecorder.mEndFrame - gRecorder.mFirstFrame,
+             gRecorder.mPath);
+  }
+}
+
+void GLTraceProgramSources(GLuint program, const std::string &vertexShaderSrc,
+                           const std::string &fragmentShaderSrc) {
+  TraceRecord(kProgramSources)
+      .Put(program)
+      .PutBytes(vertexShaderSrc.data(), vertexShaderSrc.size())
+      .PutBytes(fragmentShaderSrc.data(), fragmentShaderSrc.size())
+      .Commit();
+}
+
+bool GLTraceIsRecording() {
+  std::lock_guard<std::mutex> lock(gRecorder.mMutex);
+  return gRecorder.mRecording;
+}
+
+// Replay
+
+class TraceReader {
+
+public:
+  explicit TraceReader(const char *data) : mData(data) {}
+
+  template <typename T> T Get() {
+    T value;
+    std::memcpy(&value, mData, sizeof(T));
+    mData += sizeof(T);
+    return value;
+  }
+
+  const char *GetBytes(uint32_t *size) {
+    *size = Get<uint32_t>();
+    const char *bytes = mData;
+    mData += *size;
+    return bytes;
+  }
+
+  std::string GetString() {
+    uint32_t size;
+    const char *bytes = GetBytes(&size);
+    return std::string(bytes, size);
+  }
+
+private:
+  const char *mData;
+};
+
+struct TraceCall {
+  uint16_t mOp;
+  uint32_t mSize;
+  const char *mPayload;
+};
+
+struct ReplayState {
+  // Recorded object names -> names in the replay context
+  std::unordered_map<GLuint, GLuint> mBuffers;
+  std::unordered_map<GLuint, GLuint> mVertexArrays;
+  std::unordered_map<GLuint, GLuint> mPrograms;
+  std::unordered_map<GLuint, GLuint> mPipelines;
+  // (recorded program, recorded location) -> location
+  std::map<std::pair<GLuint, GLint>, GLint> mLocations;
+  GLuint mProgram = 0;
+};
+
+static GLuint MapName(const std::unordered_map<GLuint, GLuint> &names,
+                      GLuint name) {
+  auto found = names.find(name);
+  return found != names.end() ? found->second : 0;
+}
+
+static GLint MapLocation(const ReplayState &state, GLuint program,
+                         GLint location) {
+  auto found = state.mLocations.find(std::make_pair(program, location));
+  return found != state.mLocations.end() ? found->second : location;
+}
+
+static void GenNames(TraceReader &in,
+                     std::unordered_map<GLuint, GLuint> &names,
+                     void(APIENTRY *gen)(GLsizei, GLuint *)) {
+  uint32_t size;
+  const GLuint *recorded = (const GLuint *)in.GetBytes(&size);
+  GLsizei n = size / sizeof(GLuint);
+  std::vector<GLuint> created(n);
+  gen(n, created.data());
+  for (GLsizei i = 0; i < n; ++i) {
+    names[recorded[i]] = created[i];
+  }
+}
+
+static void DeleteNames(TraceReader &in,
+                        std::unordered_map<GLuint, GLuint> &names,
+                        void(APIENTRY *del)(GLsizei, const GLuint *)) {
+  uint32_t size;
+  const GLuint *recorded = (const GLuint *)in.GetBytes(&size);
+  GLsizei n = size / sizeof(GLuint);
+  std::vector<GLuint> mapped(n);
+  for (GLsizei i = 0; i < n; ++i) {
+    mapped[i] = MapName(names, recorded[i]);
+    names.erase(recorded[i]);
+  }
+  del(n, mapped.data());
+}
+
+// Rebuilds a program whose recorded binary this driver did not accept
+static void RelinkFromSources(GLuint program, const std::string &vertexSrc,
+                              const std::string &fragmentSrc) {
+  if (program == 0) {
+    return;
+  }
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (linked == GL_TRUE) {
+    return;
+  }
+
+  const GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+  const std::string *sources[2] = {&vertexSrc, &fragmentSrc};
+  GLuint shaders[2];
+  for (int i = 0; i < 2; ++i) {
+    const char *source = sources[i]->c_str();
+    GLint length = (GLint)sources[i]->size();
+    shaders[i] = glCreateShader(types[i]);
+    glShaderSource(shaders[i], 1, &source, &length);
+    glCompileShader(shaders[i]);
+    glAttachShader(program, shaders[i]);
+  }
+  glLinkProgram(program);
+  for (GLuint shader : shaders) {
+    glDetachShader(program, shader);
+    glDeleteShader(shader);
+  }
+}
+
+static void ReplayCall(const TraceCall &call, ReplayState &state) {
+  TraceReader in(call.mPayload);
+  uint32_t size;
+
+  switch (call.mOp) {
+  case kGenBuffers:
+    GenNames(in, state.mBuffers, glGenBuffers);
+    break;
+  case kDeleteBuffers:
+    DeleteNames(in, state.mBuffers, glDeleteBuffers);
+    break;
+  case kBindBuffer: {
+    GLenum target = in.Get<GLenum>();
+    glBindBuffer(target, MapName(state.mBuffers, in.Get<GLuint>()));
+    break;
+  }
+  case kBufferData: {
+    GLenum target = in.Get<GLenum>();
+    GLsizeiptr bytes = (GLsizeiptr)in.Get<int64_t>();
+    GLenum usage = in.Get<GLenum>();
+    const char *data = in.Get<uint8_t>() ? in.GetBytes(&size) : nullptr;
+    glBufferData(target, bytes, data, usage);
+    break;
+  }
+  case kBufferSubData: {
+    GLenum target = in.Get<GLenum>();
+    GLintptr offset = (GLintptr)in.Get<int64_t>();
+    const char *data = in.GetBytes(&size);
+    glBufferSubData(target, offset, size, data);
+    break;
+  }
+  case kBindBufferBase: {
+    GLenum target = in.Get<GLenum>();
+    GLuint index = in.Get<GLuint>();
+    glBindBufferBase(target, index, MapName(state.mBuffers, in.Get<GLuint>()));
+    break;
+  }
+  case kGenVertexArrays:
+    GenNames(in, state.mVertexArrays, glGenVertexArrays);
+    break;
+  case kDeleteVertexArrays:
+    DeleteNames(in, state.mVertexArrays, glDeleteVertexArrays);
+    break;
+  case kBindVertexArray:
+    glBindVertexArray(MapName(state.mVertexArrays, in.Get<GLuint>()));
+    break;
+  case kEnableVertexAttribArray:
+    glEnableVertexAttribArray(in.Get<GLuint>());
+    break;
+  case kDisableVertexAttribArray:
+    glDisableVertexAttribArray(in.Get<GLuint>());
+    break;
+  case kVertexAttribPointer: {
+    GLuint index = in.Get<GLuint>();
+    GLint components = in.Get<GLint>();
+    GLenum type = in.Get<GLenum>();
+    GLboolean normalized = in.Get<GLboolean>();
+    GLsizei stride = in.Get<GLsizei>();
+    uintptr_t offset = (uintptr_t)in.Get<uint64_t>();
+    glVertexAttribPointer(index, components, type, normalized, stride,
+                          (const void *)offset);
+    break;
+  }
+  case kVertexAttribDivisor: {
+    GLuint index = in.Get<GLuint>();
+    glVertexAttribDivisor(index, in.Get<GLuint>());
+    break;
+  }
+  case kCreateShader: {
+    GLenum type = in.Get<GLenum>();
+    state.mPrograms[in.Get<GLuint>()] = glCreateShader(type);
+    break;
+  }
+  case kShaderSource: {
+    GLuint shader = MapName(state.mPrograms, in.Get<GLuint>());
+    const char *source = in.GetBytes(&size);
+    GLint length = (GLint)size;
+    glShaderSource(shader, 1, &source, &length);
+    break;
+  }
+  case kCompileShader:
+    glCompileShader(MapName(state.mPrograms, in.Get<GLuint>()));
+    break;
+  case kDeleteShader: {
+    GLuint recorded = in.Get<GLuint>();
+    glDeleteShader(MapName(state.mPrograms, recorded));
+    state.mPrograms.erase(recorded);
+    break;
+  }
+  case kCreateProgram:
+    state.mPrograms[in.Get<GLuint>()] = glCreateProgram();
+    break;
+  case kAttachShader: {
+    GLuint program = MapName(state.mPrograms, in.Get<GLuint>());
+    glAttachShader(program, MapName(state.mPrograms, in.Get<GLuint>()));
+    break;
+  }
+  case kDetachShader: {
+    GLuint program = MapName(state.mPrograms, in.Get<GLuint>());
+    glDetachShader(program, MapName(state.mPrograms, in.Get<GLuint>()));
+    break;
+  }
+  case kLinkProgram:
+    glLinkProgram(MapName(state.mPrograms, in.Get<GLuint>()));
+    break;
+  case kDeleteProgram: {
+    GLuint recorded = in.Get<GLuint>();
+    glDeleteProgram(MapName(state.mPrograms, recorded));
+    state.mPrograms.erase(recorded);
+    break;
+  }
+  case kUseProgram:
+    state.mProgram = in.Get<GLuint>();
+    glUseProgram(MapName(state.mPrograms, state.mProgram));
+    break;
+  case kProgramParameteri: {
+    GLuint program = MapName(state.mPrograms, in.Get<GLuint>());
+    GLenum pname = in.Get<GLenum>();
+    glProgramParameteri(program, pname, in.Get<GLint>());
+    break;
+  }
+  case kProgramBinary: {
+    GLuint program = MapName(state.mPrograms, in.Get<GLuint>());
+    GLenum format = in.Get<GLenum>();
+    const char *binary = in.GetBytes(&size);
+    glProgramBinary(program, format, binary, size);
+    break;
+  }
+  case kProgramSources: {
+    GLuint program = MapName(state.mPrograms, in.Get<GLuint>());
+    std::string vertexSrc = in.GetString();
+    std::string fragmentSrc = in.GetString();
+    RelinkFromSources(program, vertexSrc, fragmentSrc);
+    break;
+  }
+  case kTransformFeedbackVaryings: {
+    GLuint program = MapName(state.mPrograms, in.Get<GLuint>());
+    GLenum bufferMode = in.Get<GLenum>();
+    GLsizei count = in.Get<GLsizei>();
+    std::vector<std::string> names(count);
+    std::vector<const char *> pointers(count);
+    for (GLsizei i = 0; i < count; ++i) {
+      names[i] = in.GetString();
+      pointers[i] = names[i].c_str();
+    }
+    glTransformFeedbackVaryings(program, count, pointers.data(), bufferMode);
+    break;
+  }
+  case kCreateShaderProgramv: {
+    GLenum type = in.Get<GLenum>();
+    GLuint recorded = in.Get<GLuint>();
+    std::string source = in.GetString();
+    const char *src = source.c_str();
+    state.mPrograms[recorded] = glCreateShaderProgramv(type, 1, &src);
+    break;
+  }
+  case kGenProgramPipelines:
+    GenNames(in, state.mPipelines, glGenProgramPipelines);
+    break;
+  case kDeleteProgramPipelines:
+    DeleteNames(in, state.mPipelines, glDeleteProgramPipelines);
+    break;
+  case kUseProgramStages: {
+    GLuint pipeline = MapName(state.mPipelines, in.Get<GLuint>());
+    GLbitfield stages = in.Get<GLbitfield>();
+    glUseProgramStages(pipeline, stages,
+                       MapName(state.mPrograms, in.Get<GLuint>()));
+    break;
+  }
+  case kBindProgramPipeline:
+    glBindProgramPipeline(MapName(state.mPipelines, in.Get<GLuint>()));
+    break;
+  case kGetUniformLocation: {
+    GLuint recorded = in.Get<GLuint>();
+    GLint location = in.Get<GLint>();
+    std::string name = in.GetString();
+    state.mLocations[std::make_pair(recorded, location)] = glGetUniformLocation(
+        MapName(state.mPrograms, recorded), name.c_str());
+    break;
+  }
+  case kUniform1i: {
+    GLint location = MapLocation(state, state.mProgram, in.Get<GLint>());
+    glUniform1i(location, in.Get<GLint>());
+    break;
+  }
+  case kUniform1f: {
+    GLint location = MapLocation(state, state.mProgram, in.Get<GLint>());
+    glUniform1f(location, in.Get<GLfloat>());
+    break;
+  }
+  case kUniform2f: {
+    GLint location = MapLocation(state, state.mProgram, in.Get<GLint>());
+    GLfloat v0 = in.Get<GLfloat>();
+    glUniform2f(location, v0, in.Get<GLfloat>());
+    break;
+  }
+  case kUniform4fv: {
+    GLint location = MapLocation(state, state.mProgram, in.Get<GLint>());
+    const GLfloat *value = (const GLfloat *)in.GetBytes(&size);
+    glUniform4fv(location, size / (4 * sizeof(GLfloat)), value);
+    break;
+  }
+  case kUniformMatrix4fv: {
+    GLint location = MapLocation(state, state.mProgram, in.Get<GLint>());
+    GLboolean transpose = in.Get<GLboolean>();
+    const GLfloat *value = (const GLfloat *)in.GetBytes(&size);
+    glUniformMatrix4fv(location, size / (16 * sizeof(GLfloat)), transpose,
+                       value);
+    break;
+  }
+  case kProgramUniformMatrix4fv: {
+    GLuint recorded = in.Get<GLuint>();
+    GLint location = MapLocation(state, recorded, in.Get<GLint>());
+    GLboolean transpose = in.Get<GLboolean>();
+    const GLfloat *value = (const GLfloat *)in.GetBytes(&size);
+    glProgramUniformMatrix4fv(MapName(state.mPrograms, recorded), location,
+                              size / (16 * sizeof(GLfloat)), transpose, value);
+    break;
+  }
+  case kEnable:
+    glEnable(in.Get<GLenum>());
+    break;
+  case kDisable:
+    glDisable(in.Get<GLenum>());
+    break;
+  case kViewport: {
+    GLint x = in.Get<GLint>();
+    GLint y = in.Get<GLint>();
+    GLsizei width = in.Get<GLsizei>();
+    glViewport(x, y, width, in.Get<GLsizei>());
+    break;
+  }
+  case kClearColor: {
+    GLfloat red = in.Get<GLfloat>();
+    GLfloat green = in.Get<GLfloat>();
+    GLfloat blue = in.Get<GLfloat>();
+    glClearColor(red, green, blue, in.Get<GLfloat>());
+    break;
+  }
+  case kClear:
+    glClear(in.Get<GLbitfield>());
+    break;
+  case kDrawArrays: {
+    GLenum mode = in.Get<GLenum>();
+    GLint first = in.Get<GLint>();
+    glDrawArrays(mode, first, in.Get<GLsizei>());
+    break;
+  }
+  case kDrawElements: {
+    GLenum mode = in.Get<GLenum>();
+    GLsizei count = in.Get<GLsizei>();
+    GLenum type = in.Get<GLenum>();
+    glDrawElements(mode, count, type, (const void *)in.Get<uint64_t>());
+    break;
+  }
+  case kDrawElementsBaseVertex: {
+    GLenum mode = in.Get<GLenum>();
+    GLsizei count = in.Get<GLsizei>();
+    GLenum type = in.Get<GLenum>();
+    const void *indices = (const void *)in.Get<uint64_t>();
+    glDrawElementsBaseVertex(mode, count, type, indices, in.Get<GLint>());
+    break;
+  }
+  case kDrawElementsInstanced: {
+    GLenum mode = in.Get<GLenum>();
+    GLsizei count = in.Get<GLsizei>();
+    GLenum type = in.Get<GLenum>();
+    const void *indices = (const void *)in.Get<uint64_t>();
+    glDrawElementsInstanced(mode, count, type, indices, in.Get<GLsizei>());
+    break;
+  }
+  case kDrawElementsIndirect: {
+    GLenum mode = in.Get<GLenum>();
+    GLenum type = in.Get<GLenum>();
+    glDrawElementsIndirect(mode, type, (const void *)in.Get<uint64_t>());
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+bool GLTraceReplay(const std::string &path, int loops,
+                   GLTraceReplayStats *stats) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    LOG_ERROR(kLogGL, "Could not open trace {}", path);
+    return false;
+  }
+  std::vector<char> data((size_t)file.tellg());
+  file.seekg(0);
+  file.read(data.data(), data.size());
+
+  uint32_t header[2] = {0, 0};
+  if (data.size() < sizeof(header)) {
+    LOG_ERROR(kLogGL, "{} is not a GL trace", path);
+    return false;
+  }
+  std::memcpy(header, data.data(), sizeof(header));
+  if (header[0] != kTraceMagic || header[1] != kTraceVersion) {
+    LOG_ERROR(kLogGL, "{} is not a GL trace", path);
+    return false;
+  }
+
+  // Split into calls up front so replaying is just a walk over the array
+  std::vector<TraceCall> calls;
+  size_t captureStart = 0;
+  const char *p = data.data() + sizeof(header);
+  const char *end = data.data() + data.size();
+  while (p + sizeof(uint16_t) + sizeof(uint32_t) <= end) {
+    TraceCall call;
+    std::memcpy(&call.mOp, p, sizeof(call.mOp));
+    std::memcpy(&call.mSize, p + sizeof(call.mOp), sizeof(call.mSize));
+    call.mPayload = p + sizeof(call.mOp) + sizeof(call.mSize);
+    if (call.mPayload + call.mSize > end) {
+      break;
+    }
+    if (call.mOp == kCaptureStart) {
+      captureStart = calls.size();
+    }
+    calls.push_back(call);
+    p = call.mPayload + call.mSize;
+  }
+
+  ReplayState state;
+  using Clock = std::chrono::steady_clock;
+
+  auto start = Clock::now();
+  for (size_t i = 0; i < captureStart; ++i) {
+    ReplayCall(calls[i], state);
+  }
+  glFinish();
+  stats->mSetupMs =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+  for (int loop = 0; loop < loops; ++loop) {
+    auto frameStart = Clock::now();
+    for (size_t i = captureStart; i < calls.size(); ++i) {
+      if (calls[i].mOp != kFrameEnd) {
+        ReplayCall(calls[i], state);
+        continue;
+      }
+
+      glFinish();
+      auto now = Clock::now();
+      stats->mFrameMs.push_back(
+          std::chrono::duration<double, std::milli>(now - frameStart)
+              .count());
+      stats->mFrames++;
+      frameStart = now;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,211 @@
+#include "GpuCuller.hpp"
+#include "Frustum.hpp"
+#include "Log.hpp"
+#include "RenderStats.hpp"
+#include "Shader.hpp"
+
+#include <cstddef>
+
+GpuCuller::GpuCuller()
+    : mProgram(0), mInstanceBuffer(0), mCulledBuffer(0), mIndirectBuffer(0),
+      mCullVertexArray(0), mTransformFeedback(0), mPrimitivesQuery(0),
+      mMaxInstances(0), mInstanceCount(0), mBoundingRadius(1.0f),
+      mPendingStats(0) {}
+
+bool GpuCuller::Create(GLuint maxInstances) {
+  mMaxInstances = maxInstances;
+
+  GLuint vertexShader = CompileShader(
+      GL_VERTEX_SHADER, LoadShaderAsString("./shaders/cull_vert.glsl"));
+  GLuint geometryShader = CompileShader(
+      GL_GEOMETRY_SHADER, LoadShaderAsString("./shaders/cull_geom.glsl"));
+
+  mProgram = glCreateProgram();
+  glAttachShader(mProgram, vertexShader);
+  glAttachShader(mProgram, geometryShader);
+
+  // Varyings have to be declared before linking
+  const char *varyings[] = {"culledPositionScale"};
+  glTransformFeedbackVaryings(mProgram, 1, varyings, GL_INTERLEAVED_ATTRIBS);
+  glLinkProgram(mProgram);
+
+  glDetachShader(mProgram, vertexShader);
+  glDetachShader(mProgram, geometryShader);
+  glDeleteShader(vertexShader);
+  glDeleteShader(geometryShader);
+
+  std::string log;
+  if (!ProgramLinked(mProgram, &log)) {
+    LOG_ERROR(kLogShader, "Culling program failed to link: {}", log);
+    Destroy();
+    return false;
+  }
+
+  // Input instances, read as points by the culling pass
+  glGenVertexArrays(1, &mCullVertexArray);
+  glBindVertexArray(mCullVertexArray);
+
+  glGenBuffers(1, &mInstanceBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+  glBufferData(GL_ARRAY_BUFFER, maxInstances * sizeof(glm::vec4), nullptr,
+               GL_DYNAMIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, false, 0, (void *)0);
+
+  glBindVertexArray(0);
+
+  // Surviving instances, written by transform feedback
+  glGenBuffers(1, &mCulledBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, mCulledBuffer);
+  glBufferData(GL_ARRAY_BUFFER, maxInstances * sizeof(glm::vec4), nullptr,
+               GL_DYNAMIC_COPY);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  glGenTransformFeedbacks(1, &mTransformFeedback);
+  glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, mTransformFeedback);
+  glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, mCulledBuffer);
+  glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+
+  glGenQueries(1, &mPrimitivesQuery);
+
+  DrawElementsIndirectCommand command{0, 0, 0, 0, 0};
+  glGenBuffers(1, &mIndirectBuffer);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command,
+               GL_DYNAMIC_DRAW);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+  if (!GLAD_GL_ARB_query_buffer_object) {
+    LOG_WARNING(kLogRender, "GL_ARB_query_buffer_object missing, GPU "
+                            "culling will read back its instance count");
+  }
+
+  return true;
+}
+
+void GpuCuller::Destroy() {
+  glDeleteProgram(mProgram);
+  glDeleteBuffers(1, &mInstanceBuffer);
+  glDeleteBuffers(1, &mCulledBuffer);
+  glDeleteBuffers(1, &mIndirectBuffer);
+  glDeleteVertexArrays(1, &mCullVertexArray);
+  glDeleteTransformFeedbacks(1, &mTransformFeedback);
+  glDeleteQueries(1, &mPrimitivesQuery);
+
+  mProgram = 0;
+  mInstanceBuffer = 0;
+  mCulledBuffer = 0;
+  mIndirectBuffer = 0;
+  mCullVertexArray = 0;
+  mTransformFeedback = 0;
+  mPrimitivesQuery = 0;
+  mInstanceCount = 0;
+}
+
+void GpuCuller::SetInstances(const std::vector<glm::vec4> &instances) {
+  mInstanceCount = (GLuint)instances.size();
+  if (mInstanceCount > mMaxInstances) {
+    // Called every frame, so the warning would repeat every frame
+    LOG_RATE_LIMITED(LOG_LEVEL_WARNING, kLogRender, 5000,
+                     "GpuCuller: {} instances exceeds {}, extra instances are "
+                     "ignored",
+                     mInstanceCount, mMaxInstances);
+    mInstanceCount = mMaxInstances;
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, mInstanceBuffer);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, mInstanceCount * sizeof(glm::vec4),
+                  instances.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuCuller::SetMesh(GLuint indexCount, float boundingRadius) {
+  mBoundingRadius = boundingRadius;
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+  glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+                  offsetof(DrawElementsIndirectCommand, count), sizeof(GLuint),
+                  &indexCount);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GpuCuller::AttachInstanceAttribute(GLuint vertexArrayObj,
+                                        GLuint location) const {
+  glBindVertexArray(vertexArrayObj);
+  glBindBuffer(GL_ARRAY_BUFFER, mCulledBuffer);
+  glEnableVertexAttribArray(location);
+  glVertexAttribPointer(location, 4, GL_FLOAT, false, 0, (void *)0);
+  glVertexAttribDivisor(location, 1);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuCuller::Cull(const glm::mat4 &viewProjection) {
+  Frustum frustum = ExtractFrustum(viewProjection);
+
+  // Last frame's survivors, only if the query is done by now
+  if (mPendingStats != 0) {
+    GLuint available = 0;
+    glGetQueryObjectuiv(mPrimitivesQuery, GL_QUERY_RESULT_AVAILABLE,
+                        &available);
+    if (available) {
+      GLuint visible = 0;
+      glGetQueryObjectuiv(mPrimitivesQuery, GL_QUERY_RESULT, &visible);
+      RenderStatsAdd(kRenderStatCulledIn, visible);
+      RenderStatsAdd(kRenderStatCulledOut, mPendingStats - visible);
+    }
+    mPendingStats = 0;
+  }
+
+  glUseProgram(mProgram);
+  glUniform4fv(glGetUniformLocation(mProgram, "uFrustumPlanes"), 6,
+               &frustum.planes[0][0]);
+  glUniform1f(glGetUniformLocation(mProgram, "uBoundingRadius"),
+              mBoundingRadius);
+
+  // Nothing is rasterized, we only want the captured instances
+  glEnable(GL_RASTERIZER_DISCARD);
+  glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, mTransformFeedback);
+  glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, mPrimitivesQuery);
+  glBeginTransformFeedback(GL_POINTS);
+
+  glBindVertexArray(mCullVertexArray);
+  glDrawArrays(GL_POINTS, 0, mInstanceCount);
+  glBindVertexArray(0);
+
+  glEndTransformFeedback();
+  glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+  glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+  glDisable(GL_RASTERIZER_DISCARD);
+
+  glUseProgram(0);
+
+  if (GLAD_GL_ARB_query_buffer_object) {
+    // The GPU writes the survivor count straight into the draw command
+    glBindBuffer(GL_QUERY_BUFFER, mIndirectBuffer);
+    glGetQueryObjectuiv(
+        mPrimitivesQuery, GL_QUERY_RESULT,
+        (GLuint *)offsetof(DrawElementsIndirectCommand, instanceCount));
+    glBindBuffer(GL_QUERY_BUFFER, 0);
+    mPendingStats = RenderStatsIsEnabled() ? mInstanceCount : 0;
+  } else {
+    // Fallback stalls until the culling pass has finished
+    GLuint visible = 0;
+    glGetQueryObjectuiv(mPrimitivesQuery, GL_QUERY_RESULT, &visible);
+    RenderStatsAdd(kRenderStatCulledIn, visible);
+    RenderStatsAdd(kRenderStatCulledOut, mInstanceCount - visible);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER,
+                    offsetof(DrawElementsIndirectCommand, instanceCount),
+                    sizeof(GLuint), &visible);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+}
+
+void GpuCuller::Draw(GLuint vertexArrayObj) const {
+  glBindVertexArray(vertexArrayObj);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+  glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void *)0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  glBindVertexArray(0);
+}
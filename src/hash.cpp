@@ -0,0 +1,51 @@
+#include "Hash.hpp"
+
+#include <cstring>
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+uint64_t HashWords(const void *data, size_t size, uint64_t seed) {
+  // xxHash64 style rounds on one lane, the tail byte by byte
+  static const uint64_t kPrime1 = 0x9e3779b185ebca87ull;
+  static const uint64_t kPrime2 = 0xc2b2ae3d27d4eb4full;
+  const unsigned char *bytes = (const unsigned char *)data;
+  uint64_t hash = seed ^ (size * kPrime1);
+  size_t words = size / 8;
+  for (size_t i = 0; i < words; ++i) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i * 8, 8);
+    hash ^= word * kPrime2;
+    hash = ((hash << 31) | (hash >> 33)) * kPrime1;
+  }
+  hash = HashBytes(bytes + words * 8, size - words * 8, hash);
+  // Final avalanche so every input bit reaches the low bits buckets use
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  return hash;
+}
+
+uint64_t HashString(const std::string &text, uint64_t seed) {
+  // Hash the length too so ("ab", "c") and ("a", "bc") differ
+  uint64_t length = text.size();
+  seed = HashBytes(&length, sizeof(length), seed);
+  return HashBytes(text.data(), text.size(), seed);
+}
+
+std::string HashToHex(uint64_t hash) {
+  static const char digits[] = "0123456789abcdef";
+  std::string hex(16, '0');
+  for (int i = 15; i >= 0; --i) {
+    hex[i] = digits[hash & 0xf];
+    hash >>= 4;
+  }
+  return hex;
+}
@@ -0,0 +1,168 @@
+#include "HeadlessContext.hpp"
+
+#include "Log.hpp"
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+static void *EGLProcAddress(const char *name) {
+  return (void *)eglGetProcAddress(name);
+}
+
+static EGLDisplay OpenDisplay() {
+  // Surfaceless needs neither X nor a DRM device
+  auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  if (getPlatformDisplay != nullptr) {
+    EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                            EGL_DEFAULT_DISPLAY, nullptr);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+      return display;
+    }
+  }
+
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) {
+    return display;
+  }
+  return EGL_NO_DISPLAY;
+}
+#endif
+
+HeadlessContext::~HeadlessContext() { Destroy(); }
+
+bool HeadlessContext::Create(int width, int height) {
+#if defined(__linux__)
+  EGLDisplay display = OpenDisplay();
+  if (display == EGL_NO_DISPLAY) {
+    LOG_ERROR(kLogGL, "No EGL display available");
+    return false;
+  }
+  mDisplay = display;
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    LOG_ERROR(kLogGL, "EGL does not support desktop OpenGL");
+    Destroy();
+    return false;
+  }
+
+  const EGLint configAttribs[] = {EGL_SURFACE_TYPE,
+                                  EGL_PBUFFER_BIT,
+                                  EGL_RENDERABLE_TYPE,
+                                  EGL_OPENGL_BIT,
+                                  EGL_RED_SIZE,
+                                  8,
+                                  EGL_GREEN_SIZE,
+                                  8,
+                                  EGL_BLUE_SIZE,
+                                  8,
+                                  EGL_DEPTH_SIZE,
+                                  24,
+                                  EGL_NONE};
+  EGLConfig config = nullptr;
+  EGLint configCount = 0;
+  eglChooseConfig(display, configAttribs, &config, 1, &configCount);
+
+  const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                   4,
+                                   EGL_CONTEXT_MINOR_VERSION,
+                                   1,
+                                   EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                   EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                   EGL_NONE};
+  mContext = eglCreateContext(display, configCount > 0 ? config : nullptr,
+                              EGL_NO_CONTEXT, contextAttribs);
+  if (mContext == EGL_NO_CONTEXT) {
+    LOG_ERROR(kLogGL, "Could not create an EGL OpenGL 4.1 context");
+    Destroy();
+    return false;
+  }
+
+  // Surfaceless first, a tiny pbuffer when the driver insists on a surface
+  if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, mContext)) {
+    const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    mSurface = configCount > 0
+                   ? eglCreatePbufferSurface(display, config, pbufferAttribs)
+                   : EGL_NO_SURFACE;
+    if (mSurface == EGL_NO_SURFACE ||
+        !eglMakeCurrent(display, mSurface, mSurface, mContext)) {
+      LOG_ERROR(kLogGL, "Could not make the EGL context current");
+      Destroy();
+      return false;
+    }
+  }
+
+  if (!gladLoadGLLoader(EGLProcAddress)) {
+    LOG_ERROR(kLogGL, "glad was not initialized");
+    Destroy();
+    return false;
+  }
+
+  return CreateFramebuffer(width, height);
+#else
+  LOG_ERROR(kLogGL, "Headless rendering needs EGL, which is Linux only");
+  return false;
+#endif
+}
+
+bool HeadlessContext::CreateFramebuffer(int width, int height) {
+  glGenRenderbuffers(1, &mColorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, mColorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+  glGenRenderbuffers(1, &mDepthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, mDepthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &mFramebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                            GL_RENDERBUFFER, mColorBuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                            GL_RENDERBUFFER, mDepthBuffer);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    LOG_ERROR(kLogGL, "Offscreen framebuffer is incomplete");
+    Destroy();
+    return false;
+  }
+  return true;
+}
+
+void HeadlessContext::Destroy() {
+#if defined(__linux__)
+  if (mDisplay == nullptr) {
+    return;
+  }
+
+  if (mContext != EGL_NO_CONTEXT) {
+    // Zero unless glad loaded and the framebuffer was started
+    if (mFramebuffer != 0) {
+      glDeleteFramebuffers(1, &mFramebuffer);
+    }
+    if (mColorBuffer != 0) {
+      glDeleteRenderbuffers(1, &mColorBuffer);
+    }
+    if (mDepthBuffer != 0) {
+      glDeleteRenderbuffers(1, &mDepthBuffer);
+    }
+    mFramebuffer = mColorBuffer = mDepthBuffer = 0;
+
+    eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(mDisplay, mContext);
+    mContext = nullptr;
+  }
+  if (mSurface != EGL_NO_SURFACE) {
+    eglDestroySurface(mDisplay, mSurface);
+    mSurface = nullptr;
+  }
+  eglTerminate(mDisplay);
+  mDisplay = nullptr;
+#endif
+}
@@ -0,0 +1,930 @@
+#include "Image.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <glad/glad.h>
+#include <glm/gtc/packing.hpp>
+
+#include "Inflate.hpp"
+
+static uint32_t ReadBe32(const uint8_t *data) {
+  return (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 |
+         (uint32_t)data[2] << 8 | data[3];
+}
+
+static uint16_t ReadLe16(const uint8_t *data) {
+  return (uint16_t)(data[0] | data[1] << 8);
+}
+
+static uint32_t ReadLe32(const uint8_t *data) {
+  return (uint32_t)data[0] | (uint32_t)data[1] << 8 |
+         (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static bool Fail(std::string *error, const char *message) {
+  if (error != nullptr) {
+    *error = message;
+  }
+  return false;
+}
+
+// Checked before anything the size of the image is allocated
+static bool SizeAllowed(int width, int height, int maxSize) {
+  return width > 0 && height > 0 && width <= maxSize && height <= maxSize;
+}
+
+// Sets up a single level of format
+static void AllocateSingleLevel(Image *image, ImageFormat format, int width,
+                                int height) {
+  image->mFormat = format;
+  image->mLevels.clear();
+  ImageLevel level;
+  level.mWidth = width;
+  level.mHeight = height;
+  level.mSize = ImageLevelSize(format, width, height);
+  image->mLevels.push_back(level);
+  image->mData.assign(level.mSize, 0);
+}
+
+bool ImageFormatIsCompressed(ImageFormat format) {
+  return format == kImageBc1 || format == kImageBc2 || format == kImageBc3;
+}
+
+size_t ImageRowSize(ImageFormat format, int width) {
+  switch (format) {
+  case kImageRgba8:
+    return (size_t)width * 4;
+  case kImageRgba16f:
+    return (size_t)width * 8;
+  case kImageBc1:
+    return (size_t)std::max(1, (width + 3) / 4) * 8;
+  case kImageBc2:
+  case kImageBc3:
+    return (size_t)std::max(1, (width + 3) / 4) * 16;
+  }
+  return 0;
+}
+
+int ImageRowHeight(ImageFormat format) {
+  return ImageFormatIsCompressed(format) ? 4 : 1;
+}
+
+size_t ImageLevelSize(ImageFormat format, int width, int height) {
+  int rowHeight = ImageRowHeight(format);
+  int rows = std::max(1, (height + rowHeight - 1) / rowHeight);
+  return ImageRowSize(format, width) * rows;
+}
+
+// PNG ------------------------------------------------------------------------
+
+static const uint8_t kPngSignature[8] = {0x89, 'P',  'N',  'G',
+                                         '\r', '\n', 0x1a, '\n'};
+
+static uint8_t Paeth(int a, int b, int c) {
+  int p = a + b - c;
+  int pa = std::abs(p - a);
+  int pb = std::abs(p - b);
+  int pc = std::abs(p - c);
+  if (pa <= pb && pa <= pc) {
+    return (uint8_t)a;
+  }
+  return (uint8_t)(pb <= pc ? b : c);
+}
+
+static bool Unfilter(uint8_t type, uint8_t *row, const uint8_t *previous,
+                     size_t rowBytes, size_t pixelBytes) {
+  switch (type) {
+  case 0:
+    return true;
+  case 1:
+    for (size_t i = pixelBytes; i < rowBytes; ++i) {
+      row[i] += row[i - pixelBytes];
+    }
+    return true;
+  case 2:
+    for (size_t i = 0; i < rowBytes; ++i) {
+      row[i] += previous[i];
+    }
+    return true;
+  case 3:
+    for (size_t i = 0; i < rowBytes; ++i) {
+      int left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+      row[i] += (uint8_t)((left + previous[i]) / 2);
+    }
+    return true;
+  case 4:
+    for (size_t i = 0; i < rowBytes; ++i) {
+      int left = i >= pixelBytes ? row[i - pixelBytes] : 0;
+      int upLeft = i >= pixelBytes ? previous[i - pixelBytes] : 0;
+      row[i] += Paeth(left, previous[i], upLeft);
+    }
+    return true;
+  }
+  return false;
+}
+
+struct PngInfo {
+  int mWidth = 0;
+  int mHeight = 0;
+  int mBitDepth = 0;
+  int mColorType = 0;
+  int mChannels = 0;
+  bool mInterlaced = false;
+  std::vector<uint8_t> mPalette;
+  std::vector<uint8_t> mPaletteAlpha;
+  // tRNS color key of gray and RGB images, in sample units
+  bool mHasKey = false;
+  uint16_t mKey[3] = {};
+};
+
+static uint16_t PngSample(const uint8_t *row, int index, int bitDepth) {
+  if (bitDepth == 8) {
+    return row[index];
+  }
+  if (bitDepth == 16) {
+    return (uint16_t)(row[index * 2] << 8 | row[index * 2 + 1]);
+  }
+  int bit = index * bitDepth;
+  return (uint16_t)((row[bit / 8] >> (8 - bitDepth - bit % 8)) &
+                    ((1 << bitDepth) - 1));
+}
+
+static uint8_t PngTo8Bits(uint16_t sample, int bitDepth) {
+  if (bitDepth == 16) {
+    return (uint8_t)(sample >> 8);
+  }
+  return (uint8_t)(sample * 255 / ((1 << bitDepth) - 1));
+}
+
+// Expands one unfiltered row of a pass into RGBA8 pixels
+static void PngConvertRow(const PngInfo &info, const uint8_t *row, int count,
+                          uint8_t *out, int outStep) {
+  for (int x = 0; x < count; ++x, out += outStep) {
+    uint16_t samples[4] = {};
+    for (int c = 0; c < info.mChannels; ++c) {
+      samples[c] = PngSample(row, x * info.mChannels + c, info.mBitDepth);
+    }
+
+    switch (info.mColorType) {
+    case 0:
+    case 4: {
+      uint8_t gray = PngTo8Bits(samples[0], info.mBitDepth);
+      out[0] = out[1] = out[2] = gray;
+      out[3] = info.mColorType == 4 ? PngTo8Bits(samples[1], info.mBitDepth)
+                                    : 255;
+      if (info.mHasKey && samples[0] == info.mKey[0]) {
+        out[3] = 0;
+      }
+      break;
+    }
+    case 2:
+    case 6:
+      for (int c = 0; c < 3; ++c) {
+        out[c] = PngTo8Bits(samples[c], info.mBitDepth);
+      }
+      out[3] = info.mColorType == 6 ? PngTo8Bits(samples[3], info.mBitDepth)
+                                    : 255;
+      if (info.mHasKey && samples[0] == info.mKey[0] &&
+          samples[1] == info.mKey[1] && samples[2] == info.mKey[2]) {
+        out[3] = 0;
+      }
+      break;
+    case 3: {
+      size_t index = samples[0];
+      if (index * 3 + 2 < info.mPalette.size()) {
+        out[0] = info.mPalette[index * 3];
+        out[1] = info.mPalette[index * 3 + 1];
+        out[2] = info.mPalette[index * 3 + 2];
+      }
+      out[3] = index < info.mPaletteAlpha.size() ? info.mPaletteAlpha[index]
+                                                 : 255;
+      break;
+    }
+    }
+  }
+}
+
+static bool DecodePng(const uint8_t *data, size_t size, Image *image,
+                      int maxSize, std::string *error) {
+  PngInfo info;
+  std::vector<uint8_t> compressed;
+  bool ended = false;
+
+  size_t position = sizeof(kPngSignature);
+  while (!ended && position + 12 <= size) {
+    uint32_t length = ReadBe32(data + position);
+    const uint8_t *type = data + position + 4;
+    const uint8_t *chunk = data + position + 8;
+    if (length > size - position - 12) {
+      return Fail(error, "PNG chunk runs past the end of the file");
+    }
+    position += 12 + length;
+
+    if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+      info.mWidth = (int)ReadBe32(chunk);
+      info.mHeight = (int)ReadBe32(chunk + 4);
+      info.mBitDepth = chunk[8];
+      info.mColorType = chunk[9];
+      info.mInterlaced = chunk[12] == 1;
+    } else if (std::memcmp(type, "PLTE", 4) == 0) {
+      info.mPalette.assign(chunk, chunk + length);
+    } else if (std::memcmp(type, "tRNS", 4) == 0) {
+      if (info.mColorType == 3) {
+        info.mPaletteAlpha.assign(chunk, chunk + length);
+      } else if (info.mColorType == 0 && length >= 2) {
+        info.mHasKey = true;
+        info.mKey[0] = (uint16_t)(chunk[0] << 8 | chunk[1]);
+      } else if (info.mColorType == 2 && length >= 6) {
+        info.mHasKey = true;
+        for (int c = 0; c < 3; ++c) {
+          info.mKey[c] = (uint16_t)(chunk[c * 2] << 8 | chunk[c * 2 + 1]);
+        }
+      }
+    } else if (std::memcmp(type, "IDAT", 4) == 0) {
+      compressed.insert(compressed.end(), chunk, chunk + length);
+    } else if (std::memcmp(type, "IEND", 4) == 0) {
+      ended = true;
+    }
+  }
+
+  static const int channels[7] = {1, 0, 3, 1, 2, 0, 4};
+  if (info.mColorType > 6 || channels[info.mColorType] == 0) {
+    return Fail(error, "Unknown PNG color type");
+  }
+  info.mChannels = channels[info.mColorType];
+  int depth = info.mBitDepth;
+  bool depthValid = depth == 8 || (depth == 16 && info.mColorType != 3) ||
+                    ((depth == 1 || depth == 2 || depth == 4) &&
+                     (info.mColorType == 0 || info.mColorType == 3));
+  if (!depthValid) {
+    return Fail(error, "Unsupported PNG bit depth");
+  }
+  if (!SizeAllowed(info.mWidth, info.mHeight, maxSize)) {
+    return Fail(error, "PNG size out of range");
+  }
+  if (info.mColorType == 3 && info.mPalette.empty()) {
+    return Fail(error, "PNG palette missing");
+  }
+
+  struct Pass {
+    int mX, mY, mStepX, mStepY;
+  };
+  static const Pass adam7[7] = {{0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8},
+                                {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2},
+                                {0, 1, 1, 2}};
+  static const Pass whole = {0, 0, 1, 1};
+  const Pass *passes = info.mInterlaced ? adam7 : &whole;
+  int passCount = info.mInterlaced ? 7 : 1;
+
+  // A filter byte and the packed pixels of every row of every pass; the
+  // stream may not inflate to more
+  int bitsPerPixel = info.mChannels * depth;
+  size_t rawSize = 0;
+  for (int p = 0; p < passCount; ++p) {
+    const Pass &pass = passes[p];
+    int width = (info.mWidth - pass.mX + pass.mStepX - 1) / pass.mStepX;
+    int height = (info.mHeight - pass.mY + pass.mStepY - 1) / pass.mStepY;
+    if (width > 0 && height > 0) {
+      rawSize += (size_t)height * (1 + ((size_t)width * bitsPerPixel + 7) / 8);
+    }
+  }
+
+  std::vector<uint8_t> raw;
+  raw.reserve(rawSize);
+  if (!ZlibDecompress(compressed.data(), compressed.size(), &raw, rawSize)) {
+    return Fail(error, "PNG image data is corrupt");
+  }
+
+  AllocateSingleLevel(image, kImageRgba8, info.mWidth, info.mHeight);
+
+  size_t pixelBytes = std::max(1, bitsPerPixel / 8);
+  size_t read = 0;
+  for (int p = 0; p < passCount; ++p) {
+    const Pass &pass = passes[p];
+    int width = (info.mWidth - pass.mX + pass.mStepX - 1) / pass.mStepX;
+    int height = (info.mHeight - pass.mY + pass.mStepY - 1) / pass.mStepY;
+    if (width <= 0 || height <= 0) {
+      continue;
+    }
+
+    size_t rowBytes = ((size_t)width * bitsPerPixel + 7) / 8;
+    std::vector<uint8_t> previous(rowBytes, 0);
+    for (int y = 0; y < height; ++y) {
+      if (read + 1 + rowBytes > raw.size()) {
+        return Fail(error, "PNG image data is truncated");
+      }
+      uint8_t *row = raw.data() + read + 1;
+      if (!Unfilter(raw[read], row, previous.data(), rowBytes, pixelBytes)) {
+        return Fail(error, "Unknown PNG filter");
+      }
+      read += 1 + rowBytes;
+
+      size_t outRow = (size_t)(pass.mY + y * pass.mStepY) * info.mWidth;
+      PngConvertRow(info, row, width,
+                    image->mData.data() + (outRow + pass.mX) * 4,
+                    pass.mStepX * 4);
+      previous.assign(row, row + rowBytes);
+    }
+  }
+  return true;
+}
+
+// TGA ------------------------------------------------------------------------
+
+// BGR(A) or gray pixel of bytes bytes to RGBA8
+static void TgaPixel(const uint8_t *pixel, int bytes, bool alpha16,
+                     uint8_t *out) {
+  switch (bytes) {
+  case 1:
+    out[0] = out[1] = out[2] = pixel[0];
+    out[3] = 255;
+    break;
+  case 2: {
+    uint16_t value = ReadLe16(pixel);
+    out[0] = (uint8_t)(((value >> 10) & 31) * 255 / 31);
+    out[1] = (uint8_t)(((value >> 5) & 31) * 255 / 31);
+    out[2] = (uint8_t)((value & 31) * 255 / 31);
+    out[3] = alpha16 && !(value & 0x8000) ? 0 : 255;
+    break;
+  }
+  case 3:
+  case 4:
+    out[0] = pixel[2];
+    out[1] = pixel[1];
+    out[2] = pixel[0];
+    out[3] = bytes == 4 ? pixel[3] : 255;
+    break;
+  }
+}
+
+static bool DecodeTga(const uint8_t *data, size_t size, Image *image,
+                      int maxSize, std::string *error) {
+  if (size < 18) {
+    return Fail(error, "Not a known image format");
+  }
+  int idLength = data[0];
+  int colorMapType = data[1];
+  int imageType = data[2];
+  int mapFirst = ReadLe16(data + 3);
+  int mapLength = ReadLe16(data + 5);
+  int mapEntryBits = data[7];
+  int width = ReadLe16(data + 12);
+  int height = ReadLe16(data + 14);
+  int pixelBits = data[16];
+  int descriptor = data[17];
+
+  bool rle = imageType >= 9;
+  int baseType = rle ? imageType - 8 : imageType;
+  bool mapped = baseType == 1;
+  if ((baseType < 1 || baseType > 3) || colorMapType > 1 ||
+      (mapped && colorMapType != 1) || width == 0 || height == 0) {
+    return Fail(error, "Not a known image format");
+  }
+  if (!SizeAllowed(width, height, maxSize)) {
+    return Fail(error, "TGA size out of range");
+  }
+  int pixelBytes = (pixelBits + 7) / 8;
+  int mapEntryBytes = (mapEntryBits + 7) / 8;
+  if (pixelBytes < 1 || pixelBytes > 4 || (mapped && pixelBytes > 2) ||
+      (colorMapType == 1 && (mapEntryBytes < 2 || mapEntryBytes > 4))) {
+    return Fail(error, "Unsupported TGA pixel format");
+  }
+  bool alpha16 = (descriptor & 15) != 0;
+
+  size_t position = 18 + idLength;
+  const uint8_t *colorMap = data + position;
+  if (colorMapType == 1) {
+    position += (size_t)mapLength * mapEntryBytes;
+  }
+  if (position > size) {
+    return Fail(error, "TGA file is truncated");
+  }
+
+  AllocateSingleLevel(image, kImageRgba8, width, height);
+  size_t pixels = (size_t)width * height;
+  auto readPixel = [&](const uint8_t *pixel, uint8_t *out) {
+    if (!mapped) {
+      TgaPixel(pixel, pixelBytes, alpha16, out);
+      return;
+    }
+    int index = (pixelBytes == 1 ? pixel[0] : ReadLe16(pixel)) - mapFirst;
+    if (index < 0 || index >= mapLength) {
+      std::memset(out, 0, 4);
+      return;
+    }
+    TgaPixel(colorMap + (size_t)index * mapEntryBytes, mapEntryBytes, true,
+             out);
+  };
+
+  uint8_t *out = image->mData.data();
+  for (size_t i = 0; i < pixels;) {
+    if (!rle) {
+      if (position + pixelBytes > size) {
+        return Fail(error, "TGA file is truncated");
+      }
+      readPixel(data + position, out + i * 4);
+      position += pixelBytes;
+      ++i;
+      continue;
+    }
+
+    if (position >= size) {
+      return Fail(error, "TGA file is truncated");
+    }
+    uint8_t header = data[position++];
+    size_t count = std::min<size_t>((header & 0x7f) + 1, pixels - i);
+    bool run = (header & 0x80) != 0;
+    size_t needed = run ? pixelBytes : count * pixelBytes;
+    if (position + needed > size) {
+      return Fail(error, "TGA file is truncated");
+    }
+    for (size_t j = 0; j < count; ++j, ++i) {
+      readPixel(data + position + (run ? 0 : j * pixelBytes), out + i * 4);
+    }
+    position += needed;
+  }
+
+  // Stored bottom up unless the descriptor says otherwise
+  if ((descriptor & 0x20) == 0) {
+    size_t rowBytes = (size_t)width * 4;
+    for (int y = 0; y < height / 2; ++y) {
+      std::swap_ranges(out + y * rowBytes, out + (y + 1) * rowBytes,
+                       out + (height - 1 - y) * rowBytes);
+    }
+  }
+  if ((descriptor & 0x10) != 0) {
+    uint32_t *rows = (uint32_t *)out;
+    for (int y = 0; y < height; ++y) {
+      std::reverse(rows + (size_t)y * width, rows + (size_t)(y + 1) * width);
+    }
+  }
+  return true;
+}
+
+// Radiance HDR ---------------------------------------------------------------
+
+static bool DecodeHdr(const uint8_t *data, size_t size, Image *image,
+                      int maxSize, std::string *error) {
+  // Header lines up to an empty one, then the resolution line
+  size_t position = 0;
+  auto readLine = [&](std::string *line) {
+    line->clear();
+    while (position < size && data[position] != '\n') {
+      line->push_back((char)data[position++]);
+    }
+    if (position >= size) {
+      return false;
+    }
+    ++position;
+    return true;
+  };
+
+  std::string line;
+  while (true) {
+    if (!readLine(&line)) {
+      return Fail(error, "HDR header is truncated");
+    }
+    if (line.empty()) {
+      break;
+    }
+    if (line.compare(0, 7, "FORMAT=") == 0 &&
+        line != "FORMAT=32-bit_rle_rgbe") {
+      return Fail(error, "Only RGBE HDR files are supported");
+    }
+  }
+
+  int width = 0;
+  int height = 0;
+  if (!readLine(&line) ||
+      std::sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2 ||
+      !SizeAllowed(width, height, maxSize)) {
+    return Fail(error, "Unsupported HDR orientation or size");
+  }
+
+  AllocateSingleLevel(image, kImageRgba16f, width, height);
+  std::vector<uint8_t> scanline((size_t)width * 4);
+  uint16_t *out = (uint16_t *)image->mData.data();
+  for (int y = 0; y < height; ++y) {
+    if (position + 4 > size) {
+      return Fail(error, "HDR file is truncated");
+    }
+    const uint8_t *start = data + position;
+    bool newRle = width >= 8 && width < 32768 && start[0] == 2 &&
+                  start[1] == 2 && ((start[2] << 8) | start[3]) == width;
+
+    if (newRle) {
+      // Each channel run length encoded separately
+      position += 4;
+      for (int c = 0; c < 4; ++c) {
+        for (int x = 0; x < width;) {
+          if (position >= size) {
+            return Fail(error, "HDR file is truncated");
+          }
+          int count = data[position++];
+          bool run = count > 128;
+          if (run) {
+            count -= 128;
+          }
+          if (count == 0 || x + count > width ||
+              position + (run ? 1 : count) > size) {
+            return Fail(error, "HDR scanline is corrupt");
+          }
+          for (int i = 0; i < count; ++i, ++x) {
+            scanline[(size_t)x * 4 + c] = data[position + (run ? 0 : i)];
+          }
+          position += run ? 1 : count;
+        }
+      }
+    } else {
+      // Flat pixels, where 1,1,1,n repeats the previous pixel
+      int shift = 0;
+      for (int x = 0; x < width;) {
+        if (position + 4 > size) {
+          return Fail(error, "HDR file is truncated");
+        }
+        const uint8_t *pixel = data + position;
+        position += 4;
+        if (pixel[0] == 1 && pixel[1] == 1 && pixel[2] == 1) {
+          int count = pixel[3] << shift;
+          if (x == 0 || x + count > width) {
+            return Fail(error, "HDR scanline is corrupt");
+          }
+          for (int i = 0; i < count; ++i, ++x) {
+            std::memcpy(&scanline[(size_t)x * 4],
+                        &scanline[(size_t)(x - 1) * 4], 4);
+          }
+          shift += 8;
+          continue;
+        }
+        std::memcpy(&scanline[(size_t)x * 4], pixel, 4);
+        shift = 0;
+        ++x;
+      }
+    }
+
+    for (int x = 0; x < width; ++x) {
+      const uint8_t *rgbe = &scanline[(size_t)x * 4];
+      float scale = rgbe[3] == 0 ? 0.0f : std::ldexp(1.0f, rgbe[3] - 136);
+      uint16_t *pixel = out + ((size_t)y * width + x) * 4;
+      for (int c = 0; c < 3; ++c) {
+        pixel[c] = glm::packHalf1x16(rgbe[c] * scale);
+      }
+      pixel[3] = glm::packHalf1x16(1.0f);
+    }
+  }
+  return true;
+}
+
+// KTX ------------------------------------------------------------------------
+
+static const uint8_t kKtxIdentifier[12] = {0xab, 'K',  'T',  'X',
+                                           ' ',  '1',  '1',  0xbb,
+                                           '\r', '\n', 0x1a, '\n'};
+
+static bool KtxFormat(uint32_t internalFormat, ImageFormat *format,
+                      bool *srgb) {
+  *srgb = false;
+  switch (internalFormat) {
+  case GL_SRGB8_ALPHA8:
+    *srgb = true;
+    // fallthrough
+  case GL_RGBA8:
+    *format = kImageRgba8;
+    return true;
+  case GL_RGBA16F:
+    *format = kImageRgba16f;
+    return true;
+  case GL_COMPRESSED_SRGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+    *srgb = true;
+    // fallthrough
+  case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+  case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+    *format = kImageBc1;
+    return true;
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+    *srgb = true;
+    // fallthrough
+  case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+    *format = kImageBc2;
+    return true;
+  case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+    *srgb = true;
+    // fallthrough
+  case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    *format = kImageBc3;
+    return true;
+  }
+  return false;
+}
+
+static uint32_t KtxInternalFormat(ImageFormat format, bool srgb) {
+  switch (format) {
+  case kImageRgba8:
+    return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  case kImageRgba16f:
+    return GL_RGBA16F;
+  case kImageBc1:
+    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+                : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+  case kImageBc2:
+    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+                : GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+  case kImageBc3:
+    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  }
+  return GL_RGBA8;
+}
+
+// Copies levels stored back to back, each preceded by its size when
+// sizePrefixed (KTX) and padded to 4 bytes
+static bool ReadLevels(const uint8_t *data, size_t size, size_t position,
+                       int width, int height, int levels, bool sizePrefixed,
+                       Image *image, std::string *error) {
+  image->mLevels.clear();
+  image->mData.clear();
+  for (int i = 0; i < levels; ++i) {
+    ImageLevel level;
+    level.mWidth = std::max(1, width >> i);
+    level.mHeight = std::max(1, height >> i);
+    level.mSize = ImageLevelSize(image->mFormat, level.mWidth, level.mHeight);
+    level.mOffset = image->mData.size();
+
+    size_t stored = level.mSize;
+    if (sizePrefixed) {
+      if (position + 4 > size) {
+        return Fail(error, "Image file is truncated");
+      }
+      stored = ReadLe32(data + position);
+      position += 4;
+      if (stored < level.mSize) {
+        return Fail(error, "Image level is smaller than its size");
+      }
+    }
+    if (position + stored > size) {
+      return Fail(error, "Image file is truncated");
+    }
+    image->mData.insert(image->mData.end(), data + position,
+                        data + position + level.mSize);
+    position += stored;
+    if (sizePrefixed) {
+      position += (4 - stored % 4) % 4;
+    }
+    image->mLevels.push_back(level);
+  }
+  return true;
+}
+
+static bool DecodeKtx(const uint8_t *data, size_t size, Image *image,
+                      int maxSize, std::string *error) {
+  if (size < 64) {
+    return Fail(error, "KTX file is truncated");
+  }
+  if (ReadLe32(data + 12) != 0x04030201) {
+    return Fail(error, "Big endian KTX files are not supported");
+  }
+  uint32_t internalFormat = ReadLe32(data + 28);
+  int width = (int)ReadLe32(data + 36);
+  int height = (int)ReadLe32(data + 40);
+  uint32_t depth = ReadLe32(data + 44);
+  uint32_t arrayElements = ReadLe32(data + 48);
+  uint32_t faces = ReadLe32(data + 52);
+  int levels = std::max(1, (int)ReadLe32(data + 56));
+  uint32_t keyValueBytes = ReadLe32(data + 60);
+
+  if (width <= 0 || height <= 0 || depth > 1 || arrayElements > 0 ||
+      faces != 1) {
+    return Fail(error, "Only 2D KTX textures are supported");
+  }
+  if (!SizeAllowed(width, height, maxSize)) {
+    return Fail(error, "KTX size out of range");
+  }
+  if (!KtxFormat(internalFormat, &image->mFormat, &image->mSrgb)) {
+    return Fail(error, "Unsupported KTX format");
+  }
+  if (levels > 32 || (size_t)keyValueBytes > size - 64) {
+    return Fail(error, "KTX header is corrupt");
+  }
+  return ReadLevels(data, size, 64 + keyValueBytes, width, height, levels,
+                    true, image, error);
+}
+
+// DDS ------------------------------------------------------------------------
+
+static uint32_t FourCC(const char *code) {
+  return (uint32_t)code[0] | (uint32_t)code[1] << 8 |
+         (uint32_t)code[2] << 16 | (uint32_t)code[3] << 24;
+}
+
+static bool DxgiFormat(uint32_t dxgi, ImageFormat *format, bool *srgb,
+                       bool *bgra) {
+  *srgb = false;
+  *bgra = false;
+  switch (dxgi) {
+  case 10: // R16G16B16A16_FLOAT
+    *format = kImageRgba16f;
+    return true;
+  case 29: // R8G8B8A8_UNORM_SRGB
+    *srgb = true;
+    // fallthrough
+  case 28: // R8G8B8A8_UNORM
+    *format = kImageRgba8;
+    return true;
+  case 91: // B8G8R8A8_UNORM_SRGB
+    *srgb = true;
+    // fallthrough
+  case 87: // B8G8R8A8_UNORM
+    *format = kImageRgba8;
+    *bgra = true;
+    return true;
+  case 72: // BC1_UNORM_SRGB
+    *srgb = true;
+    // fallthrough
+  case 71: // BC1_UNORM
+    *format = kImageBc1;
+    return true;
+  case 75: // BC2_UNORM_SRGB
+    *srgb = true;
+    // fallthrough
+  case 74: // BC2_UNORM
+    *format = kImageBc2;
+    return true;
+  case 78: // BC3_UNORM_SRGB
+    *srgb = true;
+    // fallthrough
+  case 77: // BC3_UNORM
+    *format = kImageBc3;
+    return true;
+  }
+  return false;
+}
+
+static bool DecodeDds(const uint8_t *data, size_t size, Image *image,
+                      int maxSize, std::string *error) {
+  if (size < 128 || ReadLe32(data + 4) != 124) {
+    return Fail(error, "DDS file is truncated");
+  }
+  const uint8_t *header = data + 4;
+  uint32_t flags = ReadLe32(header + 4);
+  int height = (int)ReadLe32(header + 8);
+  int width = (int)ReadLe32(header + 12);
+  int levels = (flags & 0x20000) ? std::max(1, (int)ReadLe32(header + 24)) : 1;
+  uint32_t pixelFlags = ReadLe32(header + 76);
+  uint32_t fourCC = ReadLe32(header + 80);
+  uint32_t bitCount = ReadLe32(header + 84);
+  uint32_t redMask = ReadLe32(header + 88);
+  uint32_t alphaMask = ReadLe32(header + 100);
+  uint32_t caps2 = ReadLe32(header + 108);
+
+  // Cube maps and volumes
+  if ((caps2 & 0x200) != 0 || (caps2 & 0x200000) != 0 || width <= 0 ||
+      height <= 0 || levels > 32) {
+    return Fail(error, "Only 2D DDS textures are supported");
+  }
+  if (!SizeAllowed(width, height, maxSize)) {
+    return Fail(error, "DDS size out of range");
+  }
+
+  size_t position = 128;
+  bool bgra = false;
+  image->mSrgb = false;
+  if ((pixelFlags & 0x4) != 0) {
+    if (fourCC == FourCC("DXT1")) {
+      image->mFormat = kImageBc1;
+    } else if (fourCC == FourCC("DXT3")) {
+      image->mFormat = kImageBc2;
+    } else if (fourCC == FourCC("DXT5")) {
+      image->mFormat = kImageBc3;
+    } else if (fourCC == 113) {
+      // D3DFMT_A16B16G16R16F
+      image->mFormat = kImageRgba16f;
+    } else if (fourCC == FourCC("DX10")) {
+      if (size < 148) {
+        return Fail(error, "DDS file is truncated");
+      }
+      uint32_t arraySize = ReadLe32(data + 128 + 12);
+      if (!DxgiFormat(ReadLe32(data + 128), &image->mFormat, &image->mSrgb,
+                      &bgra) ||
+          arraySize > 1) {
+        return Fail(error, "Unsupported DDS format");
+      }
+      position += 20;
+    } else {
+      return Fail(error, "Unsupported DDS format");
+    }
+  } else if ((pixelFlags & 0x40) != 0 && bitCount == 32 &&
+             (redMask == 0xff || redMask == 0xff0000)) {
+    image->mFormat = kImageRgba8;
+    bgra = redMask == 0xff0000;
+    if ((pixelFlags & 0x1) == 0 || alphaMask == 0) {
+      // Alpha bits without meaning, forced opaque below
+      alphaMask = 0;
+    }
+  } else {
+    return Fail(error, "Unsupported DDS format");
+  }
+
+  if (!ReadLevels(data, size, position, width, height, levels, false, image,
+                  error)) {
+    return false;
+  }
+
+  bool forceOpaque = (pixelFlags & 0x40) != 0 && alphaMask == 0;
+  if (bgra || forceOpaque) {
+    for (size_t i = 0; i + 3 < image->mData.size(); i += 4) {
+      if (bgra) {
+        std::swap(image->mData[i], image->mData[i + 2]);
+      }
+      if (forceOpaque) {
+        image->mData[i + 3] = 255;
+      }
+    }
+  }
+  return true;
+}
+
+bool DecodeImage(const uint8_t *data, size_t size, Image *image,
+                 std::string *error, int maxSize) {
+  if (size >= 8 && std::memcmp(data, kPngSignature, 8) == 0) {
+    return DecodePng(data, size, image, maxSize, error);
+  }
+  if (size >= 12 && std::memcmp(data, kKtxIdentifier, 12) == 0) {
+    return DecodeKtx(data, size, image, maxSize, error);
+  }
+  if (size >= 4 && std::memcmp(data, "DDS ", 4) == 0) {
+    return DecodeDds(data, size, image, maxSize, error);
+  }
+  if (size >= 2 && data[0] == '#' && data[1] == '?') {
+    return DecodeHdr(data, size, image, maxSize, error);
+  }
+  // TGA has no signature, its header is checked instead
+  return DecodeTga(data, size, image, maxSize, error);
+}
+
+bool LoadImage(const std::string &path, Image *image, std::string *error,
+               int maxSize) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return Fail(error, "Could not open file");
+  }
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+  return DecodeImage(bytes.data(), bytes.size(), image, error, maxSize);
+}
+
+static void WriteLe32(std::vector<uint8_t> &out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back((uint8_t)(value >> (8 * i)));
+  }
+}
+
+bool SaveKtx(const std::string &path, const Image &image,
+             std::string *error) {
+  if (image.mLevels.empty()) {
+    return Fail(error, "Image has no levels");
+  }
+
+  bool compressed = ImageFormatIsCompressed(image.mFormat);
+  uint32_t type = image.mFormat == kImageRgba16f ? GL_HALF_FLOAT
+                                                 : GL_UNSIGNED_BYTE;
+  // Rows top to bottom, as the levels are stored
+  static const char orientation[] = "KTXorientation\0S=r,T=d";
+
+  std::vector<uint8_t> out(kKtxIdentifier, kKtxIdentifier + 12);
+  WriteLe32(out, 0x04030201);
+  WriteLe32(out, compressed ? 0 : type);
+  WriteLe32(out, compressed ? 1 : (type == GL_HALF_FLOAT ? 2 : 1));
+  WriteLe32(out, compressed ? 0 : GL_RGBA);
+  WriteLe32(out, KtxInternalFormat(image.mFormat, image.mSrgb));
+  WriteLe32(out, GL_RGBA);
+  WriteLe32(out, (uint32_t)image.Width());
+  WriteLe32(out, (uint32_t)image.Height());
+  WriteLe32(out, 0);
+  WriteLe32(out, 0);
+  WriteLe32(out, 1);
+  WriteLe32(out, (uint32_t)image.mLevels.size());
+
+  uint32_t keyValue = (uint32_t)sizeof(orientation);
+  uint32_t keyValuePadding = (4 - keyValue % 4) % 4;
+  WriteLe32(out, 4 + keyValue + keyValuePadding);
+  WriteLe32(out, keyValue);
+  out.insert(out.end(), orientation, orientation + keyValue);
+  out.insert(out.end(), keyValuePadding, 0);
+
+  for (const ImageLevel &level : image.mLevels) {
+    WriteLe32(out, (uint32_t)level.mSize);
+    const uint8_t *data = image.mData.data() + level.mOffset;
+    out.insert(out.end(), data, data + level.mSize);
+    out.insert(out.end(), (4 - level.mSize % 4) % 4, 0);
+  }
+
+  std::ofstream file(path, std::ios::binary);
+  if (!file.write((const char *)out.data(), out.size())) {
+    return Fail(error, "Could not write file");
+  }
+  return true;
+}
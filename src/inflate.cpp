@@ -0,0 +1,374 @@
+#include "Inflate.hpp"
+
+#include <cstring>
+
+// Codes up to this many bits decode with a single table lookup
+static const int kFastBits = 9;
+static const int kMaxBits = 15;
+
+struct Huffman {
+  // (length << 9) | symbol for codes of up to kFastBits bits, 0 otherwise
+  uint16_t mFast[1 << kFastBits];
+  uint16_t mCounts[kMaxBits + 1];
+  uint16_t mSymbols[288];
+};
+
+// LSB first, as DEFLATE packs everything but Huffman codes
+class BitReader {
+
+public:
+  BitReader(const uint8_t *data, size_t size) : mData(data), mSize(size) {}
+
+  void Refill() {
+    while (mCount <= 56) {
+      uint64_t byte = 0;
+      if (mPosition < mSize) {
+        byte = mData[mPosition];
+      } else {
+        // Zeros past the end are fine as long as they are never consumed
+        ++mOverrun;
+      }
+      ++mPosition;
+      mBits |= byte << mCount;
+      mCount += 8;
+    }
+  }
+
+  uint32_t Peek(int count) {
+    if (mCount < count) {
+      Refill();
+    }
+    return (uint32_t)(mBits & ((1ull << count) - 1));
+  }
+
+  void Consume(int count) {
+    mBits >>= count;
+    mCount -= count;
+  }
+
+  uint32_t Get(int count) {
+    uint32_t value = Peek(count);
+    Consume(count);
+    return value;
+  }
+
+  void AlignToByte() { Consume(mCount % 8); }
+
+  // Whether more was read than the stream holds
+  bool Overrun() const { return mOverrun * 8 > (size_t)mCount; }
+
+  // Bytes consumed so far, once aligned
+  size_t Position() const { return mPosition - mCount / 8; }
+
+private:
+  const uint8_t *mData;
+  size_t mSize;
+  size_t mPosition = 0;
+  size_t mOverrun = 0;
+  uint64_t mBits = 0;
+  int mCount = 0;
+};
+
+static bool BuildHuffman(Huffman *huffman, const uint8_t *lengths,
+                         int count) {
+  std::memset(huffman->mCounts, 0, sizeof(huffman->mCounts));
+  std::memset(huffman->mFast, 0, sizeof(huffman->mFast));
+  for (int i = 0; i < count; ++i) {
+    ++huffman->mCounts[lengths[i]];
+  }
+  huffman->mCounts[0] = 0;
+
+  // Over-subscribed sets are invalid; incomplete ones are allowed
+  int left = 1;
+  uint16_t offsets[kMaxBits + 2] = {};
+  for (int length = 1; length <= kMaxBits; ++length) {
+    left = (left << 1) - huffman->mCounts[length];
+    if (left < 0) {
+      return false;
+    }
+    offsets[length + 1] = offsets[length] + huffman->mCounts[length];
+  }
+
+  // First code of each length, RFC 1951 section 3.2.2
+  int nextCode[kMaxBits + 1] = {};
+  for (int length = 2; length <= kMaxBits; ++length) {
+    nextCode[length] =
+        (nextCode[length - 1] + huffman->mCounts[length - 1]) << 1;
+  }
+
+  for (int symbol = 0; symbol < count; ++symbol) {
+    int length = lengths[symbol];
+    if (length == 0) {
+      continue;
+    }
+    huffman->mSymbols[offsets[length]++] = (uint16_t)symbol;
+
+    int symbolCode = nextCode[length]++;
+    if (length <= kFastBits) {
+      // Codes are stored MSB first in an LSB first stream
+      int reversed = 0;
+      for (int bit = 0; bit < length; ++bit) {
+        reversed |= ((symbolCode >> bit) & 1) << (length - 1 - bit);
+      }
+      for (int fill = reversed; fill < (1 << kFastBits);
+           fill += 1 << length) {
+        huffman->mFast[fill] = (uint16_t)((length << 9) | symbol);
+      }
+    }
+  }
+  return true;
+}
+
+static int Decode(BitReader &reader, const Huffman &huffman) {
+  uint32_t bits = reader.Peek(kMaxBits);
+  uint16_t entry = huffman.mFast[bits & ((1 << kFastBits) - 1)];
+  if (entry != 0) {
+    reader.Consume(entry >> 9);
+    return entry & 0x1ff;
+  }
+
+  // Canonical decode a bit at a time for the long codes
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (int length = 1; length <= kMaxBits; ++length) {
+    code |= (bits >> (length - 1)) & 1;
+    int count = huffman.mCounts[length];
+    if (code - first < count) {
+      reader.Consume(length);
+      return huffman.mSymbols[index + code - first];
+    }
+    index += count;
+    first = (first + count) << 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+static const uint16_t kLengthBase[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                         1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                         4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t kDistanceBase[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t kDistanceExtra[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                           4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                           9, 9, 10, 10, 11, 11, 12, 12, 13,
+                                           13};
+
+static bool InflateBlock(BitReader &reader, const Huffman &lengths,
+                         const Huffman &distances, size_t limit,
+                         std::vector<uint8_t> *out) {
+  while (true) {
+    int symbol = Decode(reader, lengths);
+    if (symbol < 0 || reader.Overrun()) {
+      return false;
+    }
+    if (symbol < 256) {
+      if (out->size() >= limit) {
+        return false;
+      }
+      out->push_back((uint8_t)symbol);
+      continue;
+    }
+    if (symbol == 256) {
+      return true;
+    }
+
+    symbol -= 257;
+    if (symbol >= 29) {
+      return false;
+    }
+    size_t length = kLengthBase[symbol] + reader.Get(kLengthExtra[symbol]);
+    int distanceSymbol = Decode(reader, distances);
+    if (distanceSymbol < 0 || distanceSymbol >= 30) {
+      return false;
+    }
+    size_t distance = kDistanceBase[distanceSymbol] +
+                      reader.Get(kDistanceExtra[distanceSymbol]);
+    if (distance > out->size() || length > limit - out->size()) {
+      return false;
+    }
+
+    // Byte by byte, since the copy may overlap what it is writing
+    size_t from = out->size() - distance;
+    out->resize(out->size() + length);
+    uint8_t *bytes = out->data();
+    for (size_t i = 0; i < length; ++i) {
+      bytes[from + distance + i] = bytes[from + i];
+    }
+  }
+}
+
+static bool ReadDynamicTables(BitReader &reader, Huffman *lengths,
+                              Huffman *distances) {
+  static const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                    11, 4,  12, 3, 13, 2, 14, 1, 15};
+  int lengthCount = (int)reader.Get(5) + 257;
+  int distanceCount = (int)reader.Get(5) + 1;
+  int codeCount = (int)reader.Get(4) + 4;
+  if (lengthCount > 286 || distanceCount > 30) {
+    return false;
+  }
+
+  uint8_t codeLengths[19] = {};
+  for (int i = 0; i < codeCount; ++i) {
+    codeLengths[order[i]] = (uint8_t)reader.Get(3);
+  }
+  Huffman codes;
+  if (!BuildHuffman(&codes, codeLengths, 19)) {
+    return false;
+  }
+
+  uint8_t all[286 + 30] = {};
+  int total = lengthCount + distanceCount;
+  for (int i = 0; i < total;) {
+    int symbol = Decode(reader, codes);
+    if (symbol < 0) {
+      return false;
+    }
+    if (symbol < 16) {
+      all[i++] = (uint8_t)symbol;
+      continue;
+    }
+
+    uint8_t value = 0;
+    int repeat = 0;
+    if (symbol == 16) {
+      if (i == 0) {
+        return false;
+      }
+      value = all[i - 1];
+      repeat = 3 + (int)reader.Get(2);
+    } else if (symbol == 17) {
+      repeat = 3 + (int)reader.Get(3);
+    } else {
+      repeat = 11 + (int)reader.Get(7);
+    }
+    if (i + repeat > total) {
+      return false;
+    }
+    while (repeat-- > 0) {
+      all[i++] = value;
+    }
+  }
+
+  // A block has to be able to end
+  if (all[256] == 0) {
+    return false;
+  }
+  return BuildHuffman(lengths, all, lengthCount) &&
+         BuildHuffman(distances, all + lengthCount, distanceCount);
+}
+
+// Fails rather than letting out grow past limit bytes
+static bool InflateStream(BitReader &reader, size_t limit,
+                          std::vector<uint8_t> *out) {
+  static Huffman fixedLengths;
+  static Huffman fixedDistances;
+  static bool fixedBuilt = [] {
+    uint8_t lengths[288];
+    std::memset(lengths, 8, 144);
+    std::memset(lengths + 144, 9, 112);
+    std::memset(lengths + 256, 7, 24);
+    std::memset(lengths + 280, 8, 8);
+    uint8_t distances[30];
+    std::memset(distances, 5, 30);
+    return BuildHuffman(&fixedLengths, lengths, 288) &&
+           BuildHuffman(&fixedDistances, distances, 30);
+  }();
+  if (!fixedBuilt) {
+    return false;
+  }
+
+  bool last = false;
+  while (!last) {
+    last = reader.Get(1) != 0;
+    uint32_t type = reader.Get(2);
+    if (type == 0) {
+      reader.AlignToByte();
+      uint32_t length = reader.Get(16);
+      uint32_t complement = reader.Get(16);
+      if ((length ^ 0xffff) != complement || length > limit - out->size()) {
+        return false;
+      }
+      for (uint32_t i = 0; i < length; ++i) {
+        out->push_back((uint8_t)reader.Get(8));
+      }
+    } else if (type == 1) {
+      if (!InflateBlock(reader, fixedLengths, fixedDistances, limit, out)) {
+        return false;
+      }
+    } else if (type == 2) {
+      Huffman lengths;
+      Huffman distances;
+      if (!ReadDynamicTables(reader, &lengths, &distances) ||
+          !InflateBlock(reader, lengths, distances, limit, out)) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+    if (reader.Overrun()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool Inflate(const uint8_t *data, size_t size, std::vector<uint8_t> *out) {
+  BitReader reader(data, size);
+  return InflateStream(reader, SIZE_MAX, out);
+}
+
+bool ZlibDecompress(const uint8_t *data, size_t size,
+                    std::vector<uint8_t> *out, size_t maxSize) {
+  if (size < 6) {
+    return false;
+  }
+  // Deflate, no preset dictionary, header checksum
+  uint8_t method = data[0];
+  uint8_t flags = data[1];
+  if ((method & 0x0f) != 8 || (flags & 0x20) != 0 ||
+      ((method << 8) | flags) % 31 != 0) {
+    return false;
+  }
+
+  size_t start = out->size();
+  BitReader reader(data + 2, size - 2);
+  size_t limit = maxSize < SIZE_MAX - start ? start + maxSize : SIZE_MAX;
+  if (!InflateStream(reader, limit, out)) {
+    return false;
+  }
+
+  reader.AlignToByte();
+  size_t end = 2 + reader.Position();
+  if (end + 4 > size) {
+    return false;
+  }
+  uint32_t expected = (uint32_t)data[end] << 24 |
+                      (uint32_t)data[end + 1] << 16 |
+                      (uint32_t)data[end + 2] << 8 | data[end + 3];
+
+  uint32_t a = 1;
+  uint32_t b = 0;
+  const uint8_t *bytes = out->data() + start;
+  size_t length = out->size() - start;
+  while (length > 0) {
+    // Largest run before the sums can overflow 32 bits
+    size_t run = length < 5552 ? length : 5552;
+    for (size_t i = 0; i < run; ++i) {
+      a += bytes[i];
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+    bytes += run;
+    length -= run;
+  }
+  return ((b << 16) | a) == expected;
+}
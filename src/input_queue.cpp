@@ -0,0 +1,59 @@
+#include "InputQueue.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+uint64_t InputNowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void InputQueue::Pump() {
+  SDL_Event e;
+  while (SDL_PollEvent(&e) != 0) {
+    // SDL stamps events in milliseconds when they are queued, which can be
+    // well before we poll them
+    uint64_t nowNs = InputNowNs();
+    Uint32 ageMs = SDL_GetTicks() - e.common.timestamp;
+    uint64_t eventNs = nowNs - std::min<uint64_t>(ageMs * 1000000ull, nowNs);
+
+    if (e.type == SDL_QUIT) {
+      mPending.mQuit = true;
+    } else if (e.type == SDL_MOUSEMOTION) {
+      mPending.mMouseDeltaX += e.motion.xrel;
+      mPending.mMouseDeltaY += e.motion.yrel;
+    } else if (e.type == SDL_WINDOWEVENT) {
+      // Focus and enter/leave changes do not alter what is drawn
+      if (e.window.event != SDL_WINDOWEVENT_EXPOSED &&
+          e.window.event != SDL_WINDOWEVENT_SIZE_CHANGED &&
+          e.window.event != SDL_WINDOWEVENT_SHOWN &&
+          e.window.event != SDL_WINDOWEVENT_RESTORED) {
+        continue;
+      }
+      mPending.mWindowChanged = true;
+    } else if (e.type != SDL_KEYDOWN && e.type != SDL_KEYUP) {
+      // Keys are read from the keyboard state, other events are not input
+      continue;
+    }
+
+    if (mPending.mOldestEventNs == 0 || eventNs < mPending.mOldestEventNs) {
+      mPending.mOldestEventNs = eventNs;
+    }
+    ++mPending.mEventCount;
+  }
+}
+
+InputFrame InputQueue::Latch() {
+  Pump();
+  InputFrame frame = mPending;
+  frame.mLatchNs = InputNowNs();
+  frame.mKeys = SDL_GetKeyboardState(nullptr);
+  mPending = InputFrame();
+  return frame;
+}
+
+void InputQueue::Wait(int timeoutMs) {
+  // Without an event argument SDL leaves the event queued for Pump
+  SDL_WaitEventTimeout(nullptr, timeoutMs);
+}
@@ -0,0 +1,83 @@
+#include "LatencyTracker.hpp"
+
+#include "Log.hpp"
+
+void LatencyTracker::FrameSwapped(const InputFrame &input) {
+  if (!mCalibrated) {
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    mGpuToCpuNs = (int64_t)InputNowNs() - gpuNow;
+    mCalibrated = true;
+  }
+
+  Collect();
+
+  GLuint query;
+  if (mFreeQueries.empty()) {
+    glGenQueries(1, &query);
+  } else {
+    query = mFreeQueries.back();
+    mFreeQueries.pop_back();
+  }
+  // Lands once the GPU has worked through everything the frame submitted
+  glQueryCounter(query, GL_TIMESTAMP);
+  mPending.push_back({query, input.mOldestEventNs, input.mLatchNs});
+}
+
+void LatencyTracker::Collect() {
+  // Queries finish in order, so stop at the first one still in flight
+  size_t ready = 0;
+  for (; ready < mPending.size(); ++ready) {
+    const PendingFrame &frame = mPending[ready];
+    GLint available = 0;
+    glGetQueryObjectiv(frame.mQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+    GLuint64 gpuNs = 0;
+    glGetQueryObjectui64v(frame.mQuery, GL_QUERY_RESULT, &gpuNs);
+    double presentNs = (double)((int64_t)gpuNs + mGpuToCpuNs);
+
+    mLatchToPresentMs.push_back((presentNs - frame.mLatchNs) / 1e6);
+    if (frame.mOldestEventNs != 0) {
+      mInputToPresentMs.push_back((presentNs - frame.mOldestEventNs) / 1e6);
+      mInputToLatchMs.push_back(
+          (double)(frame.mLatchNs - frame.mOldestEventNs) / 1e6);
+    }
+    mFreeQueries.push_back(frame.mQuery);
+  }
+  mPending.erase(mPending.begin(), mPending.begin() + ready);
+}
+
+LatencyStats LatencyTracker::GetStats() const {
+  LatencyStats stats;
+  stats.mInputToPresentMs = SummarizeTimings(mInputToPresentMs);
+  stats.mInputToLatchMs = SummarizeTimings(mInputToLatchMs);
+  stats.mLatchToPresentMs = SummarizeTimings(mLatchToPresentMs);
+  return stats;
+}
+
+static void PrintSummary(const char *name, const TimingSummary &summary) {
+  LOG_INFO(kLogInput,
+           "Latency {}: {} frames, mean {} ms, p50 {} ms, p95 {} ms, max {} ms",
+           name, summary.mCount, summary.mMean, summary.mP50, summary.mP95,
+           summary.mMax);
+}
+
+void LatencyTracker::PrintStats() const {
+  LatencyStats stats = GetStats();
+  PrintSummary("input to present", stats.mInputToPresentMs);
+  PrintSummary("input to latch", stats.mInputToLatchMs);
+  PrintSummary("latch to present", stats.mLatchToPresentMs);
+}
+
+void LatencyTracker::Destroy() {
+  for (const PendingFrame &frame : mPending) {
+    mFreeQueries.push_back(frame.mQuery);
+  }
+  mPending.clear();
+  if (!mFreeQueries.empty()) {
+    glDeleteQueries((GLsizei)mFreeQueries.size(), mFreeQueries.data());
+    mFreeQueries.clear();
+  }
+}
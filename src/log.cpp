@@ -0,0 +1,449 @@
+#include "Log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bytes of records each thread can have queued before new ones are dropped
+static const uint64_t kRingBytes = 1 << 16;
+// How long the writer sleeps between drains
+static const int kWriterIntervalMs = 2;
+
+struct LogHeader {
+  uint64_t mTimeNs;
+  const char *mFormat;
+  uint32_t mSuppressed;
+  uint8_t mLevel;
+  uint8_t mCategory;
+  // Set when arguments were cut or left out to fit the record
+  uint8_t mTruncated;
+};
+
+// Single producer (its thread) and single consumer (whoever holds
+// gDrainMutex). Records are a uint32_t size followed by the payload and may
+// wrap around the end.
+struct LogRing {
+  std::vector<char> mBytes = std::vector<char>(kRingBytes);
+  std::atomic<uint64_t> mHead{0};
+  std::atomic<uint64_t> mTail{0};
+};
+
+struct PendingRecord {
+  uint64_t mTimeNs;
+  size_t mOffset;
+  size_t mSize;
+};
+
+enum WriterState { kWriterIdle, kWriterRunning, kWriterStopped };
+
+static std::atomic<int> gLevel{LOG_MIN_LEVEL};
+static std::atomic<uint32_t> gCategories{~0u};
+static std::atomic<uint64_t> gDropped{0};
+
+static std::mutex gRingsMutex;
+static std::vector<std::unique_ptr<LogRing>> gRings;
+
+static std::mutex gWriterMutex;
+static std::condition_variable gWriterWake;
+static std::thread gWriter;
+static std::atomic<int> gWriterState{kWriterIdle};
+static std::FILE *gFile = nullptr;
+
+// Only touched with gDrainMutex held
+static std::mutex gDrainMutex;
+static std::vector<char> gBatch;
+static std::vector<PendingRecord> gPending;
+static std::string gLine;
+
+static uint64_t NowNs() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+static LogRing *LocalRing() {
+  thread_local LogRing *ring = nullptr;
+  if (ring == nullptr) {
+    // Only the first record of each thread locks
+    std::lock_guard<std::mutex> lock(gRingsMutex);
+    gRings.push_back(std::make_unique<LogRing>());
+    ring = gRings.back().get();
+  }
+  return ring;
+}
+
+static void RingCopyIn(LogRing *ring, uint64_t position, const void *data,
+                       size_t size) {
+  size_t offset = position % kRingBytes;
+  size_t first = std::min(size, (size_t)(kRingBytes - offset));
+  std::memcpy(ring->mBytes.data() + offset, data, first);
+  std::memcpy(ring->mBytes.data(), (const char *)data + first, size - first);
+}
+
+static void RingCopyOut(const LogRing *ring, uint64_t position, void *data,
+                        size_t size) {
+  size_t offset = position % kRingBytes;
+  size_t first = std::min(size, (size_t)(kRingBytes - offset));
+  std::memcpy(data, ring->mBytes.data() + offset, first);
+  std::memcpy((char *)data + first, ring->mBytes.data(), size - first);
+}
+
+static const char *LevelName(int level) {
+  static const char *const names[] = {"trace", "debug", "info ", "warn ",
+                                      "error"};
+  return level >= 0 && level < LOG_LEVEL_OFF ? names[level] : "?    ";
+}
+
+static const char *CategoryName(int category) {
+  static const char *const names[kLogCategoryCount] = {
+      "core", "input", "render", "shader", "gl", "asset"};
+  return category >= 0 && category < kLogCategoryCount ? names[category]
+                                                        : "?";
+}
+
+// Copies size bytes out of a record, failing if it ends first
+static bool ReadValue(const char **read, const char *end, void *value,
+                      size_t size) {
+  if ((size_t)(end - *read) < size) {
+    return false;
+  }
+  std::memcpy(value, *read, size);
+  *read += size;
+  return true;
+}
+
+// Appends the next argument of a record to gLine, returning its end
+static const char *FormatArgument(const char *read, const char *end) {
+  if (read >= end) {
+    gLine += "{}";
+    return read;
+  }
+  char tag = *read++;
+  char text[64];
+  switch (tag) {
+  case 'i': {
+    int64_t value;
+    if (!ReadValue(&read, end, &value, sizeof(value))) {
+      break;
+    }
+    std::snprintf(text, sizeof(text), "%lld", (long long)value);
+    gLine += text;
+    return read;
+  }
+  case 'u': {
+    uint64_t value;
+    if (!ReadValue(&read, end, &value, sizeof(value))) {
+      break;
+    }
+    std::snprintf(text, sizeof(text), "%llu", (unsigned long long)value);
+    gLine += text;
+    return read;
+  }
+  case 'f': {
+    double value;
+    if (!ReadValue(&read, end, &value, sizeof(value))) {
+      break;
+    }
+    std::snprintf(text, sizeof(text), "%g", value);
+    gLine += text;
+    return read;
+  }
+  case 'b': {
+    char value;
+    if (!ReadValue(&read, end, &value, sizeof(value))) {
+      break;
+    }
+    gLine += value ? "true" : "false";
+    return read;
+  }
+  case 'p': {
+    const void *value;
+    if (!ReadValue(&read, end, &value, sizeof(value))) {
+      break;
+    }
+    std::snprintf(text, sizeof(text), "%p", value);
+    gLine += text;
+    return read;
+  }
+  case 's': {
+    uint16_t length;
+    if (!ReadValue(&read, end, &length, sizeof(length)) ||
+        (size_t)(end - read) < length) {
+      break;
+    }
+    gLine.append(read, length);
+    return read + length;
+  }
+  }
+  // Unknown tags and cut payloads end the record
+  gLine += "{}";
+  return end;
+}
+
+static void FormatRecord(const char *record, size_t size) {
+  LogHeader header;
+  std::memcpy(&header, record, sizeof(header));
+  const char *read = record + sizeof(header);
+  const char *end = record + size;
+
+  char prefix[64];
+  std::snprintf(prefix, sizeof(prefix), "[%9.3f] [%s] [%s] ",
+                header.mTimeNs / 1e9, LevelName(header.mLevel),
+                CategoryName(header.mCategory));
+  gLine = prefix;
+
+  for (const char *format = header.mFormat; *format; ++format) {
+    if (format[0] == '{' && format[1] == '}') {
+      read = FormatArgument(read, end);
+      ++format;
+    } else {
+      gLine += *format;
+    }
+  }
+  if (header.mTruncated) {
+    gLine += " (truncated)";
+  }
+  if (header.mSuppressed > 0) {
+    std::snprintf(prefix, sizeof(prefix), " (%u similar suppressed)",
+                  header.mSuppressed);
+    gLine += prefix;
+  }
+  gLine += '\n';
+}
+
+// Writes out everything the rings hold, in time order across threads
+static void Drain() {
+  std::lock_guard<std::mutex> drainLock(gDrainMutex);
+  gBatch.clear();
+  gPending.clear();
+  {
+    std::lock_guard<std::mutex> lock(gRingsMutex);
+    for (auto &ring : gRings) {
+      uint64_t tail = ring->mTail.load(std::memory_order_relaxed);
+      uint64_t head = ring->mHead.load(std::memory_order_acquire);
+      while (tail < head) {
+        uint32_t size;
+        RingCopyOut(ring.get(), tail, &size, sizeof(size));
+        size_t offset = gBatch.size();
+        gBatch.resize(offset + size);
+        RingCopyOut(ring.get(), tail + sizeof(size), gBatch.data() + offset,
+                    size);
+        uint64_t timeNs;
+        std::memcpy(&timeNs, gBatch.data() + offset, sizeof(timeNs));
+        gPending.push_back({timeNs, offset, size});
+        tail += sizeof(size) + size;
+      }
+      ring->mTail.store(tail, std::memory_order_release);
+    }
+  }
+  if (gPending.empty()) {
+    return;
+  }
+
+  std::stable_sort(gPending.begin(), gPending.end(),
+                   [](const PendingRecord &a, const PendingRecord &b) {
+                     return a.mTimeNs < b.mTimeNs;
+                   });
+  for (const PendingRecord &pending : gPending) {
+    FormatRecord(gBatch.data() + pending.mOffset, pending.mSize);
+    std::fwrite(gLine.data(), 1, gLine.size(), stdout);
+    if (gFile != nullptr) {
+      std::fwrite(gLine.data(), 1, gLine.size(), gFile);
+    }
+  }
+  std::fflush(stdout);
+  if (gFile != nullptr) {
+    std::fflush(gFile);
+  }
+}
+
+static void WriterMain() {
+  std::unique_lock<std::mutex> lock(gWriterMutex);
+  while (gWriterState == kWriterRunning) {
+    gWriterWake.wait_for(lock, std::chrono::milliseconds(kWriterIntervalMs));
+    lock.unlock();
+    Drain();
+    lock.lock();
+  }
+}
+
+// Started by the first record or LogStart
+static void StartWriter(const std::string &path) {
+  std::lock_guard<std::mutex> lock(gWriterMutex);
+  if (!path.empty() && gFile == nullptr) {
+    gFile = std::fopen(path.c_str(), "w");
+    if (gFile == nullptr) {
+      std::fprintf(stdout, "Could not open log %s\n", path.c_str());
+    }
+  }
+  if (gWriterState != kWriterRunning) {
+    gWriterState = kWriterRunning;
+    gWriter = std::thread(WriterMain);
+  }
+}
+
+void LogStart(const std::string &path) { StartWriter(path); }
+
+void LogStop() {
+  {
+    std::lock_guard<std::mutex> lock(gWriterMutex);
+    if (gWriterState == kWriterRunning) {
+      gWriterState = kWriterStopped;
+      gWriterWake.notify_one();
+    }
+  }
+  if (gWriter.joinable()) {
+    gWriter.join();
+  }
+  Drain();
+  if (gFile != nullptr) {
+    std::fclose(gFile);
+    gFile = nullptr;
+  }
+}
+
+void LogSetLevel(int level) { gLevel = level; }
+
+bool LogParseLevel(const char *name, int *level) {
+  static const char *const names[] = {"trace",   "debug", "info",
+                                      "warning", "error", "off"};
+  for (int i = 0; i <= LOG_LEVEL_OFF; ++i) {
+    if (std::strcmp(name, names[i]) == 0) {
+      *level = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void LogSetCategoryEnabled(LogCategory category, bool enabled) {
+  if (enabled) {
+    gCategories.fetch_or(1u << category);
+  } else {
+    gCategories.fetch_and(~(1u << category));
+  }
+}
+
+bool LogEnabled(int level, LogCategory category) {
+  return level >= gLevel.load(std::memory_order_relaxed) &&
+         (gCategories.load(std::memory_order_relaxed) >> category & 1u);
+}
+
+uint64_t LogGetDroppedCount() { return gDropped; }
+
+LogRecord::LogRecord(int level, LogCategory category, uint32_t suppressed,
+                     const char *format)
+    : mSize(sizeof(LogHeader)), mTruncated(false) {
+  LogHeader header = {NowNs(), format, suppressed, (uint8_t)level,
+                      (uint8_t)category, 0};
+  std::memcpy(mData, &header, sizeof(header));
+}
+
+void LogRecord::Append(char tag, const void *data, size_t size) {
+  // Arguments that do not fit are left out and print as {}, along with
+  // every one after them so the rest do not shift placeholders
+  if (mTruncated || mSize + 1 + size > sizeof(mData)) {
+    mTruncated = true;
+    return;
+  }
+  mData[mSize] = tag;
+  std::memcpy(mData + mSize + 1, data, size);
+  mSize += 1 + size;
+}
+
+void LogRecord::AddSigned(int64_t value) {
+  Append('i', &value, sizeof(value));
+}
+
+void LogRecord::AddUnsigned(uint64_t value) {
+  Append('u', &value, sizeof(value));
+}
+
+void LogRecord::AddDouble(double value) { Append('f', &value, sizeof(value)); }
+
+void LogRecord::AddBool(bool value) {
+  char byte = value ? 1 : 0;
+  Append('b', &byte, 1);
+}
+
+void LogRecord::AddString(const char *value) {
+  if (value == nullptr) {
+    value = "(null)";
+  }
+  // Long strings are cut to what is left of the record
+  size_t available = sizeof(mData) - mSize;
+  if (mTruncated || available < 1 + sizeof(uint16_t)) {
+    mTruncated = true;
+    return;
+  }
+  size_t fullLength = std::strlen(value);
+  size_t length = std::min(fullLength, available - 1 - sizeof(uint16_t));
+  if (length < fullLength) {
+    mTruncated = true;
+  }
+  uint16_t length16 = (uint16_t)length;
+  mData[mSize] = 's';
+  std::memcpy(mData + mSize + 1, &length16, sizeof(length16));
+  std::memcpy(mData + mSize + 1 + sizeof(length16), value, length);
+  mSize += 1 + sizeof(length16) + length;
+}
+
+void LogRecord::AddPointer(const void *value) {
+  Append('p', &value, sizeof(value));
+}
+
+void LogRecord::Commit() {
+  if (gWriterState.load(std::memory_order_relaxed) == kWriterIdle) {
+    StartWriter("");
+  }
+
+  if (mTruncated) {
+    uint8_t truncated = 1;
+    std::memcpy(mData + offsetof(LogHeader, mTruncated), &truncated,
+                sizeof(truncated));
+  }
+
+  LogRing *ring = LocalRing();
+  uint32_t size = (uint32_t)mSize;
+  uint64_t head = ring->mHead.load(std::memory_order_relaxed);
+  uint64_t tail = ring->mTail.load(std::memory_order_acquire);
+  if (head + sizeof(size) + size - tail > kRingBytes) {
+    // Never wait on the writer
+    gDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  RingCopyIn(ring, head, &size, sizeof(size));
+  RingCopyIn(ring, head + sizeof(size), mData, size);
+  ring->mHead.store(head + sizeof(size) + size, std::memory_order_release);
+
+  // Once stopped there is no writer, so records go out right away
+  if (gWriterState.load(std::memory_order_relaxed) == kWriterStopped) {
+    Drain();
+  }
+}
+
+bool LogRateLimit::Allow(uint32_t *suppressed) {
+  uint64_t now = NowNs();
+  uint64_t next = mNextNs.load(std::memory_order_relaxed);
+  if (now < next || !mNextNs.compare_exchange_strong(
+                        next, now + mIntervalMs * 1000000ull,
+                        std::memory_order_relaxed)) {
+    mSuppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  *suppressed = mSuppressed.exchange(0, std::memory_order_relaxed);
+  return true;
+}
+
+// Writes out what is still queued when the program exits
+static struct LogExitFlush {
+  ~LogExitFlush() { LogStop(); }
+} gExitFlush;
@@ -1,6 +1,10 @@
 #include "glm/trigonometric.hpp"
 #include <SDL2/SDL.h>
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,6 +16,27 @@
 
 // Our Libraries
 #include "Camera.hpp"
+#include "FixedTimestep.hpp"
+#include "FramePacer.hpp"
+#include "GLCall.hpp"
+#include "GLTrace.hpp"
+#include "GeometryCache.hpp"
+#include "InputQueue.hpp"
+#include "LatencyTracker.hpp"
+#include "Log.hpp"
+#include "Mesh.hpp"
+#include "PipelineCompiler.hpp"
+#include "Profiler.hpp"
+#include "ProgramPipelineLibrary.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "RenderStats.hpp"
+#include "Renderer.hpp"
+#include "SceneGenerator.hpp"
+#include "SceneRenderer.hpp"
+#include "Shader.hpp"
+#include "ShaderHotReload.hpp"
+#include "ShaderLibrary.hpp"
+#include "TextureManager.hpp"
 struct App {
   int mScreenHeight = 480;
   int mScreenWidth = 640;
@@ -20,28 +45,57 @@ struct App {
   bool mQuit = false;
   // Program Object (for our shaders)
   GLuint mGraphicsPipelineShaderProgram = 0;
+  // Linked program binaries from previous runs
+  ProgramBinaryCache mProgramCache = ProgramBinaryCache("./shader_cache");
+  // Builds programs in the background while meshes use the fallback
+  PipelineCompiler mPipelineCompiler{&mProgramCache};
+  // Expanded shader variants, shared when their sources match
+  ShaderLibrary mShaderLibrary{&mProgramCache, &mPipelineCompiler};
+  GLuint mFallbackShaderProgram = 0;
+  // --compile-on-worker builds programs on a second, shared context
+  bool mCompileOnWorker = false;
+  // --program-pipelines combines separable stages in program pipeline
+  // objects instead of monolithic programs
+  bool mUseProgramPipelines = false;
+  ProgramPipelineLibrary mProgramPipelines;
+  // --hot-reload rebuilds programs when shaders/*.glsl change on disk
+  bool mHotReloadShaders = false;
+  ShaderHotReload mShaderHotReload{&mPipelineCompiler};
+  // --capture=<file> records GL calls for the standalone replayer
+  std::string mCapturePath;
+  int mCaptureFirstFrame = 60;
+  int mCaptureFrames = 120;
+  // --stats=<file> dumps per frame render counters as CSV on exit
+  std::string mStatsPath;
+  // --profile=<file> writes a Chrome trace of the run on exit
+  std::string mProfilePath;
+  // --scene=<file> draws a generated scene instead of the two quads
+  std::string mScenePath;
+  Scene mScene;
+  SceneRenderer mSceneRenderer;
+  // The two quads are the same geometry and share one upload
+  GeometryCache mGeometry;
   Camera mCamera;
-};
-
-struct Transform {
-  glm::vec3 translation;
-};
-
-struct Mesh3D {
-  // VAO
-  GLuint mVertexArrayObj = 0;
-  // VBO
-  GLuint mVertexBufferObj = 0;
-  GLuint mVertexBufferObj2 = 0;
-
-  GLuint mIndexBufferObj = 0;
-  GLuint mIndexBufferObj2 = 0;
-
-  GLuint mPipeline = 0;
-
-  Transform mTransform;
-  float m_uRotate = 0.0f;
-  float m_uScale = 0.5f;
+  InputQueue mInput;
+  LatencyTracker mLatency;
+  // --vsync=off|on|adaptive, --max-fps=<n> and --just-in-time
+  FramePacerSettings mPacing;
+  FramePacer mFramePacer;
+  // --sim-rate=<hz>, independent of the frame rate
+  FixedTimestep mTimestep;
+  // --on-demand[=<hz>] only draws when something changed, and animation at
+  // most hz times a second
+  bool mOnDemand = false;
+  double mAnimationRate = 30.0;
+  Uint64 mNextAnimationFrame = 0;
+  uint64_t mProgramsDelivered = 0;
+  // --texture=<file> maps an image onto the two quads, streaming its mips
+  // within --texture-budget=<MB> of GPU memory, keeping at most
+  // --texture-ram=<MB> of decoded levels to stream from
+  std::string mTexturePath;
+  TextureManager mTextures;
+  TextureHandle mTexture = 0;
+  uint64_t mTextureChanges = 0;
 };
 
 // Globals
@@ -49,160 +103,90 @@ App gApp;
 Mesh3D gMesh1;
 Mesh3D gMesh2;
 
-void MeshDelete(Mesh3D *mesh) {
-  glDeleteBuffers(1, &mesh->mVertexBufferObj);
-  glDeleteBuffers(1, &mesh->mVertexBufferObj2);
-}
-
-void MeshSetPipeline(Mesh3D *mesh, GLuint pipeline) {
-
-  mesh->mPipeline = pipeline;
-}
-
-static void GLClearAllErrors() {
-  while (glGetError() != GL_NO_ERROR) {
+// Called once the real program is built and again after every reload
+void SetGraphicsPipeline(GLuint program) {
+  // Failed builds keep the fallback, or the last program that worked
+  if (program == 0) {
+    return;
   }
+  gApp.mGraphicsPipelineShaderProgram = program;
+  MeshSetPipeline(&gMesh1, program);
+  MeshSetPipeline(&gMesh2, program);
 }
 
-static bool GLCheckErrorStatus(const char *function, int line) {
-  while (GLenum error = glGetError()) {
-    std::cout << "OpenGL Error: " << error << "\tLine: " << line
-              << "\tfunction: " << function << std::endl;
-    return true;
+void CreateGraphicsPipeline() {
+  ShaderDefines defines;
+  if (!gApp.mTexturePath.empty()) {
+    defines.push_back({"TEXTURED", "1"});
   }
 
-  return false;
-}
-
-#define GLCheck(x)                                                             \
-  GLClearAllErrors();                                                          \
-  x;                                                                           \
-  GLCheckErrorStatus(#x, __LINE__);
-
-std::string LoadShaderAsString(const std::string &filename) {
-  std::string result = "";
-
-  std::string line = "";
-  std::ifstream myFile(filename.c_str());
-
-  if (myFile.is_open()) {
-    while (std::getline(myFile, line)) {
-      result += line + '\n';
+  if (gApp.mUseProgramPipelines) {
+    GLuint vertexStage = gApp.mProgramPipelines.GetStage(
+        GL_VERTEX_SHADER, "./shaders/vert.glsl", defines);
+    GLuint fragmentStage = gApp.mProgramPipelines.GetStage(
+        GL_FRAGMENT_SHADER, "./shaders/frag.glsl", defines);
+    if (vertexStage != 0 && fragmentStage != 0) {
+      // Stages link on their own, quick enough that nothing waits on a
+      // fallback
+      if (gApp.mCompileOnWorker) {
+        LOG_WARNING(kLogShader, "--compile-on-worker does not apply to "
+                                "--program-pipelines, stages build here");
+      }
+      GLuint pipeline =
+          gApp.mProgramPipelines.GetPipeline(vertexStage, fragmentStage);
+      MeshSetProgramPipeline(&gMesh1, pipeline, vertexStage);
+      MeshSetProgramPipeline(&gMesh2, pipeline, vertexStage);
+
+      // Edits rebuild just the stage they touch
+      if (gApp.mHotReloadShaders) {
+        gApp.mShaderHotReload.WatchPipeline(
+            &gApp.mProgramPipelines, pipeline, "./shaders/vert.glsl",
+            "./shaders/frag.glsl", defines, [pipeline](GLuint stage) {
+              MeshSetProgramPipeline(&gMesh1, pipeline, stage);
+              MeshSetProgramPipeline(&gMesh2, pipeline, stage);
+            });
+        gApp.mShaderHotReload.Start();
+      }
+      return;
     }
+    LOG_WARNING(kLogShader, "Program pipeline stages failed, using "
+                            "monolithic programs");
   }
 
-  return result;
-}
-
-GLuint CompileShader(GLuint type, const std::string &source) {
-  GLuint shaderObject;
-
-  if (type == GL_VERTEX_SHADER) {
-    shaderObject = glCreateShader(GL_VERTEX_SHADER);
+  // Cheap program to draw with until the real one is ready
+  gApp.mFallbackShaderProgram = gApp.mShaderLibrary.GetProgram(
+      "./shaders/vert.glsl", "./shaders/fallback_frag.glsl");
+  gApp.mGraphicsPipelineShaderProgram = gApp.mFallbackShaderProgram;
+  MeshSetPipeline(&gMesh1, gApp.mGraphicsPipelineShaderProgram);
+  MeshSetPipeline(&gMesh2, gApp.mGraphicsPipelineShaderProgram);
 
-  } else if (type == GL_FRAGMENT_SHADER) {
-    shaderObject = glCreateShader(GL_FRAGMENT_SHADER);
+  // Reloads should stay off the render thread too
+  if (gApp.mCompileOnWorker || gApp.mHotReloadShaders) {
+    gApp.mPipelineCompiler.StartWorker(gApp.mGraphicsAppWindow);
   }
 
-  const char *src = source.c_str();
-  glShaderSource(shaderObject, 1, &src, nullptr);
-  glCompileShader(shaderObject);
-
-  return shaderObject;
-}
-
-GLuint CreateShaderProgram(const std::string &vertexShaderSrc,
-                           const std::string &fragmentShaderSrc) {
-  GLuint programObj = glCreateProgram();
-
-  GLuint myVertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSrc);
-  GLuint myFragmentShader =
-      CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSrc);
-
-  glAttachShader(programObj, myVertexShader);
-  glAttachShader(programObj, myFragmentShader);
-  glLinkProgram(programObj);
-
-  glValidateProgram(programObj);
+  gApp.mShaderLibrary.RequestProgram(
+      "./shaders/vert.glsl", "./shaders/frag.glsl", defines,
+      SetGraphicsPipeline);
 
-  return programObj;
-}
-
-void CreateGraphicsPipeline() {
-
-  std::string vertexShaderSource = LoadShaderAsString("./shaders/vert.glsl");
-  std::string fragmentShaderSource = LoadShaderAsString("./shaders/frag.glsl");
-  gApp.mGraphicsPipelineShaderProgram =
-      CreateShaderProgram(vertexShaderSource, fragmentShaderSource);
+  if (gApp.mHotReloadShaders) {
+    gApp.mShaderHotReload.Watch("./shaders/vert.glsl", "./shaders/frag.glsl",
+                                defines, SetGraphicsPipeline);
+    gApp.mShaderHotReload.Start();
+  }
 }
 
 void GetOpenGLVersionInfo() {
-  std::cout << "Vendor: " << glGetString(GL_VENDOR) << std::endl;
-  std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
-  std::cout << "Version: " << glGetString(GL_VERSION) << std::endl;
-  std::cout << "Shading Language: " << glGetString(GL_SHADING_LANGUAGE_VERSION)
-            << std::endl;
-}
-
-void MeshCreate(Mesh3D *mesh) {
-
-  const std::vector<GLfloat> vertexPosition{
-      // x    y    z
-      -0.5f, -0.5f, 0.0f, // Left vertex
-      0.5f, -0.5f, 0.0f,  // Right vertex
-      -0.5f, 0.5f, 0.0f,  // Top vertex
-      // Second Triangle
-
-      0.5f, 0.5f, 0.0f, // Top-right vertex
-
-  };
-
-  const std::vector<GLfloat> vertexColors{
-      // r   g     b
-      1.0f, 0.0f, 0.0f, // Left vertex pos
-      0.0f, 1.0f, 0.0f, // Right vertex pos
-      0.0f, 0.0f, 1.0f, // Top vertex pos
-                        // second triangle
-      0.0f, 0.0f, 1.0f, // Top vertex pos
-  };
-
-  glGenVertexArrays(1, &mesh->mVertexArrayObj);
-  glBindVertexArray(mesh->mVertexArrayObj);
-
-  // Setting up positions
-  glGenBuffers(1, &mesh->mVertexBufferObj);
-  glBindBuffer(GL_ARRAY_BUFFER, mesh->mVertexBufferObj);
-  glBufferData(GL_ARRAY_BUFFER, vertexPosition.size() * sizeof(GLfloat),
-               vertexPosition.data(), GL_STATIC_DRAW);
-
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, (void *)0);
-
-  // Setting up colors
-  glGenBuffers(1, &mesh->mVertexBufferObj2);
-  glBindBuffer(GL_ARRAY_BUFFER, mesh->mVertexBufferObj2);
-  glBufferData(GL_ARRAY_BUFFER, vertexColors.size() * sizeof(GLfloat),
-               vertexColors.data(), GL_STATIC_DRAW);
-
-  // Setup index buffer object
-  const std::vector<GLuint> indexBufferData{2, 0, 1, 3, 2, 1};
-
-  glGenBuffers(1, &mesh->mIndexBufferObj);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->mIndexBufferObj);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferData.size() * sizeof(GLuint),
-               indexBufferData.data(), GL_STATIC_DRAW);
-
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1, 3, // rgb
-                        GL_FLOAT, false, 0, (void *)0);
-
-  glBindVertexArray(0);
-  glDisableVertexAttribArray(0);
+  LOG_INFO(kLogGL, "Vendor: {}", glGetString(GL_VENDOR));
+  LOG_INFO(kLogGL, "Renderer: {}", glGetString(GL_RENDERER));
+  LOG_INFO(kLogGL, "Version: {}", glGetString(GL_VERSION));
+  LOG_INFO(kLogGL, "Shading Language: {}",
+           glGetString(GL_SHADING_LANGUAGE_VERSION));
 }
 
 void InitializeProgram(App *app) {
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-    std::cout << "Failed to initialize the SDL2 library\n";
+    LOG_ERROR(kLogCore, "Failed to initialize the SDL2 library");
     exit(1);
   }
 
@@ -212,52 +196,80 @@ void InitializeProgram(App *app) {
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
   SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+  GLConfigureContext();
 
   app->mGraphicsAppWindow = SDL_CreateWindow(
       "OpenGL Window", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
       app->mScreenWidth, app->mScreenHeight, SDL_WINDOW_OPENGL);
 
   if (app->mGraphicsAppWindow == nullptr) {
-    std::cout << "SDL_Window was not able to be created" << std::endl;
+    LOG_ERROR(kLogCore, "SDL_Window was not able to be created");
     exit(1);
   }
 
   app->mOpenGLContext = SDL_GL_CreateContext(app->mGraphicsAppWindow);
 
   if (app->mOpenGLContext == nullptr) {
-    std::cout << "OpenGL context not available\n";
+    LOG_ERROR(kLogCore, "OpenGL context not available");
     exit(1);
   }
 
   // Initialize the Glad Library
   if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) {
-    std::cout << "glad was not initialized" << std::endl;
+    LOG_ERROR(kLogCore, "glad was not initialized");
     exit(1);
   }
 
   GetOpenGLVersionInfo();
+  GLInstallDebugOutput();
+  app->mFramePacer.Initialize(app->mGraphicsAppWindow, app->mPacing);
+
+  // Hooks have to be in before the first resource is created, stats first
+  // so the capture can remove its own hooks
+  if (!app->mStatsPath.empty()) {
+    RenderStatsEnable();
+  }
+  if (!app->mCapturePath.empty()) {
+    GLTraceBegin(app->mCapturePath, app->mCaptureFirstFrame,
+                 app->mCaptureFrames);
+  }
+
+  app->mProgramCache.Initialize();
 }
 
-void Input() {
+// Applies the input latched for this frame that does not go through the
+// simulation, so mouse look is not delayed to the next step
+void Input(const InputFrame &input) {
   static int mouseX = gApp.mScreenWidth / 2;
   static int mouseY = gApp.mScreenHeight / 2;
 
-  SDL_Event e;
-
-  while (SDL_PollEvent(&e) != 0) {
-    if (e.type == SDL_QUIT) {
-      std::cout << "Goodbye!" << std::endl;
-      gApp.mQuit = true;
-    } else if (e.type == SDL_MOUSEMOTION) {
-      mouseX += e.motion.xrel;
-      mouseY += e.motion.yrel;
-      gApp.mCamera.MouseLook(mouseX, mouseY);
-    }
+  if (input.mQuit) {
+    LOG_INFO(kLogCore, "Goodbye!");
+    gApp.mQuit = true;
+  }
+  if (input.mMouseDeltaX != 0 || input.mMouseDeltaY != 0) {
+    mouseX += input.mMouseDeltaX;
+    mouseY += input.mMouseDeltaY;
+    gApp.mCamera.MouseLook(mouseX, mouseY);
+  }
+  if (input.mKeys[SDL_SCANCODE_ESCAPE]) {
+    gApp.mQuit = true;
   }
+}
+
+static bool CameraKeysHeld(const Uint8 *state) {
+  return state[SDL_SCANCODE_E] || state[SDL_SCANCODE_D] ||
+         state[SDL_SCANCODE_S] || state[SDL_SCANCODE_F];
+}
+
+// One fixed step of everything that moves
+void Simulate(const InputFrame &input, float seconds) {
+  // World units per second
+  static const float cameraSpeed = 6.0f;
 
-  // Retrieve keyboard state
-  const Uint8 *state = SDL_GetKeyboardState(NULL);
-  float speed = 0.1f;
+  gApp.mCamera.BeginStep();
+  const Uint8 *state = input.mKeys;
+  float speed = cameraSpeed * seconds;
   if (state[SDL_SCANCODE_E]) {
     gApp.mCamera.MoveForward(speed);
     // g_uOffset += 0.01f;
@@ -272,127 +284,326 @@ void Input() {
   if (state[SDL_SCANCODE_F]) {
     gApp.mCamera.MoveRight(speed);
   }
-  if (state[SDL_SCANCODE_ESCAPE]) {
-    gApp.mQuit = true;
-  }
-}
 
-// Returns location of uniform var based on its name
-int FindUniformLocation(GLuint pipeline, const GLchar *name) {
-  GLint location = glGetUniformLocation(pipeline, name);
-  if (location < 0) {
-    std::cerr << "Could not find " << name << ", maybe a mispelling?\n";
-    exit(EXIT_FAILURE);
-  }
-  return location;
+  MeshSimulate(&gMesh1, seconds);
+  MeshSimulate(&gMesh2, seconds);
 }
 
-void MeshDraw(Mesh3D *mesh) {
-  if (mesh == nullptr) {
-    return;
+static bool SceneIsAnimated() {
+  if (!gApp.mScenePath.empty()) {
+    return gApp.mSceneRenderer.IsAnimated();
   }
+  return gMesh1.mSpinDegreesPerSecond != 0.0f ||
+         gMesh2.mSpinDegreesPerSecond != 0.0f;
+}
 
-  // Setup which graphics pipeline we are going to use
-  glUseProgram(mesh->mPipeline);
-
-  mesh->m_uRotate -= 0.1f;
-
-  // Model tansformation by translating object into world space
-  glm::mat4 model = glm::translate(glm::mat4(1.0f),
-                                   glm::vec3(mesh->mTransform.translation.x,
-                                             mesh->mTransform.translation.y,
-                                             mesh->mTransform.translation.z));
-
-  model = glm::rotate(model, glm::radians(mesh->m_uRotate),
-                      glm::vec3(0.0f, 1.0f, 0.0f));
-  model = glm::scale(model,
-                     glm::vec3(mesh->m_uScale, mesh->m_uScale, mesh->m_uScale));
-
-  GLint u_ModelMatrixLocation =
-      FindUniformLocation(gApp.mGraphicsPipelineShaderProgram, "uModelMatrix");
-  glUniformMatrix4fv(u_ModelMatrixLocation, 1, false, &model[0][0]);
-
-  glm::mat4 view = gApp.mCamera.GetViewMatrix();
-  GLint u_ViewLocation =
-      FindUniformLocation(gApp.mGraphicsPipelineShaderProgram, "uViewMatrix");
-  glUniformMatrix4fv(u_ViewLocation, 1, false, &view[0][0]);
+// With --on-demand, decides whether this frame has to be drawn. Animation
+// is redrawn at its own rate rather than every frame.
+static bool NeedsRedraw(const InputFrame &input, int steps) {
+  bool redraw = input.mEventCount > 0 || input.mWindowChanged;
 
-  glm::mat4 perspective = gApp.mCamera.GetProjectionMatrix();
+  uint64_t delivered = gApp.mPipelineCompiler.GetDeliveredCount();
+  if (delivered != gApp.mProgramsDelivered) {
+    gApp.mProgramsDelivered = delivered;
+    redraw = true;
+  }
 
-  GLint u_ProjectionLocation =
-      FindUniformLocation(gApp.mGraphicsPipelineShaderProgram, "uProjection");
-  glUniformMatrix4fv(u_ProjectionLocation, 1, false, &perspective[0][0]);
+  uint64_t changes = gApp.mTextures.GetChangeCount();
+  if (changes != gApp.mTextureChanges) {
+    gApp.mTextureChanges = changes;
+    redraw = true;
+  }
 
-  // Enable our attributes
-  glBindVertexArray(mesh->mVertexArrayObj);
+  if (steps > 0 && CameraKeysHeld(input.mKeys)) {
+    redraw = true;
+  }
 
-  // Render Data
-  // glDrawArrays(GL_TRIANGLES, 0, 6);
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+  Uint64 now = SDL_GetPerformanceCounter();
+  if (SceneIsAnimated() && now >= gApp.mNextAnimationFrame) {
+    redraw = true;
+  }
+  if (redraw) {
+    gApp.mNextAnimationFrame =
+        now + (Uint64)(SDL_GetPerformanceFrequency() / gApp.mAnimationRate);
+  }
+  return redraw;
+}
 
-  // Stop using our current graphics pipeline
-  glUseProgram(0);
+// Blocks until the next input, animation frame or simulation step that
+// could change the picture. Compiles finishing on the worker have no
+// event, so the wait is bounded. Texture uploads only make progress in
+// Update, so they keep the loop turning over quickly.
+static void WaitForChange(const InputFrame &input) {
+  static const double maxWaitSeconds = 0.1;
+  static const double uploadWaitSeconds = 0.005;
+
+  double wait = maxWaitSeconds;
+  if (gApp.mTextures.IsBusy()) {
+    wait = uploadWaitSeconds;
+  }
+  if (SceneIsAnimated()) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double untilAnimation =
+        now < gApp.mNextAnimationFrame
+            ? (double)(gApp.mNextAnimationFrame - now) /
+                  SDL_GetPerformanceFrequency()
+            : 0.0;
+    wait = std::min(wait, untilAnimation);
+  }
+  if (CameraKeysHeld(input.mKeys)) {
+    wait = std::min(wait, gApp.mTimestep.SecondsToNextStep());
+  }
+  gApp.mInput.Wait(std::max(1, (int)std::ceil(wait * 1000.0)));
 }
 
 void MainLoop() {
   SDL_WarpMouseInWindow(gApp.mGraphicsAppWindow, gApp.mScreenWidth / 2,
                         gApp.mScreenHeight / 2);
   SDL_SetRelativeMouseMode(SDL_TRUE);
+  Uint64 lastCounter = SDL_GetPerformanceCounter();
   while (!gApp.mQuit) {
-    Input();
+    {
+      PROFILE_SCOPE("FramePacer");
+      gApp.mFramePacer.BeginFrame();
+    }
+
+    {
+      PROFILE_SCOPE("Update");
+      // Swap in any programs that finished compiling
+      gApp.mShaderHotReload.Update();
+      gApp.mPipelineCompiler.Poll();
+
+      gApp.mTextures.Update();
+    }
+
+    // Latched as late as possible so every draw sees the freshest camera
+    InputFrame input;
+    int steps = 0;
+    {
+      PROFILE_SCOPE("Input");
+      input = gApp.mInput.Latch();
+      Input(input);
+    }
 
-    glDisable(GL_DEPTH_TEST);
-    glDisable(GL_CULL_FACE);
+    {
+      PROFILE_SCOPE("Simulate");
+      Uint64 counter = SDL_GetPerformanceCounter();
+      double elapsed =
+          (double)(counter - lastCounter) / SDL_GetPerformanceFrequency();
+      lastCounter = counter;
+
+      steps = gApp.mTimestep.Advance(elapsed);
+      for (int i = 0; i < steps; ++i) {
+        Simulate(input, (float)gApp.mTimestep.StepSeconds());
+      }
+    }
+    float alpha = gApp.mTimestep.Alpha();
 
-    glViewport(0, 0, gApp.mScreenWidth, gApp.mScreenHeight);
-    glClearColor(1.f, 1.f, 0.1f, 1.f);
+    if (gApp.mOnDemand && !NeedsRedraw(input, steps)) {
+      gApp.mFramePacer.FrameSkipped();
+      PROFILE_SCOPE("Idle");
+      WaitForChange(input);
+      continue;
+    }
 
-    glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+    {
+      PROFILE_SCOPE("Render");
+      PROFILE_GPU_SCOPE("Render");
+      RenderBeginFrame(gApp.mScreenWidth, gApp.mScreenHeight);
+
+      Camera camera = gApp.mCamera.Interpolated(alpha);
+      if (!gApp.mScenePath.empty()) {
+        // Scene motion is a function of time, so evaluating it at the
+        // interpolated time is the interpolated state
+        gApp.mSceneRenderer.Update((float)gApp.mTimestep.RenderSeconds());
+        gApp.mSceneRenderer.Draw(camera);
+      } else {
+        MeshDraw(&gMesh1, camera, alpha);
+
+        MeshDraw(&gMesh2, camera, alpha);
+      }
+    }
 
-    MeshDraw(&gMesh1);
+    // Catch anything the frame raised without syncing on every call
+    GLCheckPoint("frame");
 
-    MeshDraw(&gMesh2);
+    GLTraceFrameEnd();
 
     // Update the screen
-    SDL_GL_SwapWindow(gApp.mGraphicsAppWindow);
+    gApp.mFramePacer.BeforeSwap();
+    {
+      PROFILE_SCOPE("SDL_GL_SwapWindow");
+      SDL_GL_SwapWindow(gApp.mGraphicsAppWindow);
+    }
+    gApp.mFramePacer.EndFrame();
+    gApp.mLatency.FrameSwapped(input);
+
+    ProfilerEndFrame();
+    RenderStatsEndFrame();
   }
 }
 
 void CleanUp() {
-  SDL_DestroyWindow(gApp.mGraphicsAppWindow);
-  gApp.mGraphicsAppWindow = nullptr;
+  gApp.mShaderHotReload.Stop();
+  gApp.mPipelineCompiler.StopWorker();
 
-  // Delete opengl objects
-  MeshDelete(&gMesh1);
+  if (!gApp.mStatsPath.empty()) {
+    RenderStatsWriteCsv(gApp.mStatsPath);
+  }
+  if (!gApp.mProfilePath.empty()) {
+    ProfilerPrintStats();
+    ProfilerWriteChromeTrace(gApp.mProfilePath);
+  }
+  gApp.mFramePacer.PrintStats();
+  gApp.mLatency.PrintStats();
+  gApp.mLatency.Destroy();
+  if (gApp.mTexture != 0) {
+    gApp.mTextures.PrintResidencyStats();
+  }
+
+  // Delete opengl objects while their context still exists
+  gApp.mGeometry.Release(&gMesh1);
+  gApp.mGeometry.Release(&gMesh2);
+  gApp.mGeometry.Destroy();
+  gApp.mSceneRenderer.Destroy();
+  gApp.mTextures.Destroy();
 
   // Delete graphics pipeline
-  glDeleteProgram(gApp.mGraphicsPipelineShaderProgram);
+  gApp.mShaderHotReload.Clear();
+  gApp.mShaderLibrary.Clear();
+  gApp.mProgramPipelines.Clear();
+
+  SDL_GL_DeleteContext(gApp.mOpenGLContext);
+  gApp.mOpenGLContext = nullptr;
+  SDL_DestroyWindow(gApp.mGraphicsAppWindow);
+  gApp.mGraphicsAppWindow = nullptr;
   SDL_Quit();
+
+  LogStop();
 }
 
 int main(int argc, char *argv[]) {
 
+  ProfilerSetThreadName("Main");
+
+  for (int i = 1; i < argc; ++i) {
+    int mode;
+    if (std::strncmp(argv[i], "--gl-check=", 11) == 0 &&
+        GLParseCheckMode(argv[i] + 11, &mode)) {
+      GLSetCheckMode(mode);
+    } else if (std::strncmp(argv[i], "--capture=", 10) == 0) {
+      gApp.mCapturePath = argv[i] + 10;
+    } else if (std::strncmp(argv[i], "--capture-frames=", 17) == 0) {
+      // first:count
+      int first = 0;
+      int count = 0;
+      if (std::sscanf(argv[i] + 17, "%d:%d", &first, &count) == 2 &&
+          first >= 0 && count > 0) {
+        gApp.mCaptureFirstFrame = first;
+        gApp.mCaptureFrames = count;
+      } else {
+        LOG_WARNING(kLogCore, "Bad --capture-frames {}, expected first:count",
+                    argv[i] + 17);
+      }
+    } else if (std::strncmp(argv[i], "--scene=", 8) == 0) {
+      gApp.mScenePath = argv[i] + 8;
+    } else if (std::strncmp(argv[i], "--texture=", 10) == 0) {
+      gApp.mTexturePath = argv[i] + 10;
+    } else if (std::strncmp(argv[i], "--texture-budget=", 17) == 0) {
+      double megabytes = std::atof(argv[i] + 17);
+      gApp.mTextures.SetMemoryBudget((size_t)(megabytes * 1024 * 1024));
+    } else if (std::strncmp(argv[i], "--texture-ram=", 14) == 0) {
+      double megabytes = std::atof(argv[i] + 14);
+      gApp.mTextures.SetImageBudget((size_t)(megabytes * 1024 * 1024));
+    } else if (std::strncmp(argv[i], "--stats=", 8) == 0) {
+      gApp.mStatsPath = argv[i] + 8;
+    } else if (std::strncmp(argv[i], "--profile=", 10) == 0) {
+      gApp.mProfilePath = argv[i] + 10;
+      ProfilerSetEnabled(true);
+    } else if (std::strncmp(argv[i], "--vsync=", 8) == 0) {
+      if (!ParseVsyncMode(argv[i] + 8, &gApp.mPacing.mVsync)) {
+        LOG_WARNING(kLogCore, "Unknown vsync mode {}", argv[i] + 8);
+      }
+    } else if (std::strncmp(argv[i], "--max-fps=", 10) == 0) {
+      gApp.mPacing.mMaxFps = std::atof(argv[i] + 10);
+    } else if (std::strncmp(argv[i], "--on-demand", 11) == 0) {
+      gApp.mOnDemand = true;
+      if (argv[i][11] == '=' && std::atof(argv[i] + 12) > 0.0) {
+        gApp.mAnimationRate = std::atof(argv[i] + 12);
+      }
+    } else if (std::strncmp(argv[i], "--sim-rate=", 11) == 0) {
+      double rate = std::atof(argv[i] + 11);
+      if (rate > 0.0) {
+        gApp.mTimestep = FixedTimestep(1.0 / rate);
+      }
+    } else if (std::strcmp(argv[i], "--compile-on-worker") == 0) {
+      gApp.mCompileOnWorker = true;
+    } else if (std::strcmp(argv[i], "--program-pipelines") == 0) {
+      gApp.mUseProgramPipelines = true;
+    } else if (std::strcmp(argv[i], "--hot-reload") == 0) {
+      gApp.mHotReloadShaders = true;
+    } else if (std::strcmp(argv[i], "--just-in-time") == 0) {
+      gApp.mPacing.mJustInTime = true;
+    } else if (std::strncmp(argv[i], "--log=", 6) == 0) {
+      LogStart(argv[i] + 6);
+    } else if (std::strncmp(argv[i], "--log-level=", 12) == 0 &&
+               LogParseLevel(argv[i] + 12, &mode)) {
+      LogSetLevel(mode);
+    }
+  }
+
   InitializeProgram(&gApp);
 
+  // Far enough to see all of a loaded scene
+  float farPlane = 10.0f;
+  if (!gApp.mScenePath.empty()) {
+    if (!SceneLoad(gApp.mScenePath, &gApp.mScene)) {
+      exit(1);
+    }
+    glm::vec3 center;
+    float radius;
+    SceneBounds(gApp.mScene, &center, &radius);
+    farPlane = std::max(farPlane, glm::length(center) + radius);
+  }
+
   // Setup camera
   gApp.mCamera.SetProjectionMatrix(
       glm::radians(45.0f), (float)gApp.mScreenWidth / (float)gApp.mScreenHeight,
-      0.1f, 10.0f);
+      0.1f, farPlane);
 
-  MeshCreate(&gMesh1);
+  gApp.mGeometry.Acquire(&gMesh1, MeshQuadData());
   gMesh1.mTransform.translation.x = 0.0f;
   gMesh1.mTransform.translation.y = 0.0f;
   gMesh1.mTransform.translation.z = -2.0f;
 
-  MeshCreate(&gMesh2);
+  gApp.mGeometry.Acquire(&gMesh2, MeshQuadData());
   gMesh2.mTransform.translation.x = 2.0f;
   gMesh2.mTransform.translation.y = 0.0f;
   gMesh2.mTransform.translation.z = -2.0f;
 
+  gApp.mTextures.Initialize();
+  if (!gApp.mTexturePath.empty()) {
+    SamplerDesc samplerDesc;
+    samplerDesc.mAnisotropy = 8.0f;
+    GLuint sampler = gApp.mTextures.GetSampler(samplerDesc);
+    TextureOptions options;
+    options.mStream = true;
+    gApp.mTexture = gApp.mTextures.Load(gApp.mTexturePath, options);
+    MeshSetTexture(&gMesh1, &gApp.mTextures, gApp.mTexture, sampler);
+    MeshSetTexture(&gMesh2, &gApp.mTextures, gApp.mTexture, sampler);
+  }
+
+  // Empty steps so the first frames do not interpolate from the origin
+  MeshSimulate(&gMesh1, 0.0f);
+  MeshSimulate(&gMesh2, 0.0f);
+
   CreateGraphicsPipeline();
 
-  MeshSetPipeline(&gMesh1, gApp.mGraphicsPipelineShaderProgram);
-  MeshSetPipeline(&gMesh2, gApp.mGraphicsPipelineShaderProgram);
+  if (!gApp.mScenePath.empty() &&
+      !gApp.mSceneRenderer.Create(&gApp.mScene, &gApp.mShaderLibrary)) {
+    LOG_ERROR(kLogCore, "Could not build the scene");
+    exit(1);
+  }
 
   MainLoop();
 
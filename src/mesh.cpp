@@ -0,0 +1,169 @@
+#include "Mesh.hpp"
+
+#include <algorithm>
+#include <glm/gtc/matrix_transform.hpp>
+
+MeshData MeshQuadData() {
+  MeshData data;
+
+  data.positions = {
+      // x    y    z
+      -0.5f, -0.5f, 0.0f, // Left vertex
+      0.5f, -0.5f, 0.0f,  // Right vertex
+      -0.5f, 0.5f, 0.0f,  // Top vertex
+      // Second Triangle
+
+      0.5f, 0.5f, 0.0f, // Top-right vertex
+
+  };
+
+  data.colors = {
+      // r   g     b
+      1.0f, 0.0f, 0.0f, // Left vertex pos
+      0.0f, 1.0f, 0.0f, // Right vertex pos
+      0.0f, 0.0f, 1.0f, // Top vertex pos
+                        // second triangle
+      0.0f, 0.0f, 1.0f, // Top vertex pos
+  };
+
+  data.texcoords = {
+      // u   v
+      0.0f, 1.0f, // Left vertex
+      1.0f, 1.0f, // Right vertex
+      0.0f, 0.0f, // Top vertex
+      1.0f, 0.0f, // Top-right vertex
+  };
+
+  data.indices = {2, 0, 1, 3, 2, 1};
+
+  return data;
+}
+
+void MeshCreate(Mesh3D *mesh) { MeshCreate(mesh, MeshQuadData()); }
+
+void MeshCreate(Mesh3D *mesh, const MeshData &data) {
+  const std::vector<GLfloat> &vertexPosition = data.positions;
+  const std::vector<GLfloat> &vertexColors = data.colors;
+
+  glGenVertexArrays(1, &mesh->mVertexArrayObj);
+  glBindVertexArray(mesh->mVertexArrayObj);
+
+  // Setting up positions
+  glGenBuffers(1, &mesh->mVertexBufferObj);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->mVertexBufferObj);
+  glBufferData(GL_ARRAY_BUFFER, vertexPosition.size() * sizeof(GLfloat),
+               vertexPosition.data(), GL_STATIC_DRAW);
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, (void *)0);
+
+  mesh->mBoundsRadius = 0.0f;
+  for (size_t i = 0; i + 2 < vertexPosition.size(); i += 3) {
+    mesh->mBoundsRadius =
+        std::max(mesh->mBoundsRadius,
+                 glm::length(glm::vec3(vertexPosition[i], vertexPosition[i + 1],
+                                       vertexPosition[i + 2])));
+  }
+
+  // Setting up colors
+  glGenBuffers(1, &mesh->mVertexBufferObj2);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->mVertexBufferObj2);
+  glBufferData(GL_ARRAY_BUFFER, vertexColors.size() * sizeof(GLfloat),
+               vertexColors.data(), GL_STATIC_DRAW);
+
+  // Setup index buffer object
+  const std::vector<GLuint> &indexBufferData = data.indices;
+  mesh->mIndexCount = (GLsizei)indexBufferData.size();
+
+  glGenBuffers(1, &mesh->mIndexBufferObj);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->mIndexBufferObj);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferData.size() * sizeof(GLuint),
+               indexBufferData.data(), GL_STATIC_DRAW);
+
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 3, // rgb
+                        GL_FLOAT, false, 0, (void *)0);
+
+  if (!data.texcoords.empty()) {
+    glGenBuffers(1, &mesh->mTexcoordBufferObj);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->mTexcoordBufferObj);
+    glBufferData(GL_ARRAY_BUFFER, data.texcoords.size() * sizeof(GLfloat),
+                 data.texcoords.data(), GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, // uv
+                          GL_FLOAT, false, 0, (void *)0);
+  }
+
+  glBindVertexArray(0);
+  glDisableVertexAttribArray(0);
+}
+
+void MeshDelete(Mesh3D *mesh) {
+  glDeleteVertexArrays(1, &mesh->mVertexArrayObj);
+  glDeleteBuffers(1, &mesh->mVertexBufferObj);
+  glDeleteBuffers(1, &mesh->mVertexBufferObj2);
+  glDeleteBuffers(1, &mesh->mTexcoordBufferObj);
+  glDeleteBuffers(1, &mesh->mIndexBufferObj);
+  mesh->mVertexArrayObj = 0;
+  mesh->mVertexBufferObj = 0;
+  mesh->mVertexBufferObj2 = 0;
+  mesh->mTexcoordBufferObj = 0;
+  mesh->mIndexBufferObj = 0;
+  mesh->mIndexCount = 0;
+}
+
+void MeshSetPipeline(Mesh3D *mesh, GLuint pipeline) {
+
+  mesh->mPipeline = pipeline;
+  mesh->mProgramPipeline = 0;
+  mesh->mVertexStage = 0;
+}
+
+void MeshSetProgramPipeline(Mesh3D *mesh, GLuint programPipeline,
+                            GLuint vertexStage) {
+  mesh->mPipeline = 0;
+  mesh->mProgramPipeline = programPipeline;
+  mesh->mVertexStage = vertexStage;
+}
+
+void MeshSetTexture(Mesh3D *mesh, TextureManager *textures, uint32_t handle,
+                    GLuint sampler) {
+  mesh->mTextureManager = textures;
+  mesh->mTextureHandle = handle;
+  mesh->mSampler = sampler;
+}
+
+glm::mat4 MeshModelMatrix(const Mesh3D *mesh) {
+  // Model tansformation by translating object into world space
+  glm::mat4 model = glm::translate(glm::mat4(1.0f),
+                                   glm::vec3(mesh->mTransform.translation.x,
+                                             mesh->mTransform.translation.y,
+                                             mesh->mTransform.translation.z));
+
+  model = glm::rotate(model, glm::radians(mesh->m_uRotate),
+                      glm::vec3(0.0f, 1.0f, 0.0f));
+  model = glm::scale(model,
+                     glm::vec3(mesh->m_uScale, mesh->m_uScale, mesh->m_uScale));
+
+  return model;
+}
+
+glm::mat4 MeshModelMatrix(const Mesh3D *mesh, float alpha) {
+  glm::vec3 translation = glm::mix(mesh->mPrevTransform.translation,
+                                   mesh->mTransform.translation, alpha);
+  float rotate = glm::mix(mesh->mPrevRotate, mesh->m_uRotate, alpha);
+
+  glm::mat4 model = glm::translate(glm::mat4(1.0f), translation);
+  model = glm::rotate(model, glm::radians(rotate), glm::vec3(0.0f, 1.0f, 0.0f));
+  model = glm::scale(model,
+                     glm::vec3(mesh->m_uScale, mesh->m_uScale, mesh->m_uScale));
+
+  return model;
+}
+
+void MeshSimulate(Mesh3D *mesh, float seconds) {
+  mesh->mPrevTransform = mesh->mTransform;
+  mesh->mPrevRotate = mesh->m_uRotate;
+  mesh->m_uRotate += mesh->mSpinDegreesPerSecond * seconds;
+}
@@ -0,0 +1,288 @@
+#include "PipelineCompiler.hpp"
+#include "Log.hpp"
+#include "Profiler.hpp"
+#include "Shader.hpp"
+
+PipelineCompiler::PipelineCompiler(ProgramBinaryCache *cache)
+    : mCache(cache), mWorkerWindow(nullptr), mWorkerContext(nullptr),
+      mWorkerPending(0), mStopWorker(false) {}
+
+PipelineCompiler::~PipelineCompiler() { StopWorker(); }
+
+bool PipelineCompiler::StartWorker(SDL_Window *window) {
+  if (mWorker.joinable()) {
+    return true;
+  }
+
+  SDL_GLContext mainContext = SDL_GL_GetCurrentContext();
+
+  // The worker needs its own drawable, a hidden window is the portable way
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+  mWorkerWindow = SDL_CreateWindow("", SDL_WINDOWPOS_UNDEFINED,
+                                   SDL_WINDOWPOS_UNDEFINED, 1, 1,
+                                   SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+  if (mWorkerWindow != nullptr) {
+    mWorkerContext = SDL_GL_CreateContext(mWorkerWindow);
+  }
+  SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+
+  // Creating a context makes it current, give the main thread its own back
+  SDL_GL_MakeCurrent(window, mainContext);
+
+  if (mWorkerContext == nullptr) {
+    LOG_WARNING(kLogShader,
+                "Shared compile context not available, compiling on the main "
+                "thread: {}",
+                SDL_GetError());
+    if (mWorkerWindow != nullptr) {
+      SDL_DestroyWindow(mWorkerWindow);
+      mWorkerWindow = nullptr;
+    }
+    return false;
+  }
+
+  mStopWorker = false;
+  mWorker = std::thread(&PipelineCompiler::WorkerMain, this);
+  return true;
+}
+
+void PipelineCompiler::StopWorker() {
+  if (!mWorker.joinable()) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopWorker = true;
+  }
+  mWake.notify_one();
+  mWorker.join();
+
+  SDL_GL_DeleteContext(mWorkerContext);
+  SDL_DestroyWindow(mWorkerWindow);
+  mWorkerContext = nullptr;
+  mWorkerWindow = nullptr;
+
+  // Hand over anything the worker finished on its way out
+  for (Job &job : mWorkerDone) {
+    Complete(job);
+  }
+  mWorkerDone.clear();
+  mWorkerPending = 0;
+}
+
+void PipelineCompiler::Submit(const std::string &name,
+                              const std::string &vertexShaderSrc,
+                              const std::string &fragmentShaderSrc,
+                              ReadyCallback onReady) {
+  Job job;
+  job.mName = name;
+  job.mVertexShaderSrc = vertexShaderSrc;
+  job.mFragmentShaderSrc = fragmentShaderSrc;
+  job.mOnReady = onReady;
+  mQueued.push_back(job);
+}
+
+size_t PipelineCompiler::Poll() {
+  if (mWorker.joinable()) {
+    std::vector<Job> done;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mWorkerPending += mQueued.size();
+      mWorkerQueue.insert(mWorkerQueue.end(), mQueued.begin(), mQueued.end());
+      done.swap(mWorkerDone);
+    }
+    if (!mQueued.empty()) {
+      mQueued.clear();
+      mWake.notify_one();
+    }
+
+    for (Job &job : done) {
+      Complete(job);
+    }
+    mWorkerPending -= done.size();
+    return mWorkerPending;
+  }
+
+  if (!mQueued.empty()) {
+    Issue(mQueued);
+    mIssued.insert(mIssued.end(), mQueued.begin(), mQueued.end());
+    mQueued.clear();
+  }
+
+  for (size_t i = 0; i < mIssued.size();) {
+    if (!IsComplete(mIssued[i])) {
+      ++i;
+      continue;
+    }
+    Resolve(mIssued[i]);
+    Complete(mIssued[i]);
+    mIssued.erase(mIssued.begin() + i);
+  }
+
+  return mIssued.size();
+}
+
+void PipelineCompiler::Finish() {
+  if (mWorker.joinable()) {
+    while (Poll() > 0) {
+      SDL_Delay(1);
+    }
+    return;
+  }
+
+  Issue(mQueued);
+  mIssued.insert(mIssued.end(), mQueued.begin(), mQueued.end());
+  mQueued.clear();
+
+  for (Job &job : mIssued) {
+    Resolve(job);
+    Complete(job);
+  }
+  mIssued.clear();
+}
+
+void PipelineCompiler::Issue(std::vector<Job> &jobs) {
+  // Let the driver spread compiles over its own threads, once per context
+  static thread_local bool requestedThreads = false;
+  if (!requestedThreads) {
+    requestedThreads = true;
+    if (GLAD_GL_KHR_parallel_shader_compile) {
+      glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    } else if (GLAD_GL_ARB_parallel_shader_compile) {
+      glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+  }
+
+  bool retrievable = mCache != nullptr && mCache->IsEnabled();
+
+  for (Job &job : jobs) {
+    if (mCache != nullptr) {
+      job.mProgram =
+          mCache->LoadProgram(job.mVertexShaderSrc, job.mFragmentShaderSrc);
+      job.mFromCache = job.mProgram != 0;
+      job.mLinked = job.mFromCache;
+    }
+  }
+
+  // Every compile goes out before any link so the driver can overlap them
+  for (Job &job : jobs) {
+    if (job.mFromCache) {
+      continue;
+    }
+    job.mVertexShader = CompileShader(GL_VERTEX_SHADER, job.mVertexShaderSrc);
+    job.mFragmentShader =
+        CompileShader(GL_FRAGMENT_SHADER, job.mFragmentShaderSrc);
+  }
+
+  for (Job &job : jobs) {
+    if (job.mFromCache) {
+      continue;
+    }
+    job.mProgram = glCreateProgram();
+    if (retrievable) {
+      glProgramParameteri(job.mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                          GL_TRUE);
+    }
+    glAttachShader(job.mProgram, job.mVertexShader);
+    glAttachShader(job.mProgram, job.mFragmentShader);
+    glLinkProgram(job.mProgram);
+  }
+}
+
+bool PipelineCompiler::IsComplete(const Job &job) const {
+  if (job.mFromCache) {
+    return true;
+  }
+  // Without the extension the status query in Resolve simply waits
+  if (!GLAD_GL_KHR_parallel_shader_compile &&
+      !GLAD_GL_ARB_parallel_shader_compile) {
+    return true;
+  }
+
+  GLint complete = GL_FALSE;
+  glGetProgramiv(job.mProgram, GL_COMPLETION_STATUS_KHR, &complete);
+  return complete == GL_TRUE;
+}
+
+void PipelineCompiler::Resolve(Job &job) {
+  if (job.mFromCache) {
+    return;
+  }
+
+  job.mLinked = ProgramLinked(job.mProgram, &job.mLog);
+  if (job.mLinked) {
+    if (mCache != nullptr) {
+      mCache->StoreProgram(job.mProgram, job.mVertexShaderSrc,
+                           job.mFragmentShaderSrc);
+    }
+  } else {
+    std::string shaderLog;
+    if (!ShaderCompiled(job.mVertexShader, &shaderLog)) {
+      job.mLog += "vertex: " + shaderLog;
+    }
+    if (!ShaderCompiled(job.mFragmentShader, &shaderLog)) {
+      job.mLog += "fragment: " + shaderLog;
+    }
+  }
+
+  glDetachShader(job.mProgram, job.mVertexShader);
+  glDetachShader(job.mProgram, job.mFragmentShader);
+  glDeleteShader(job.mVertexShader);
+  glDeleteShader(job.mFragmentShader);
+  job.mVertexShader = 0;
+  job.mFragmentShader = 0;
+
+  if (!job.mLinked) {
+    glDeleteProgram(job.mProgram);
+    job.mProgram = 0;
+  }
+}
+
+void PipelineCompiler::Complete(Job &job) {
+  if (job.mLinked) {
+    ++mDelivered;
+  } else {
+    LOG_ERROR(kLogShader, "Pipeline {} failed to build, keeping the "
+              "fallback:\n{}",
+              job.mName, job.mLog);
+  }
+
+  // Failures are reported too, so callers stop waiting on them
+  if (job.mOnReady) {
+    job.mOnReady(job.mLinked ? job.mProgram : 0);
+  }
+}
+
+void PipelineCompiler::WorkerMain() {
+  SDL_GL_MakeCurrent(mWorkerWindow, mWorkerContext);
+  ProfilerSetThreadName("PipelineCompiler");
+
+  while (true) {
+    std::vector<Job> jobs;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWake.wait(lock,
+                 [this] { return mStopWorker || !mWorkerQueue.empty(); });
+      if (mStopWorker && mWorkerQueue.empty()) {
+        break;
+      }
+      jobs.swap(mWorkerQueue);
+    }
+
+    {
+      PROFILE_SCOPE("CompilePrograms");
+      Issue(jobs);
+      for (Job &job : jobs) {
+        Resolve(job);
+      }
+      // Programs must be complete before the main context touches them
+      glFinish();
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWorkerDone.insert(mWorkerDone.end(), jobs.begin(), jobs.end());
+  }
+
+  SDL_GL_MakeCurrent(mWorkerWindow, nullptr);
+}
@@ -0,0 +1,322 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <glad/glad.h>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "Log.hpp"
+
+struct ProfileEvent {
+  const char *mName;
+  uint64_t mStartNs;
+  uint64_t mEndNs;
+};
+
+// Events each thread can hold before the oldest are overwritten
+static const uint64_t kThreadEvents = 1 << 16;
+// Frames a GPU query waits before it is read
+static const int kGpuFrameLatency = 4;
+// Frames averaged into each published set of stats
+static const int kStatsFrames = 60;
+
+// Written only by its thread; the frame thread reads up to mWritten
+struct ThreadBuffer {
+  std::vector<ProfileEvent> mEvents = std::vector<ProfileEvent>(kThreadEvents);
+  std::atomic<uint64_t> mWritten{0};
+  // Frame thread's read cursor for the stats
+  uint64_t mConsumed = 0;
+  const char *mName = nullptr;
+  int mIndex = 0;
+};
+
+struct GpuScope {
+  const char *mName;
+  GLuint mStartQuery;
+  GLuint mEndQuery;
+};
+
+struct GpuFrame {
+  std::vector<GLuint> mQueries;
+  size_t mUsedQueries = 0;
+  std::vector<GpuScope> mScopes;
+};
+
+struct StatTotals {
+  double mCalls = 0.0;
+  double mCpuMs = 0.0;
+  double mCpuMaxMs = 0.0;
+  double mGpuMs = 0.0;
+};
+
+static std::atomic<bool> gEnabled{false};
+
+static std::mutex gThreadsMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> gThreads;
+
+// Everything below is only touched by the GL thread
+static GpuFrame gGpuFrames[kGpuFrameLatency];
+static int gGpuFrame = 0;
+// Indices into the current frame's scopes still waiting for their end
+static std::vector<size_t> gGpuOpen;
+static std::vector<ProfileEvent> gGpuEvents;
+static uint64_t gGpuEventsWritten = 0;
+static int64_t gGpuToCpuNs = 0;
+static bool gGpuCalibrated = false;
+static uint64_t gGpuFramesDropped = 0;
+
+static std::map<std::string, StatTotals> gWindow;
+static int gWindowFrames = 0;
+
+static std::mutex gStatsMutex;
+static std::vector<ProfileStat> gStats;
+
+static uint64_t NowNs() {
+  static const auto epoch = std::chrono::steady_clock::now();
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+static ThreadBuffer *LocalBuffer() {
+  thread_local ThreadBuffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    // Only the first marker of each thread locks
+    std::lock_guard<std::mutex> lock(gThreadsMutex);
+    gThreads.push_back(std::make_unique<ThreadBuffer>());
+    buffer = gThreads.back().get();
+    buffer->mIndex = (int)gThreads.size();
+  }
+  return buffer;
+}
+
+void ProfilerSetEnabled(bool enabled) { gEnabled = enabled; }
+
+bool ProfilerIsEnabled() { return gEnabled; }
+
+void ProfilerSetThreadName(const char *name) { LocalBuffer()->mName = name; }
+
+ProfileScope::ProfileScope(const char *name)
+    : mName(gEnabled ? name : nullptr), mStartNs(mName ? NowNs() : 0) {}
+
+ProfileScope::~ProfileScope() {
+  if (mName == nullptr) {
+    return;
+  }
+  ThreadBuffer *buffer = LocalBuffer();
+  uint64_t written = buffer->mWritten.load(std::memory_order_relaxed);
+  buffer->mEvents[written % kThreadEvents] = {mName, mStartNs, NowNs()};
+  buffer->mWritten.store(written + 1, std::memory_order_release);
+}
+
+static GLuint NextQuery(GpuFrame &frame) {
+  if (frame.mUsedQueries == frame.mQueries.size()) {
+    GLuint query;
+    glGenQueries(1, &query);
+    frame.mQueries.push_back(query);
+  }
+  return frame.mQueries[frame.mUsedQueries++];
+}
+
+GpuProfileScope::GpuProfileScope(const char *name) : mActive(gEnabled) {
+  if (!mActive) {
+    return;
+  }
+
+  if (!gGpuCalibrated) {
+    // Maps GPU timestamps onto the CPU timeline of the trace
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gGpuToCpuNs = (int64_t)NowNs() - gpuNow;
+    gGpuCalibrated = true;
+  }
+
+  GpuFrame &frame = gGpuFrames[gGpuFrame];
+  GpuScope scope = {name, NextQuery(frame), NextQuery(frame)};
+  glQueryCounter(scope.mStartQuery, GL_TIMESTAMP);
+  gGpuOpen.push_back(frame.mScopes.size());
+  frame.mScopes.push_back(scope);
+}
+
+GpuProfileScope::~GpuProfileScope() {
+  if (!mActive || gGpuOpen.empty()) {
+    return;
+  }
+  // Scopes nest, so the innermost open one is ours
+  GpuFrame &frame = gGpuFrames[gGpuFrame];
+  glQueryCounter(frame.mScopes[gGpuOpen.back()].mEndQuery, GL_TIMESTAMP);
+  gGpuOpen.pop_back();
+}
+
+// Reads the oldest frame in the ring if the driver is done with it,
+// otherwise drops it rather than waiting
+static void CollectGpuFrame(GpuFrame &frame) {
+  if (frame.mScopes.empty()) {
+    return;
+  }
+
+  GLint available = 0;
+  glGetQueryObjectiv(frame.mScopes.back().mEndQuery,
+                     GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    gGpuFramesDropped++;
+  } else {
+    for (const GpuScope &scope : frame.mScopes) {
+      GLuint64 start = 0;
+      GLuint64 end = 0;
+      glGetQueryObjectui64v(scope.mStartQuery, GL_QUERY_RESULT, &start);
+      glGetQueryObjectui64v(scope.mEndQuery, GL_QUERY_RESULT, &end);
+
+      ProfileEvent event = {scope.mName, (uint64_t)(start + gGpuToCpuNs),
+                            (uint64_t)(end + gGpuToCpuNs)};
+      if (gGpuEvents.size() < kThreadEvents) {
+        gGpuEvents.push_back(event);
+      } else {
+        gGpuEvents[gGpuEventsWritten % kThreadEvents] = event;
+      }
+      gGpuEventsWritten++;
+      gWindow[scope.mName].mGpuMs += (end - start) / 1.0e6;
+    }
+  }
+
+  frame.mScopes.clear();
+  frame.mUsedQueries = 0;
+}
+
+static void PublishStats() {
+  std::vector<ProfileStat> stats;
+  for (const auto &[name, totals] : gWindow) {
+    ProfileStat stat;
+    stat.mName = name;
+    stat.mCalls = totals.mCalls / gWindowFrames;
+    stat.mCpuMs = totals.mCpuMs / gWindowFrames;
+    stat.mCpuMaxMs = totals.mCpuMaxMs;
+    stat.mGpuMs = totals.mGpuMs / gWindowFrames;
+    stats.push_back(stat);
+  }
+
+  std::lock_guard<std::mutex> lock(gStatsMutex);
+  gStats.swap(stats);
+}
+
+void ProfilerEndFrame() {
+  if (!gEnabled) {
+    return;
+  }
+
+  // CPU time per name for this frame, over every thread
+  std::map<std::string, double> frameCpuMs;
+  {
+    std::lock_guard<std::mutex> lock(gThreadsMutex);
+    for (auto &buffer : gThreads) {
+      uint64_t written = buffer->mWritten.load(std::memory_order_acquire);
+      uint64_t first = std::max(buffer->mConsumed,
+                                written > kThreadEvents
+                                    ? written - kThreadEvents
+                                    : (uint64_t)0);
+      for (uint64_t i = first; i < written; ++i) {
+        const ProfileEvent &event = buffer->mEvents[i % kThreadEvents];
+        frameCpuMs[event.mName] += (event.mEndNs - event.mStartNs) / 1.0e6;
+        gWindow[event.mName].mCalls += 1.0;
+      }
+      buffer->mConsumed = written;
+    }
+  }
+  for (const auto &[name, ms] : frameCpuMs) {
+    StatTotals &totals = gWindow[name];
+    totals.mCpuMs += ms;
+    totals.mCpuMaxMs = std::max(totals.mCpuMaxMs, ms);
+  }
+
+  gGpuOpen.clear();
+  gGpuFrame = (gGpuFrame + 1) % kGpuFrameLatency;
+  CollectGpuFrame(gGpuFrames[gGpuFrame]);
+
+  if (++gWindowFrames == kStatsFrames) {
+    PublishStats();
+    gWindow.clear();
+    gWindowFrames = 0;
+  }
+}
+
+std::vector<ProfileStat> ProfilerGetStats() {
+  std::lock_guard<std::mutex> lock(gStatsMutex);
+  return gStats;
+}
+
+void ProfilerPrintStats() {
+  std::vector<ProfileStat> stats = ProfilerGetStats();
+  std::printf("%-24s %8s %10s %10s %10s\n", "scope", "calls", "cpu ms",
+              "cpu max", "gpu ms");
+  for (const ProfileStat &stat : stats) {
+    std::printf("%-24s %8.1f %10.3f %10.3f %10.3f\n", stat.mName.c_str(),
+                stat.mCalls, stat.mCpuMs, stat.mCpuMaxMs, stat.mGpuMs);
+  }
+  if (gGpuFramesDropped > 0) {
+    std::printf("%llu GPU frames were not ready in time and were dropped\n",
+                (unsigned long long)gGpuFramesDropped);
+  }
+}
+
+static void WriteEvent(std::ofstream &out, bool &first,
+                       const ProfileEvent &event, int tid) {
+  char line[256];
+  std::snprintf(line, sizeof(line),
+                "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "\n" : ",\n", event.mName, tid,
+                event.mStartNs / 1000.0,
+                (event.mEndNs - event.mStartNs) / 1000.0);
+  out << line;
+  first = false;
+}
+
+static void WriteThreadName(std::ofstream &out, bool &first, int tid,
+                            const std::string &name) {
+  out << (first ? "\n" : ",\n")
+      << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+      << ",\"args\":{\"name\":\"" << name << "\"}}";
+  first = false;
+}
+
+bool ProfilerWriteChromeTrace(const std::string &path) {
+  std::ofstream out(path, std::ios::trunc);
+  if (!out.is_open()) {
+    LOG_ERROR(kLogCore, "Could not write trace {}", path);
+    return false;
+  }
+
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  {
+    std::lock_guard<std::mutex> lock(gThreadsMutex);
+    for (auto &buffer : gThreads) {
+      WriteThreadName(out, first, buffer->mIndex,
+                      buffer->mName != nullptr
+                          ? buffer->mName
+                          : "Thread " + std::to_string(buffer->mIndex));
+      uint64_t written = buffer->mWritten.load(std::memory_order_acquire);
+      uint64_t start = written > kThreadEvents ? written - kThreadEvents : 0;
+      for (uint64_t i = start; i < written; ++i) {
+        WriteEvent(out, first, buffer->mEvents[i % kThreadEvents],
+                   buffer->mIndex);
+      }
+    }
+  }
+
+  // GPU work gets a row of its own
+  if (!gGpuEvents.empty()) {
+    WriteThreadName(out, first, 0, "GPU");
+  }
+  for (const ProfileEvent &event : gGpuEvents) {
+    WriteEvent(out, first, event, 0);
+  }
+
+  out << "\n]}\n";
+  return (bool)out;
+}
@@ -0,0 +1,206 @@
+#include "ProgramBinaryCache.hpp"
+#include "GLTrace.hpp"
+#include "Hash.hpp"
+#include "Log.hpp"
+#include "Shader.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+struct ProgramBinaryHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;
+  uint32_t length;
+};
+
+static const uint32_t kProgramBinaryMagic = 0x4e494250; // "PBIN"
+static const uint32_t kProgramBinaryVersion = 1;
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string &directory)
+    : mDirectory(directory), mSupported(false), mHits(0), mMisses(0) {}
+
+void ProgramBinaryCache::Initialize() {
+  GLint formats = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  mSupported = formats > 0;
+  if (!mSupported) {
+    LOG_WARNING(kLogShader,
+                "Driver exposes no program binary formats, shader cache "
+                "disabled");
+    return;
+  }
+
+  // Binaries are only valid for the driver that produced them
+  mDriverId = std::string((const char *)glGetString(GL_VENDOR)) + "|" +
+              (const char *)glGetString(GL_RENDERER) + "|" +
+              (const char *)glGetString(GL_VERSION);
+
+  std::error_code error;
+  std::filesystem::create_directories(mDirectory, error);
+  if (error) {
+    LOG_ERROR(kLogShader, "Could not create shader cache {}: {}",
+              mDirectory, error.message());
+    mSupported = false;
+  }
+}
+
+GLuint ProgramBinaryCache::CreateProgram(const std::string &vertexShaderSrc,
+                                         const std::string &fragmentShaderSrc,
+                                         const std::string &defines) {
+  GLuint programObj =
+      LoadProgram(vertexShaderSrc, fragmentShaderSrc, defines);
+  if (programObj != 0) {
+    return programObj;
+  }
+
+  programObj = glCreateProgram();
+  GLuint myVertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSrc);
+  GLuint myFragmentShader =
+      CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSrc);
+
+  glProgramParameteri(programObj, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glAttachShader(programObj, myVertexShader);
+  glAttachShader(programObj, myFragmentShader);
+  glLinkProgram(programObj);
+
+  glDetachShader(programObj, myVertexShader);
+  glDetachShader(programObj, myFragmentShader);
+  glDeleteShader(myVertexShader);
+  glDeleteShader(myFragmentShader);
+
+  StoreProgram(programObj, vertexShaderSrc, fragmentShaderSrc, defines);
+
+  return programObj;
+}
+
+GLuint ProgramBinaryCache::LoadProgram(const std::string &vertexShaderSrc,
+                                       const std::string &fragmentShaderSrc,
+                                       const std::string &defines) {
+  std::lock_guard<std::mutex> lock(mMutex);
+  if (!mSupported) {
+    mMisses++;
+    return 0;
+  }
+
+  GLuint programObj = glCreateProgram();
+  if (LoadBinary(programObj,
+                 EntryPath(vertexShaderSrc, fragmentShaderSrc, defines))) {
+    // A trace replayed on another driver cannot use the binary
+    GLTraceProgramSources(programObj, vertexShaderSrc, fragmentShaderSrc);
+    mHits++;
+    return programObj;
+  }
+
+  glDeleteProgram(programObj);
+  mMisses++;
+  return 0;
+}
+
+void ProgramBinaryCache::StoreProgram(GLuint program,
+                                      const std::string &vertexShaderSrc,
+                                      const std::string &fragmentShaderSrc,
+                                      const std::string &defines) {
+  if (!mSupported) {
+    return;
+  }
+
+  if (ProgramLinked(program)) {
+    // Writers of the same entry share its temporary file
+    std::lock_guard<std::mutex> lock(mMutex);
+    StoreBinary(program,
+                EntryPath(vertexShaderSrc, fragmentShaderSrc, defines));
+  }
+}
+
+bool ProgramBinaryCache::IsEnabled() const { return mSupported; }
+
+int ProgramBinaryCache::GetHits() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mHits;
+}
+
+int ProgramBinaryCache::GetMisses() const {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mMisses;
+}
+
+std::string
+ProgramBinaryCache::EntryPath(const std::string &vertexShaderSrc,
+                              const std::string &fragmentShaderSrc,
+                              const std::string &defines) const {
+  uint64_t key = HashString(mDriverId);
+  key = HashString(defines, key);
+  key = HashString(vertexShaderSrc, key);
+  key = HashString(fragmentShaderSrc, key);
+  return mDirectory + "/" + HashToHex(key) + ".bin";
+}
+
+bool ProgramBinaryCache::LoadBinary(GLuint program,
+                                    const std::string &path) const {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file.is_open()) {
+    return false;
+  }
+  uint64_t fileSize = (uint64_t)std::max<std::streamoff>(file.tellg(), 0);
+  file.seekg(0);
+
+  ProgramBinaryHeader header;
+  file.read((char *)&header, sizeof(header));
+  if (!file || header.magic != kProgramBinaryMagic ||
+      header.version != kProgramBinaryVersion) {
+    return false;
+  }
+  // Entries are written whole, so the binary is the rest of the file. A
+  // length that disagrees is corruption, and not allocated for.
+  if (header.length == 0 || header.length != fileSize - sizeof(header)) {
+    return false;
+  }
+
+  std::vector<char> binary(header.length);
+  file.read(binary.data(), binary.size());
+  if (!file) {
+    return false;
+  }
+
+  glProgramBinary(program, header.format, binary.data(), header.length);
+
+  // Drivers may reject binaries after an update even with the same strings
+  return ProgramLinked(program);
+}
+
+void ProgramBinaryCache::StoreBinary(GLuint program,
+                                     const std::string &path) const {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+  ProgramBinaryHeader header{kProgramBinaryMagic, kProgramBinaryVersion,
+                             format, (uint32_t)length};
+
+  // Write aside and rename so a crash never leaves a truncated entry
+  std::string temporary = path + ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+      return;
+    }
+    file.write((const char *)&header, sizeof(header));
+    file.write(binary.data(), binary.size());
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+  }
+}
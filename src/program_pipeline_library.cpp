@@ -0,0 +1,100 @@
+#include "ProgramPipelineLibrary.hpp"
+#include "Hash.hpp"
+#include "Log.hpp"
+#include "Shader.hpp"
+
+ProgramPipelineLibrary::ProgramPipelineLibrary() {}
+
+GLuint ProgramPipelineLibrary::GetStage(GLenum stage, const std::string &path,
+                                        const ShaderDefines &defines) {
+  std::string source = PreprocessShader(path, defines);
+  uint64_t key = HashString(source, HashBytes(&stage, sizeof(stage)));
+
+  auto found = mStages.find(key);
+  if (found != mStages.end()) {
+    return found->second;
+  }
+
+  // Compiles and links a separable program in one call
+  const char *src = source.c_str();
+  GLuint program = glCreateShaderProgramv(stage, 1, &src);
+
+  // Not kept, so the next request tries again once the shader is fixed
+  std::string log;
+  if (!ProgramLinked(program, &log)) {
+    LOG_ERROR(kLogShader, "Stage {} failed to build: {}", path, log);
+    glDeleteProgram(program);
+    return 0;
+  }
+
+  mStages[key] = program;
+  return program;
+}
+
+GLuint ProgramPipelineLibrary::GetPipeline(GLuint vertexStage,
+                                           GLuint fragmentStage) {
+  auto key = std::make_pair(vertexStage, fragmentStage);
+  auto found = mPipelines.find(key);
+  if (found != mPipelines.end()) {
+    return found->second;
+  }
+
+  GLuint pipeline = 0;
+  glGenProgramPipelines(1, &pipeline);
+  glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertexStage);
+  glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragmentStage);
+
+  mPipelines[key] = pipeline;
+  return pipeline;
+}
+
+GLuint ProgramPipelineLibrary::ReplaceStage(GLuint pipeline, GLenum stage,
+                                            const std::string &path,
+                                            const ShaderDefines &defines) {
+  GLuint program = GetStage(stage, path, defines);
+  if (program == 0) {
+    return 0;
+  }
+
+  bool vertex = stage == GL_VERTEX_SHADER;
+  glUseProgramStages(pipeline,
+                     vertex ? GL_VERTEX_SHADER_BIT : GL_FRAGMENT_SHADER_BIT,
+                     program);
+
+  // Keep the pair lookup in step with what the pipeline now holds. The
+  // replaced stage stays cached, other pipelines may still use it.
+  for (auto it = mPipelines.begin(); it != mPipelines.end(); ++it) {
+    if (it->second != pipeline) {
+      continue;
+    }
+    std::pair<GLuint, GLuint> key = it->first;
+    (vertex ? key.first : key.second) = program;
+    mPipelines.erase(it);
+    if (!mPipelines.emplace(key, pipeline).second) {
+      mUnkeyedPipelines.push_back(pipeline);
+    }
+    break;
+  }
+  return program;
+}
+
+void ProgramPipelineLibrary::Clear() {
+  for (auto &entry : mPipelines) {
+    glDeleteProgramPipelines(1, &entry.second);
+  }
+  for (GLuint pipeline : mUnkeyedPipelines) {
+    glDeleteProgramPipelines(1, &pipeline);
+  }
+  mUnkeyedPipelines.clear();
+  for (auto &entry : mStages) {
+    glDeleteProgram(entry.second);
+  }
+  mPipelines.clear();
+  mStages.clear();
+}
+
+size_t ProgramPipelineLibrary::GetStageCount() const { return mStages.size(); }
+
+size_t ProgramPipelineLibrary::GetPipelineCount() const {
+  return mPipelines.size() + mUnkeyedPipelines.size();
+}
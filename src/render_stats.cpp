@@ -0,0 +1,357 @@
+#include "RenderStats.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <glad/glad.h>
+#include <mutex>
+#include <vector>
+
+#include "Log.hpp"
+
+// Frames kept for the CSV dump, the oldest are overwritten
+static const size_t kHistoryFrames = 1 << 14;
+
+static const char *kStatNames[kRenderStatCount] = {
+    "draw_calls",
+    "instances",
+    "triangles",
+    "program_binds",
+    "vao_binds",
+    "texture_binds",
+    "uniform_uploads",
+    "buffer_bytes",
+    "buffer_allocations",
+    "texture_allocations",
+    "culled_in",
+    "culled_out",
+};
+
+static bool gEnabled = false;
+// Atomic since the pipeline compiler and loaders call GL from other threads
+static std::atomic<uint64_t> gCounters[kRenderStatCount];
+
+static std::mutex gHistoryMutex;
+static std::vector<RenderStatsFrame> gHistory;
+static uint64_t gFrame = 0;
+
+static inline void Count(RenderStat stat, uint64_t amount = 1) {
+  gCounters[stat].fetch_add(amount, std::memory_order_relaxed);
+}
+
+static uint64_t Triangles(GLenum mode, GLsizei count) {
+  switch (mode) {
+  case GL_TRIANGLES:
+    return count / 3;
+  case GL_TRIANGLE_STRIP:
+  case GL_TRIANGLE_FAN:
+    return count > 2 ? count - 2 : 0;
+  default:
+    return 0;
+  }
+}
+
+static void CountDraw(GLenum mode, GLsizei count, GLsizei instances) {
+  Count(kRenderStatDrawCalls);
+  Count(kRenderStatInstances, instances);
+  Count(kRenderStatTriangles, Triangles(mode, count) * instances);
+}
+
+// Every hooked entry point, X(name) without the gl prefix
+#define RENDER_STATS_FUNCTIONS(X)                                              \
+  X(DrawArrays)                                                                \
+  X(DrawArraysInstanced)                                                       \
+  X(DrawElements)                                                              \
+  X(DrawElementsBaseVertex)                                                    \
+  X(DrawElementsInstanced)                                                     \
+  X(DrawElementsIndirect)                                                      \
+  X(UseProgram)                                                                \
+  X(BindProgramPipeline)                                                       \
+  X(BindVertexArray)                                                           \
+  X(BindTexture)                                                               \
+  X(Uniform1i)                                                                 \
+  X(Uniform1f)                                                                 \
+  X(Uniform2f)                                                                 \
+  X(Uniform3f)                                                                 \
+  X(Uniform4fv)                                                                \
+  X(UniformMatrix4fv)                                                          \
+  X(ProgramUniform1i)                                                          \
+  X(ProgramUniformMatrix4fv)                                                   \
+  X(BufferData)                                                                \
+  X(BufferSubData)                                                             \
+  X(MapBufferRange)                                                            \
+  X(TexImage2D)                                                                \
+  X(TexImage3D)                                                                \
+  X(TexStorage2D)                                                              \
+  X(TexStorage3D)                                                              \
+  X(CompressedTexImage2D)                                                      \
+  X(CompressedTexImage3D)
+
+#define RENDER_STATS_DECLARE_REAL(name)                                        \
+  static decltype(glad_gl##name) sReal##name;
+RENDER_STATS_FUNCTIONS(RENDER_STATS_DECLARE_REAL)
+
+static void APIENTRY StatsDrawArrays(GLenum mode, GLint first,
+                                     GLsizei count) {
+  sRealDrawArrays(mode, first, count);
+  CountDraw(mode, count, 1);
+}
+
+static void APIENTRY StatsDrawArraysInstanced(GLenum mode, GLint first,
+                                              GLsizei count,
+                                              GLsizei instancecount) {
+  sRealDrawArraysInstanced(mode, first, count, instancecount);
+  CountDraw(mode, count, instancecount);
+}
+
+static void APIENTRY StatsDrawElements(GLenum mode, GLsizei count,
+                                       GLenum type, const void *indices) {
+  sRealDrawElements(mode, count, type, indices);
+  CountDraw(mode, count, 1);
+}
+
+static void APIENTRY StatsDrawElementsBaseVertex(GLenum mode, GLsizei count,
+                                                 GLenum type,
+                                                 const void *indices,
+                                                 GLint basevertex) {
+  sRealDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+  CountDraw(mode, count, 1);
+}
+
+static void APIENTRY StatsDrawElementsInstanced(GLenum mode, GLsizei count,
+                                                GLenum type,
+                                                const void *indices,
+                                                GLsizei instancecount) {
+  sRealDrawElementsInstanced(mode, count, type, indices, instancecount);
+  CountDraw(mode, count, instancecount);
+}
+
+static void APIENTRY StatsDrawElementsIndirect(GLenum mode, GLenum type,
+                                               const void *indirect) {
+  sRealDrawElementsIndirect(mode, type, indirect);
+  Count(kRenderStatDrawCalls);
+}
+
+static void APIENTRY StatsUseProgram(GLuint program) {
+  sRealUseProgram(program);
+  Count(kRenderStatProgramBinds);
+}
+
+static void APIENTRY StatsBindProgramPipeline(GLuint pipeline) {
+  sRealBindProgramPipeline(pipeline);
+  Count(kRenderStatProgramBinds);
+}
+
+static void APIENTRY StatsBindVertexArray(GLuint array) {
+  sRealBindVertexArray(array);
+  Count(kRenderStatVertexArrayBinds);
+}
+
+static void APIENTRY StatsBindTexture(GLenum target, GLuint texture) {
+  sRealBindTexture(target, texture);
+  Count(kRenderStatTextureBinds);
+}
+
+static void APIENTRY StatsUniform1i(GLint location, GLint v0) {
+  sRealUniform1i(location, v0);
+  Count(kRenderStatUniformUploads);
+}
+
+static void APIENTRY StatsUniform1f(GLint location, GLfloat v0) {
+  sRealUniform1f(location, v0);
+  Count(kRenderStatUniformUploads);
+}
+
+static void APIENTRY StatsUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+  sRealUniform2f(location, v0, v1);
+  Count(kRenderStatUniformUploads);
+}
+
+static void APIENTRY StatsUniform3f(GLint location, GLfloat v0, GLfloat v1,
+                                    GLfloat v2) {
+  sRealUniform3f(location, v0, v1, v2);
+  Count(kRenderStatUniformUploads);
+}
+
+static void APIENTRY StatsUniform4fv(GLint location, GLsizei count,
+                                     const GLfloat *value) {
+  sRealUniform4fv(location, count, value);
+  Count(kRenderStatUniformUploads);
+}
+
+static void APIENTRY StatsUniformMatrix4fv(GLint location, GLsizei count,
+                                           GLboolean transpose,
+                                           const GLfloat *value) {
+  sRealUniformMatrix4fv(location, count, transpose, value);
+  Count(kRenderStatUniformUploads);
+}
+
+static void APIENTRY StatsProgramUniform1i(GLuint program, GLint location,
+                                           GLint v0) {
+  sRealProgramUniform1i(program, location, v0);
+  Count(kRenderStatUniformUploads);
+}
+
+static void APIENTRY StatsProgramUniformMatrix4fv(GLuint program,
+                                                  GLint location,
+                                                  GLsizei count,
+                                                  GLboolean transpose,
+                                                  const GLfloat *value) {
+  sRealProgramUniformMatrix4fv(program, location, count, transpose, value);
+  Count(kRenderStatUniformUploads);
+}
+
+static void APIENTRY StatsBufferData(GLenum target, GLsizeiptr size,
+                                     const void *data, GLenum usage) {
+  sRealBufferData(target, size, data, usage);
+  Count(kRenderStatBufferAllocations);
+  if (data != nullptr) {
+    Count(kRenderStatBufferBytes, size);
+  }
+}
+
+static void APIENTRY StatsBufferSubData(GLenum target, GLintptr offset,
+                                        GLsizeiptr size, const void *data) {
+  sRealBufferSubData(target, offset, size, data);
+  Count(kRenderStatBufferBytes, size);
+}
+
+static void *APIENTRY StatsMapBufferRange(GLenum target, GLintptr offset,
+                                          GLsizeiptr length,
+                                          GLbitfield access) {
+  // Assumes a write mapping is filled, which is how the batchers use them
+  if (access & GL_MAP_WRITE_BIT) {
+    Count(kRenderStatBufferBytes, length);
+  }
+  return sRealMapBufferRange(target, offset, length, access);
+}
+
+static void APIENTRY StatsTexImage2D(GLenum target, GLint level,
+                                     GLint internalformat, GLsizei width,
+                                     GLsizei height, GLint border,
+                                     GLenum format, GLenum type,
+                                     const void *pixels) {
+  sRealTexImage2D(target, level, internalformat, width, height, border, format,
+                  type, pixels);
+  Count(kRenderStatTextureAllocations);
+}
+
+static void APIENTRY StatsTexImage3D(GLenum target, GLint level,
+                                     GLint internalformat, GLsizei width,
+                                     GLsizei height, GLsizei depth,
+                                     GLint border, GLenum format, GLenum type,
+                                     const void *pixels) {
+  sRealTexImage3D(target, level, internalformat, width, height, depth, border,
+                  format, type, pixels);
+  Count(kRenderStatTextureAllocations);
+}
+
+static void APIENTRY StatsTexStorage2D(GLenum target, GLsizei levels,
+                                       GLenum internalformat, GLsizei width,
+                                       GLsizei height) {
+  sRealTexStorage2D(target, levels, internalformat, width, height);
+  Count(kRenderStatTextureAllocations);
+}
+
+static void APIENTRY StatsCompressedTexImage2D(GLenum target, GLint level,
+                                               GLenum internalformat,
+                                               GLsizei width, GLsizei height,
+                                               GLint border, GLsizei imageSize,
+                                               const void *data) {
+  sRealCompressedTexImage2D(target, level, internalformat, width, height,
+                            border, imageSize, data);
+  Count(kRenderStatTextureAllocations);
+}
+
+static void APIENTRY StatsTexStorage3D(GLenum target, GLsizei levels,
+                                       GLenum internalformat, GLsizei width,
+                                       GLsizei height, GLsizei depth) {
+  sRealTexStorage3D(target, levels, internalformat, width, height, depth);
+  Count(kRenderStatTextureAllocations);
+}
+
+static void APIENTRY StatsCompressedTexImage3D(
+    GLenum target, GLint level, GLenum internalformat, GLsizei width,
+    GLsizei height, GLsizei depth, GLint border, GLsizei imageSize,
+    const void *data) {
+  sRealCompressedTexImage3D(target, level, internalformat, width, height,
+                            depth, border, imageSize, data);
+  Count(kRenderStatTextureAllocations);
+}
+
+// Functions the driver does not expose stay unhooked
+#define RENDER_STATS_INSTALL(name)                                             \
+  sReal##name = glad_gl##name;                                                 \
+  if (sReal##name != nullptr) {                                                \
+    glad_gl##name = Stats##name;                                               \
+  }
+
+void RenderStatsEnable() {
+  if (gEnabled) {
+    return;
+  }
+  RENDER_STATS_FUNCTIONS(RENDER_STATS_INSTALL)
+  gEnabled = true;
+}
+
+bool RenderStatsIsEnabled() { return gEnabled; }
+
+void RenderStatsAdd(RenderStat stat, uint64_t amount) {
+  if (gEnabled) {
+    Count(stat, amount);
+  }
+}
+
+void RenderStatsEndFrame() {
+  if (!gEnabled) {
+    return;
+  }
+
+  RenderStatsFrame frame;
+  frame.mFrame = gFrame++;
+  for (int i = 0; i < kRenderStatCount; ++i) {
+    frame.mValues[i] = gCounters[i].exchange(0, std::memory_order_relaxed);
+  }
+
+  std::lock_guard<std::mutex> lock(gHistoryMutex);
+  if (gHistory.size() < kHistoryFrames) {
+    gHistory.push_back(frame);
+  } else {
+    gHistory[frame.mFrame % kHistoryFrames] = frame;
+  }
+}
+
+RenderStatsFrame RenderStatsGetLastFrame() {
+  std::lock_guard<std::mutex> lock(gHistoryMutex);
+  if (gHistory.empty()) {
+    return RenderStatsFrame();
+  }
+  return gHistory[(gFrame - 1) % kHistoryFrames];
+}
+
+const char *RenderStatName(RenderStat stat) { return kStatNames[stat]; }
+
+bool RenderStatsWriteCsv(const std::string &path) {
+  std::ofstream out(path, std::ios::trunc);
+  if (!out.is_open()) {
+    LOG_ERROR(kLogRender, "Could not write stats {}", path);
+    return false;
+  }
+
+  out << "frame";
+  for (int i = 0; i < kRenderStatCount; ++i) {
+    out << "," << kStatNames[i];
+  }
+  out << "\n";
+
+  std::lock_guard<std::mutex> lock(gHistoryMutex);
+  uint64_t first = gFrame > gHistory.size() ? gFrame - gHistory.size() : 0;
+  for (uint64_t frame = first; frame < gFrame; ++frame) {
+    const RenderStatsFrame &stats = gHistory[frame % kHistoryFrames];
+    out << stats.mFrame;
+    for (int i = 0; i < kRenderStatCount; ++i) {
+      out << "," << stats.mValues[i];
+    }
+    out << "\n";
+  }
+  return (bool)out;
+}
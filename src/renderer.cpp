@@ -0,0 +1,106 @@
+#include "Renderer.hpp"
+
+#include <cstdlib>
+
+#include "GLCall.hpp"
+#include "Log.hpp"
+#include "Profiler.hpp"
+#include "TextureManager.hpp"
+
+// Set by RenderBeginFrame, for sizes on screen
+static int sViewportHeight = 1;
+
+// Returns location of uniform var based on its name
+static int FindUniformLocation(GLuint pipeline, const GLchar *name) {
+  GLint location = glGetUniformLocation(pipeline, name);
+  if (location < 0) {
+    LOG_ERROR(kLogRender, "Could not find {}, maybe a mispelling?", name);
+    exit(EXIT_FAILURE);
+  }
+  return location;
+}
+
+void RenderBeginFrame(int width, int height) {
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_CULL_FACE);
+
+  glViewport(0, 0, width, height);
+  sViewportHeight = height;
+  glClearColor(1.f, 1.f, 0.1f, 1.f);
+
+  glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
+}
+
+float MeshScreenSize(const Mesh3D *mesh, const glm::mat4 &model,
+                     const glm::mat4 &view, const glm::mat4 &projection) {
+  float scale = glm::length(glm::vec3(model[0]));
+  float radius = mesh->mBoundsRadius * scale;
+  float depth = -(view * model[3]).z;
+  // Entirely behind the camera, so only the resident tail is wanted
+  if (depth < -radius) {
+    return 0.0f;
+  }
+  // Around the camera, close enough to fill the screen
+  if (depth <= radius) {
+    return (float)sViewportHeight;
+  }
+  return radius * projection[1][1] * sViewportHeight / depth;
+}
+
+void MeshDraw(Mesh3D *mesh, const Camera &camera, float alpha) {
+  if (mesh == nullptr) {
+    return;
+  }
+  PROFILE_SCOPE("MeshDraw");
+
+  // Setup which graphics pipeline we are going to use
+  GLuint uniformProgram = mesh->mPipeline;
+  if (mesh->mProgramPipeline != 0) {
+    glUseProgram(0);
+    glBindProgramPipeline(mesh->mProgramPipeline);
+    uniformProgram = mesh->mVertexStage;
+  } else {
+    glUseProgram(mesh->mPipeline);
+  }
+
+  glm::mat4 model = MeshModelMatrix(mesh, alpha);
+
+  GLint u_ModelMatrixLocation =
+      FindUniformLocation(uniformProgram, "uModelMatrix");
+  glProgramUniformMatrix4fv(uniformProgram, u_ModelMatrixLocation, 1, false,
+                            &model[0][0]);
+
+  glm::mat4 view = camera.GetViewMatrix();
+  GLint u_ViewLocation = FindUniformLocation(uniformProgram, "uViewMatrix");
+  glProgramUniformMatrix4fv(uniformProgram, u_ViewLocation, 1, false,
+                            &view[0][0]);
+
+  glm::mat4 perspective = camera.GetProjectionMatrix();
+
+  GLint u_ProjectionLocation =
+      FindUniformLocation(uniformProgram, "uProjection");
+  glProgramUniformMatrix4fv(uniformProgram, u_ProjectionLocation, 1, false,
+                            &perspective[0][0]);
+
+  if (mesh->mTextureManager != nullptr) {
+    mesh->mTexture = mesh->mTextureManager->UseTexture(
+        mesh->mTextureHandle, MeshScreenSize(mesh, model, view, perspective));
+  }
+  if (mesh->mTexture != 0) {
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, mesh->mTexture);
+    glBindSampler(0, mesh->mSampler);
+  }
+
+  // Enable our attributes
+  glBindVertexArray(mesh->mVertexArrayObj);
+
+  // Render Data
+  // glDrawArrays(GL_TRIANGLES, 0, 6);
+  GLCheck(
+      glDrawElements(GL_TRIANGLES, mesh->mIndexCount, GL_UNSIGNED_INT, 0));
+
+  // Stop using our current graphics pipeline
+  glUseProgram(0);
+  glBindProgramPipeline(0);
+}
@@ -0,0 +1,322 @@
+#include "SceneGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "Log.hpp"
+
+static const uint32_t kSceneMagic = 0x4e435350; // "PSCN"
+static const uint32_t kSceneVersion = 2;
+// Before meshes had texture coordinates
+static const uint32_t kSceneVersionUntextured = 1;
+
+// splitmix64, so a seed gives the same scene with every standard library
+class SceneRandom {
+
+public:
+  explicit SceneRandom(uint64_t seed) : mState(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (mState += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+
+  // [0, 1)
+  float Float() { return (float)(Next() >> 40) / (float)(1ull << 24); }
+  float Range(float min, float max) { return min + (max - min) * Float(); }
+  uint32_t Below(uint32_t count) {
+    return count > 0 ? (uint32_t)(Next() % count) : 0;
+  }
+
+private:
+  uint64_t mState;
+};
+
+// Flat n-gon facing +z, more sides means more vertices per object
+static MeshData GenerateMesh(SceneRandom &random, uint32_t sides) {
+  MeshData data;
+  glm::vec3 color(random.Float(), random.Float(), random.Float());
+
+  data.positions.insert(data.positions.end(), {0.0f, 0.0f, 0.0f});
+  data.colors.insert(data.colors.end(), {color.r, color.g, color.b});
+  data.texcoords.insert(data.texcoords.end(), {0.5f, 0.5f});
+  for (uint32_t i = 0; i < sides; ++i) {
+    float angle = 2.0f * 3.14159265f * (float)i / (float)sides;
+    data.positions.insert(data.positions.end(),
+                          {0.5f * std::cos(angle), 0.5f * std::sin(angle),
+                           0.0f});
+    // Planar, image rows run down the screen
+    data.texcoords.insert(data.texcoords.end(),
+                          {0.5f + 0.5f * std::cos(angle),
+                           0.5f - 0.5f * std::sin(angle)});
+    float shade = 0.6f + 0.4f * random.Float();
+    data.colors.insert(data.colors.end(),
+                       {color.r * shade, color.g * shade, color.b * shade});
+    data.indices.insert(data.indices.end(),
+                        {0, i + 1, (i + 1) % sides + 1});
+  }
+  return data;
+}
+
+// Centered in front of a camera at the origin looking down -z
+static glm::vec3 VolumeCenter(float extent) {
+  return glm::vec3(0.0f, 0.0f, -extent);
+}
+
+static glm::vec3 UniformPosition(SceneRandom &random, float extent,
+                                 float spread = 1.0f) {
+  float half = extent * spread;
+  return VolumeCenter(extent) + glm::vec3(random.Range(-half, half),
+                                          random.Range(-half, half),
+                                          random.Range(-half, half));
+}
+
+static glm::vec3 GeneratePosition(SceneRandom &random,
+                                  const SceneParams &params,
+                                  const std::vector<glm::vec3> &clusters,
+                                  uint32_t spot, uint32_t spotCount) {
+  const float extent = params.mExtent;
+
+  switch (params.mDistribution) {
+  case kSceneClustered: {
+    glm::vec3 offset;
+    for (int axis = 0; axis < 3; ++axis) {
+      // Sum of uniforms approximates a normal distribution
+      offset[axis] = (random.Float() + random.Float() + random.Float() - 1.5f);
+    }
+    return clusters[random.Below((uint32_t)clusters.size())] +
+           offset * (extent * 0.1f);
+  }
+  case kSceneGrid: {
+    uint32_t side = (uint32_t)std::ceil(std::cbrt((double)spotCount));
+    glm::vec3 cell((float)(spot % side), (float)(spot / side % side),
+                   (float)(spot / (side * side)));
+    float step = side > 1 ? 2.0f * extent / (float)(side - 1) : 0.0f;
+    return VolumeCenter(extent) - glm::vec3(extent) + cell * step;
+  }
+  default:
+    return UniformPosition(random, extent);
+  }
+}
+
+void GenerateScene(const SceneParams &params, Scene *scene) {
+  SceneRandom random(params.mSeed);
+  uint32_t meshCount = std::max(params.mUniqueMeshes, 1u);
+  uint32_t variants = std::max(params.mShaderVariants, 1u);
+  uint32_t layers = std::max(params.mDepthLayers, 1u);
+
+  scene->mParams = params;
+  scene->mMeshes.clear();
+  scene->mMeshRadii.clear();
+  scene->mObjects.clear();
+
+  for (uint32_t i = 0; i < meshCount; ++i) {
+    // 3 to 64 sides
+    scene->mMeshes.push_back(GenerateMesh(random, 3 + random.Below(62)));
+    scene->mMeshRadii.push_back(0.5f);
+  }
+
+  std::vector<glm::vec3> clusters;
+  uint32_t clusterCount =
+      std::max(1u, (uint32_t)std::sqrt((double)params.mObjectCount) / 8);
+  for (uint32_t i = 0; i < clusterCount; ++i) {
+    clusters.push_back(UniformPosition(random, params.mExtent, 0.8f));
+  }
+
+  uint32_t spotCount = (params.mObjectCount + layers - 1) / layers;
+  scene->mObjects.reserve(params.mObjectCount);
+  glm::vec3 spot(0.0f);
+  for (uint32_t i = 0; i < params.mObjectCount; ++i) {
+    uint32_t layer = i % layers;
+    if (layer == 0) {
+      spot = GeneratePosition(random, params, clusters, i / layers, spotCount);
+    }
+
+    SceneObject object;
+    object.mMesh = random.Below(meshCount);
+    object.mVariant = random.Below(variants);
+    object.mScale = random.Range(0.5f, 1.5f);
+    object.mPosition = spot - glm::vec3(0.0f, 0.0f, 0.25f * layer);
+    object.mFlags = 0;
+    if (random.Float() < params.mMovingFraction) {
+      object.mFlags |= kSceneObjectMoving;
+    } else if (random.Float() < params.mInstancedFraction) {
+      object.mFlags |= kSceneObjectInstanced;
+    }
+    scene->mObjects.push_back(object);
+  }
+}
+
+template <typename T>
+static void WriteArray(std::ofstream &out, const std::vector<T> &values) {
+  uint32_t count = (uint32_t)values.size();
+  out.write((const char *)&count, sizeof(count));
+  out.write((const char *)values.data(), count * sizeof(T));
+}
+
+// Bytes between the read position and fileSize
+static uint64_t BytesLeft(std::ifstream &in, uint64_t fileSize) {
+  std::streamoff position = in.tellg();
+  return position < 0 || (uint64_t)position > fileSize
+             ? 0
+             : fileSize - (uint64_t)position;
+}
+
+// The count is checked against what is left of the file before anything is
+// allocated for it
+template <typename T>
+static bool ReadArray(std::ifstream &in, uint64_t fileSize,
+                      std::vector<T> &values) {
+  uint32_t count = 0;
+  if (!in.read((char *)&count, sizeof(count)) ||
+      count > BytesLeft(in, fileSize) / sizeof(T)) {
+    return false;
+  }
+  values.resize(count);
+  return (bool)in.read((char *)values.data(), count * sizeof(T));
+}
+
+bool SceneSave(const std::string &path, const Scene &scene) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    LOG_ERROR(kLogAsset, "Could not write scene {}", path);
+    return false;
+  }
+
+  out.write((const char *)&kSceneMagic, sizeof(kSceneMagic));
+  out.write((const char *)&kSceneVersion, sizeof(kSceneVersion));
+  out.write((const char *)&scene.mParams, sizeof(scene.mParams));
+
+  uint32_t meshCount = (uint32_t)scene.mMeshes.size();
+  out.write((const char *)&meshCount, sizeof(meshCount));
+  for (const MeshData &mesh : scene.mMeshes) {
+    WriteArray(out, mesh.positions);
+    WriteArray(out, mesh.colors);
+    WriteArray(out, mesh.indices);
+    WriteArray(out, mesh.texcoords);
+  }
+  WriteArray(out, scene.mMeshRadii);
+  WriteArray(out, scene.mObjects);
+
+  return (bool)out;
+}
+
+// Attributes agree on the vertex count and indices stay inside it
+static bool MeshDataValid(const MeshData &mesh) {
+  size_t vertices = mesh.positions.size() / 3;
+  if (mesh.positions.size() % 3 != 0 || mesh.colors.size() != vertices * 3 ||
+      (!mesh.texcoords.empty() && mesh.texcoords.size() != vertices * 2)) {
+    return false;
+  }
+  for (GLuint index : mesh.indices) {
+    if (index >= vertices) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool SceneLoad(const std::string &path, Scene *scene) {
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in.is_open()) {
+    LOG_ERROR(kLogAsset, "Could not open scene {}", path);
+    return false;
+  }
+  uint64_t fileSize = (uint64_t)std::max<std::streamoff>(in.tellg(), 0);
+  in.seekg(0);
+
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  in.read((char *)&magic, sizeof(magic));
+  in.read((char *)&version, sizeof(version));
+  if (magic != kSceneMagic ||
+      (version != kSceneVersion && version != kSceneVersionUntextured)) {
+    LOG_ERROR(kLogAsset, "{} is not a scene file", path);
+    return false;
+  }
+
+  uint32_t meshCount = 0;
+  in.read((char *)&scene->mParams, sizeof(scene->mParams));
+  in.read((char *)&meshCount, sizeof(meshCount));
+  // Every mesh stores at least the counts of its arrays
+  bool ok = in && meshCount <= BytesLeft(in, fileSize) / (3 * sizeof(uint32_t));
+  if (ok) {
+    scene->mMeshes.resize(meshCount);
+  }
+  for (MeshData &mesh : scene->mMeshes) {
+    ok = ok && ReadArray(in, fileSize, mesh.positions) &&
+         ReadArray(in, fileSize, mesh.colors) &&
+         ReadArray(in, fileSize, mesh.indices);
+    if (version != kSceneVersionUntextured) {
+      ok = ok && ReadArray(in, fileSize, mesh.texcoords);
+    }
+  }
+  ok = ok && ReadArray(in, fileSize, scene->mMeshRadii) &&
+       ReadArray(in, fileSize, scene->mObjects);
+
+  if (!ok) {
+    LOG_ERROR(kLogAsset, "{} is truncated", path);
+    return false;
+  }
+  if (scene->mMeshRadii.size() != meshCount) {
+    LOG_ERROR(kLogAsset, "{} has {} mesh radii for {} meshes", path,
+              scene->mMeshRadii.size(), meshCount);
+    return false;
+  }
+  for (const MeshData &mesh : scene->mMeshes) {
+    if (!MeshDataValid(mesh)) {
+      LOG_ERROR(kLogAsset, "{} has a malformed mesh", path);
+      return false;
+    }
+  }
+  for (const SceneObject &object : scene->mObjects) {
+    if (object.mMesh >= meshCount) {
+      LOG_ERROR(kLogAsset, "{} references a missing mesh", path);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ParseSceneOption(const char *arg, SceneParams *params) {
+  char distribution[16] = {};
+  if (std::sscanf(arg, "--seed=%u", &params->mSeed) == 1 ||
+      std::sscanf(arg, "--objects=%u", &params->mObjectCount) == 1 ||
+      std::sscanf(arg, "--meshes=%u", &params->mUniqueMeshes) == 1 ||
+      std::sscanf(arg, "--instanced=%f", &params->mInstancedFraction) == 1 ||
+      std::sscanf(arg, "--moving=%f", &params->mMovingFraction) == 1 ||
+      std::sscanf(arg, "--extent=%f", &params->mExtent) == 1 ||
+      std::sscanf(arg, "--depth=%u", &params->mDepthLayers) == 1 ||
+      std::sscanf(arg, "--variants=%u", &params->mShaderVariants) == 1) {
+    return true;
+  }
+  if (std::sscanf(arg, "--distribution=%15s", distribution) == 1) {
+    if (std::strcmp(distribution, "clustered") == 0) {
+      params->mDistribution = kSceneClustered;
+    } else if (std::strcmp(distribution, "grid") == 0) {
+      params->mDistribution = kSceneGrid;
+    } else {
+      params->mDistribution = kSceneUniform;
+    }
+    return true;
+  }
+  return false;
+}
+
+void SceneBounds(const Scene &scene, glm::vec3 *center, float *radius) {
+  glm::vec3 min(INFINITY);
+  glm::vec3 max(-INFINITY);
+  for (const SceneObject &object : scene.mObjects) {
+    min = glm::min(min, object.mPosition - glm::vec3(object.mScale));
+    max = glm::max(max, object.mPosition + glm::vec3(object.mScale));
+  }
+  if (scene.mObjects.empty()) {
+    min = max = glm::vec3(0.0f);
+  }
+  *center = (min + max) * 0.5f;
+  *radius = glm::length(max - min) * 0.5f;
+}
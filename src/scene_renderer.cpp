@@ -0,0 +1,178 @@
+#include "SceneRenderer.hpp"
+#include "Log.hpp"
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+SceneRenderer::SceneRenderer() : mScene(nullptr) {}
+
+bool SceneRenderer::Create(const Scene *scene, ShaderLibrary *library,
+                           const TexturePacker *materials) {
+  mScene = scene;
+  uint32_t variants = std::max(scene->mParams.mShaderVariants, 1u);
+  size_t materialCount = materials != nullptr ? materials->GetSlotCount() : 0;
+
+  // Each variant is its own program so shader variety costs real switches
+  for (uint32_t variant = 0; variant < variants; ++variant) {
+    ShaderDefines defines = {{"SCENE_VARIANT", std::to_string(variant)}};
+    mPrograms.push_back(library->GetProgram(
+        "./shaders/vert.glsl", "./shaders/frag.glsl", defines));
+    mInstancedPrograms.push_back(library->GetProgram(
+        "./shaders/instanced_vert.glsl", "./shaders/frag.glsl", defines));
+    GLuint instancedModel = library->GetProgram(
+        "./shaders/instanced_model_vert.glsl", "./shaders/frag.glsl", defines);
+    mDynamicBatcher.SetInstancedPipeline(mPrograms.back(), instancedModel);
+    if (mPrograms.back() == 0 || mInstancedPrograms.back() == 0) {
+      return false;
+    }
+
+    if (materialCount > 0) {
+      ShaderDefines textured = defines;
+      textured.push_back({"TEXTURE_ARRAY", "1"});
+      mTexturedPrograms.push_back(library->GetProgram(
+          "./shaders/vert.glsl", "./shaders/frag.glsl", textured));
+      if (mTexturedPrograms.back() == 0) {
+        return false;
+      }
+    }
+  }
+
+  std::map<std::pair<uint32_t, uint32_t>, std::vector<glm::vec4>> instances;
+  for (size_t i = 0; i < scene->mObjects.size(); ++i) {
+    const SceneObject &object = scene->mObjects[i];
+    auto key = std::make_pair(object.mMesh, object.mVariant % variants);
+
+    if (object.mFlags & kSceneObjectMoving) {
+      Mesh3D &mesh = mDynamicMeshes[key];
+      if (mesh.mVertexArrayObj == 0) {
+        mGeometry.Acquire(&mesh, scene->mMeshes[object.mMesh]);
+        MeshSetPipeline(&mesh, mPrograms[key.second]);
+      }
+      mMovingObjects.push_back(i);
+    } else if (object.mFlags & kSceneObjectInstanced) {
+      instances[key].push_back(glm::vec4(object.mPosition, object.mScale));
+    } else {
+      glm::mat4 model = glm::translate(glm::mat4(1.0f), object.mPosition);
+      model = glm::scale(model, glm::vec3(object.mScale));
+      if (materialCount > 0) {
+        mStaticBatcher.Add(scene->mMeshes[object.mMesh], model,
+                           mTexturedPrograms[key.second],
+                           &materials->GetSlot(i % materialCount));
+      } else {
+        mStaticBatcher.Add(scene->mMeshes[object.mMesh], model,
+                           mPrograms[key.second]);
+      }
+    }
+  }
+  mStaticBatcher.Build();
+
+  for (const auto &[key, positions] : instances) {
+    auto group = std::make_unique<InstanceGroup>();
+    // Not shared, the culler attaches its instances to the vertex array
+    MeshCreate(&group->mMesh, scene->mMeshes[key.first]);
+    if (!group->mCuller.Create((GLuint)positions.size())) {
+      return false;
+    }
+    group->mCuller.SetMesh(group->mMesh.mIndexCount,
+                           scene->mMeshRadii[key.first]);
+    group->mCuller.SetInstances(positions);
+    group->mCuller.AttachInstanceAttribute(group->mMesh.mVertexArrayObj, 2);
+    group->mProgram = mInstancedPrograms[key.second];
+    mInstanceGroups.push_back(std::move(group));
+  }
+
+  if (!mDynamicBatcher.Create(1 << 16, 3 << 16, 4096)) {
+    return false;
+  }
+  mMovingModels.resize(mMovingObjects.size());
+  Update(0.0f);
+
+  GeometryCacheStats geometry = mGeometry.GetStats();
+  LOG_INFO(kLogRender,
+           "Scene: {} objects, {} moving, {} instance groups, {} dynamic "
+           "meshes sharing {} uploads",
+           scene->mObjects.size(), mMovingObjects.size(),
+           mInstanceGroups.size(), geometry.mMeshes, geometry.mGeometries);
+  return true;
+}
+
+void SceneRenderer::Destroy() {
+  for (auto &[key, mesh] : mDynamicMeshes) {
+    mGeometry.Release(&mesh);
+  }
+  mDynamicMeshes.clear();
+  mGeometry.Destroy();
+  for (auto &group : mInstanceGroups) {
+    group->mCuller.Destroy();
+    MeshDelete(&group->mMesh);
+  }
+  mInstanceGroups.clear();
+  mStaticBatcher.Destroy();
+  mDynamicBatcher.Destroy();
+  mPrograms.clear();
+  mTexturedPrograms.clear();
+  mInstancedPrograms.clear();
+  mMovingObjects.clear();
+  mMovingModels.clear();
+  mScene = nullptr;
+}
+
+void SceneRenderer::Update(float seconds) {
+  for (size_t i = 0; i < mMovingObjects.size(); ++i) {
+    const SceneObject &object = mScene->mObjects[mMovingObjects[i]];
+    // Per object phase so they do not all move in lockstep
+    float phase = (float)(mMovingObjects[i] % 64) * 0.1f;
+    glm::vec3 bob(0.0f, 0.5f * std::sin(seconds * 2.0f + phase), 0.0f);
+
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), object.mPosition + bob);
+    model = glm::rotate(model, seconds + phase, glm::vec3(0.0f, 0.0f, 1.0f));
+    mMovingModels[i] = glm::scale(model, glm::vec3(object.mScale));
+  }
+}
+
+SceneDrawStats SceneRenderer::Draw(const Camera &camera) {
+  SceneDrawStats stats;
+  glm::mat4 view = camera.GetViewMatrix();
+  glm::mat4 projection = camera.GetProjectionMatrix();
+
+  {
+    PROFILE_SCOPE("StaticBatcher");
+    PROFILE_GPU_SCOPE("StaticBatcher");
+    stats.mStaticChunks = mStaticBatcher.Draw(view, projection);
+  }
+
+  glm::mat4 viewProjection = projection * view;
+  for (auto &group : mInstanceGroups) {
+    {
+      PROFILE_SCOPE("GpuCuller::Cull");
+      PROFILE_GPU_SCOPE("GpuCuller::Cull");
+      group->mCuller.Cull(viewProjection);
+    }
+
+    PROFILE_SCOPE("GpuCuller::Draw");
+    PROFILE_GPU_SCOPE("GpuCuller::Draw");
+    glUseProgram(group->mProgram);
+    glUniformMatrix4fv(glGetUniformLocation(group->mProgram, "uViewMatrix"), 1,
+                       false, &view[0][0]);
+    glUniformMatrix4fv(glGetUniformLocation(group->mProgram, "uProjection"), 1,
+                       false, &projection[0][0]);
+    group->mCuller.Draw(group->mMesh.mVertexArrayObj);
+  }
+  glUseProgram(0);
+  stats.mInstanceGroups = (int)mInstanceGroups.size();
+
+  PROFILE_SCOPE("DynamicBatcher");
+  PROFILE_GPU_SCOPE("DynamicBatcher");
+  for (size_t i = 0; i < mMovingObjects.size(); ++i) {
+    const SceneObject &object = mScene->mObjects[mMovingObjects[i]];
+    auto key = std::make_pair(object.mMesh,
+                              object.mVariant % (uint32_t)mPrograms.size());
+    mDynamicBatcher.Submit(&mDynamicMeshes[key],
+                           &mScene->mMeshes[object.mMesh], mMovingModels[i]);
+  }
+  stats.mDynamicDraws = mDynamicBatcher.Flush(view, projection);
+
+  return stats;
+}
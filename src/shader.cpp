@@ -0,0 +1,75 @@
+#include "Shader.hpp"
+
+#include <fstream>
+
+std::string LoadShaderAsString(const std::string &filename) {
+  std::string result = "";
+
+  std::string line = "";
+  std::ifstream myFile(filename.c_str());
+
+  if (myFile.is_open()) {
+    while (std::getline(myFile, line)) {
+      result += line + '\n';
+    }
+  }
+
+  return result;
+}
+
+GLuint CompileShader(GLuint type, const std::string &source) {
+  GLuint shaderObject = glCreateShader(type);
+
+  const char *src = source.c_str();
+  glShaderSource(shaderObject, 1, &src, nullptr);
+  glCompileShader(shaderObject);
+
+  return shaderObject;
+}
+
+GLuint CreateShaderProgram(const std::string &vertexShaderSrc,
+                           const std::string &fragmentShaderSrc) {
+  GLuint programObj = glCreateProgram();
+
+  GLuint myVertexShader = CompileShader(GL_VERTEX_SHADER, vertexShaderSrc);
+  GLuint myFragmentShader =
+      CompileShader(GL_FRAGMENT_SHADER, fragmentShaderSrc);
+
+  glAttachShader(programObj, myVertexShader);
+  glAttachShader(programObj, myFragmentShader);
+  glLinkProgram(programObj);
+
+  return programObj;
+}
+
+bool ShaderCompiled(GLuint shader, std::string *log) {
+  GLint compiled = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+
+  if (compiled != GL_TRUE && log != nullptr) {
+    GLint length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    log->resize(length > 0 ? length : 0);
+    if (length > 0) {
+      glGetShaderInfoLog(shader, length, nullptr, &(*log)[0]);
+    }
+  }
+
+  return compiled == GL_TRUE;
+}
+
+bool ProgramLinked(GLuint program, std::string *log) {
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+  if (linked != GL_TRUE && log != nullptr) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    log->resize(length > 0 ? length : 0);
+    if (length > 0) {
+      glGetProgramInfoLog(program, length, nullptr, &(*log)[0]);
+    }
+  }
+
+  return linked == GL_TRUE;
+}
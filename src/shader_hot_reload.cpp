@@ -0,0 +1,319 @@
+#include "ShaderHotReload.hpp"
+#include "Hash.hpp"
+#include "Log.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+// Dependencies are compared as normalized relative or absolute paths, the
+// same form PreprocessShader reports them in
+static std::string NormalizePath(const std::string &path) {
+  return fs::path(path).lexically_normal().string();
+}
+
+ShaderHotReload::ShaderHotReload(PipelineCompiler *compiler)
+    : mCompiler(compiler), mStopWatcher(false) {}
+
+ShaderHotReload::~ShaderHotReload() { Stop(); }
+
+bool ShaderHotReload::Start() {
+  if (mWatcher.joinable()) {
+    return true;
+  }
+  mStopWatcher = false;
+  mWatcher = std::thread(&ShaderHotReload::WatcherMain, this);
+  return true;
+}
+
+void ShaderHotReload::Stop() {
+  if (!mWatcher.joinable()) {
+    return;
+  }
+  mStopWatcher = true;
+  mWatcher.join();
+}
+
+void ShaderHotReload::Clear() {
+  Stop();
+  for (Entry &entry : mEntries) {
+    if (entry.mReloadedProgram != 0) {
+      glDeleteProgram(entry.mReloadedProgram);
+    }
+  }
+  mEntries.clear();
+  std::lock_guard<std::mutex> lock(mMutex);
+  mWatchedFiles.clear();
+  mChanged.clear();
+}
+
+void ShaderHotReload::Watch(const std::string &vertexPath,
+                            const std::string &fragmentPath,
+                            const ShaderDefines &defines,
+                            PipelineCompiler::ReadyCallback onReload) {
+  Entry entry;
+  entry.mVertexPath = vertexPath;
+  entry.mFragmentPath = fragmentPath;
+  entry.mDefines = defines;
+  entry.mOnReload = onReload;
+  Add(entry);
+}
+
+void ShaderHotReload::WatchPipeline(ProgramPipelineLibrary *library,
+                                    GLuint pipeline,
+                                    const std::string &vertexPath,
+                                    const std::string &fragmentPath,
+                                    const ShaderDefines &defines,
+                                    PipelineCompiler::ReadyCallback onReload) {
+  Entry entry;
+  entry.mVertexPath = vertexPath;
+  entry.mFragmentPath = fragmentPath;
+  entry.mDefines = defines;
+  entry.mOnReload = onReload;
+  entry.mPipelineLibrary = library;
+  entry.mPipeline = pipeline;
+  Add(entry);
+}
+
+void ShaderHotReload::Add(Entry &entry) {
+  std::vector<std::string> dependencies;
+  entry.mVertexHash = HashString(
+      PreprocessShader(entry.mVertexPath, entry.mDefines, &dependencies));
+  entry.mFragmentHash = HashString(
+      PreprocessShader(entry.mFragmentPath, entry.mDefines, &dependencies));
+  for (const std::string &dependency : dependencies) {
+    entry.mDependencies.insert(NormalizePath(dependency));
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWatchedFiles.insert(entry.mDependencies.begin(),
+                         entry.mDependencies.end());
+  }
+  mEntries.push_back(entry);
+}
+
+void ShaderHotReload::Update() {
+  std::set<std::string> changed;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    changed.swap(mChanged);
+  }
+  if (changed.empty()) {
+    return;
+  }
+
+  for (size_t i = 0; i < mEntries.size(); ++i) {
+    for (const std::string &file : changed) {
+      if (mEntries[i].mDependencies.count(file) != 0) {
+        Rebuild(i);
+        break;
+      }
+    }
+  }
+}
+
+void ShaderHotReload::Rebuild(size_t index) {
+  Entry &entry = mEntries[index];
+  auto start = std::chrono::steady_clock::now();
+
+  // Includes may have been added or removed by the edit
+  std::vector<std::string> dependencies;
+  std::string vertexShaderSrc =
+      PreprocessShader(entry.mVertexPath, entry.mDefines, &dependencies);
+  std::string fragmentShaderSrc =
+      PreprocessShader(entry.mFragmentPath, entry.mDefines, &dependencies);
+  entry.mDependencies.clear();
+  for (const std::string &dependency : dependencies) {
+    entry.mDependencies.insert(NormalizePath(dependency));
+  }
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWatchedFiles.insert(entry.mDependencies.begin(),
+                         entry.mDependencies.end());
+  }
+
+  // An editor may have caught the file half written, try again next change
+  if (vertexShaderSrc.empty() || fragmentShaderSrc.empty()) {
+    return;
+  }
+
+  // Touched without an edit that reaches either stage, such as a save with
+  // no changes or an edit to an unused include
+  uint64_t vertexHash = HashString(vertexShaderSrc);
+  uint64_t fragmentHash = HashString(fragmentShaderSrc);
+  if (vertexHash == entry.mVertexHash && fragmentHash == entry.mFragmentHash) {
+    return;
+  }
+  if (entry.mPipelineLibrary != nullptr) {
+    RebuildStages(entry, vertexHash, fragmentHash);
+    return;
+  }
+  entry.mVertexHash = vertexHash;
+  entry.mFragmentHash = fragmentHash;
+
+  std::string name = entry.mVertexPath + " + " + entry.mFragmentPath;
+  mCompiler->Submit(
+      name, vertexShaderSrc, fragmentShaderSrc,
+      [this, index, name, start](GLuint program) {
+        // The compiler logged why, keep drawing with the last good program
+        if (program == 0) {
+          return;
+        }
+        // Finished after Clear
+        if (index >= mEntries.size()) {
+          glDeleteProgram(program);
+          return;
+        }
+        Entry &reloaded = mEntries[index];
+        reloaded.mOnReload(program);
+        if (reloaded.mReloadedProgram != 0) {
+          glDeleteProgram(reloaded.mReloadedProgram);
+        }
+        reloaded.mReloadedProgram = program;
+
+        double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+        LOG_INFO(kLogShader, "Reloaded {} in {} ms", name, ms);
+      });
+}
+
+void ShaderHotReload::RebuildStages(Entry &entry, uint64_t vertexHash,
+                                    uint64_t fragmentHash) {
+  auto start = std::chrono::steady_clock::now();
+  ProgramPipelineLibrary *library = entry.mPipelineLibrary;
+
+  // A stage that fails keeps its old hash, so the next save retries it
+  int replaced = 0;
+  if (vertexHash != entry.mVertexHash) {
+    GLuint stage = library->ReplaceStage(entry.mPipeline, GL_VERTEX_SHADER,
+                                         entry.mVertexPath, entry.mDefines);
+    if (stage != 0) {
+      entry.mVertexHash = vertexHash;
+      entry.mOnReload(stage);
+      replaced++;
+    }
+  }
+  if (fragmentHash != entry.mFragmentHash) {
+    GLuint stage = library->ReplaceStage(entry.mPipeline, GL_FRAGMENT_SHADER,
+                                         entry.mFragmentPath, entry.mDefines);
+    if (stage != 0) {
+      entry.mFragmentHash = fragmentHash;
+      replaced++;
+    }
+  }
+  if (replaced == 0) {
+    return;
+  }
+
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - start)
+                  .count();
+  LOG_INFO(kLogShader, "Reloaded {} stage(s) of {} + {} in {} ms", replaced,
+           entry.mVertexPath, entry.mFragmentPath, ms);
+}
+
+#ifdef __linux__
+
+void ShaderHotReload::WatcherMain() {
+  int notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (notify < 0) {
+    LOG_WARNING(kLogShader, "inotify not available, shader hot reload "
+                            "disabled");
+    return;
+  }
+
+  std::map<int, std::string> directories;
+  std::set<std::string> watchedDirectories;
+  char buffer[4096] __attribute__((aligned(__alignof__(inotify_event))));
+
+  while (!mStopWatcher) {
+    // Pick up directories of files registered since the last pass
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (const std::string &file : mWatchedFiles) {
+        std::string directory = fs::path(file).parent_path().string();
+        if (directory.empty()) {
+          directory = ".";
+        }
+        if (watchedDirectories.insert(directory).second) {
+          // Editors often save through a rename, so watch for moves too
+          int wd = inotify_add_watch(notify, directory.c_str(),
+                                     IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+          if (wd >= 0) {
+            directories[wd] = directory;
+          }
+        }
+      }
+    }
+
+    pollfd descriptor{notify, POLLIN, 0};
+    if (poll(&descriptor, 1, 50) <= 0) {
+      continue;
+    }
+
+    ssize_t length;
+    while ((length = read(notify, buffer, sizeof(buffer))) > 0) {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for (char *p = buffer; p < buffer + length;) {
+        const inotify_event *event = (const inotify_event *)p;
+        if (event->len > 0) {
+          std::string directory = directories[event->wd];
+          std::string file =
+              NormalizePath(directory == "." ? event->name
+                                             : directory + "/" + event->name);
+          if (mWatchedFiles.count(file) != 0) {
+            mChanged.insert(file);
+          }
+        }
+        p += sizeof(inotify_event) + event->len;
+      }
+    }
+  }
+
+  close(notify);
+}
+
+#else
+
+void ShaderHotReload::WatcherMain() {
+  std::map<std::string, fs::file_time_type> stamps;
+
+  while (!mStopWatcher) {
+    std::set<std::string> files;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      files = mWatchedFiles;
+    }
+
+    for (const std::string &file : files) {
+      std::error_code error;
+      fs::file_time_type stamp = fs::last_write_time(file, error);
+      if (error) {
+        continue;
+      }
+
+      auto known = stamps.find(file);
+      if (known == stamps.end()) {
+        stamps[file] = stamp;
+      } else if (known->second != stamp) {
+        known->second = stamp;
+        std::lock_guard<std::mutex> lock(mMutex);
+        mChanged.insert(file);
+      }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+}
+
+#endif
@@ -0,0 +1,245 @@
+#include "ShaderLibrary.hpp"
+#include "Hash.hpp"
+#include "Log.hpp"
+#include "Shader.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+// Appends path to out with its includes expanded. Each file gets its own
+// source string number in #line directives so errors point at the right file.
+static bool ExpandFile(const fs::path &path, const ShaderDefines *defines,
+                       std::set<std::string> &included, int &nextFileIndex,
+                       std::vector<std::string> *dependencies,
+                       std::string &out) {
+  std::ifstream myFile(path);
+  if (!myFile.is_open()) {
+    LOG_ERROR(kLogShader, "Could not open shader {}", path.string());
+    return false;
+  }
+  if (dependencies != nullptr) {
+    dependencies->push_back(path.string());
+  }
+
+  int fileIndex = nextFileIndex++;
+  int lineNumber = 0;
+  std::string line;
+  while (std::getline(myFile, line)) {
+    lineNumber++;
+
+    size_t start = line.find_first_not_of(" \t");
+    std::string directive =
+        start == std::string::npos ? "" : line.substr(start);
+
+    if (directive.compare(0, 8, "#include") == 0) {
+      size_t open = directive.find('"');
+      size_t close = directive.find('"', open + 1);
+      if (open == std::string::npos || close == std::string::npos) {
+        LOG_ERROR(kLogShader, "{}:{}: malformed #include", path.string(),
+                  lineNumber);
+        return false;
+      }
+
+      fs::path child = (path.parent_path() /
+                        directive.substr(open + 1, close - open - 1))
+                           .lexically_normal();
+      if (included.insert(child.string()).second) {
+        out += "#line 1 " + std::to_string(nextFileIndex) + "\n";
+        if (!ExpandFile(child, nullptr, included, nextFileIndex, dependencies,
+                        out)) {
+          return false;
+        }
+        out += "#line " + std::to_string(lineNumber + 1) + " " +
+               std::to_string(fileIndex) + "\n";
+      } else {
+        // Already included, keep the line count intact
+        out += '\n';
+      }
+      continue;
+    }
+
+    out += line + '\n';
+
+    // Defines have to follow #version, which must come first
+    if (defines != nullptr && directive.compare(0, 8, "#version") == 0) {
+      for (const auto &define : *defines) {
+        out += "#define " + define.first + " " + define.second + "\n";
+      }
+      out += "#line " + std::to_string(lineNumber + 1) + " " +
+             std::to_string(fileIndex) + "\n";
+    }
+  }
+
+  return true;
+}
+
+std::string PreprocessShader(const std::string &path,
+                             const ShaderDefines &defines,
+                             std::vector<std::string> *dependencies) {
+  fs::path root = fs::path(path).lexically_normal();
+  std::set<std::string> included{root.string()};
+  int nextFileIndex = 0;
+
+  std::string result;
+  if (!ExpandFile(root, &defines, included, nextFileIndex, dependencies,
+                  result)) {
+    return "";
+  }
+  return result;
+}
+
+void BakeUniform(ShaderDefines &defines, const std::string &name,
+                 float value) {
+  // Always spell it as a float literal, "1" would be an int in GLSL
+  std::ostringstream literal;
+  literal.precision(9);
+  literal << std::showpoint << value;
+  defines.emplace_back("BAKED_" + name, literal.str());
+}
+
+void BakeUniform(ShaderDefines &defines, const std::string &name, int value) {
+  defines.emplace_back("BAKED_" + name, std::to_string(value));
+}
+
+ShaderLibrary::ShaderLibrary(ProgramBinaryCache *cache,
+                             PipelineCompiler *compiler)
+    : mCache(cache), mCompiler(compiler) {}
+
+GLuint ShaderLibrary::GetProgram(const std::string &vertexPath,
+                                 const std::string &fragmentPath,
+                                 const ShaderDefines &defines) {
+  GLuint existing = FindProgram(vertexPath, fragmentPath, defines);
+  if (existing != 0) {
+    return existing;
+  }
+
+  Expanded expanded = Expand(vertexPath, fragmentPath, defines);
+
+  auto found = mPrograms.find(expanded.mHash);
+  if (found != mPrograms.end()) {
+    return found->second;
+  }
+
+  GLuint program =
+      mCache != nullptr
+          ? mCache->CreateProgram(expanded.mVertexShaderSrc,
+                                  expanded.mFragmentShaderSrc)
+          : CreateShaderProgram(expanded.mVertexShaderSrc,
+                                expanded.mFragmentShaderSrc);
+  // Not kept, so the next request tries again once the shader is fixed
+  std::string log;
+  if (!ProgramLinked(program, &log)) {
+    LOG_ERROR(kLogShader, "{} + {} failed to link:\n{}", vertexPath,
+              fragmentPath, log);
+    glDeleteProgram(program);
+    return 0;
+  }
+  mPrograms[expanded.mHash] = program;
+  return program;
+}
+
+void ShaderLibrary::RequestProgram(const std::string &vertexPath,
+                                   const std::string &fragmentPath,
+                                   const ShaderDefines &defines,
+                                   PipelineCompiler::ReadyCallback onReady) {
+  GLuint existing = FindProgram(vertexPath, fragmentPath, defines);
+  if (existing != 0) {
+    onReady(existing);
+    return;
+  }
+
+  Expanded expanded = Expand(vertexPath, fragmentPath, defines);
+  uint64_t hash = expanded.mHash;
+
+  auto found = mPrograms.find(hash);
+  if (found != mPrograms.end()) {
+    onReady(found->second);
+    return;
+  }
+
+  // Someone already asked for this code, wait on the same compile
+  std::vector<PipelineCompiler::ReadyCallback> &waiting = mPending[hash];
+  waiting.push_back(onReady);
+  if (waiting.size() > 1) {
+    return;
+  }
+
+  mCompiler->Submit(vertexPath + " + " + fragmentPath,
+                    expanded.mVertexShaderSrc, expanded.mFragmentShaderSrc,
+                    [this, hash](GLuint program) {
+                      // Failures are left out so a later request retries
+                      if (program != 0) {
+                        mPrograms[hash] = program;
+                      }
+                      std::vector<PipelineCompiler::ReadyCallback> callbacks;
+                      callbacks.swap(mPending[hash]);
+                      mPending.erase(hash);
+                      for (auto &callback : callbacks) {
+                        callback(program);
+                      }
+                    });
+}
+
+void ShaderLibrary::Clear() {
+  for (auto &entry : mPrograms) {
+    glDeleteProgram(entry.second);
+  }
+  mPrograms.clear();
+  mVariants.clear();
+  mPending.clear();
+}
+
+size_t ShaderLibrary::GetVariantCount() const { return mVariants.size(); }
+
+size_t ShaderLibrary::GetProgramCount() const { return mPrograms.size(); }
+
+// Define order shouldn't create a new variant
+static ShaderDefines SortedDefines(const ShaderDefines &defines) {
+  ShaderDefines sorted = defines;
+  std::sort(sorted.begin(), sorted.end());
+  return sorted;
+}
+
+static std::string VariantKey(const std::string &vertexPath,
+                              const std::string &fragmentPath,
+                              const ShaderDefines &sorted) {
+  std::string key = vertexPath + "\n" + fragmentPath + "\n";
+  for (const auto &define : sorted) {
+    key += define.first + "=" + define.second + "\n";
+  }
+  return key;
+}
+
+GLuint ShaderLibrary::FindProgram(const std::string &vertexPath,
+                                  const std::string &fragmentPath,
+                                  const ShaderDefines &defines) const {
+  auto variant = mVariants.find(
+      VariantKey(vertexPath, fragmentPath, SortedDefines(defines)));
+  if (variant == mVariants.end()) {
+    return 0;
+  }
+  auto program = mPrograms.find(variant->second);
+  return program != mPrograms.end() ? program->second : 0;
+}
+
+ShaderLibrary::Expanded
+ShaderLibrary::Expand(const std::string &vertexPath,
+                      const std::string &fragmentPath,
+                      const ShaderDefines &defines) {
+  ShaderDefines sorted = SortedDefines(defines);
+  std::string key = VariantKey(vertexPath, fragmentPath, sorted);
+
+  Expanded expanded;
+  expanded.mVertexShaderSrc = PreprocessShader(vertexPath, sorted);
+  expanded.mFragmentShaderSrc = PreprocessShader(fragmentPath, sorted);
+  expanded.mHash = HashString(expanded.mFragmentShaderSrc,
+                              HashString(expanded.mVertexShaderSrc));
+  mVariants[key] = expanded.mHash;
+
+  return expanded;
+}
@@ -0,0 +1,222 @@
+#include "StaticBatcher.hpp"
+#include "Frustum.hpp"
+#include "Log.hpp"
+#include "RenderStats.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+StaticBatcher::StaticBatcher(float chunkSize) : mChunkSize(chunkSize) {}
+
+void StaticBatcher::Add(const MeshData &data, const glm::mat4 &model,
+                        GLuint pipeline, const TextureSlot *texture) {
+  size_t vertexCount = data.positions.size() / 3;
+  if (vertexCount == 0) {
+    return;
+  }
+  // Colors or indices that do not line up with the positions would shift
+  // or reach into every mesh added to the chunk after this one
+  bool valid = data.positions.size() % 3 == 0 &&
+               data.colors.size() == data.positions.size();
+  for (size_t i = 0; valid && i < data.indices.size(); ++i) {
+    valid = data.indices[i] < vertexCount;
+  }
+  if (!valid) {
+    LOG_WARNING(kLogRender,
+                "Static batch skipped a malformed mesh: {} position floats, "
+                "{} color floats, {} indices",
+                data.positions.size(), data.colors.size(),
+                data.indices.size());
+    return;
+  }
+
+  // Pre-transform into world space
+  std::vector<glm::vec3> world(vertexCount);
+  glm::vec3 min(INFINITY);
+  glm::vec3 max(-INFINITY);
+  for (size_t i = 0; i < vertexCount; ++i) {
+    glm::vec4 p(data.positions[i * 3 + 0], data.positions[i * 3 + 1],
+                data.positions[i * 3 + 2], 1.0f);
+    world[i] = glm::vec3(model * p);
+    min = glm::min(min, world[i]);
+    max = glm::max(max, world[i]);
+  }
+
+  // The mesh's center decides which chunk it lands in
+  glm::vec3 cell = glm::floor((min + max) * 0.5f / mChunkSize);
+  GLuint textureObj = texture != nullptr ? texture->mTexture : 0;
+  auto key = std::make_tuple(pipeline, textureObj, (int)cell.x, (int)cell.y,
+                             (int)cell.z);
+
+  auto found = mChunkLookup.find(key);
+  if (found == mChunkLookup.end()) {
+    Chunk chunk;
+    chunk.mPipeline = pipeline;
+    chunk.mTexture = textureObj;
+    chunk.mMin = min;
+    chunk.mMax = max;
+    mChunks.push_back(chunk);
+    found = mChunkLookup.emplace(key, mChunks.size() - 1).first;
+  }
+
+  Chunk &chunk = mChunks[found->second];
+  chunk.mMin = glm::min(chunk.mMin, min);
+  chunk.mMax = glm::max(chunk.mMax, max);
+
+  GLuint baseVertex = (GLuint)(chunk.mData.positions.size() / 3);
+  for (size_t i = 0; i < vertexCount; ++i) {
+    chunk.mData.positions.push_back(world[i].x);
+    chunk.mData.positions.push_back(world[i].y);
+    chunk.mData.positions.push_back(world[i].z);
+  }
+  chunk.mData.colors.insert(chunk.mData.colors.end(), data.colors.begin(),
+                            data.colors.end());
+  for (GLuint index : data.indices) {
+    chunk.mData.indices.push_back(baseVertex + index);
+  }
+  if (textureObj != 0) {
+    // Into the texture's layer and its place in an atlas page; meshes
+    // without coordinates sample its corner
+    const glm::vec4 &uv = texture->mUvTransform;
+    for (size_t i = 0; i < vertexCount; ++i) {
+      glm::vec2 texcoord(0.0f);
+      if (i * 2 + 1 < data.texcoords.size()) {
+        texcoord = glm::vec2(data.texcoords[i * 2], data.texcoords[i * 2 + 1]);
+      }
+      chunk.mTexcoords.push_back(texcoord.x * uv.x + uv.z);
+      chunk.mTexcoords.push_back(texcoord.y * uv.y + uv.w);
+      chunk.mTexcoords.push_back(texture->mLayer);
+    }
+  }
+
+  mStats.mSourceMeshes++;
+}
+
+void StaticBatcher::Build() {
+  // Keep chunks of one pipeline together so Draw binds each program once,
+  // and each texture once within it
+  std::stable_sort(mChunks.begin(), mChunks.end(),
+                   [](const Chunk &a, const Chunk &b) {
+                     return std::tie(a.mPipeline, a.mTexture) <
+                            std::tie(b.mPipeline, b.mTexture);
+                   });
+  mChunkLookup.clear();
+
+  for (Chunk &chunk : mChunks) {
+    if (chunk.mVertexArrayObj != 0) {
+      continue;
+    }
+
+    glGenVertexArrays(1, &chunk.mVertexArrayObj);
+    glBindVertexArray(chunk.mVertexArrayObj);
+
+    glGenBuffers(1, &chunk.mVertexBufferObj);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.mVertexBufferObj);
+    glBufferData(GL_ARRAY_BUFFER,
+                 chunk.mData.positions.size() * sizeof(GLfloat),
+                 chunk.mData.positions.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, false, 0, (void *)0);
+
+    glGenBuffers(1, &chunk.mVertexBufferObj2);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.mVertexBufferObj2);
+    glBufferData(GL_ARRAY_BUFFER, chunk.mData.colors.size() * sizeof(GLfloat),
+                 chunk.mData.colors.data(), GL_STATIC_DRAW);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, false, 0, (void *)0);
+
+    if (!chunk.mTexcoords.empty()) {
+      glGenBuffers(1, &chunk.mTexcoordBufferObj);
+      glBindBuffer(GL_ARRAY_BUFFER, chunk.mTexcoordBufferObj);
+      glBufferData(GL_ARRAY_BUFFER, chunk.mTexcoords.size() * sizeof(GLfloat),
+                   chunk.mTexcoords.data(), GL_STATIC_DRAW);
+      glEnableVertexAttribArray(2);
+      glVertexAttribPointer(2, 3, GL_FLOAT, false, 0, (void *)0);
+    }
+
+    glGenBuffers(1, &chunk.mIndexBufferObj);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.mIndexBufferObj);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 chunk.mData.indices.size() * sizeof(GLuint),
+                 chunk.mData.indices.data(), GL_STATIC_DRAW);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    chunk.mIndexCount = (GLsizei)chunk.mData.indices.size();
+    mStats.mVertices += chunk.mData.positions.size() / 3;
+    mStats.mIndices += chunk.mData.indices.size();
+
+    // The GPU has its own copy now
+    chunk.mData = MeshData();
+    chunk.mTexcoords = std::vector<GLfloat>();
+  }
+
+  mStats.mChunks = mChunks.size();
+
+  LOG_INFO(kLogRender, "Static batching: {} meshes -> {} draw calls ({} "
+                       "vertices)",
+           mStats.mSourceMeshes, mStats.mChunks, mStats.mVertices);
+}
+
+void StaticBatcher::Destroy() {
+  for (Chunk &chunk : mChunks) {
+    glDeleteVertexArrays(1, &chunk.mVertexArrayObj);
+    glDeleteBuffers(1, &chunk.mVertexBufferObj);
+    glDeleteBuffers(1, &chunk.mVertexBufferObj2);
+    glDeleteBuffers(1, &chunk.mTexcoordBufferObj);
+    glDeleteBuffers(1, &chunk.mIndexBufferObj);
+  }
+  mChunks.clear();
+  mChunkLookup.clear();
+  mStats = StaticBatchStats();
+}
+
+int StaticBatcher::Draw(const glm::mat4 &view,
+                        const glm::mat4 &projection) const {
+  Frustum frustum = ExtractFrustum(projection * view);
+  const glm::mat4 identity(1.0f);
+
+  int drawn = 0;
+  GLuint boundPipeline = 0;
+  GLuint boundTexture = 0;
+  for (const Chunk &chunk : mChunks) {
+    if (!FrustumIntersectsAabb(frustum, chunk.mMin, chunk.mMax)) {
+      continue;
+    }
+
+    if (chunk.mPipeline != boundPipeline) {
+      boundPipeline = chunk.mPipeline;
+      glUseProgram(boundPipeline);
+      // Vertices are already in world space
+      glUniformMatrix4fv(glGetUniformLocation(boundPipeline, "uModelMatrix"),
+                         1, false, &identity[0][0]);
+      glUniformMatrix4fv(glGetUniformLocation(boundPipeline, "uViewMatrix"), 1,
+                         false, &view[0][0]);
+      glUniformMatrix4fv(glGetUniformLocation(boundPipeline, "uProjection"), 1,
+                         false, &projection[0][0]);
+    }
+    if (chunk.mTexture != boundTexture) {
+      boundTexture = chunk.mTexture;
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, boundTexture);
+    }
+
+    glBindVertexArray(chunk.mVertexArrayObj);
+    glDrawElements(GL_TRIANGLES, chunk.mIndexCount, GL_UNSIGNED_INT, 0);
+    drawn++;
+  }
+
+  RenderStatsAdd(kRenderStatCulledIn, drawn);
+  RenderStatsAdd(kRenderStatCulledOut, mChunks.size() - drawn);
+
+  glBindVertexArray(0);
+  glUseProgram(0);
+  if (boundTexture != 0) {
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  }
+
+  return drawn;
+}
+
+StaticBatchStats StaticBatcher::GetStats() const { return mStats; }
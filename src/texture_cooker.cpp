@@ -0,0 +1,521 @@
+#include "TextureCooker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TEXTURE_COOKER_SSE2
+#endif
+
+// Resolution of the linear to sRGB table, fine enough that the darkest
+// steps stay within a fraction of a byte
+static const int kLinearSteps = 16384;
+
+struct SrgbTables {
+  float mToLinear[256];
+  uint8_t mFromLinear[kLinearSteps];
+};
+
+static SrgbTables BuildSrgbTables() {
+  SrgbTables tables;
+  for (int i = 0; i < 256; ++i) {
+    float s = i / 255.0f;
+    tables.mToLinear[i] =
+        s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+  }
+  for (int i = 0; i < kLinearSteps; ++i) {
+    float l = (float)i / (kLinearSteps - 1);
+    float s = l <= 0.0031308f ? l * 12.92f
+                              : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+    tables.mFromLinear[i] = (uint8_t)std::lround(s * 255.0f);
+  }
+  return tables;
+}
+
+static const SrgbTables &GetSrgbTables() {
+  static const SrgbTables tables = BuildSrgbTables();
+  return tables;
+}
+
+static bool Fail(std::string *error, const char *message) {
+  if (error != nullptr) {
+    *error = message;
+  }
+  return false;
+}
+
+bool ParseCookFormat(const char *name, CookFormat *format) {
+  static const std::pair<const char *, CookFormat> names[] = {
+      {"auto", kCookAuto},
+      {"rgba", kCookRgba8},
+      {"bc1", kCookBc1},
+      {"bc3", kCookBc3}};
+  for (const auto &entry : names) {
+    if (std::strcmp(name, entry.first) == 0) {
+      *format = entry.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Mips -----------------------------------------------------------------------
+
+// One row of a level as 4 floats per pixel, color in linear light
+static void ReadRow(const Image &image, const ImageLevel &level, int y,
+                    bool srgb, float *out) {
+  size_t offset = level.mOffset + ImageRowSize(image.mFormat, level.mWidth) * y;
+  if (image.mFormat == kImageRgba16f) {
+    const uint8_t *row = image.mData.data() + offset;
+    for (int i = 0; i < level.mWidth * 4; ++i) {
+      uint16_t half;
+      std::memcpy(&half, row + i * 2, 2);
+      out[i] = glm::unpackHalf1x16(half);
+    }
+    return;
+  }
+
+  const float *toLinear = GetSrgbTables().mToLinear;
+  const uint8_t *row = image.mData.data() + offset;
+  for (int x = 0; x < level.mWidth; ++x) {
+    const uint8_t *pixel = row + x * 4;
+    float *o = out + x * 4;
+    for (int c = 0; c < 3; ++c) {
+      o[c] = srgb ? toLinear[pixel[c]] : pixel[c] * (1.0f / 255.0f);
+    }
+    o[3] = pixel[3] * (1.0f / 255.0f);
+  }
+}
+
+// Weights of the source pixels 2i, 2i + 1 and 2i + 2 that pixel i covers
+// when an axis of size is halved. Odd sizes spread each pixel over three,
+// so the last row or column still counts. Returns how many are used.
+static int HalveTaps(int size, int i, float weights[3]) {
+  if (size == 1) {
+    weights[0] = 1.0f;
+    return 1;
+  }
+  if (size % 2 == 0) {
+    weights[0] = weights[1] = 0.5f;
+    return 2;
+  }
+  float half = (float)(size / 2);
+  weights[0] = (half - i) / size;
+  weights[1] = half / size;
+  weights[2] = (i + 1.0f) / size;
+  return 3;
+}
+
+// Weighted sum of count rows of floats values each
+static void BlendRows(const std::vector<float> *rows, const float *weights,
+                      int count, int floats, float *out) {
+  int i = 0;
+
+#ifdef TEXTURE_COOKER_SSE2
+  for (; i + 4 <= floats; i += 4) {
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < count; ++k) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(rows[k].data() + i),
+                                       _mm_set1_ps(weights[k])));
+    }
+    _mm_storeu_ps(out + i, sum);
+  }
+#endif
+
+  for (; i < floats; ++i) {
+    float sum = 0.0f;
+    for (int k = 0; k < count; ++k) {
+      sum += rows[k][i] * weights[k];
+    }
+    out[i] = sum;
+  }
+}
+
+// Filters one row of pixels down to the width of the next level
+static void DownsampleRow(const float *row, int sourceWidth, int width,
+                          float *out) {
+  int x = 0;
+
+#ifdef TEXTURE_COOKER_SSE2
+  for (; x < width; ++x) {
+    float weights[3];
+    int taps = HalveTaps(sourceWidth, x, weights);
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < taps; ++k) {
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + (2 * x + k) * 4),
+                                       _mm_set1_ps(weights[k])));
+    }
+    _mm_storeu_ps(out + x * 4, sum);
+  }
+#endif
+
+  for (; x < width; ++x) {
+    float weights[3];
+    int taps = HalveTaps(sourceWidth, x, weights);
+    for (int c = 0; c < 4; ++c) {
+      float sum = 0.0f;
+      for (int k = 0; k < taps; ++k) {
+        sum += row[(2 * x + k) * 4 + c] * weights[k];
+      }
+      out[x * 4 + c] = sum;
+    }
+  }
+}
+
+// Quantizes a row of linear pixels back to the image format
+static void WriteRow(const float *in, int width, ImageFormat format,
+                     bool srgb, uint8_t *out) {
+  if (format == kImageRgba16f) {
+    for (int i = 0; i < width * 4; ++i) {
+      uint16_t half = glm::packHalf1x16(in[i]);
+      std::memcpy(out + i * 2, &half, 2);
+    }
+    return;
+  }
+
+  const uint8_t *fromLinear = GetSrgbTables().mFromLinear;
+  const float colorScale = srgb ? (float)(kLinearSteps - 1) : 255.0f;
+  int x = 0;
+
+#ifdef TEXTURE_COOKER_SSE2
+  const __m128 scale = _mm_setr_ps(colorScale, colorScale, colorScale, 255.0f);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  alignas(16) int32_t q[4];
+  for (; x < width; ++x) {
+    __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + x * 4), zero), one);
+    _mm_store_si128((__m128i *)q,
+                    _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half)));
+    uint8_t *pixel = out + x * 4;
+    for (int c = 0; c < 3; ++c) {
+      pixel[c] = srgb ? fromLinear[q[c]] : (uint8_t)q[c];
+    }
+    pixel[3] = (uint8_t)q[3];
+  }
+#endif
+
+  for (; x < width; ++x) {
+    uint8_t *pixel = out + x * 4;
+    for (int c = 0; c < 4; ++c) {
+      float v = std::min(std::max(in[x * 4 + c], 0.0f), 1.0f);
+      int q = (int)(v * (c < 3 ? colorScale : 255.0f) + 0.5f);
+      pixel[c] = c < 3 && srgb ? fromLinear[q] : (uint8_t)q;
+    }
+  }
+}
+
+bool BuildMipChain(Image *image, bool srgb) {
+  if (image->mLevels.size() != 1 ||
+      (image->mFormat != kImageRgba8 && image->mFormat != kImageRgba16f)) {
+    return false;
+  }
+  srgb = srgb && image->mFormat == kImageRgba8;
+
+  std::vector<ImageLevel> levels = image->mLevels;
+  size_t total = levels[0].mSize;
+  while (levels.back().mWidth > 1 || levels.back().mHeight > 1) {
+    ImageLevel level;
+    level.mWidth = std::max(1, levels.back().mWidth / 2);
+    level.mHeight = std::max(1, levels.back().mHeight / 2);
+    level.mOffset = total;
+    level.mSize = ImageLevelSize(image->mFormat, level.mWidth, level.mHeight);
+    total += level.mSize;
+    levels.push_back(level);
+  }
+  image->mData.resize(total);
+
+  // Each level is filtered from the one above: the source rows a row covers
+  // are blended, then the blended row is narrowed
+  std::vector<float> rows[3];
+  for (std::vector<float> &row : rows) {
+    row.resize(levels[0].mWidth * 4);
+  }
+  std::vector<float> blended(levels[0].mWidth * 4);
+  std::vector<float> filtered(levels[0].mWidth * 4);
+  for (size_t i = 1; i < levels.size(); ++i) {
+    const ImageLevel &source = levels[i - 1];
+    const ImageLevel &level = levels[i];
+    size_t rowSize = ImageRowSize(image->mFormat, level.mWidth);
+    for (int y = 0; y < level.mHeight; ++y) {
+      float weights[3];
+      int taps = HalveTaps(source.mHeight, y, weights);
+      for (int k = 0; k < taps; ++k) {
+        ReadRow(*image, source, 2 * y + k, srgb, rows[k].data());
+      }
+      BlendRows(rows, weights, taps, source.mWidth * 4, blended.data());
+      DownsampleRow(blended.data(), source.mWidth, level.mWidth,
+                    filtered.data());
+      WriteRow(filtered.data(), level.mWidth, image->mFormat, srgb,
+               image->mData.data() + level.mOffset + rowSize * y);
+    }
+  }
+  image->mLevels = levels;
+  return true;
+}
+
+// BCn ------------------------------------------------------------------------
+
+static uint16_t Pack565(const int rgb[3]) {
+  return (uint16_t)(((rgb[0] * 31 + 127) / 255) << 11 |
+                    ((rgb[1] * 63 + 127) / 255) << 5 |
+                    (rgb[2] * 31 + 127) / 255);
+}
+
+static void Unpack565(uint16_t color, int rgb[3]) {
+  int r = color >> 11 & 31;
+  int g = color >> 5 & 63;
+  int b = color & 31;
+  rgb[0] = r << 3 | r >> 2;
+  rgb[1] = g << 2 | g >> 4;
+  rgb[2] = b << 3 | b >> 2;
+}
+
+// Endpoints from the bounding box of the block's colors, inset a little
+// and laid along the diagonal the colors actually vary on. BC1 blocks
+// with cut out pixels switch to the 3 color mode, where index 3 is
+// transparent; BC3 color blocks always use 4 colors.
+static void EncodeColor(const uint8_t pixels[64], bool bc1, uint8_t out[8]) {
+  int lo[3] = {255, 255, 255};
+  int hi[3] = {0, 0, 0};
+  int sum[3] = {0, 0, 0};
+  int count = 0;
+  bool opaque[16];
+  for (int i = 0; i < 16; ++i) {
+    const uint8_t *pixel = pixels + i * 4;
+    opaque[i] = !bc1 || pixel[3] >= 128;
+    if (!opaque[i]) {
+      continue;
+    }
+    for (int c = 0; c < 3; ++c) {
+      lo[c] = std::min(lo[c], (int)pixel[c]);
+      hi[c] = std::max(hi[c], (int)pixel[c]);
+      sum[c] += pixel[c];
+    }
+    ++count;
+  }
+
+  if (count == 0) {
+    std::memset(out, 0, 4);
+    std::memset(out + 4, 0xff, 4);
+    return;
+  }
+
+  // Scaled by count to stay in integers
+  int covRed = 0;
+  int covBlue = 0;
+  for (int i = 0; i < 16; ++i) {
+    if (opaque[i]) {
+      const uint8_t *pixel = pixels + i * 4;
+      int green = pixel[1] * count - sum[1];
+      covRed += (pixel[0] * count - sum[0]) * green;
+      covBlue += (pixel[2] * count - sum[2]) * green;
+    }
+  }
+  for (int c = 0; c < 3; ++c) {
+    int inset = (hi[c] - lo[c]) >> 4;
+    lo[c] += inset;
+    hi[c] -= inset;
+  }
+  if (covRed < 0) {
+    std::swap(lo[0], hi[0]);
+  }
+  if (covBlue < 0) {
+    std::swap(lo[2], hi[2]);
+  }
+
+  uint16_t color0 = Pack565(hi);
+  uint16_t color1 = Pack565(lo);
+  bool threeColors = bc1 && count < 16;
+  if (bc1 && (threeColors ? color0 > color1 : color0 < color1)) {
+    std::swap(color0, color1);
+  }
+  // Equal endpoints read as 3 color mode in BC1, where only the first
+  // three entries are colors
+  int colors = bc1 && (threeColors || color0 == color1) ? 3 : 4;
+
+  int palette[4][3];
+  Unpack565(color0, palette[0]);
+  Unpack565(color1, palette[1]);
+  for (int c = 0; c < 3; ++c) {
+    if (colors == 4) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+    }
+  }
+
+  uint32_t indices = 0;
+  for (int i = 0; i < 16; ++i) {
+    uint32_t best = 3;
+    if (opaque[i]) {
+      const uint8_t *pixel = pixels + i * 4;
+      int bestDistance = 1 << 30;
+      for (int j = 0; j < colors; ++j) {
+        int dr = pixel[0] - palette[j][0];
+        int dg = pixel[1] - palette[j][1];
+        int db = pixel[2] - palette[j][2];
+        int distance = dr * dr + dg * dg + db * db;
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          best = (uint32_t)j;
+        }
+      }
+    }
+    indices |= best << (2 * i);
+  }
+
+  out[0] = (uint8_t)color0;
+  out[1] = (uint8_t)(color0 >> 8);
+  out[2] = (uint8_t)color1;
+  out[3] = (uint8_t)(color1 >> 8);
+  for (int i = 0; i < 4; ++i) {
+    out[4 + i] = (uint8_t)(indices >> (8 * i));
+  }
+}
+
+// Alpha endpoints at the block's extremes, 8 interpolated values between
+static void EncodeAlpha(const uint8_t pixels[64], uint8_t out[8]) {
+  int lo = 255;
+  int hi = 0;
+  for (int i = 0; i < 16; ++i) {
+    lo = std::min(lo, (int)pixels[i * 4 + 3]);
+    hi = std::max(hi, (int)pixels[i * 4 + 3]);
+  }
+
+  int palette[8] = {hi, lo};
+  for (int i = 1; i < 7; ++i) {
+    palette[i + 1] = ((7 - i) * hi + i * lo) / 7;
+  }
+
+  uint64_t indices = 0;
+  for (int i = 0; hi > lo && i < 16; ++i) {
+    int alpha = pixels[i * 4 + 3];
+    uint64_t best = 0;
+    for (int j = 1; j < 8; ++j) {
+      if (std::abs(alpha - palette[j]) < std::abs(alpha - palette[best])) {
+        best = (uint64_t)j;
+      }
+    }
+    indices |= best << (3 * i);
+  }
+
+  out[0] = (uint8_t)hi;
+  out[1] = (uint8_t)lo;
+  for (int i = 0; i < 6; ++i) {
+    out[2 + i] = (uint8_t)(indices >> (8 * i));
+  }
+}
+
+void CompressBc1Block(const uint8_t pixels[64], uint8_t out[8]) {
+  EncodeColor(pixels, true, out);
+}
+
+void CompressBc3Block(const uint8_t pixels[64], uint8_t out[16]) {
+  EncodeAlpha(pixels, out);
+  EncodeColor(pixels, false, out + 8);
+}
+
+// A 4x4 block, repeating the last row and column past the edges
+static void FetchBlock(const uint8_t *pixels, int width, int height, int bx,
+                       int by, uint8_t block[64]) {
+  for (int y = 0; y < 4; ++y) {
+    int sy = std::min(by * 4 + y, height - 1);
+    for (int x = 0; x < 4; ++x) {
+      int sx = std::min(bx * 4 + x, width - 1);
+      std::memcpy(block + (y * 4 + x) * 4,
+                  pixels + ((size_t)sy * width + sx) * 4, 4);
+    }
+  }
+}
+
+bool CompressImage(const Image &source, ImageFormat format, Image *out) {
+  if (source.mFormat != kImageRgba8 ||
+      (format != kImageBc1 && format != kImageBc3)) {
+    return false;
+  }
+
+  Image result;
+  result.mFormat = format;
+  result.mSrgb = source.mSrgb;
+  size_t total = 0;
+  for (const ImageLevel &sourceLevel : source.mLevels) {
+    ImageLevel level = sourceLevel;
+    level.mOffset = total;
+    level.mSize = ImageLevelSize(format, level.mWidth, level.mHeight);
+    total += level.mSize;
+    result.mLevels.push_back(level);
+  }
+  result.mData.resize(total);
+
+  size_t blockSize = format == kImageBc1 ? 8 : 16;
+  uint8_t block[64];
+  for (size_t i = 0; i < source.mLevels.size(); ++i) {
+    const ImageLevel &level = source.mLevels[i];
+    const uint8_t *pixels = source.mData.data() + level.mOffset;
+    uint8_t *blocks = result.mData.data() + result.mLevels[i].mOffset;
+    int blocksWide = (level.mWidth + 3) / 4;
+    int blocksHigh = (level.mHeight + 3) / 4;
+    for (int by = 0; by < blocksHigh; ++by) {
+      for (int bx = 0; bx < blocksWide; ++bx) {
+        FetchBlock(pixels, level.mWidth, level.mHeight, bx, by, block);
+        uint8_t *target = blocks + ((size_t)by * blocksWide + bx) * blockSize;
+        if (format == kImageBc1) {
+          CompressBc1Block(block, target);
+        } else {
+          CompressBc3Block(block, target);
+        }
+      }
+    }
+  }
+
+  *out = std::move(result);
+  return true;
+}
+
+static bool IsOpaque(const Image &image) {
+  const ImageLevel &level = image.mLevels[0];
+  const uint8_t *pixels = image.mData.data() + level.mOffset;
+  for (size_t i = 0; i < (size_t)level.mWidth * level.mHeight; ++i) {
+    if (pixels[i * 4 + 3] != 255) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool CookTexture(Image *image, const CookOptions &options,
+                 std::string *error) {
+  if (image->mLevels.empty()) {
+    return Fail(error, "Image has no levels");
+  }
+  if (ImageFormatIsCompressed(image->mFormat)) {
+    return true;
+  }
+  image->mSrgb = options.mSrgb && image->mFormat == kImageRgba8;
+
+  if (options.mMips && image->mLevels.size() == 1 &&
+      !BuildMipChain(image, image->mSrgb)) {
+    return Fail(error, "Could not build mips");
+  }
+  if (image->mFormat != kImageRgba8 || options.mFormat == kCookRgba8) {
+    return true;
+  }
+
+  ImageFormat format = kImageBc3;
+  if (options.mFormat == kCookBc1 ||
+      (options.mFormat == kCookAuto && IsOpaque(*image))) {
+    format = kImageBc1;
+  }
+  if (!CompressImage(*image, format, image)) {
+    return Fail(error, "Could not compress");
+  }
+  return true;
+}
@@ -0,0 +1,697 @@
+#include "TextureManager.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Log.hpp"
+#include "Profiler.hpp"
+#include "TextureCooker.hpp"
+
+// Staging buffers in flight; one is only refilled once the GPU is done
+// with it, so uploads skip a frame rather than wait
+static const size_t kStagingBuffers = 3;
+// Replacement textures started per frame, the rest wait their turn
+static const int kMaxBuildsPerFrame = 16;
+// Streamed textures keep the levels this size and smaller resident
+static const int kTailSize = 64;
+
+GLenum TextureInternalFormat(ImageFormat format, bool srgb) {
+  switch (format) {
+  case kImageRgba8:
+    return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+  case kImageRgba16f:
+    return GL_RGBA16F;
+  case kImageBc1:
+    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+                : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+  case kImageBc2:
+    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT
+                : GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+  case kImageBc3:
+    return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  }
+  return GL_RGBA8;
+}
+
+GLenum TexturePixelType(ImageFormat format) {
+  return format == kImageRgba16f ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE;
+}
+
+// Bytes of the levels from base on
+static size_t LevelBytes(const Image &image, size_t base) {
+  size_t bytes = 0;
+  for (size_t i = base; i < image.mLevels.size(); ++i) {
+    bytes += image.mLevels[i].mSize;
+  }
+  return bytes;
+}
+
+// Frees the levels before base, keeping the level table so their sizes
+// stay known. Levels are stored finest first.
+static void DropLevels(Image *image, size_t base) {
+  size_t dropped = image->mLevels[base].mOffset;
+  std::vector<uint8_t>(image->mData.begin() + dropped, image->mData.end())
+      .swap(image->mData);
+  for (size_t i = 0; i < image->mLevels.size(); ++i) {
+    ImageLevel &level = image->mLevels[i];
+    level.mOffset = i < base ? 0 : level.mOffset - dropped;
+  }
+}
+
+static size_t TailBase(const Image &image) {
+  size_t base = 0;
+  while (base + 1 < image.mLevels.size() &&
+         std::max(image.mLevels[base].mWidth, image.mLevels[base].mHeight) >
+             kTailSize) {
+    ++base;
+  }
+  return base;
+}
+
+// glTexStorage2D when there is one, otherwise every level specified empty
+static void AllocateStorage(GLenum internalFormat, ImageFormat format,
+                            GLsizei levels, int width, int height) {
+  if (GLAD_GL_ARB_texture_storage) {
+    glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+    return;
+  }
+
+  for (GLsizei level = 0; level < levels; ++level) {
+    int levelWidth = std::max(1, width >> level);
+    int levelHeight = std::max(1, height >> level);
+    if (ImageFormatIsCompressed(format)) {
+      glCompressedTexImage2D(
+          GL_TEXTURE_2D, level, internalFormat, levelWidth, levelHeight, 0,
+          (GLsizei)ImageLevelSize(format, levelWidth, levelHeight), nullptr);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelWidth,
+                   levelHeight, 0, GL_RGBA, TexturePixelType(format),
+                   nullptr);
+    }
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+}
+
+TextureManager::TextureManager()
+    : mPending(0), mReady(0), mChanges(0), mUploadedBytes(0), mFrame(1),
+      mMaxTextureSize(0), mBudgetBytes(256 * 1024 * 1024),
+      mCommittedBytes(0), mStreamedIn(0), mEvicted(0),
+      mImageBudgetBytes(256 * 1024 * 1024), mImageBytes(0), mReloading(0),
+      mReloads(0), mStagingIndex(0), mUploadBytesPerFrame(0),
+      mPlaceholder(0) {}
+
+void TextureManager::Initialize(int decodeThreads,
+                                size_t uploadBytesPerFrame) {
+  // Every row of the largest level has to fit in one staging buffer
+  mUploadBytesPerFrame = std::max<size_t>(uploadBytesPerFrame, 1024 * 1024);
+  mPool.Start(decodeThreads, "TextureDecode");
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &mMaxTextureSize);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  mStaging.resize(kStagingBuffers);
+  for (StagingBuffer &staging : mStaging) {
+    glGenBuffers(1, &staging.mBuffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.mBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, mUploadBytesPerFrame, nullptr,
+                 GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  // Gray checker, so missing textures are obvious but not glaring
+  static const uint8_t checker[16] = {160, 160, 160, 255, 96,  96,  96,  255,
+                                      96,  96,  96,  255, 160, 160, 160, 255};
+  glGenTextures(1, &mPlaceholder);
+  glBindTexture(GL_TEXTURE_2D, mPlaceholder);
+  AllocateStorage(GL_RGBA8, kImageRgba8, 1, 2, 2);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 2, 2, GL_RGBA, GL_UNSIGNED_BYTE,
+                  checker);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void TextureManager::Destroy() {
+  // Decodes still queued would only be thrown away, so shutdown waits for
+  // the running ones alone
+  mPool.CancelQueued();
+  mPool.Stop();
+  mDecoded.clear();
+
+  for (Texture &texture : mTextures) {
+    if (texture.mTexture != 0) {
+      glDeleteTextures(1, &texture.mTexture);
+    }
+    if (texture.mBuildTexture != 0) {
+      glDeleteTextures(1, &texture.mBuildTexture);
+    }
+  }
+  mTextures.clear();
+  mHandles.clear();
+  mUploadQueue.clear();
+  mPending = 0;
+  mCommittedBytes = 0;
+  mImageBytes = 0;
+  mReloading = 0;
+
+  for (StagingBuffer &staging : mStaging) {
+    if (staging.mFence != nullptr) {
+      glDeleteSync(staging.mFence);
+    }
+    glDeleteBuffers(1, &staging.mBuffer);
+  }
+  mStaging.clear();
+
+  for (auto &sampler : mSamplers) {
+    glDeleteSamplers(1, &sampler.second);
+  }
+  mSamplers.clear();
+
+  if (mPlaceholder != 0) {
+    glDeleteTextures(1, &mPlaceholder);
+    mPlaceholder = 0;
+  }
+}
+
+TextureHandle TextureManager::Load(const std::string &path,
+                                   const TextureOptions &options) {
+  auto found = mHandles.find(path);
+  if (found != mHandles.end()) {
+    return found->second;
+  }
+
+  Texture texture;
+  texture.mPath = path;
+  texture.mOptions = options;
+  mTextures.push_back(std::move(texture));
+  TextureHandle handle = (TextureHandle)mTextures.size();
+  mHandles[path] = handle;
+  ++mPending;
+  SubmitDecode(handle);
+  return handle;
+}
+
+void TextureManager::SubmitDecode(TextureHandle handle) {
+  const Texture &texture = mTextures[handle - 1];
+  std::string path = texture.mPath;
+  TextureOptions options = texture.mOptions;
+  int maxSize = mMaxTextureSize;
+  mPool.Submit([this, path, handle, options, maxSize] {
+    PROFILE_SCOPE("DecodeImage");
+    Decoded decoded;
+    decoded.mHandle = handle;
+    Image &image = decoded.mImage;
+    if (!LoadImage(path, &image, &decoded.mError, maxSize)) {
+      image = Image();
+    } else if (options.mGenerateMips && image.mLevels.size() == 1 &&
+               !ImageFormatIsCompressed(image.mFormat)) {
+      // Here rather than with glGenerateMipmap, so every level can be
+      // streamed on its own
+      BuildMipChain(&image, options.mSrgb || image.mSrgb);
+    }
+    std::lock_guard<std::mutex> lock(mDecodedMutex);
+    mDecoded.push_back(std::move(decoded));
+  });
+}
+
+void TextureManager::AcceptImage(TextureHandle handle, Image &&image) {
+  Texture &texture = mTextures[handle - 1];
+
+  const char *problem = nullptr;
+  if (image.Width() > mMaxTextureSize || image.Height() > mMaxTextureSize) {
+    problem = "larger than GL_MAX_TEXTURE_SIZE";
+  } else if (ImageFormatIsCompressed(image.mFormat) &&
+             !GLAD_GL_EXT_texture_compression_s3tc) {
+    problem = "S3TC textures are not supported by the driver";
+  }
+  if (problem != nullptr) {
+    LOG_WARNING(kLogAsset, "Could not load {}: {}", texture.mPath, problem);
+    texture.mState = kTextureFailed;
+    --mPending;
+    return;
+  }
+
+  texture.mInternalFormat = TextureInternalFormat(
+      image.mFormat, texture.mOptions.mSrgb || image.mSrgb);
+  texture.mWidth = image.Width();
+  texture.mHeight = image.Height();
+  texture.mLevelCount = image.mLevels.size();
+  texture.mTailBase = texture.mOptions.mStream ? TailBase(image) : 0;
+  texture.mWantedBase = texture.mTailBase;
+  texture.mImage = std::move(image);
+}
+
+void TextureManager::AcceptReload(Texture &texture, Decoded &decoded) {
+  texture.mReloading = false;
+  --mReloading;
+
+  const Image &image = decoded.mImage;
+  if (decoded.mError.empty() &&
+      (image.mFormat != texture.mImage.mFormat ||
+       image.Width() != texture.mWidth || image.Height() != texture.mHeight ||
+       image.mLevels.size() != texture.mLevelCount)) {
+    decoded.mError = "the file changed";
+  }
+  if (!decoded.mError.empty()) {
+    // Make do with the levels still held rather than retry every frame
+    LOG_WARNING(kLogAsset, "Could not read {} again: {}", texture.mPath,
+                decoded.mError);
+    texture.mFinestBase = texture.mImageBase;
+    return;
+  }
+  texture.mImage = std::move(decoded.mImage);
+  texture.mImageBase = 0;
+}
+
+size_t TextureManager::DesiredBase(const Texture &texture) const {
+  if (!texture.mOptions.mStream) {
+    return 0;
+  }
+  // Drawn this frame or the last one
+  if (texture.mLastUsedFrame + 1 >= mFrame) {
+    return std::max(std::min(texture.mWantedBase, texture.mTailBase),
+                    texture.mFinestBase);
+  }
+  return texture.mTailBase;
+}
+
+std::vector<TextureHandle>
+TextureManager::EvictionCandidates(TextureHandle keep) const {
+  std::vector<TextureHandle> candidates;
+  for (size_t i = 0; i < mTextures.size(); ++i) {
+    const Texture &texture = mTextures[i];
+    if (i + 1 != keep && texture.mTexture != 0 &&
+        texture.mBuildTexture == 0 && !texture.mImage.mLevels.empty() &&
+        DesiredBase(texture) > texture.mResidentBase) {
+      candidates.push_back((TextureHandle)(i + 1));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [this](TextureHandle a, TextureHandle b) {
+              return mTextures[a - 1].mLastUsedFrame <
+                     mTextures[b - 1].mLastUsedFrame;
+            });
+  return candidates;
+}
+
+size_t TextureManager::EvictableBytes(TextureHandle keep) const {
+  size_t bytes = 0;
+  for (TextureHandle handle : EvictionCandidates(keep)) {
+    const Texture &texture = mTextures[handle - 1];
+    bytes += texture.mResidentBytes -
+             LevelBytes(texture.mImage, DesiredBase(texture));
+  }
+  return bytes;
+}
+
+bool TextureManager::Evict(size_t bytes, TextureHandle keep) {
+  size_t freed = 0;
+  for (TextureHandle handle : EvictionCandidates(keep)) {
+    Texture &texture = mTextures[handle - 1];
+    size_t before = texture.mResidentBytes;
+    StartBuild(handle, DesiredBase(texture));
+    freed += before - texture.mBuildBytes;
+    ++mEvicted;
+    if (freed >= bytes) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void TextureManager::UpdateResidency() {
+  // Textures that need finer levels, most recently drawn first
+  std::vector<TextureHandle> upgrades;
+  for (size_t i = 0; i < mTextures.size(); ++i) {
+    const Texture &texture = mTextures[i];
+    if (texture.mImage.mLevels.empty() || texture.mBuildTexture != 0) {
+      continue;
+    }
+    size_t current =
+        texture.mTexture != 0 ? texture.mResidentBase : texture.mLevelCount;
+    if (DesiredBase(texture) < current) {
+      upgrades.push_back((TextureHandle)(i + 1));
+    }
+  }
+  std::stable_sort(upgrades.begin(), upgrades.end(),
+                   [this](TextureHandle a, TextureHandle b) {
+                     return mTextures[a - 1].mLastUsedFrame >
+                            mTextures[b - 1].mLastUsedFrame;
+                   });
+
+  int builds = 0;
+  for (TextureHandle handle : upgrades) {
+    Texture &texture = mTextures[handle - 1];
+    if (builds == kMaxBuildsPerFrame) {
+      break;
+    }
+    if (texture.mBuildTexture != 0) {
+      continue;
+    }
+
+    // As fine as the budget allows once other textures drop what they do
+    // not need. Something has to be resident, so a texture with nothing
+    // yet gets its tail regardless.
+    size_t others = mCommittedBytes - texture.mResidentBytes;
+    size_t room = mBudgetBytes + EvictableBytes(handle);
+    size_t current =
+        texture.mTexture != 0 ? texture.mResidentBase : texture.mLevelCount;
+    size_t coarsest =
+        texture.mTexture != 0 ? current - 1 : texture.mTailBase;
+    size_t base = DesiredBase(texture);
+    while (base < coarsest &&
+           others + LevelBytes(texture.mImage, base) > room) {
+      ++base;
+    }
+    size_t committed = others + LevelBytes(texture.mImage, base);
+    if (committed > room && texture.mTexture != 0) {
+      continue;
+    }
+    // The levels were dropped from RAM, so they are read again first
+    if (base < texture.mImageBase) {
+      if (!texture.mReloading) {
+        texture.mReloading = true;
+        ++mReloading;
+        ++mReloads;
+        SubmitDecode(handle);
+      }
+      continue;
+    }
+    // Only evicts for the level chosen
+    if (committed > mBudgetBytes) {
+      Evict(committed - mBudgetBytes, handle);
+    }
+    StartBuild(handle, base);
+    ++builds;
+  }
+}
+
+void TextureManager::StartBuild(TextureHandle handle, size_t base) {
+  Texture &texture = mTextures[handle - 1];
+  const ImageLevel &level = texture.mImage.mLevels[base];
+
+  glGenTextures(1, &texture.mBuildTexture);
+  glBindTexture(GL_TEXTURE_2D, texture.mBuildTexture);
+  AllocateStorage(texture.mInternalFormat, texture.mImage.mFormat,
+                  (GLsizei)(texture.mLevelCount - base), level.mWidth,
+                  level.mHeight);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  texture.mBuildBase = base;
+  texture.mBuildBytes = LevelBytes(texture.mImage, base);
+  mCommittedBytes =
+      mCommittedBytes - texture.mResidentBytes + texture.mBuildBytes;
+  texture.mUploadLevel = base;
+  texture.mUploadRow = 0;
+  mUploadQueue.push_back(handle);
+}
+
+void TextureManager::FinishBuild(Texture &texture) {
+  if (texture.mTexture != 0) {
+    if (texture.mBuildBase < texture.mResidentBase) {
+      ++mStreamedIn;
+    }
+    glDeleteTextures(1, &texture.mTexture);
+  }
+  texture.mTexture = texture.mBuildTexture;
+  texture.mResidentBase = texture.mBuildBase;
+  texture.mResidentBytes = texture.mBuildBytes;
+  texture.mBuildTexture = 0;
+  texture.mBuildBytes = 0;
+  ++mChanges;
+
+  if (texture.mState == kTextureLoading) {
+    texture.mState = kTextureReady;
+    --mPending;
+    ++mReady;
+  }
+  if (!texture.mOptions.mStream) {
+    texture.mImage = Image();
+  }
+}
+
+void TextureManager::TrimImages() {
+  std::vector<TextureHandle> candidates;
+  mImageBytes = 0;
+  for (size_t i = 0; i < mTextures.size(); ++i) {
+    const Texture &texture = mTextures[i];
+    mImageBytes += texture.mImage.mData.size();
+    if (texture.mOptions.mStream && texture.mTexture != 0 &&
+        texture.mBuildTexture == 0 && !texture.mReloading &&
+        texture.mImageBase < texture.mResidentBase) {
+      candidates.push_back((TextureHandle)(i + 1));
+    }
+  }
+  if (mImageBytes <= mImageBudgetBytes) {
+    return;
+  }
+
+  // Least recently drawn first
+  std::sort(candidates.begin(), candidates.end(),
+            [this](TextureHandle a, TextureHandle b) {
+              return mTextures[a - 1].mLastUsedFrame <
+                     mTextures[b - 1].mLastUsedFrame;
+            });
+  for (TextureHandle handle : candidates) {
+    Texture &texture = mTextures[handle - 1];
+    size_t before = texture.mImage.mData.size();
+    DropLevels(&texture.mImage, texture.mResidentBase);
+    texture.mImageBase = texture.mResidentBase;
+    mImageBytes -= before - texture.mImage.mData.size();
+    if (mImageBytes <= mImageBudgetBytes) {
+      return;
+    }
+  }
+}
+
+void TextureManager::Upload() {
+  if (mUploadQueue.empty() || mStaging.empty()) {
+    return;
+  }
+
+  StagingBuffer &staging = mStaging[mStagingIndex];
+  if (staging.mFence != nullptr) {
+    if (glClientWaitSync(staging.mFence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      return;
+    }
+    glDeleteSync(staging.mFence);
+    staging.mFence = nullptr;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging.mBuffer);
+  // The fence says the GPU is done with it, no need for the driver to check
+  uint8_t *mapped = (uint8_t *)glMapBufferRange(
+      GL_PIXEL_UNPACK_BUFFER, 0, mUploadBytesPerFrame,
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+          GL_MAP_UNSYNCHRONIZED_BIT);
+  if (mapped == nullptr) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return;
+  }
+
+  struct Copy {
+    TextureHandle mHandle;
+    size_t mLevel;
+    int mRow;
+    int mRows;
+    size_t mOffset;
+    size_t mSize;
+  };
+  std::vector<Copy> copies;
+  std::vector<TextureHandle> finished;
+  size_t used = 0;
+
+  // Whole rows (or rows of blocks) until the buffer is full
+  while (!mUploadQueue.empty()) {
+    TextureHandle handle = mUploadQueue.front();
+    Texture &texture = mTextures[handle - 1];
+    const Image &image = texture.mImage;
+    const ImageLevel &level = image.mLevels[texture.mUploadLevel];
+
+    int rowHeight = ImageRowHeight(image.mFormat);
+    size_t rowBytes = ImageRowSize(image.mFormat, level.mWidth);
+    size_t rowsLeft =
+        (size_t)(level.mHeight - texture.mUploadRow + rowHeight - 1) /
+        rowHeight;
+    size_t rows = std::min((mUploadBytesPerFrame - used) / rowBytes, rowsLeft);
+    if (rows == 0) {
+      break;
+    }
+
+    size_t source = level.mOffset + texture.mUploadRow / rowHeight * rowBytes;
+    std::memcpy(mapped + used, image.mData.data() + source, rows * rowBytes);
+    int pixelRows =
+        std::min((int)rows * rowHeight, level.mHeight - texture.mUploadRow);
+    copies.push_back({handle, texture.mUploadLevel, texture.mUploadRow,
+                      pixelRows, used, rows * rowBytes});
+    used += rows * rowBytes;
+
+    texture.mUploadRow += pixelRows;
+    if (texture.mUploadRow >= level.mHeight) {
+      texture.mUploadRow = 0;
+      if (++texture.mUploadLevel == image.mLevels.size()) {
+        mUploadQueue.pop_front();
+        finished.push_back(handle);
+      }
+    }
+  }
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  for (const Copy &copy : copies) {
+    const Texture &texture = mTextures[copy.mHandle - 1];
+    const ImageLevel &level = texture.mImage.mLevels[copy.mLevel];
+    // The replacement starts at its base level
+    GLint target = (GLint)(copy.mLevel - texture.mBuildBase);
+    glBindTexture(GL_TEXTURE_2D, texture.mBuildTexture);
+    if (ImageFormatIsCompressed(texture.mImage.mFormat)) {
+      glCompressedTexSubImage2D(GL_TEXTURE_2D, target, 0, copy.mRow,
+                                level.mWidth, copy.mRows,
+                                texture.mInternalFormat, (GLsizei)copy.mSize,
+                                (const void *)copy.mOffset);
+    } else {
+      glTexSubImage2D(GL_TEXTURE_2D, target, 0, copy.mRow, level.mWidth,
+                      copy.mRows, GL_RGBA,
+                      TexturePixelType(texture.mImage.mFormat),
+                      (const void *)copy.mOffset);
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  for (TextureHandle handle : finished) {
+    FinishBuild(mTextures[handle - 1]);
+  }
+
+  staging.mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  mStagingIndex = (mStagingIndex + 1) % mStaging.size();
+  mUploadedBytes += used;
+}
+
+void TextureManager::Update() {
+  PROFILE_SCOPE("TextureManager::Update");
+  ++mFrame;
+
+  std::vector<Decoded> decoded;
+  {
+    std::lock_guard<std::mutex> lock(mDecodedMutex);
+    decoded.swap(mDecoded);
+  }
+
+  for (Decoded &result : decoded) {
+    Texture &texture = mTextures[result.mHandle - 1];
+    if (texture.mReloading) {
+      AcceptReload(texture, result);
+      continue;
+    }
+    if (!result.mError.empty()) {
+      LOG_WARNING(kLogAsset, "Could not load {}: {}", texture.mPath,
+                  result.mError);
+      texture.mState = kTextureFailed;
+      --mPending;
+      continue;
+    }
+    AcceptImage(result.mHandle, std::move(result.mImage));
+  }
+
+  UpdateResidency();
+  Upload();
+  TrimImages();
+}
+
+GLuint TextureManager::GetTexture(TextureHandle handle) const {
+  if (handle == 0 || handle > mTextures.size() ||
+      mTextures[handle - 1].mTexture == 0) {
+    return mPlaceholder;
+  }
+  return mTextures[handle - 1].mTexture;
+}
+
+GLuint TextureManager::UseTexture(TextureHandle handle, float screenSize) {
+  if (handle == 0 || handle > mTextures.size()) {
+    return mPlaceholder;
+  }
+
+  Texture &texture = mTextures[handle - 1];
+  if (texture.mLevelCount > 0) {
+    // Each level halves the texels per pixel, as the sampler sees it
+    float texels = (float)std::max(texture.mWidth, texture.mHeight);
+    size_t level = 0;
+    if (screenSize < texels) {
+      level = (size_t)std::log2(texels / std::max(screenSize, 1.0f));
+    }
+    level = std::min(level, texture.mTailBase);
+    // The largest draw this frame wins
+    if (texture.mLastUsedFrame != mFrame || level < texture.mWantedBase) {
+      texture.mWantedBase = level;
+    }
+  }
+  texture.mLastUsedFrame = mFrame;
+  return GetTexture(handle);
+}
+
+TextureState TextureManager::GetState(TextureHandle handle) const {
+  if (handle == 0 || handle > mTextures.size()) {
+    return kTextureFailed;
+  }
+  return mTextures[handle - 1].mState;
+}
+
+TextureResidencyStats TextureManager::GetResidencyStats() const {
+  TextureResidencyStats stats;
+  stats.mBudgetBytes = mBudgetBytes;
+  stats.mCommittedBytes = mCommittedBytes;
+  stats.mImageBytes = mImageBytes;
+  stats.mImageBudgetBytes = mImageBudgetBytes;
+  stats.mStreamedIn = mStreamedIn;
+  stats.mEvicted = mEvicted;
+  stats.mReloads = mReloads;
+  for (const Texture &texture : mTextures) {
+    if (texture.mTexture != 0) {
+      ++stats.mResidentTextures;
+      if (texture.mResidentBase == 0) {
+        ++stats.mCompleteTextures;
+      }
+    }
+  }
+  return stats;
+}
+
+void TextureManager::PrintResidencyStats() const {
+  TextureResidencyStats stats = GetResidencyStats();
+  LOG_INFO(kLogAsset,
+           "Textures: {} resident, {} with every level, {} of {} MB budget",
+           stats.mResidentTextures, stats.mCompleteTextures,
+           stats.mCommittedBytes / (1024.0 * 1024.0),
+           stats.mBudgetBytes / (1024.0 * 1024.0));
+  LOG_INFO(kLogAsset,
+           "Texture streaming: {} streamed in, {} evicted, {} files read "
+           "again, {} of {} MB decoded in RAM",
+           stats.mStreamedIn, stats.mEvicted, stats.mReloads,
+           stats.mImageBytes / (1024.0 * 1024.0),
+           stats.mImageBudgetBytes / (1024.0 * 1024.0));
+}
+
+GLuint TextureManager::GetSampler(const SamplerDesc &desc) {
+  auto key = std::make_tuple(desc.mMinFilter, desc.mMagFilter, desc.mWrap,
+                             desc.mAnisotropy);
+  auto found = mSamplers.find(key);
+  if (found != mSamplers.end()) {
+    return found->second;
+  }
+
+  GLuint sampler;
+  glGenSamplers(1, &sampler);
+  glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, desc.mMinFilter);
+  glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, desc.mMagFilter);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, desc.mWrap);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, desc.mWrap);
+  if (desc.mAnisotropy > 1.0f && (GLAD_GL_ARB_texture_filter_anisotropic ||
+                                  GLAD_GL_EXT_texture_filter_anisotropic)) {
+    GLfloat maxAnisotropy = 1.0f;
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+    glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT,
+                        std::min(desc.mAnisotropy, maxAnisotropy));
+  }
+  mSamplers[key] = sampler;
+  return sampler;
+}
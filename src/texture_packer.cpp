@@ -0,0 +1,325 @@
+#include "TexturePacker.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+#include "Log.hpp"
+#include "TextureCooker.hpp"
+#include "TextureManager.hpp"
+
+// Atlas entries start on multiples of kAtlasAlign and are surrounded by
+// kAtlasPadding copies of their edge pixels, so the first kAtlasLevels mips
+// of a page never blend neighbors together
+static const int kAtlasAlign = 16;
+static const int kAtlasPadding = 8;
+static const size_t kAtlasLevels = 5;
+// Smallest page tried before settling on the full page size
+static const int kMinAtlasPage = 256;
+
+static int AlignUp(int value, int alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+static GLuint CreateArray(GLenum internalFormat, ImageFormat format,
+                          GLsizei levels, int width, int height, int layers,
+                          GLenum wrap) {
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+
+  if (GLAD_GL_ARB_texture_storage) {
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat, width, height,
+                   layers);
+  } else {
+    for (GLsizei level = 0; level < levels; ++level) {
+      int levelWidth = std::max(1, width >> level);
+      int levelHeight = std::max(1, height >> level);
+      if (ImageFormatIsCompressed(format)) {
+        size_t size = ImageLevelSize(format, levelWidth, levelHeight);
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat,
+                               levelWidth, levelHeight, layers, 0,
+                               (GLsizei)(size * layers), nullptr);
+      } else {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, levelWidth,
+                     levelHeight, layers, 0, GL_RGBA, TexturePixelType(format),
+                     nullptr);
+      }
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  }
+
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,
+                  levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+  return texture;
+}
+
+// Returns the bytes uploaded
+static size_t UploadLayer(const Image &image, GLenum internalFormat,
+                          size_t levels, int layer) {
+  size_t bytes = 0;
+  for (size_t i = 0; i < levels; ++i) {
+    const ImageLevel &level = image.mLevels[i];
+    const uint8_t *data = image.mData.data() + level.mOffset;
+    if (ImageFormatIsCompressed(image.mFormat)) {
+      glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, layer,
+                                level.mWidth, level.mHeight, 1, internalFormat,
+                                (GLsizei)level.mSize, data);
+    } else {
+      glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)i, 0, 0, layer, level.mWidth,
+                      level.mHeight, 1, GL_RGBA,
+                      TexturePixelType(image.mFormat), data);
+    }
+    bytes += level.mSize;
+  }
+  return bytes;
+}
+
+struct AtlasPlacement {
+  size_t mPending = 0;
+  int mPage = 0;
+  int mX = 0;
+  int mY = 0;
+};
+
+// Shelves filled left to right, tallest entries first. Returns the number
+// of pages used.
+static int PackShelves(std::vector<AtlasPlacement> &placements,
+                       const std::vector<std::pair<int, int>> &sizes,
+                       int pageSize) {
+  int page = 0;
+  int x = 0;
+  int y = 0;
+  int shelfHeight = 0;
+  for (AtlasPlacement &placement : placements) {
+    int width = sizes[placement.mPending].first;
+    int height = sizes[placement.mPending].second;
+    if (x + width > pageSize) {
+      x = 0;
+      y += shelfHeight;
+      shelfHeight = 0;
+    }
+    if (y + height > pageSize) {
+      ++page;
+      x = 0;
+      y = 0;
+      shelfHeight = 0;
+    }
+    placement.mPage = page;
+    placement.mX = x;
+    placement.mY = y;
+    x += width;
+    shelfHeight = std::max(shelfHeight, height);
+  }
+  return page + 1;
+}
+
+// Level 0 of source into page at x, y, edge pixels repeated into the
+// padding around it
+static void CopyPadded(const Image &source, Image *page, int x, int y) {
+  const ImageLevel &level = source.mLevels[0];
+  int pageWidth = page->Width();
+  size_t rowSize = (size_t)level.mWidth * 4;
+  for (int row = -kAtlasPadding; row < level.mHeight + kAtlasPadding;
+       ++row) {
+    int sourceRow = std::min(std::max(row, 0), level.mHeight - 1);
+    const uint8_t *in =
+        source.mData.data() + level.mOffset + rowSize * sourceRow;
+    uint8_t *out =
+        page->mData.data() + ((size_t)(y + row) * pageWidth + x) * 4;
+    std::memcpy(out, in, rowSize);
+    for (int i = 1; i <= kAtlasPadding; ++i) {
+      std::memcpy(out - i * 4, in, 4);
+      std::memcpy(out + rowSize + (i - 1) * 4, in + rowSize - 4, 4);
+    }
+  }
+}
+
+TexturePacker::TexturePacker(int pageSize, int maxAtlasSize)
+    : mPageSize(pageSize), mMaxAtlasSize(maxAtlasSize) {}
+
+size_t TexturePacker::Add(Image &&image, bool srgb, bool repeat) {
+  Pending pending;
+  pending.mInternalFormat =
+      TextureInternalFormat(image.mFormat, srgb || image.mSrgb);
+  pending.mImage = std::move(image);
+  pending.mRepeat = repeat;
+  pending.mSlot = mSlots.size();
+  mPending.push_back(std::move(pending));
+  mSlots.emplace_back();
+  return mSlots.size() - 1;
+}
+
+bool TexturePacker::CanAtlas(const Pending &pending) const {
+  const Image &image = pending.mImage;
+  int largest = std::max(image.Width(), image.Height());
+  return !pending.mRepeat && image.mFormat == kImageRgba8 &&
+         largest <= mMaxAtlasSize &&
+         AlignUp(largest + 2 * kAtlasPadding, kAtlasAlign) <= mPageSize;
+}
+
+void TexturePacker::Build() {
+  GLint maxLayers = 0;
+  glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+  maxLayers = std::max(maxLayers, 1);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  // (internal format, width, height, levels) -> pending textures
+  std::map<std::tuple<GLenum, int, int, size_t>, std::vector<size_t>> groups;
+  for (size_t i = 0; i < mPending.size(); ++i) {
+    const Pending &pending = mPending[i];
+    if (pending.mImage.mLevels.empty()) {
+      continue;
+    }
+    groups[std::make_tuple(pending.mInternalFormat, pending.mImage.Width(),
+                           pending.mImage.Height(),
+                           pending.mImage.mLevels.size())]
+        .push_back(i);
+    mStats.mTextures++;
+  }
+
+  // Matches share an array and keep their mips and wrapping, what is left
+  // over goes to the atlas of its format if it can
+  std::map<GLenum, std::vector<size_t>> atlases;
+  for (const auto &[key, pending] : groups) {
+    if (pending.size() == 1 && CanAtlas(mPending[pending[0]])) {
+      atlases[std::get<0>(key)].push_back(pending[0]);
+      continue;
+    }
+    for (size_t first = 0; first < pending.size(); first += maxLayers) {
+      size_t last = std::min(pending.size(), first + maxLayers);
+      BuildArray(std::vector<size_t>(pending.begin() + first,
+                                     pending.begin() + last));
+    }
+  }
+  for (const auto &[internalFormat, pending] : atlases) {
+    BuildAtlas(pending, internalFormat, maxLayers);
+  }
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  // The GPU has its own copy now
+  mPending.clear();
+
+  LOG_INFO(kLogAsset,
+           "Texture packing: {} textures -> {} array textures ({} layers, {} "
+           "textures in {} atlas pages)",
+           mStats.mTextures, mStats.mArrays, mStats.mLayers, mStats.mAtlased,
+           mStats.mAtlasPages);
+}
+
+void TexturePacker::BuildArray(const std::vector<size_t> &pending) {
+  const Pending &first = mPending[pending[0]];
+  const Image &image = first.mImage;
+  GLsizei levels = (GLsizei)image.mLevels.size();
+  GLuint texture =
+      CreateArray(first.mInternalFormat, image.mFormat, levels, image.Width(),
+                  image.Height(), (int)pending.size(), GL_REPEAT);
+  mArrays.push_back(texture);
+  mStats.mArrays++;
+
+  for (size_t layer = 0; layer < pending.size(); ++layer) {
+    const Pending &entry = mPending[pending[layer]];
+    mStats.mBytes += UploadLayer(entry.mImage, entry.mInternalFormat,
+                                 entry.mImage.mLevels.size(), (int)layer);
+    TextureSlot &slot = mSlots[entry.mSlot];
+    slot.mTexture = texture;
+    slot.mLayer = (float)layer;
+    mStats.mLayers++;
+  }
+}
+
+void TexturePacker::BuildAtlas(const std::vector<size_t> &pending,
+                               GLenum internalFormat, int maxLayers) {
+  // Padded sizes, indexed like mPending
+  std::vector<std::pair<int, int>> sizes(mPending.size());
+  std::vector<AtlasPlacement> placements;
+  for (size_t index : pending) {
+    const Image &image = mPending[index].mImage;
+    sizes[index] = {AlignUp(image.Width() + 2 * kAtlasPadding, kAtlasAlign),
+                    AlignUp(image.Height() + 2 * kAtlasPadding, kAtlasAlign)};
+    AtlasPlacement placement;
+    placement.mPending = index;
+    placements.push_back(placement);
+  }
+  std::stable_sort(placements.begin(), placements.end(),
+                   [&](const AtlasPlacement &a, const AtlasPlacement &b) {
+                     return sizes[a.mPending].second >
+                            sizes[b.mPending].second;
+                   });
+
+  // The smallest page that holds everything, or as many full size pages as
+  // it takes
+  int pageSize = std::min(kMinAtlasPage, mPageSize);
+  int pageCount = PackShelves(placements, sizes, pageSize);
+  while (pageCount > 1 && pageSize < mPageSize) {
+    pageSize = std::min(pageSize * 2, mPageSize);
+    pageCount = PackShelves(placements, sizes, pageSize);
+  }
+
+  std::vector<Image> pages(pageCount);
+  for (Image &page : pages) {
+    ImageLevel level;
+    level.mWidth = pageSize;
+    level.mHeight = pageSize;
+    level.mSize = ImageLevelSize(kImageRgba8, pageSize, pageSize);
+    page.mLevels.push_back(level);
+    page.mData.assign(level.mSize, 0);
+  }
+  for (const AtlasPlacement &placement : placements) {
+    CopyPadded(mPending[placement.mPending].mImage, &pages[placement.mPage],
+               placement.mX + kAtlasPadding, placement.mY + kAtlasPadding);
+  }
+
+  bool srgb = internalFormat == GL_SRGB8_ALPHA8;
+  for (Image &page : pages) {
+    BuildMipChain(&page, srgb);
+  }
+  // Split like the same-size groups when the pages outnumber the layers an
+  // array can have
+  size_t levels = std::min(kAtlasLevels, pages[0].mLevels.size());
+  std::vector<GLuint> textures;
+  for (int first = 0; first < pageCount; first += maxLayers) {
+    int layers = std::min(maxLayers, pageCount - first);
+    GLuint texture = CreateArray(internalFormat, kImageRgba8, (GLsizei)levels,
+                                 pageSize, pageSize, layers,
+                                 GL_CLAMP_TO_EDGE);
+    mArrays.push_back(texture);
+    textures.push_back(texture);
+    mStats.mArrays++;
+    for (int i = 0; i < layers; ++i) {
+      mStats.mBytes +=
+          UploadLayer(pages[first + i], internalFormat, levels, i);
+    }
+  }
+  mStats.mAtlasPages += pageCount;
+
+  for (const AtlasPlacement &placement : placements) {
+    const Pending &entry = mPending[placement.mPending];
+    TextureSlot &slot = mSlots[entry.mSlot];
+    slot.mTexture = textures[placement.mPage / maxLayers];
+    slot.mLayer = (float)(placement.mPage % maxLayers);
+    slot.mUvTransform =
+        glm::vec4((float)entry.mImage.Width(), (float)entry.mImage.Height(),
+                  (float)(placement.mX + kAtlasPadding),
+                  (float)(placement.mY + kAtlasPadding)) /
+        (float)pageSize;
+    mStats.mAtlased++;
+  }
+}
+
+void TexturePacker::Destroy() {
+  if (!mArrays.empty()) {
+    glDeleteTextures((GLsizei)mArrays.size(), mArrays.data());
+  }
+  mArrays.clear();
+  mPending.clear();
+  mSlots.clear();
+  mStats = TexturePackStats();
+}
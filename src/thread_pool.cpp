@@ -0,0 +1,75 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+#include "Profiler.hpp"
+
+ThreadPool::~ThreadPool() { Stop(); }
+
+void ThreadPool::Start(int threads, const char *name) {
+  if (!mThreads.empty()) {
+    return;
+  }
+  if (threads <= 0) {
+    threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+  }
+  mName = name;
+  mStop = false;
+  for (int i = 0; i < threads; ++i) {
+    mThreads.emplace_back(&ThreadPool::WorkerMain, this);
+  }
+}
+
+void ThreadPool::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mWake.notify_all();
+  for (std::thread &thread : mThreads) {
+    thread.join();
+  }
+  mThreads.clear();
+}
+
+size_t ThreadPool::CancelQueued() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  size_t cancelled = mJobs.size();
+  mJobs.clear();
+  return cancelled;
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJobs.push_back(std::move(job));
+  }
+  mWake.notify_one();
+}
+
+size_t ThreadPool::GetPendingCount() {
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mJobs.size() + mRunning;
+}
+
+void ThreadPool::WorkerMain() {
+  ProfilerSetThreadName(mName);
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  while (true) {
+    mWake.wait(lock, [this] { return mStop || !mJobs.empty(); });
+    if (mJobs.empty()) {
+      // Only reached once stopping
+      break;
+    }
+    std::function<void()> job = std::move(mJobs.front());
+    mJobs.pop_front();
+    ++mRunning;
+    lock.unlock();
+
+    job();
+
+    lock.lock();
+    --mRunning;
+  }
+}
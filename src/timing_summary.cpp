@@ -0,0 +1,41 @@
+#include "TimingSummary.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+static double Percentile(const std::vector<double> &sorted, double percent) {
+  size_t rank = (size_t)std::ceil(percent / 100.0 * sorted.size());
+  return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+TimingSummary SummarizeTimings(std::vector<double> samples) {
+  TimingSummary summary;
+  if (samples.empty()) {
+    return summary;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  double total = 0.0;
+  for (double sample : samples) {
+    total += sample;
+  }
+
+  summary.mCount = (int)samples.size();
+  summary.mMean = total / samples.size();
+  summary.mMin = samples.front();
+  summary.mMax = samples.back();
+  summary.mP50 = Percentile(samples, 50.0);
+  summary.mP95 = Percentile(samples, 95.0);
+  summary.mP99 = Percentile(samples, 99.0);
+  return summary;
+}
+
+std::string TimingSummaryJson(const TimingSummary &summary) {
+  std::ostringstream out;
+  out << "{\"count\": " << summary.mCount << ", \"mean\": " << summary.mMean
+      << ", \"min\": " << summary.mMin << ", \"max\": " << summary.mMax
+      << ", \"p50\": " << summary.mP50 << ", \"p95\": " << summary.mP95
+      << ", \"p99\": " << summary.mP99 << "}";
+  return out.str();
+}
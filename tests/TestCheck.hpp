@@ -0,0 +1,34 @@
+#ifndef TEST_CHECK_HPP
+#define TEST_CHECK_HPP
+
+#include <cstdio>
+
+// Each test is its own executable: failed checks print where they are and
+// keep going, and main returns TestResult() for ctest to read
+inline int &TestFailures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__,             \
+                  #condition);                                                 \
+      ++TestFailures();                                                        \
+    }                                                                          \
+  } while (0)
+
+// ctest reports this exit code as skipped, for GL tests on machines without
+// a usable context
+static const int kTestSkipped = 77;
+
+inline int TestResult() {
+  if (TestFailures() > 0) {
+    std::printf("%d checks failed\n", TestFailures());
+    return 1;
+  }
+  return 0;
+}
+
+#endif // !TEST_CHECK_HPP
@@ -0,0 +1,87 @@
+#include "GeometryCache.hpp"
+#include "HeadlessContext.hpp"
+#include "TestCheck.hpp"
+
+// One triangle, offset along x so different offsets differ only in data
+static MeshData MakeTriangle(float offset) {
+  MeshData data;
+  data.positions = {offset, 0.0f, 0.0f, offset + 1.0f, 0.0f,
+                    0.0f,   offset, 1.0f, 0.0f};
+  data.colors = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+  data.indices = {0, 1, 2};
+  return data;
+}
+
+int main() {
+  HeadlessContext context;
+  if (!context.Create(64, 64)) {
+    return kTestSkipped;
+  }
+
+  GeometryCache cache;
+  MeshData triangle = MakeTriangle(0.0f);
+  Mesh3D first;
+  Mesh3D second;
+  Mesh3D other;
+  // Same values in a separate copy still match
+  MeshData copy = triangle;
+  cache.Acquire(&first, triangle);
+  cache.Acquire(&second, copy);
+  cache.Acquire(&other, MakeTriangle(2.0f));
+
+  CHECK(first.mVertexArrayObj != 0);
+  CHECK(first.mVertexArrayObj == second.mVertexArrayObj);
+  CHECK(first.mVertexBufferObj == second.mVertexBufferObj);
+  CHECK(first.mIndexBufferObj == second.mIndexBufferObj);
+  CHECK(first.mIndexCount == 3);
+  CHECK(second.mIndexCount == 3);
+  CHECK(other.mVertexArrayObj != first.mVertexArrayObj);
+  CHECK(other.mVertexBufferObj != first.mVertexBufferObj);
+  CHECK(other.mBoundsRadius > first.mBoundsRadius);
+
+  // Positions, colors and indices of one triangle
+  size_t bytes = 18 * sizeof(GLfloat) + 3 * sizeof(GLuint);
+  GeometryCacheStats stats = cache.GetStats();
+  CHECK(stats.mMeshes == 3);
+  CHECK(stats.mGeometries == 2);
+  CHECK(stats.mBytes == 2 * bytes);
+  CHECK(stats.mBytesSaved == bytes);
+
+  // The shared buffers outlive the first release
+  GLuint vertexArray = first.mVertexArrayObj;
+  GLuint vertexBuffer = first.mVertexBufferObj;
+  cache.Release(&first);
+  CHECK(first.mVertexArrayObj == 0);
+  CHECK(first.mIndexCount == 0);
+  CHECK(glIsVertexArray(vertexArray));
+  CHECK(glIsBuffer(vertexBuffer));
+  stats = cache.GetStats();
+  CHECK(stats.mMeshes == 2);
+  CHECK(stats.mGeometries == 2);
+  CHECK(stats.mBytesSaved == 0);
+
+  // Releasing an already released mesh does nothing
+  cache.Release(&first);
+  CHECK(cache.GetStats().mMeshes == 2);
+
+  cache.Release(&second);
+  CHECK(!glIsVertexArray(vertexArray));
+  CHECK(!glIsBuffer(vertexBuffer));
+  stats = cache.GetStats();
+  CHECK(stats.mMeshes == 1);
+  CHECK(stats.mGeometries == 1);
+  CHECK(stats.mBytes == bytes);
+
+  // The freed slot is reused, and the data uploaded again
+  cache.Acquire(&first, triangle);
+  CHECK(first.mVertexArrayObj != 0);
+  CHECK(first.mVertexArrayObj != other.mVertexArrayObj);
+  CHECK(cache.GetStats().mGeometries == 2);
+
+  GLuint otherBuffer = other.mVertexBufferObj;
+  cache.Destroy();
+  CHECK(!glIsBuffer(otherBuffer));
+  CHECK(cache.GetStats().mMeshes == 0);
+  CHECK(glGetError() == GL_NO_ERROR);
+  return TestResult();
+}
@@ -0,0 +1,134 @@
+#include "GpuCuller.hpp"
+#include "HeadlessContext.hpp"
+#include "TestCheck.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+static DrawElementsIndirectCommand ReadCommand(const GpuCuller &culler) {
+  DrawElementsIndirectCommand command{0, 0, 0, 0, 0};
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culler.GetIndirectBuffer());
+  glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  return command;
+}
+
+// The survivors Cull captured, read back through the instance attribute
+static std::vector<glm::vec4> ReadCulled(const GpuCuller &culler,
+                                         GLuint count) {
+  GLuint vertexArray = 0;
+  glGenVertexArrays(1, &vertexArray);
+  culler.AttachInstanceAttribute(vertexArray, 2);
+  glBindVertexArray(vertexArray);
+  GLint buffer = 0;
+  glGetVertexAttribiv(2, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+  glBindVertexArray(0);
+  glDeleteVertexArrays(1, &vertexArray);
+
+  std::vector<glm::vec4> culled(count);
+  glBindBuffer(GL_ARRAY_BUFFER, (GLuint)buffer);
+  glGetBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::vec4),
+                     culled.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  return culled;
+}
+
+static bool Contains(const std::vector<glm::vec4> &instances,
+                     const glm::vec4 &instance) {
+  for (const glm::vec4 &candidate : instances) {
+    if (candidate == instance) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int main() {
+  HeadlessContext context;
+  if (!context.Create(64, 64)) {
+    return kTestSkipped;
+  }
+
+  GpuCuller culler;
+  CHECK(culler.Create(16));
+
+  // 90 degree frustum from the origin down -z, near 0.1 and far 100.
+  // Bounding radius 1, so spheres poking into the frustum survive.
+  std::vector<glm::vec4> visible = {
+      glm::vec4(0.0f, 0.0f, -10.0f, 1.0f),
+      // Centers outside the right, far and near planes but within reach
+      glm::vec4(10.5f, 0.0f, -10.0f, 1.0f),
+      glm::vec4(0.0f, 0.0f, -100.5f, 1.0f),
+      glm::vec4(0.0f, 0.0f, 0.5f, 1.0f),
+      // Scaled up to reach in
+      glm::vec4(0.0f, 30.0f, -10.0f, 20.0f)};
+  std::vector<glm::vec4> hidden = {
+      glm::vec4(0.0f, 0.0f, 10.0f, 1.0f),
+      glm::vec4(0.0f, 0.0f, -200.0f, 1.0f),
+      glm::vec4(30.0f, 0.0f, -10.0f, 1.0f),
+      // Same place as a survivor but scaled down out of reach
+      glm::vec4(10.5f, 0.0f, -10.0f, 0.1f)};
+  std::vector<glm::vec4> instances;
+  for (size_t i = 0; i < hidden.size(); ++i) {
+    instances.push_back(hidden[i]);
+    instances.push_back(visible[i]);
+  }
+  instances.push_back(visible.back());
+  culler.SetInstances(instances);
+  culler.SetMesh(36, 1.0f);
+
+  glm::mat4 projection =
+      glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 100.0f);
+  glm::mat4 forward = projection;
+  glm::mat4 backward =
+      projection * glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+
+  // The GPU writes the count into the command through the query buffer
+  bool queryBuffer = GLAD_GL_ARB_query_buffer_object != 0;
+  if (!queryBuffer) {
+    std::printf("GL_ARB_query_buffer_object missing, only the readback "
+                "path is tested\n");
+  }
+  culler.Cull(forward);
+  DrawElementsIndirectCommand command = ReadCommand(culler);
+  CHECK(command.count == 36);
+  CHECK(command.instanceCount == visible.size());
+  CHECK(command.firstIndex == 0 && command.baseInstance == 0);
+  std::vector<glm::vec4> culled = ReadCulled(culler, command.instanceCount);
+  for (const glm::vec4 &instance : visible) {
+    CHECK(Contains(culled, instance));
+  }
+
+  // Without the extension the count is read back and uploaded
+  GLAD_GL_ARB_query_buffer_object = 0;
+  culler.Cull(backward);
+  command = ReadCommand(culler);
+  // Looking down +z only the spheres at z 10 and 0.5 are in
+  CHECK(command.instanceCount == 2);
+  culled = ReadCulled(culler, command.instanceCount);
+  CHECK(Contains(culled, glm::vec4(0.0f, 0.0f, 10.0f, 1.0f)));
+  CHECK(Contains(culled, glm::vec4(0.0f, 0.0f, 0.5f, 1.0f)));
+
+  culler.Cull(forward);
+  CHECK(ReadCommand(culler).instanceCount == visible.size());
+  GLAD_GL_ARB_query_buffer_object = queryBuffer ? 1 : 0;
+
+  // Both paths again after the other wrote the command
+  if (queryBuffer) {
+    culler.Cull(backward);
+    CHECK(ReadCommand(culler).instanceCount == 2);
+  }
+
+  // Instances past the maximum are ignored
+  std::vector<glm::vec4> many(20, glm::vec4(0.0f, 0.0f, -10.0f, 1.0f));
+  culler.SetInstances(many);
+  culler.Cull(forward);
+  CHECK(ReadCommand(culler).instanceCount == 16);
+
+  culler.Destroy();
+  CHECK(glGetError() == GL_NO_ERROR);
+  return TestResult();
+}
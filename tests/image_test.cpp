@@ -0,0 +1,233 @@
+#include "Image.hpp"
+#include "Inflate.hpp"
+#include "TestCheck.hpp"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+// "hello hello hello hello" as zlib.compress(..., 9) writes it, one fixed
+// Huffman block
+static const uint8_t kFixedStream[] = {0x78, 0xda, 0xcb, 0x48, 0xcd, 0xc9,
+                                       0xc9, 0x57, 0xc8, 0x40, 0x27, 0x01,
+                                       0x68, 0x03, 0x08, 0xb1};
+static const char kFixedText[] = "hello hello hello hello";
+
+// kDynamicText as zlib.compress(..., 9) writes it, one dynamic Huffman block
+static const uint8_t kDynamicStream[] = {
+    0x78, 0xda, 0xb5, 0xcb, 0xd9, 0x15, 0x40, 0x30, 0x14, 0x45, 0xd1, 0x56,
+    0xae, 0x06, 0x2c, 0xf3, 0xd0, 0x85, 0x0f, 0x0d, 0x04, 0x41, 0x4c, 0x8f,
+    0x90, 0x20, 0xd5, 0x7b, 0x4d, 0xf8, 0x3e, 0xfb, 0xd4, 0xa3, 0xc4, 0x61,
+    0x54, 0x3b, 0xa3, 0xd1, 0x74, 0x6f, 0xe8, 0xe9, 0xc1, 0x64, 0xd6, 0xfd,
+    0x04, 0x59, 0xa9, 0x71, 0x71, 0x5e, 0x84, 0x7b, 0xd1, 0xd1, 0xe0, 0xa3,
+    0xfe, 0x0d, 0x57, 0x82, 0xdd, 0xfa, 0xa2, 0x61, 0x74, 0xab, 0x6b, 0x44,
+    0xaf, 0xac, 0xe4, 0xe4, 0xe4, 0x86, 0x45, 0x1d, 0x86, 0x34, 0xbf, 0xc3,
+    0xe9, 0x21, 0x08, 0xa3, 0x38, 0x49, 0xb3, 0xbc, 0x28, 0x3f, 0x74, 0x70,
+    0x41, 0x2d};
+static const char kDynamicText[] =
+    "The quick brown fox jumps over the lazy dog. The quick brown fox jumps "
+    "over the lazy dog. The quick brown fox jumps over the lazy dog. Pack my "
+    "box with five dozen liquor jugs! 0123456789";
+
+static void PutBe32(std::vector<uint8_t> &out, uint32_t value) {
+  for (int shift = 24; shift >= 0; shift -= 8) {
+    out.push_back((uint8_t)(value >> shift));
+  }
+}
+
+static uint32_t Adler32(const std::vector<uint8_t> &data) {
+  uint32_t a = 1;
+  uint32_t b = 0;
+  for (uint8_t byte : data) {
+    a = (a + byte) % 65521;
+    b = (b + a) % 65521;
+  }
+  return b << 16 | a;
+}
+
+static uint32_t Crc32(const uint8_t *data, size_t size) {
+  uint32_t crc = 0xffffffffu;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+// zlib stream of stored blocks, so tests can build image data by hand
+static std::vector<uint8_t> ZlibStored(const std::vector<uint8_t> &raw) {
+  std::vector<uint8_t> out = {0x78, 0x01};
+  size_t position = 0;
+  do {
+    size_t length = std::min<size_t>(raw.size() - position, 65535);
+    bool last = position + length == raw.size();
+    out.push_back(last ? 1 : 0);
+    out.push_back((uint8_t)length);
+    out.push_back((uint8_t)(length >> 8));
+    out.push_back((uint8_t)~length);
+    out.push_back((uint8_t)(~length >> 8));
+    out.insert(out.end(), raw.begin() + position,
+               raw.begin() + position + length);
+    position += length;
+  } while (position < raw.size());
+  PutBe32(out, Adler32(raw));
+  return out;
+}
+
+static void PutChunk(std::vector<uint8_t> &png, const char *type,
+                     const std::vector<uint8_t> &data) {
+  PutBe32(png, (uint32_t)data.size());
+  size_t start = png.size();
+  png.insert(png.end(), type, type + 4);
+  png.insert(png.end(), data.begin(), data.end());
+  PutBe32(png, Crc32(png.data() + start, png.size() - start));
+}
+
+static std::vector<uint8_t> MakePng(uint32_t width, uint32_t height,
+                                    uint8_t depth, uint8_t colorType,
+                                    const std::vector<uint8_t> &filtered,
+                                    const std::vector<uint8_t> &palette = {},
+                                    const std::vector<uint8_t> &alpha = {}) {
+  std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  std::vector<uint8_t> header;
+  PutBe32(header, width);
+  PutBe32(header, height);
+  header.insert(header.end(), {depth, colorType, 0, 0, 0});
+  PutChunk(png, "IHDR", header);
+  if (!palette.empty()) {
+    PutChunk(png, "PLTE", palette);
+  }
+  if (!alpha.empty()) {
+    PutChunk(png, "tRNS", alpha);
+  }
+  PutChunk(png, "IDAT", ZlibStored(filtered));
+  PutChunk(png, "IEND", {});
+  return png;
+}
+
+static bool Decode(const std::vector<uint8_t> &file, Image *image,
+                   int maxSize = kImageMaxSize) {
+  std::string error;
+  return DecodeImage(file.data(), file.size(), image, &error, maxSize);
+}
+
+static bool PixelIs(const Image &image, int x, int y, uint8_t r, uint8_t g,
+                    uint8_t b, uint8_t a) {
+  const uint8_t *pixel =
+      image.mData.data() + ((size_t)y * image.Width() + x) * 4;
+  return pixel[0] == r && pixel[1] == g && pixel[2] == b && pixel[3] == a;
+}
+
+static void TestInflate() {
+  std::vector<uint8_t> out;
+  CHECK(ZlibDecompress(kFixedStream, sizeof(kFixedStream), &out,
+                       sizeof(kFixedText) - 1));
+  CHECK(std::string(out.begin(), out.end()) == kFixedText);
+
+  // The cap is on the bytes appended, past what out already holds
+  out.assign({'x', 'y'});
+  CHECK(ZlibDecompress(kDynamicStream, sizeof(kDynamicStream), &out,
+                       sizeof(kDynamicText) - 1));
+  CHECK(std::string(out.begin(), out.end()) ==
+        std::string("xy") + kDynamicText);
+
+  out.clear();
+  CHECK(!ZlibDecompress(kDynamicStream, sizeof(kDynamicStream), &out,
+                        sizeof(kDynamicText) - 2));
+
+  // Raw DEFLATE, without the zlib header and Adler-32
+  out.clear();
+  CHECK(Inflate(kFixedStream + 2, sizeof(kFixedStream) - 6, &out));
+  CHECK(std::string(out.begin(), out.end()) == kFixedText);
+
+  std::vector<uint8_t> corrupt(kFixedStream,
+                               kFixedStream + sizeof(kFixedStream));
+  corrupt.back() ^= 1;
+  out.clear();
+  CHECK(!ZlibDecompress(corrupt.data(), corrupt.size(), &out, 1 << 20));
+
+  std::vector<uint8_t> raw(70000);
+  for (size_t i = 0; i < raw.size(); ++i) {
+    raw[i] = (uint8_t)(i * 7);
+  }
+  std::vector<uint8_t> stored = ZlibStored(raw);
+  out.clear();
+  CHECK(ZlibDecompress(stored.data(), stored.size(), &out, raw.size()));
+  CHECK(out == raw);
+}
+
+static void TestPngFilters() {
+  // 3x3 RGB: row 0 unfiltered, row 1 Sub, row 2 Up
+  std::vector<uint8_t> filtered = {
+      0, 10, 20, 30, 40, 50, 60, 70, 80, 90,
+      1, 1,  2,  3,  4,  5,  6,  1,  2,  3,
+      2, 10, 20, 30, 40, 50, 60, 70, 80, 90};
+  Image image;
+  CHECK(Decode(MakePng(3, 3, 8, 2, filtered), &image));
+  CHECK(image.mFormat == kImageRgba8);
+  CHECK(image.Width() == 3 && image.Height() == 3);
+  CHECK(image.mLevels.size() == 1);
+  CHECK(PixelIs(image, 0, 0, 10, 20, 30, 255));
+  CHECK(PixelIs(image, 2, 0, 70, 80, 90, 255));
+  CHECK(PixelIs(image, 0, 1, 1, 2, 3, 255));
+  CHECK(PixelIs(image, 1, 1, 5, 7, 9, 255));
+  CHECK(PixelIs(image, 2, 1, 6, 9, 12, 255));
+  CHECK(PixelIs(image, 0, 2, 11, 22, 33, 255));
+  CHECK(PixelIs(image, 2, 2, 76, 89, 102, 255));
+}
+
+static void TestPngPalette() {
+  // Four 2 bit indices in one byte, index 0 transparent through tRNS
+  std::vector<uint8_t> palette = {255, 0,   0,   0,   255, 0,
+                                  0,   0,   255, 255, 255, 255};
+  Image image;
+  CHECK(Decode(MakePng(4, 1, 2, 3, {0, 0x1b}, palette, {0}), &image));
+  CHECK(PixelIs(image, 0, 0, 255, 0, 0, 0));
+  CHECK(PixelIs(image, 1, 0, 0, 255, 0, 255));
+  CHECK(PixelIs(image, 2, 0, 0, 0, 255, 255));
+  CHECK(PixelIs(image, 3, 0, 255, 255, 255, 255));
+}
+
+static void TestPngLimits() {
+  std::vector<uint8_t> row = {0, 1, 2, 3};
+  Image image;
+  CHECK(Decode(MakePng(1, 1, 8, 2, row), &image));
+
+  // Rejected from the header alone, before anything is allocated
+  CHECK(!Decode(MakePng(kImageMaxSize + 1, 1, 8, 2, row), &image));
+  CHECK(!Decode(MakePng(2, 2, 8, 2, row), &image, 1));
+
+  // Too little data, and more than the rows can use
+  CHECK(!Decode(MakePng(1, 2, 8, 2, row), &image));
+  std::vector<uint8_t> padded = row;
+  padded.resize(64, 0);
+  CHECK(!Decode(MakePng(1, 1, 8, 2, padded), &image));
+}
+
+static void TestTga() {
+  // 2x2 true color, stored bottom row first as BGR
+  std::vector<uint8_t> tga(18, 0);
+  tga[2] = 2;
+  tga[12] = 2;
+  tga[14] = 2;
+  tga[16] = 24;
+  tga.insert(tga.end(), {255, 0, 0, 0, 255, 0, 0, 0, 255, 255, 255, 255});
+  Image image;
+  CHECK(Decode(tga, &image));
+  CHECK(image.Width() == 2 && image.Height() == 2);
+  CHECK(PixelIs(image, 0, 0, 255, 0, 0, 255));
+  CHECK(PixelIs(image, 1, 0, 255, 255, 255, 255));
+  CHECK(PixelIs(image, 0, 1, 0, 0, 255, 255));
+  CHECK(PixelIs(image, 1, 1, 0, 255, 0, 255));
+}
+
+int main() {
+  TestInflate();
+  TestPngFilters();
+  TestPngPalette();
+  TestPngLimits();
+  TestTga();
+  return TestResult();
+}
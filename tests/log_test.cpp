@@ -0,0 +1,77 @@
+#include "Log.hpp"
+#include "TestCheck.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static bool Contains(const std::string &line, const std::string &text) {
+  return line.find(text) != std::string::npos;
+}
+
+int main() {
+#if LOG_MIN_LEVEL > LOG_LEVEL_INFO
+  // The records checked below are compiled out
+  return kTestSkipped;
+#endif
+  std::string path =
+      (std::filesystem::temp_directory_path() / "practice_log_test.txt")
+          .string();
+  LogStart(path);
+
+  int value = -2;
+  const void *pointer = nullptr;
+  LOG_INFO(kLogCore, "a={} b={} c={} d={} e={} f={}", 1u, value, 2.5, true,
+           "text", std::string("string"));
+  LOG_WARNING(kLogShader, "pointer {}", pointer);
+  // Too few arguments leaves the rest of the placeholders as they are
+  LOG_ERROR(kLogAsset, "one {} two {}", 1);
+
+  // Arguments past a cut one are left out too, so placeholders never pick
+  // up the wrong value
+  std::string big(3000, 'x');
+  LOG_INFO(kLogRender, "n={} s={} m={} k={}", 7, big, 8, 9);
+  std::string mid(2000, 'y');
+  LOG_INFO(kLogRender, "s={} m={}", mid, 3);
+
+  LogSetCategoryEnabled(kLogInput, false);
+  LOG_ERROR(kLogInput, "filtered out");
+  LogSetCategoryEnabled(kLogInput, true);
+  LogSetLevel(LOG_LEVEL_ERROR);
+  LOG_WARNING(kLogCore, "below the level");
+  LogSetLevel(LOG_LEVEL_INFO);
+
+  LogStop();
+
+  std::ifstream file(path);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+  }
+  file.close();
+  std::filesystem::remove(path);
+
+  CHECK(lines.size() == 5);
+  if (lines.size() != 5) {
+    return TestResult();
+  }
+  CHECK(Contains(lines[0], "[info ] [core] a=1 b=-2 c=2.5 d=true e=text "
+                           "f=string"));
+  CHECK(!Contains(lines[0], "(truncated)"));
+  CHECK(Contains(lines[1], "[warn ] [shader] pointer "));
+  CHECK(Contains(lines[2], "[error] [asset] one 1 two {}"));
+
+  CHECK(Contains(lines[3], "[render] n=7 s=xxx"));
+  CHECK(Contains(lines[3], "x m={} k={} (truncated)"));
+  // The string was cut to what the record had left
+  CHECK(lines[3].size() < 2100);
+
+  CHECK(Contains(lines[4], "m=3"));
+  CHECK(Contains(lines[4], std::string(2000, 'y')));
+  CHECK(!Contains(lines[4], "(truncated)"));
+
+  CHECK(LogGetDroppedCount() == 0);
+  return TestResult();
+}
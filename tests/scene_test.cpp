@@ -0,0 +1,141 @@
+#include "SceneGenerator.hpp"
+#include "TestCheck.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static std::string TempPath(const char *name) {
+  return (std::filesystem::temp_directory_path() / name).string();
+}
+
+static std::vector<char> ReadFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<char>(std::istreambuf_iterator<char>(file),
+                           std::istreambuf_iterator<char>());
+}
+
+static void WriteFile(const std::string &path, const std::vector<char> &data) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(data.data(), data.size());
+}
+
+static bool SameMesh(const MeshData &a, const MeshData &b) {
+  return a.positions == b.positions && a.colors == b.colors &&
+         a.indices == b.indices && a.texcoords == b.texcoords;
+}
+
+static bool SameObject(const SceneObject &a, const SceneObject &b) {
+  return a.mMesh == b.mMesh && a.mVariant == b.mVariant &&
+         a.mFlags == b.mFlags && a.mPosition == b.mPosition &&
+         a.mScale == b.mScale;
+}
+
+static void TestGenerate(const Scene &scene, const SceneParams &params) {
+  CHECK(scene.mMeshes.size() == params.mUniqueMeshes);
+  CHECK(scene.mMeshRadii.size() == scene.mMeshes.size());
+  CHECK(scene.mObjects.size() == params.mObjectCount);
+  for (const SceneObject &object : scene.mObjects) {
+    CHECK(object.mMesh < params.mUniqueMeshes);
+    CHECK(object.mVariant < params.mShaderVariants);
+  }
+
+  // Same parameters, same scene
+  Scene again;
+  GenerateScene(params, &again);
+  CHECK(again.mObjects.size() == scene.mObjects.size());
+  for (size_t i = 0; i < scene.mObjects.size(); ++i) {
+    CHECK(SameObject(again.mObjects[i], scene.mObjects[i]));
+  }
+}
+
+static void TestRoundTrip(const Scene &scene, const std::string &path) {
+  CHECK(SceneSave(path, scene));
+  Scene loaded;
+  CHECK(SceneLoad(path, &loaded));
+
+  CHECK(std::memcmp(&loaded.mParams, &scene.mParams, sizeof(SceneParams)) ==
+        0);
+  CHECK(loaded.mMeshes.size() == scene.mMeshes.size());
+  for (size_t i = 0; i < scene.mMeshes.size() && i < loaded.mMeshes.size();
+       ++i) {
+    CHECK(SameMesh(loaded.mMeshes[i], scene.mMeshes[i]));
+  }
+  CHECK(loaded.mMeshRadii == scene.mMeshRadii);
+  CHECK(loaded.mObjects.size() == scene.mObjects.size());
+  for (size_t i = 0; i < scene.mObjects.size() && i < loaded.mObjects.size();
+       ++i) {
+    CHECK(SameObject(loaded.mObjects[i], scene.mObjects[i]));
+  }
+}
+
+static void TestRejects(const Scene &scene, const std::string &path) {
+  CHECK(SceneSave(path, scene));
+  std::vector<char> good = ReadFile(path);
+  Scene loaded;
+
+  std::vector<char> bad = good;
+  bad.resize(bad.size() - 4);
+  WriteFile(path, bad);
+  CHECK(!SceneLoad(path, &loaded));
+
+  bad = good;
+  bad[0] ^= 1;
+  WriteFile(path, bad);
+  CHECK(!SceneLoad(path, &loaded));
+
+  // Counts far beyond the file size fail before anything is allocated
+  size_t meshCountOffset = 2 * sizeof(uint32_t) + sizeof(SceneParams);
+  uint32_t huge = 0x7fffffff;
+  bad = good;
+  std::memcpy(&bad[meshCountOffset], &huge, sizeof(huge));
+  WriteFile(path, bad);
+  CHECK(!SceneLoad(path, &loaded));
+
+  bad = good;
+  std::memcpy(&bad[meshCountOffset + sizeof(uint32_t)], &huge, sizeof(huge));
+  WriteFile(path, bad);
+  CHECK(!SceneLoad(path, &loaded));
+
+  Scene broken = scene;
+  broken.mMeshRadii.pop_back();
+  CHECK(SceneSave(path, broken));
+  CHECK(!SceneLoad(path, &loaded));
+
+  broken = scene;
+  broken.mMeshes[0].indices[0] =
+      (GLuint)(broken.mMeshes[0].positions.size() / 3);
+  CHECK(SceneSave(path, broken));
+  CHECK(!SceneLoad(path, &loaded));
+
+  broken = scene;
+  broken.mMeshes[0].colors.pop_back();
+  CHECK(SceneSave(path, broken));
+  CHECK(!SceneLoad(path, &loaded));
+
+  broken = scene;
+  broken.mObjects[0].mMesh = (uint32_t)scene.mMeshes.size();
+  CHECK(SceneSave(path, broken));
+  CHECK(!SceneLoad(path, &loaded));
+}
+
+int main() {
+  SceneParams params;
+  params.mSeed = 7;
+  params.mObjectCount = 500;
+  params.mUniqueMeshes = 5;
+  params.mShaderVariants = 3;
+  params.mDistribution = kSceneClustered;
+  Scene scene;
+  GenerateScene(params, &scene);
+
+  std::string path = TempPath("practice_scene_test.bin");
+  TestGenerate(scene, params);
+  TestRoundTrip(scene, path);
+  TestRejects(scene, path);
+  std::filesystem::remove(path);
+  return TestResult();
+}
@@ -0,0 +1,97 @@
+#include "ShaderLibrary.hpp"
+#include "TestCheck.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static void WriteFile(const fs::path &path, const std::string &text) {
+  fs::create_directories(path.parent_path());
+  std::ofstream file(path, std::ios::trunc);
+  file << text;
+}
+
+static bool Depends(const std::vector<std::string> &dependencies,
+                    const fs::path &path) {
+  return std::find(dependencies.begin(), dependencies.end(),
+                   path.lexically_normal().string()) != dependencies.end();
+}
+
+// a.glsl and lib/b.glsl include each other, and b the root as well
+static void TestIncludes(const fs::path &directory) {
+  WriteFile(directory / "root.glsl", "#version 410 core\n"
+                                     "#include \"a.glsl\"\n"
+                                     "void main() {}\n");
+  WriteFile(directory / "a.glsl", "// a\n"
+                                  "  #include \"lib/b.glsl\"\n"
+                                  "float a() { return 1.0; }\n");
+  WriteFile(directory / "lib" / "b.glsl", "#include \"../a.glsl\"\n"
+                                          "#include \"../root.glsl\"\n"
+                                          "float b() { return 2.0; }\n");
+
+  std::vector<std::string> dependencies;
+  std::string source = PreprocessShader((directory / "root.glsl").string(),
+                                        {{"FOO", "1"}, {"BAR", "2.0"}},
+                                        &dependencies);
+  // Defines right after #version, each file numbered in #line, lines of
+  // files already included kept as blank ones, and the count restored
+  // after every include
+  CHECK(source == "#version 410 core\n"
+                  "#define FOO 1\n"
+                  "#define BAR 2.0\n"
+                  "#line 2 0\n"
+                  "#line 1 1\n"
+                  "// a\n"
+                  "#line 1 2\n"
+                  "\n"
+                  "\n"
+                  "float b() { return 2.0; }\n"
+                  "#line 3 1\n"
+                  "float a() { return 1.0; }\n"
+                  "#line 3 0\n"
+                  "void main() {}\n");
+
+  CHECK(dependencies.size() == 3);
+  CHECK(Depends(dependencies, directory / "root.glsl"));
+  CHECK(Depends(dependencies, directory / "a.glsl"));
+  CHECK(Depends(dependencies, directory / "lib" / "b.glsl"));
+}
+
+static void TestErrors(const fs::path &directory) {
+  WriteFile(directory / "missing.glsl", "#version 410 core\n"
+                                        "#include \"nowhere.glsl\"\n");
+  CHECK(PreprocessShader((directory / "missing.glsl").string(), {}).empty());
+
+  WriteFile(directory / "malformed.glsl", "#version 410 core\n"
+                                          "#include <a.glsl>\n");
+  CHECK(PreprocessShader((directory / "malformed.glsl").string(), {}).empty());
+
+  CHECK(PreprocessShader((directory / "absent.glsl").string(), {}).empty());
+}
+
+// The mesh vertex shaders share their interface through an include
+static void TestShaders() {
+  const char *paths[] = {"./shaders/vert.glsl", "./shaders/instanced_vert.glsl",
+                         "./shaders/instanced_model_vert.glsl"};
+  for (const char *path : paths) {
+    std::vector<std::string> dependencies;
+    std::string source = PreprocessShader(path, {}, &dependencies);
+    CHECK(source.find("out vec3 v_vertexColors;") != std::string::npos);
+    CHECK(source.find("#include") == std::string::npos);
+    CHECK(Depends(dependencies, "./shaders/common_vert.glsl"));
+  }
+}
+
+int main() {
+  fs::path directory = fs::temp_directory_path() / "practice_preprocessor";
+  fs::remove_all(directory);
+  TestIncludes(directory);
+  TestErrors(directory);
+  TestShaders();
+  fs::remove_all(directory);
+  return TestResult();
+}
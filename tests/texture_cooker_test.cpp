@@ -0,0 +1,349 @@
+#include "TestCheck.hpp"
+#include "TextureCooker.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+// Reference BC1 color decoding, as the spec reads it
+static void DecodeColor(const uint8_t block[8], bool bc1, uint8_t out[64]) {
+  uint16_t color0 = (uint16_t)(block[0] | block[1] << 8);
+  uint16_t color1 = (uint16_t)(block[2] | block[3] << 8);
+  int palette[4][4];
+  for (int i = 0; i < 2; ++i) {
+    uint16_t color = i == 0 ? color0 : color1;
+    int r = color >> 11 & 31;
+    int g = color >> 5 & 63;
+    int b = color & 31;
+    palette[i][0] = r << 3 | r >> 2;
+    palette[i][1] = g << 2 | g >> 4;
+    palette[i][2] = b << 3 | b >> 2;
+    palette[i][3] = 255;
+  }
+  bool fourColors = !bc1 || color0 > color1;
+  for (int c = 0; c < 3; ++c) {
+    if (fourColors) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    } else {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+  palette[2][3] = 255;
+  palette[3][3] = fourColors ? 255 : 0;
+
+  uint32_t indices = (uint32_t)(block[4] | block[5] << 8 | block[6] << 16 |
+                                (uint32_t)block[7] << 24);
+  for (int i = 0; i < 16; ++i) {
+    const int *color = palette[indices >> (2 * i) & 3];
+    for (int c = 0; c < 4; ++c) {
+      out[i * 4 + c] = (uint8_t)color[c];
+    }
+  }
+}
+
+static void DecodeBc3(const uint8_t block[16], uint8_t out[64]) {
+  DecodeColor(block + 8, false, out);
+  int palette[8] = {block[0], block[1]};
+  for (int i = 1; i < 7; ++i) {
+    palette[i + 1] = block[0] > block[1]
+                         ? ((7 - i) * block[0] + i * block[1]) / 7
+                         : 0;
+  }
+  if (block[0] <= block[1]) {
+    for (int i = 1; i < 5; ++i) {
+      palette[i + 1] = ((5 - i) * block[0] + i * block[1]) / 5;
+    }
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; ++i) {
+    indices |= (uint64_t)block[2 + i] << (8 * i);
+  }
+  for (int i = 0; i < 16; ++i) {
+    out[i * 4 + 3] = (uint8_t)palette[indices >> (3 * i) & 7];
+  }
+}
+
+static int MaxColorError(const uint8_t a[64], const uint8_t b[64]) {
+  int error = 0;
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      error = std::max(error, std::abs(a[i * 4 + c] - b[i * 4 + c]));
+    }
+  }
+  return error;
+}
+
+static void TestSolidBlock() {
+  uint8_t pixels[64];
+  for (int i = 0; i < 16; ++i) {
+    pixels[i * 4 + 0] = 200;
+    pixels[i * 4 + 1] = 100;
+    pixels[i * 4 + 2] = 30;
+    pixels[i * 4 + 3] = 255;
+  }
+  uint8_t block[8];
+  uint8_t decoded[64];
+  CompressBc1Block(pixels, block);
+  DecodeColor(block, true, decoded);
+  // One 565 step
+  CHECK(MaxColorError(pixels, decoded) <= 8);
+  for (int i = 0; i < 16; ++i) {
+    CHECK(decoded[i * 4 + 3] == 255);
+  }
+}
+
+static void TestGradientBlock() {
+  uint8_t pixels[64];
+  for (int i = 0; i < 16; ++i) {
+    pixels[i * 4 + 0] = (uint8_t)(40 + 12 * i);
+    pixels[i * 4 + 1] = (uint8_t)(20 + 8 * i);
+    pixels[i * 4 + 2] = (uint8_t)(220 - 12 * i);
+    pixels[i * 4 + 3] = 255;
+  }
+  uint8_t block[8];
+  uint8_t decoded[64];
+  CompressBc1Block(pixels, block);
+  DecodeColor(block, true, decoded);
+  // Four colors spread over a 180 wide ramp, plus the inset
+  CHECK(MaxColorError(pixels, decoded) <= 40);
+  for (int i = 0; i < 16; ++i) {
+    CHECK(decoded[i * 4 + 3] == 255);
+  }
+}
+
+static void TestBc1Cutout() {
+  uint8_t pixels[64];
+  for (int i = 0; i < 16; ++i) {
+    pixels[i * 4 + 0] = 10;
+    pixels[i * 4 + 1] = 250;
+    pixels[i * 4 + 2] = 10;
+    pixels[i * 4 + 3] = (uint8_t)(i % 2 ? 127 : 128);
+  }
+  uint8_t block[8];
+  uint8_t decoded[64];
+  CompressBc1Block(pixels, block);
+  DecodeColor(block, true, decoded);
+  for (int i = 0; i < 16; ++i) {
+    CHECK(decoded[i * 4 + 3] == (i % 2 ? 0 : 255));
+    if (i % 2 == 0) {
+      CHECK(std::abs(decoded[i * 4 + 1] - 250) <= 8);
+    }
+  }
+
+  // Fully cut out
+  for (int i = 0; i < 16; ++i) {
+    pixels[i * 4 + 3] = 0;
+  }
+  CompressBc1Block(pixels, block);
+  DecodeColor(block, true, decoded);
+  for (int i = 0; i < 16; ++i) {
+    CHECK(decoded[i * 4 + 3] == 0);
+  }
+}
+
+static void TestBc3Alpha() {
+  uint8_t pixels[64];
+  for (int i = 0; i < 16; ++i) {
+    pixels[i * 4 + 0] = 128;
+    pixels[i * 4 + 1] = 64;
+    pixels[i * 4 + 2] = 32;
+    pixels[i * 4 + 3] = (uint8_t)(i * 17);
+  }
+  uint8_t block[16];
+  uint8_t decoded[64];
+  CompressBc3Block(pixels, block);
+  DecodeBc3(block, decoded);
+  CHECK(MaxColorError(pixels, decoded) <= 8);
+  for (int i = 0; i < 16; ++i) {
+    // Half of one of 7 steps across 0..255
+    CHECK(std::abs(decoded[i * 4 + 3] - pixels[i * 4 + 3]) <= 19);
+  }
+
+  // Constant alpha comes back exactly
+  for (int i = 0; i < 16; ++i) {
+    pixels[i * 4 + 3] = 77;
+  }
+  CompressBc3Block(pixels, block);
+  DecodeBc3(block, decoded);
+  for (int i = 0; i < 16; ++i) {
+    CHECK(decoded[i * 4 + 3] == 77);
+  }
+}
+
+static Image MakeImage(int width, int height, uint8_t alpha) {
+  Image image;
+  ImageLevel level;
+  level.mWidth = width;
+  level.mHeight = height;
+  level.mSize = (size_t)width * height * 4;
+  image.mLevels.push_back(level);
+  image.mData.resize(level.mSize);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t *pixel = &image.mData[((size_t)y * width + x) * 4];
+      pixel[0] = (uint8_t)(x * 255 / width);
+      pixel[1] = (uint8_t)(y * 255 / height);
+      pixel[2] = 90;
+      pixel[3] = alpha;
+    }
+  }
+  return image;
+}
+
+static void TestCompressImage() {
+  // 6x5 rounds up to 2x2 blocks, repeating the edge pixels
+  Image image = MakeImage(6, 5, 255);
+  Image compressed;
+  CHECK(CompressImage(image, kImageBc1, &compressed));
+  CHECK(compressed.mFormat == kImageBc1);
+  CHECK(compressed.mLevels.size() == 1);
+  CHECK(compressed.mLevels[0].mWidth == 6);
+  CHECK(compressed.mLevels[0].mSize == 4 * 8);
+  CHECK(compressed.mData.size() == 4 * 8);
+
+  CHECK(CompressImage(image, kImageBc3, &compressed));
+  CHECK(compressed.mData.size() == 4 * 16);
+
+  // The last block column only has the edge pixels 4 and 5, so the
+  // repeated ones decode the same as pixel 5
+  uint8_t decoded[64];
+  DecodeBc3(&compressed.mData[16], decoded);
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 2; x < 4; ++x) {
+      CHECK(std::memcmp(&decoded[(y * 4 + x) * 4], &decoded[(y * 4 + 1) * 4],
+                        4) == 0);
+    }
+  }
+
+  CHECK(!CompressImage(compressed, kImageBc1, &image));
+  CHECK(!CompressImage(image, kImageRgba8, &compressed));
+}
+
+static void TestCookTexture() {
+  std::string error;
+  CookOptions options;
+
+  Image opaque = MakeImage(16, 8, 255);
+  CHECK(CookTexture(&opaque, options, &error));
+  CHECK(opaque.mFormat == kImageBc1);
+  CHECK(opaque.mSrgb);
+  // 16x8, 8x4, 4x2, 2x1 and 1x1
+  CHECK(opaque.mLevels.size() == 5);
+  size_t expected = 0;
+  for (const ImageLevel &level : opaque.mLevels) {
+    CHECK(level.mOffset == expected);
+    CHECK(level.mSize == ImageLevelSize(kImageBc1, level.mWidth,
+                                        level.mHeight));
+    expected += level.mSize;
+  }
+  CHECK(opaque.mData.size() == expected);
+  CHECK(opaque.mLevels.back().mWidth == 1);
+  CHECK(opaque.mLevels.back().mHeight == 1);
+
+  Image translucent = MakeImage(16, 8, 200);
+  CHECK(CookTexture(&translucent, options, &error));
+  CHECK(translucent.mFormat == kImageBc3);
+
+  options.mFormat = kCookRgba8;
+  options.mMips = false;
+  options.mSrgb = false;
+  Image plain = MakeImage(8, 8, 200);
+  CHECK(CookTexture(&plain, options, &error));
+  CHECK(plain.mFormat == kImageRgba8);
+  CHECK(plain.mLevels.size() == 1);
+  CHECK(!plain.mSrgb);
+
+  // Already compressed input is left alone
+  Image again = opaque;
+  options.mFormat = kCookBc3;
+  CHECK(CookTexture(&again, options, &error));
+  CHECK(again.mFormat == kImageBc1);
+  CHECK(again.mData == opaque.mData);
+}
+
+static void TestOddMips() {
+  // 3x3 black with a white last row and column, the ones a 2x2 filter
+  // would drop
+  Image image = MakeImage(3, 3, 255);
+  for (int y = 0; y < 3; ++y) {
+    for (int x = 0; x < 3; ++x) {
+      uint8_t value = x == 2 || y == 2 ? 255 : 0;
+      std::memset(&image.mData[(y * 3 + x) * 4], value, 3);
+    }
+  }
+  CHECK(BuildMipChain(&image, false));
+  CHECK(image.mLevels.size() == 2);
+  // A third of each axis: 5 of 9 pixels are white
+  const uint8_t *pixel = &image.mData[image.mLevels[1].mOffset];
+  CHECK(std::abs(pixel[0] - 142) <= 1);
+  CHECK(pixel[3] == 255);
+
+  // 5x2 keeps every column at the same weight: the constant row stays
+  // constant and the 2 pixels wide level splits the middle column
+  image = MakeImage(5, 2, 255);
+  for (int y = 0; y < 2; ++y) {
+    for (int x = 0; x < 5; ++x) {
+      image.mData[(y * 5 + x) * 4 + 0] = x == 2 ? 250 : 0;
+      image.mData[(y * 5 + x) * 4 + 1] = 100;
+    }
+  }
+  CHECK(BuildMipChain(&image, false));
+  CHECK(image.mLevels[1].mWidth == 2 && image.mLevels[1].mHeight == 1);
+  pixel = &image.mData[image.mLevels[1].mOffset];
+  CHECK(pixel[0] == pixel[4]);
+  CHECK(pixel[0] == 50);
+  CHECK(pixel[1] == 100 && pixel[5] == 100);
+}
+
+static void TestKtxRoundTrip() {
+  Image image;
+  image.mFormat = kImageBc1;
+  image.mSrgb = true;
+  size_t offset = 0;
+  for (int size = 8; size >= 4; size /= 2) {
+    ImageLevel level;
+    level.mWidth = size;
+    level.mHeight = size;
+    level.mOffset = offset;
+    level.mSize = ImageLevelSize(kImageBc1, size, size);
+    offset += level.mSize;
+    image.mLevels.push_back(level);
+  }
+  image.mData.resize(offset);
+  for (size_t i = 0; i < image.mData.size(); ++i) {
+    image.mData[i] = (uint8_t)(i * 31 + 5);
+  }
+
+  std::string path =
+      (std::filesystem::temp_directory_path() / "practice_cooker_test.ktx")
+          .string();
+  std::string error;
+  CHECK(SaveKtx(path, image, &error));
+  Image loaded;
+  CHECK(LoadImage(path, &loaded, &error));
+  std::filesystem::remove(path);
+
+  CHECK(loaded.mFormat == kImageBc1);
+  CHECK(loaded.mSrgb);
+  CHECK(loaded.mLevels.size() == 2);
+  CHECK(loaded.Width() == 8 && loaded.Height() == 8);
+  CHECK(loaded.mData == image.mData);
+}
+
+int main() {
+  TestSolidBlock();
+  TestGradientBlock();
+  TestBc1Cutout();
+  TestBc3Alpha();
+  TestCompressImage();
+  TestCookTexture();
+  TestOddMips();
+  TestKtxRoundTrip();
+  return TestResult();
+}
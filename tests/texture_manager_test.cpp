@@ -0,0 +1,158 @@
+#include "HeadlessContext.hpp"
+#include "TestCheck.hpp"
+#include "TextureCooker.hpp"
+#include "TextureManager.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 256x256 with its full mip chain, seeded so every file differs
+static std::string WriteTexture(const char *name, uint8_t seed) {
+  Image image;
+  ImageLevel level;
+  level.mWidth = 256;
+  level.mHeight = 256;
+  level.mSize = 256 * 256 * 4;
+  image.mLevels.push_back(level);
+  image.mData.resize(level.mSize);
+  for (size_t i = 0; i < image.mData.size(); ++i) {
+    image.mData[i] = (uint8_t)(i * 7 + seed);
+  }
+  BuildMipChain(&image, false);
+
+  std::string path = (std::filesystem::temp_directory_path() / name).string();
+  std::string error;
+  CHECK(SaveKtx(path, image, &error));
+  return path;
+}
+
+// Draws the textures at their sizes, a size of 0 skipping one, until
+// loading and streaming settle. Frames are spaced out so the decode thread
+// gets to run.
+static void Run(TextureManager &manager,
+                const std::vector<TextureHandle> &handles,
+                const std::vector<float> &sizes) {
+  for (int frame = 0; frame < 2000; ++frame) {
+    for (size_t i = 0; i < handles.size(); ++i) {
+      if (sizes[i] > 0.0f) {
+        manager.UseTexture(handles[i], sizes[i]);
+      }
+    }
+    manager.Update();
+    glFinish();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (frame > 2 && !manager.IsBusy()) {
+      return;
+    }
+  }
+  CHECK(!manager.IsBusy());
+}
+
+static GLint BaseWidth(GLuint texture) {
+  GLint width = 0;
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return width;
+}
+
+int main() {
+  HeadlessContext context;
+  if (!context.Create(64, 64)) {
+    return kTestSkipped;
+  }
+
+  std::vector<std::string> paths = {
+      WriteTexture("practice_stream_a.ktx", 1),
+      WriteTexture("practice_stream_b.ktx", 2),
+      WriteTexture("practice_stream_c.ktx", 3),
+      WriteTexture("practice_stream_d.ktx", 4)};
+
+  // Every level, the levels from 128 pixels down and the 64 pixel tail
+  const size_t full = 349524;
+  const size_t half = 87380;
+  const size_t tail = 21844;
+  TextureManager manager;
+  manager.Initialize(1);
+  manager.SetMemoryBudget(560000);
+
+  TextureOptions options;
+  options.mSrgb = false;
+  options.mStream = true;
+  std::vector<TextureHandle> handles;
+  for (const std::string &path : paths) {
+    handles.push_back(manager.Load(path, options));
+  }
+
+  // Only the tails until something is drawn large
+  Run(manager, handles, {0.0f, 0.0f, 0.0f, 0.0f});
+  TextureResidencyStats stats = manager.GetResidencyStats();
+  CHECK(stats.mResidentTextures == 4);
+  CHECK(stats.mCompleteTextures == 0);
+  CHECK(stats.mCommittedBytes == 4 * tail);
+  CHECK(BaseWidth(manager.GetTexture(handles[0])) == 64);
+
+  Run(manager, handles, {256.0f, 0.0f, 128.0f, 128.0f});
+  stats = manager.GetResidencyStats();
+  CHECK(stats.mCompleteTextures == 1);
+  CHECK(stats.mCommittedBytes == full + 2 * half + tail);
+  CHECK(BaseWidth(manager.GetTexture(handles[0])) == 256);
+  CHECK(BaseWidth(manager.GetTexture(handles[2])) == 128);
+
+  // Every level of the second would not fit even with the unused ones
+  // dropped to their tails, but 128 pixels does once one of them is
+  CHECK(stats.mEvicted == 0);
+  Run(manager, handles, {256.0f, 256.0f, 0.0f, 0.0f});
+  stats = manager.GetResidencyStats();
+  CHECK(stats.mEvicted == 1);
+  CHECK(stats.mCommittedBytes == full + 2 * half + tail);
+  CHECK(BaseWidth(manager.GetTexture(handles[0])) == 256);
+  CHECK(BaseWidth(manager.GetTexture(handles[1])) == 128);
+  CHECK(BaseWidth(manager.GetTexture(handles[2])) +
+            BaseWidth(manager.GetTexture(handles[3])) ==
+        128 + 64);
+
+  // Once the first is no longer drawn it gives up its levels too
+  Run(manager, handles, {0.0f, 256.0f, 0.0f, 0.0f});
+  stats = manager.GetResidencyStats();
+  CHECK(stats.mCommittedBytes <= stats.mBudgetBytes);
+  CHECK(BaseWidth(manager.GetTexture(handles[0])) == 64);
+  CHECK(BaseWidth(manager.GetTexture(handles[1])) == 256);
+
+  // Every level stays decoded in RAM until the image budget runs out. Then
+  // only what is resident is kept, and the file read again when needed.
+  stats = manager.GetResidencyStats();
+  CHECK(stats.mImageBytes == 4 * full);
+  manager.SetImageBudget(0);
+  Run(manager, handles, {0.0f, 256.0f, 0.0f, 0.0f});
+  stats = manager.GetResidencyStats();
+  CHECK(stats.mImageBytes == full + 3 * tail);
+  CHECK(stats.mReloads == 0);
+
+  Run(manager, handles, {256.0f, 0.0f, 0.0f, 0.0f});
+  stats = manager.GetResidencyStats();
+  CHECK(stats.mReloads == 1);
+  CHECK(BaseWidth(manager.GetTexture(handles[0])) == 256);
+  CHECK(BaseWidth(manager.GetTexture(handles[1])) == 64);
+  CHECK(stats.mImageBytes == full + 3 * tail);
+
+  // A file that is gone leaves the texture with what it has, and is not
+  // read again every frame
+  std::filesystem::remove(paths[2]);
+  Run(manager, handles, {0.0f, 0.0f, 256.0f, 0.0f});
+  Run(manager, handles, {0.0f, 0.0f, 256.0f, 0.0f});
+  stats = manager.GetResidencyStats();
+  CHECK(stats.mReloads == 2);
+  CHECK(manager.GetState(handles[2]) == kTextureReady);
+  CHECK(BaseWidth(manager.GetTexture(handles[2])) == 64);
+
+  manager.Destroy();
+  for (const std::string &path : paths) {
+    std::filesystem::remove(path);
+  }
+  CHECK(glGetError() == GL_NO_ERROR);
+  return TestResult();
+}
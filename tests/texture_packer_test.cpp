@@ -0,0 +1,199 @@
+#include "HeadlessContext.hpp"
+#include "TestCheck.hpp"
+#include "TexturePacker.hpp"
+
+#include <cstring>
+#include <vector>
+
+// Every pixel different within an image, and each image seeded apart
+static Image MakeImage(int width, int height, uint8_t seed) {
+  Image image;
+  ImageLevel level;
+  level.mWidth = width;
+  level.mHeight = height;
+  level.mSize = (size_t)width * height * 4;
+  image.mLevels.push_back(level);
+  image.mData.resize(level.mSize);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t *pixel = &image.mData[((size_t)y * width + x) * 4];
+      pixel[0] = (uint8_t)x;
+      pixel[1] = (uint8_t)y;
+      pixel[2] = seed;
+      pixel[3] = 255;
+    }
+  }
+  return image;
+}
+
+struct Layers {
+  int mWidth = 0;
+  int mHeight = 0;
+  int mDepth = 0;
+  std::vector<uint8_t> mData;
+
+  const uint8_t *Pixel(int layer, int x, int y) const {
+    return &mData[(((size_t)layer * mHeight + y) * mWidth + x) * 4];
+  }
+};
+
+static Layers ReadArray(GLuint texture) {
+  Layers layers;
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_WIDTH,
+                           &layers.mWidth);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_HEIGHT,
+                           &layers.mHeight);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D_ARRAY, 0, GL_TEXTURE_DEPTH,
+                           &layers.mDepth);
+  layers.mData.resize((size_t)layers.mWidth * layers.mHeight *
+                      layers.mDepth * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glGetTexImage(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                layers.mData.data());
+  return layers;
+}
+
+// The image's pixels at its place in the layer
+static bool SameImage(const Layers &layers, int layer, int x0, int y0,
+                      const Image &image) {
+  for (int y = 0; y < image.Height(); ++y) {
+    for (int x = 0; x < image.Width(); ++x) {
+      const uint8_t *expected =
+          &image.mData[((size_t)y * image.Width() + x) * 4];
+      if (std::memcmp(layers.Pixel(layer, x0 + x, y0 + y), expected, 4)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static void TestSameSizeArray(const TexturePacker &packer,
+                              const std::vector<Image> &images) {
+  const TextureSlot &first = packer.GetSlot(0);
+  const TextureSlot &second = packer.GetSlot(1);
+  CHECK(first.mTexture != 0);
+  CHECK(first.mTexture == second.mTexture);
+  CHECK(first.mLayer == 0.0f);
+  CHECK(second.mLayer == 1.0f);
+  CHECK(first.mUvTransform == glm::vec4(1.0f, 1.0f, 0.0f, 0.0f));
+
+  Layers layers = ReadArray(first.mTexture);
+  CHECK(layers.mWidth == 64 && layers.mHeight == 64 && layers.mDepth == 2);
+  CHECK(SameImage(layers, 0, 0, 0, images[0]));
+  CHECK(SameImage(layers, 1, 0, 0, images[1]));
+
+  GLint wrap = 0;
+  glGetTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, &wrap);
+  CHECK(wrap == GL_REPEAT);
+}
+
+static void TestAtlas(const TexturePacker &packer,
+                      const std::vector<Image> &images) {
+  GLuint atlas = packer.GetSlot(2).mTexture;
+  CHECK(atlas != 0);
+  CHECK(atlas != packer.GetSlot(0).mTexture);
+  Layers layers = ReadArray(atlas);
+  CHECK(layers.mDepth == 1);
+  CHECK(layers.mWidth == layers.mHeight);
+
+  GLint wrap = 0;
+  glGetTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, &wrap);
+  CHECK(wrap == GL_CLAMP_TO_EDGE);
+
+  float pageSize = (float)layers.mWidth;
+  for (size_t i = 2; i < 5; ++i) {
+    const TextureSlot &slot = packer.GetSlot(i);
+    const Image &image = images[i];
+    CHECK(slot.mTexture == atlas);
+    CHECK(slot.mLayer == 0.0f);
+    glm::vec4 rect = slot.mUvTransform * pageSize;
+    CHECK((int)rect.x == image.Width());
+    CHECK((int)rect.y == image.Height());
+    int x0 = (int)rect.z;
+    int y0 = (int)rect.w;
+    // Entries start past their 8 pixel gutter on a 16 pixel grid
+    CHECK(x0 % 16 == 8 && y0 % 16 == 8);
+    bool same = SameImage(layers, 0, x0, y0, image);
+    CHECK(same);
+    if (!same) {
+      continue;
+    }
+
+    // Gutters repeat the edge pixels, corners included
+    int right = x0 + image.Width() - 1;
+    int bottom = y0 + image.Height() - 1;
+    for (int d = 1; d <= 8; ++d) {
+      CHECK(!std::memcmp(layers.Pixel(0, x0 - d, y0), layers.Pixel(0, x0, y0),
+                         4));
+      CHECK(!std::memcmp(layers.Pixel(0, right + d, bottom),
+                         layers.Pixel(0, right, bottom), 4));
+      CHECK(!std::memcmp(layers.Pixel(0, x0, y0 - d), layers.Pixel(0, x0, y0),
+                         4));
+      CHECK(!std::memcmp(layers.Pixel(0, right, bottom + d),
+                         layers.Pixel(0, right, bottom), 4));
+      CHECK(!std::memcmp(layers.Pixel(0, x0 - d, y0 - d),
+                         layers.Pixel(0, x0, y0), 4));
+    }
+  }
+
+  // No two entries overlap, gutters included
+  for (size_t i = 2; i < 5; ++i) {
+    for (size_t j = i + 1; j < 5; ++j) {
+      glm::vec4 a = packer.GetSlot(i).mUvTransform * pageSize;
+      glm::vec4 b = packer.GetSlot(j).mUvTransform * pageSize;
+      bool apart = a.z + a.x + 8 <= b.z - 8 || b.z + b.x + 8 <= a.z - 8 ||
+                   a.w + a.y + 8 <= b.w - 8 || b.w + b.y + 8 <= a.w - 8;
+      CHECK(apart);
+    }
+  }
+}
+
+int main() {
+  HeadlessContext context;
+  if (!context.Create(64, 64)) {
+    return kTestSkipped;
+  }
+
+  std::vector<Image> images;
+  images.push_back(MakeImage(64, 64, 1));
+  images.push_back(MakeImage(64, 64, 2));
+  // Sizes nothing else has, small enough for the atlas
+  images.push_back(MakeImage(16, 16, 3));
+  images.push_back(MakeImage(32, 8, 4));
+  images.push_back(MakeImage(8, 24, 5));
+  // Wrapping keeps it out of the atlas
+  images.push_back(MakeImage(20, 20, 6));
+
+  TexturePacker packer;
+  for (size_t i = 0; i < images.size(); ++i) {
+    Image copy = images[i];
+    CHECK(packer.Add(std::move(copy), false, i == 5) == i);
+  }
+  packer.Build();
+  CHECK(glGetError() == GL_NO_ERROR);
+
+  TexturePackStats stats = packer.GetStats();
+  CHECK(stats.mTextures == 6);
+  CHECK(stats.mArrays == 3);
+  CHECK(stats.mLayers == 3);
+  CHECK(stats.mAtlased == 3);
+  CHECK(stats.mAtlasPages == 1);
+
+  TestSameSizeArray(packer, images);
+  TestAtlas(packer, images);
+
+  const TextureSlot &repeat = packer.GetSlot(5);
+  CHECK(repeat.mTexture != 0);
+  CHECK(repeat.mTexture != packer.GetSlot(0).mTexture);
+  CHECK(repeat.mTexture != packer.GetSlot(2).mTexture);
+  CHECK(SameImage(ReadArray(repeat.mTexture), 0, 0, 0, images[5]));
+
+  GLuint texture = packer.GetSlot(0).mTexture;
+  packer.Destroy();
+  CHECK(!glIsTexture(texture));
+  CHECK(packer.GetSlotCount() == 0);
+  CHECK(glGetError() == GL_NO_ERROR);
+  return TestResult();
+}
@@ -0,0 +1,394 @@
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Camera.hpp"
+#include "GeometryCache.hpp"
+#include "HeadlessContext.hpp"
+#include "Mesh.hpp"
+#include "PipelineCompiler.hpp"
+#include "Profiler.hpp"
+#include "ProgramBinaryCache.hpp"
+#include "RenderStats.hpp"
+#include "Renderer.hpp"
+#include "SceneGenerator.hpp"
+#include "SceneRenderer.hpp"
+#include "ShaderLibrary.hpp"
+#include "TextureCooker.hpp"
+#include "TextureManager.hpp"
+#include "TexturePacker.hpp"
+#include "ThreadPool.hpp"
+#include "TimingSummary.hpp"
+
+// Draws the demo scene along a fixed camera path and reports CPU and GPU
+// frame times as JSON. Runs headless unless --window is given.
+//
+//   PracticeBench [--frames=N] [--warmup=N] [--width=W] [--height=H]
+//                 [--out=report.json] [--window] [--profile=trace.json]
+//                 [--scene=<file> | PracticeSceneGen options]
+//                 [--textures=<dir>] [--materials=<dir>]
+//
+// Without a scene it draws the two quads of the demo. Generator options
+// build the scene in memory, so a sweep needs no files. --textures starts
+// loading every file in dir on the first measured frame, to see what
+// streaming costs the frame. --materials packs every file in dir into
+// texture arrays before the run and spreads them over the static objects
+// of the scene.
+
+struct BenchOptions {
+  int mFrames = 600;
+  int mWarmup = 60;
+  int mWidth = 640;
+  int mHeight = 480;
+  std::string mOutPath;
+  bool mWindow = false;
+  std::string mProfilePath;
+  std::string mScenePath;
+  std::string mTextureDir;
+  std::string mMaterialDir;
+  bool mGenerateScene = false;
+  SceneParams mSceneParams;
+};
+
+// Timer queries in flight before the oldest one is read back
+static const int kQueryLatency = 4;
+
+static bool ParseOptions(int argc, char *argv[], BenchOptions *options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (std::sscanf(arg, "--frames=%d", &options->mFrames) == 1 ||
+        std::sscanf(arg, "--warmup=%d", &options->mWarmup) == 1 ||
+        std::sscanf(arg, "--width=%d", &options->mWidth) == 1 ||
+        std::sscanf(arg, "--height=%d", &options->mHeight) == 1) {
+      continue;
+    }
+    if (std::strncmp(arg, "--out=", 6) == 0) {
+      options->mOutPath = arg + 6;
+    } else if (std::strncmp(arg, "--profile=", 10) == 0) {
+      options->mProfilePath = arg + 10;
+    } else if (std::strncmp(arg, "--scene=", 8) == 0) {
+      options->mScenePath = arg + 8;
+    } else if (std::strncmp(arg, "--textures=", 11) == 0) {
+      options->mTextureDir = arg + 11;
+    } else if (std::strncmp(arg, "--materials=", 12) == 0) {
+      options->mMaterialDir = arg + 12;
+    } else if (ParseSceneOption(arg, &options->mSceneParams)) {
+      options->mGenerateScene = true;
+    } else if (std::strcmp(arg, "--window") == 0) {
+      options->mWindow = true;
+    } else {
+      std::cout << "Unknown option " << arg << std::endl;
+      return false;
+    }
+  }
+  return options->mFrames > 0 && options->mWarmup >= 0;
+}
+
+// Regular files in dir, sorted so runs see them in the same order
+static std::vector<std::string> ListFiles(const std::string &dir) {
+  std::vector<std::string> paths;
+  std::error_code error;
+  for (const auto &entry : std::filesystem::directory_iterator(dir, error)) {
+    if (entry.is_regular_file()) {
+      paths.push_back(entry.path().string());
+    }
+  }
+  std::sort(paths.begin(), paths.end());
+  return paths;
+}
+
+// Decodes the files on every core, with mips, and packs the ones that load
+static void LoadMaterials(const std::vector<std::string> &paths,
+                          TexturePacker *packer) {
+  std::vector<Image> images(paths.size());
+  ThreadPool pool;
+  pool.Start(0, "MaterialDecode");
+  for (size_t i = 0; i < paths.size(); ++i) {
+    pool.Submit([&, i] {
+      std::string error;
+      if (!LoadImage(paths[i], &images[i], &error)) {
+        images[i] = Image();
+        return;
+      }
+      if (!ImageFormatIsCompressed(images[i].mFormat)) {
+        BuildMipChain(&images[i], true);
+      }
+    });
+  }
+  pool.Stop();
+
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (images[i].mLevels.empty()) {
+      std::cout << "Could not load material " << paths[i] << std::endl;
+      continue;
+    }
+    packer->Add(std::move(images[i]), true);
+  }
+  packer->Build();
+}
+
+// One orbit around the scene over the measured frames, the same every run
+static void CameraPath(Camera *camera, const glm::vec3 &center, float radius,
+                       int frame, int frameCount) {
+  float t = 2.0f * 3.14159265f * (float)frame / (float)frameCount;
+  glm::vec3 eye = center + glm::vec3(std::sin(t) * radius, radius / 6.0f,
+                                     std::cos(t) * radius);
+  camera->LookAt(eye, center);
+}
+
+int main(int argc, char *argv[]) {
+
+  BenchOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+  ProfilerSetThreadName("Main");
+  ProfilerSetEnabled(!options.mProfilePath.empty());
+
+  HeadlessContext headless;
+  SDL_Window *window = nullptr;
+  SDL_GLContext context = nullptr;
+  std::string backend = "egl";
+
+  if (options.mWindow || !headless.Create(options.mWidth, options.mHeight)) {
+    backend = "sdl";
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+      std::cout << "SDL could not initialize video subsystem" << std::endl;
+      return 1;
+    }
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                        SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    window = SDL_CreateWindow("Bench", 0, 0, options.mWidth, options.mHeight,
+                              SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    context = window != nullptr ? SDL_GL_CreateContext(window) : nullptr;
+    if (context == nullptr ||
+        !gladLoadGLLoader(SDL_GL_GetProcAddress)) {
+      std::cout << "OpenGL context not available" << std::endl;
+      SDL_Quit();
+      return 1;
+    }
+    // Measure the renderer, not the display
+    SDL_GL_SetSwapInterval(0);
+  }
+
+  // Counts what each frame asks of the driver, reported as averages
+  RenderStatsEnable();
+
+  // Scene
+  ProgramBinaryCache programCache("./shader_cache");
+  programCache.Initialize();
+  PipelineCompiler pipelineCompiler(&programCache);
+  ShaderLibrary shaderLibrary(&programCache, &pipelineCompiler);
+  GLuint program =
+      shaderLibrary.GetProgram("./shaders/vert.glsl", "./shaders/frag.glsl");
+  if (program == 0) {
+    return 1;
+  }
+
+  Scene scene;
+  SceneRenderer sceneRenderer;
+  bool useScene = !options.mScenePath.empty() || options.mGenerateScene;
+  if (!options.mScenePath.empty()) {
+    if (!SceneLoad(options.mScenePath, &scene)) {
+      return 1;
+    }
+  } else if (options.mGenerateScene) {
+    GenerateScene(options.mSceneParams, &scene);
+  }
+  TexturePacker materials;
+  std::vector<std::string> materialPaths;
+  if (!options.mMaterialDir.empty()) {
+    materialPaths = ListFiles(options.mMaterialDir);
+    LoadMaterials(materialPaths, &materials);
+  }
+  if (useScene && !sceneRenderer.Create(&scene, &shaderLibrary, &materials)) {
+    std::cout << "Could not build the scene" << std::endl;
+    return 1;
+  }
+
+  GeometryCache geometry;
+  Mesh3D meshes[2];
+  for (int i = 0; i < 2 && !useScene; ++i) {
+    geometry.Acquire(&meshes[i], MeshQuadData());
+    MeshSetPipeline(&meshes[i], program);
+    meshes[i].mTransform.translation = glm::vec3(2.0f * i, 0.0f, -2.0f);
+    MeshSimulate(&meshes[i], 0.0f);
+  }
+
+  glm::vec3 center(1.0f, 0.0f, -2.0f);
+  float radius = 1.0f;
+  if (useScene) {
+    SceneBounds(scene, &center, &radius);
+  }
+  float orbit = std::max(3.0f, radius * 1.5f);
+
+  Camera camera;
+  camera.SetProjectionMatrix(glm::radians(45.0f),
+                             (float)options.mWidth / (float)options.mHeight,
+                             0.1f, std::max(10.0f, orbit + radius));
+
+  TextureManager textures;
+  textures.Initialize();
+  std::vector<std::string> texturePaths;
+  if (!options.mTextureDir.empty()) {
+    texturePaths = ListFiles(options.mTextureDir);
+  }
+  TextureHandle texture = 0;
+
+  GLuint queries[kQueryLatency];
+  glGenQueries(kQueryLatency, queries);
+
+  std::vector<double> cpuMs;
+  std::vector<double> gpuMs;
+  double statTotals[kRenderStatCount] = {};
+  using Clock = std::chrono::steady_clock;
+  int total = options.mWarmup + options.mFrames;
+
+  // Reads the query of an earlier frame, warmup frames are dropped
+  auto collect = [&](int frame) {
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(queries[frame % kQueryLatency], GL_QUERY_RESULT,
+                          &elapsed);
+    if (frame >= options.mWarmup) {
+      gpuMs.push_back(elapsed / 1.0e6);
+    }
+  };
+
+  for (int frame = 0; frame < total; ++frame) {
+    if (frame >= kQueryLatency) {
+      collect(frame - kQueryLatency);
+    }
+
+    auto start = Clock::now();
+    CameraPath(&camera, center, orbit, frame - options.mWarmup,
+               options.mFrames);
+
+    if (frame == options.mWarmup) {
+      for (const std::string &path : texturePaths) {
+        TextureHandle handle = textures.Load(path);
+        texture = texture != 0 ? texture : handle;
+      }
+    }
+
+    glBeginQuery(GL_TIME_ELAPSED, queries[frame % kQueryLatency]);
+    {
+      PROFILE_SCOPE("Textures");
+      textures.Update();
+      for (int i = 0; i < 2 && texture != 0; ++i) {
+        meshes[i].mTexture = textures.GetTexture(texture);
+      }
+    }
+    {
+      PROFILE_SCOPE("Render");
+      RenderBeginFrame(options.mWidth, options.mHeight);
+      if (useScene) {
+        // Fixed 60 Hz steps keep the animation independent of frame time
+        sceneRenderer.Update((float)frame / 60.0f);
+        sceneRenderer.Draw(camera);
+      } else {
+        for (Mesh3D &mesh : meshes) {
+          MeshSimulate(&mesh, 1.0f / 60.0f);
+          MeshDraw(&mesh, camera, 1.0f);
+        }
+      }
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+
+    {
+      PROFILE_SCOPE("Present");
+      if (window != nullptr) {
+        SDL_GL_SwapWindow(window);
+      } else {
+        glFlush();
+      }
+    }
+    ProfilerEndFrame();
+    RenderStatsEndFrame();
+    if (frame >= options.mWarmup) {
+      RenderStatsFrame stats = RenderStatsGetLastFrame();
+      for (int i = 0; i < kRenderStatCount; ++i) {
+        statTotals[i] += (double)stats.mValues[i];
+      }
+    }
+
+    if (frame >= options.mWarmup) {
+      cpuMs.push_back(
+          std::chrono::duration<double, std::milli>(Clock::now() - start)
+              .count());
+    }
+  }
+  glFinish();
+  for (int frame = std::max(0, total - kQueryLatency); frame < total;
+       ++frame) {
+    collect(frame);
+  }
+
+  std::ostringstream report;
+  report << "{\n"
+         << "  \"backend\": \"" << backend << "\",\n"
+         << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+         << "  \"width\": " << options.mWidth << ",\n"
+         << "  \"height\": " << options.mHeight << ",\n"
+         << "  \"frames\": " << options.mFrames << ",\n"
+         << "  \"objects\": " << (useScene ? scene.mObjects.size() : 2)
+         << ",\n"
+         << "  \"textures\": " << texturePaths.size() << ",\n"
+         << "  \"textures_ready\": " << textures.GetReadyCount() << ",\n"
+         << "  \"texture_upload_mb\": "
+         << textures.GetUploadedBytes() / (1024.0 * 1024.0) << ",\n"
+         << "  \"materials\": " << materials.GetStats().mTextures << ",\n"
+         << "  \"material_arrays\": " << materials.GetStats().mArrays
+         << ",\n"
+         << "  \"cpu_ms\": " << TimingSummaryJson(SummarizeTimings(cpuMs))
+         << ",\n"
+         << "  \"gpu_ms\": " << TimingSummaryJson(SummarizeTimings(gpuMs))
+         << ",\n  \"per_frame\": {";
+  for (int i = 0; i < kRenderStatCount; ++i) {
+    report << (i > 0 ? ", " : "") << "\"" << RenderStatName((RenderStat)i)
+           << "\": " << statTotals[i] / options.mFrames;
+  }
+  report << "}\n}\n";
+
+  if (options.mOutPath.empty()) {
+    std::cout << report.str();
+  } else {
+    std::ofstream out(options.mOutPath);
+    out << report.str();
+  }
+
+  if (!options.mProfilePath.empty()) {
+    ProfilerWriteChromeTrace(options.mProfilePath);
+  }
+
+  glDeleteQueries(kQueryLatency, queries);
+  for (int i = 0; i < 2 && !useScene; ++i) {
+    geometry.Release(&meshes[i]);
+  }
+  geometry.Destroy();
+  sceneRenderer.Destroy();
+  materials.Destroy();
+  textures.Destroy();
+  shaderLibrary.Clear();
+  headless.Destroy();
+  if (window != nullptr) {
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+  }
+  return 0;
+}
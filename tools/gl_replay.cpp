@@ -0,0 +1,82 @@
+#include <SDL2/SDL.h>
+#include <algorithm>
+#include <cstdlib>
+#include <glad/glad.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "GLTrace.hpp"
+#include "HeadlessContext.hpp"
+
+// Replays a trace written with Practice --capture=<file> and reports how
+// long each captured frame took to issue and finish.
+int main(int argc, char *argv[]) {
+
+  if (argc < 2) {
+    std::cout << "usage: PracticeReplay <trace> [loops]" << std::endl;
+    return 1;
+  }
+  std::string path = argv[1];
+  int loops = argc > 2 ? std::max(1, std::atoi(argv[2])) : 10;
+
+  // Headless where EGL is available, a hidden window otherwise
+  HeadlessContext headless;
+  SDL_Window *window = nullptr;
+  SDL_GLContext context = nullptr;
+  if (!headless.Create(640, 480)) {
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+      std::cout << "SDL could not initialize video subsystem" << std::endl;
+      return 1;
+    }
+
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
+                        SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+
+    window = SDL_CreateWindow("Replay", 0, 0, 640, 480,
+                              SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    context = window != nullptr ? SDL_GL_CreateContext(window) : nullptr;
+    if (context == nullptr) {
+      std::cout << "OpenGL context not available" << std::endl;
+      SDL_Quit();
+      return 1;
+    }
+    if (!gladLoadGLLoader(SDL_GL_GetProcAddress)) {
+      std::cout << "glad was not initialized" << std::endl;
+      SDL_Quit();
+      return 1;
+    }
+    SDL_GL_SetSwapInterval(0);
+  }
+
+  GLTraceReplayStats stats;
+  bool replayed = GLTraceReplay(path, loops, &stats);
+
+  if (replayed && stats.mFrames > 0) {
+    std::vector<double> frames = stats.mFrameMs;
+    std::sort(frames.begin(), frames.end());
+    double total = 0.0;
+    for (double ms : frames) {
+      total += ms;
+    }
+    std::cout << "setup:  " << stats.mSetupMs << " ms" << std::endl;
+    std::cout << "frames: " << stats.mFrames << " over " << loops << " loops"
+              << std::endl;
+    std::cout << "mean:   " << total / frames.size() << " ms" << std::endl;
+    std::cout << "min:    " << frames.front() << " ms" << std::endl;
+    std::cout << "median: " << frames[frames.size() / 2] << " ms" << std::endl;
+    std::cout << "max:    " << frames.back() << " ms" << std::endl;
+  }
+
+  headless.Destroy();
+  if (window != nullptr) {
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+  }
+  return replayed ? 0 : 1;
+}
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Camera.hpp"
+#include "DynamicBatcher.hpp"
+#include "Frustum.hpp"
+#include "GpuCuller.hpp"
+#include "Hash.hpp"
+#include "Mesh.hpp"
+#include "TimingSummary.hpp"
+
+// CPU micro-benchmarks of the renderer's per-object paths. No GL context is
+// needed, so it runs anywhere the core library builds.
+//
+//   PracticeMicroBench [--filter=<substring>] [--samples=N] [--out=file]
+//
+// Every benchmark is warmed up, then timed in samples long enough to swamp
+// the clock's resolution. Results are nanoseconds per item.
+
+struct MicroBenchmark {
+  std::string mName;
+  // Items processed by one call of mRun, results are reported per item
+  size_t mItems;
+  std::function<void()> mRun;
+};
+
+struct MicroBenchOptions {
+  std::string mFilter;
+  int mSamples = 30;
+  std::string mOutPath;
+};
+
+// Keeps the compiler from discarding work whose result is never used
+template <typename T> static void KeepAlive(const T &value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  static volatile const void *sink;
+  sink = &value;
+#endif
+}
+
+using Clock = std::chrono::steady_clock;
+
+static double ElapsedNs(Clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+      .count();
+}
+
+static TimingSummary RunBenchmark(const MicroBenchmark &benchmark,
+                                  int samples) {
+  // Warm caches and branch predictors, and find how many calls make a
+  // sample of at least a millisecond
+  size_t calls = 1;
+  for (;;) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < calls; ++i) {
+      benchmark.mRun();
+    }
+    if (ElapsedNs(start) >= 1.0e6 || calls >= (1u << 24)) {
+      break;
+    }
+    calls *= 2;
+  }
+
+  std::vector<double> perItemNs;
+  for (int sample = 0; sample < samples; ++sample) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < calls; ++i) {
+      benchmark.mRun();
+    }
+    perItemNs.push_back(ElapsedNs(start) / (calls * benchmark.mItems));
+  }
+  return SummarizeTimings(perItemNs);
+}
+
+// Inputs shared by the benchmarks, filled the same way every run
+struct MicroBenchData {
+  std::vector<Mesh3D> mMeshes;
+  std::vector<glm::mat4> mModels;
+  std::vector<glm::vec4> mSpheres;
+  std::vector<glm::vec3> mBoxMins;
+  std::vector<glm::vec3> mBoxMaxs;
+  std::vector<GLfloat> mPositions;
+  std::vector<GLfloat> mTransformed;
+  std::vector<uint64_t> mSortKeys;
+  std::vector<DrawElementsIndirectCommand> mCommands;
+  std::vector<float> mUniforms;
+  Camera mCamera;
+  Frustum mFrustum;
+};
+
+static const size_t kObjects = 4096;
+
+static void FillData(MicroBenchData *data) {
+  uint32_t state = 12345;
+  auto next = [&state]() {
+    state = state * 1664525u + 1013904223u;
+    return (float)(state >> 8) / (float)(1u << 24);
+  };
+
+  data->mMeshes.resize(kObjects);
+  data->mModels.resize(kObjects);
+  for (Mesh3D &mesh : data->mMeshes) {
+    mesh.mTransform.translation =
+        glm::vec3(next() * 100.0f - 50.0f, next() * 100.0f - 50.0f,
+                  next() * -100.0f);
+    mesh.m_uRotate = next() * 360.0f;
+    mesh.mPipeline = 1 + (GLuint)(next() * 8.0f);
+    mesh.mVertexArrayObj = 1 + (GLuint)(next() * 64.0f);
+    mesh.mIndexCount = 6;
+  }
+  for (size_t i = 0; i < kObjects; ++i) {
+    glm::vec3 center = data->mMeshes[i].mTransform.translation;
+    data->mSpheres.push_back(glm::vec4(center, 0.5f + next()));
+    data->mBoxMins.push_back(center - glm::vec3(0.5f));
+    data->mBoxMaxs.push_back(center + glm::vec3(0.5f));
+  }
+
+  data->mPositions.resize(kObjects * 3);
+  for (GLfloat &value : data->mPositions) {
+    value = next() * 2.0f - 1.0f;
+  }
+  data->mTransformed.resize(kObjects * 3);
+  data->mSortKeys.resize(kObjects);
+  data->mCommands.resize(kObjects);
+  data->mUniforms.resize(kObjects * 16);
+
+  data->mCamera.SetProjectionMatrix(glm::radians(45.0f), 4.0f / 3.0f, 0.1f,
+                                    100.0f);
+  data->mFrustum = ExtractFrustum(data->mCamera.GetProjectionMatrix() *
+                                  data->mCamera.GetViewMatrix());
+}
+
+// Program in the top bits so state changes are minimized first, then vertex
+// array, then front to back depth
+static uint64_t DrawSortKey(const Mesh3D &mesh, float viewDepth) {
+  uint32_t depth = (uint32_t)std::min(std::max(viewDepth, 0.0f) * 256.0f,
+                                      16777215.0f);
+  return ((uint64_t)(mesh.mPipeline & 0xffff) << 48) |
+         ((uint64_t)(mesh.mVertexArrayObj & 0xffffff) << 24) | depth;
+}
+
+static std::vector<MicroBenchmark> CreateBenchmarks(MicroBenchData *data) {
+  std::vector<MicroBenchmark> benchmarks;
+
+  benchmarks.push_back({"MeshModelMatrix", kObjects, [data]() {
+                          for (size_t i = 0; i < kObjects; ++i) {
+                            data->mModels[i] =
+                                MeshModelMatrix(&data->mMeshes[i]);
+                          }
+                          KeepAlive(data->mModels);
+                        }});
+
+  benchmarks.push_back({"Camera::GetViewMatrix", 1, [data]() {
+                          glm::mat4 view = data->mCamera.GetViewMatrix();
+                          KeepAlive(view);
+                        }});
+
+  benchmarks.push_back({"ExtractFrustum", 1, [data]() {
+                          Frustum frustum =
+                              ExtractFrustum(data->mModels[0]);
+                          KeepAlive(frustum);
+                        }});
+
+  benchmarks.push_back(
+      {"FrustumIntersectsSphere", kObjects, [data]() {
+         int visible = 0;
+         for (const glm::vec4 &sphere : data->mSpheres) {
+           visible += FrustumIntersectsSphere(
+               data->mFrustum, glm::vec3(sphere), sphere.w);
+         }
+         KeepAlive(visible);
+       }});
+
+  benchmarks.push_back(
+      {"FrustumIntersectsAabb", kObjects, [data]() {
+         int visible = 0;
+         for (size_t i = 0; i < kObjects; ++i) {
+           visible += FrustumIntersectsAabb(data->mFrustum, data->mBoxMins[i],
+                                            data->mBoxMaxs[i]);
+         }
+         KeepAlive(visible);
+       }});
+
+  benchmarks.push_back(
+      {"DrawSortKey", kObjects, [data]() {
+         glm::mat4 view = data->mCamera.GetViewMatrix();
+         for (size_t i = 0; i < kObjects; ++i) {
+           glm::vec4 viewPosition =
+               view * glm::vec4(data->mMeshes[i].mTransform.translation, 1.0f);
+           data->mSortKeys[i] = DrawSortKey(data->mMeshes[i], -viewPosition.z);
+         }
+         KeepAlive(data->mSortKeys);
+       }});
+
+  benchmarks.push_back({"std::sort keys", kObjects, [data]() {
+                          std::vector<uint64_t> keys = data->mSortKeys;
+                          std::sort(keys.begin(), keys.end());
+                          KeepAlive(keys);
+                        }});
+
+  benchmarks.push_back(
+      {"Record indirect commands", kObjects, [data]() {
+         for (size_t i = 0; i < kObjects; ++i) {
+           const Mesh3D &mesh = data->mMeshes[i];
+           DrawElementsIndirectCommand &command = data->mCommands[i];
+           command.count = (GLuint)mesh.mIndexCount;
+           command.instanceCount = 1;
+           command.firstIndex = 0;
+           command.baseVertex = 0;
+           command.baseInstance = (GLuint)i;
+         }
+         KeepAlive(data->mCommands);
+       }});
+
+  benchmarks.push_back(
+      {"Pack model uniforms", kObjects, [data]() {
+         float *out = data->mUniforms.data();
+         for (size_t i = 0; i < kObjects; ++i) {
+           std::memcpy(out + i * 16, &data->mModels[i][0][0],
+                       16 * sizeof(float));
+         }
+         KeepAlive(data->mUniforms);
+       }});
+
+  benchmarks.push_back(
+      {"TransformPositions", kObjects, [data]() {
+         TransformPositions(data->mModels[0], data->mPositions.data(),
+                            data->mTransformed.data(), kObjects);
+         KeepAlive(data->mTransformed);
+       }});
+
+  benchmarks.push_back(
+      {"HashBytes 1KiB", 1024, [data]() {
+         uint64_t hash = HashBytes(data->mPositions.data(), 1024);
+         KeepAlive(hash);
+       }});
+
+  benchmarks.push_back(
+      {"HashWords 1KiB", 1024, [data]() {
+         uint64_t hash = HashWords(data->mPositions.data(), 1024);
+         KeepAlive(hash);
+       }});
+
+  return benchmarks;
+}
+
+static bool ParseOptions(int argc, char *argv[], MicroBenchOptions *options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (std::strncmp(arg, "--filter=", 9) == 0) {
+      options->mFilter = arg + 9;
+    } else if (std::strncmp(arg, "--out=", 6) == 0) {
+      options->mOutPath = arg + 6;
+    } else if (std::sscanf(arg, "--samples=%d", &options->mSamples) != 1) {
+      std::cout << "Unknown option " << arg << std::endl;
+      return false;
+    }
+  }
+  return options->mSamples > 0;
+}
+
+int main(int argc, char *argv[]) {
+
+  MicroBenchOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+
+  MicroBenchData data;
+  FillData(&data);
+  std::vector<MicroBenchmark> benchmarks = CreateBenchmarks(&data);
+
+  std::ostringstream report;
+  report << "{\n  \"unit\": \"ns_per_item\",\n  \"benchmarks\": [";
+  bool first = true;
+  for (const MicroBenchmark &benchmark : benchmarks) {
+    if (benchmark.mName.find(options.mFilter) == std::string::npos) {
+      continue;
+    }
+
+    TimingSummary summary = RunBenchmark(benchmark, options.mSamples);
+    // Progress on stderr keeps stdout valid JSON
+    std::fprintf(stderr, "%-28s %10.3f ns/item (p95 %.3f)\n",
+                 benchmark.mName.c_str(), summary.mP50, summary.mP95);
+
+    report << (first ? "\n" : ",\n") << "    {\"name\": \"" << benchmark.mName
+           << "\", \"items\": " << benchmark.mItems
+           << ", \"ns\": " << TimingSummaryJson(summary)
+           << ", \"items_per_second\": "
+           << (summary.mP50 > 0.0 ? 1.0e9 / summary.mP50 : 0.0) << "}";
+    first = false;
+  }
+  report << "\n  ]\n}\n";
+
+  if (options.mOutPath.empty()) {
+    std::cout << report.str();
+  } else {
+    std::ofstream out(options.mOutPath);
+    out << report.str();
+  }
+  return 0;
+}
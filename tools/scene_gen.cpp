@@ -0,0 +1,39 @@
+#include <iostream>
+#include <string>
+
+#include "SceneGenerator.hpp"
+
+// Writes a generated scene for Practice --scene=<file> and PracticeBench.
+//
+//   PracticeSceneGen --out=scene.bin [--seed=N] [--objects=N] [--meshes=N]
+//                    [--instanced=F] [--moving=F] [--extent=F] [--depth=N]
+//                    [--variants=N] [--distribution=uniform|clustered|grid]
+int main(int argc, char *argv[]) {
+
+  SceneParams params;
+  std::string outPath;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind("--out=", 0) == 0) {
+      outPath = arg.substr(6);
+    } else if (!ParseSceneOption(argv[i], &params)) {
+      std::cout << "Unknown option " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (outPath.empty()) {
+    std::cout << "usage: PracticeSceneGen --out=<file> [scene options]"
+              << std::endl;
+    return 1;
+  }
+
+  Scene scene;
+  GenerateScene(params, &scene);
+  if (!SceneSave(outPath, scene)) {
+    return 1;
+  }
+
+  std::cout << "Wrote " << scene.mObjects.size() << " objects using "
+            << scene.mMeshes.size() << " meshes to " << outPath << std::endl;
+  return 0;
+}
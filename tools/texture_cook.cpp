@@ -0,0 +1,129 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Image.hpp"
+#include "TextureCooker.hpp"
+#include "ThreadPool.hpp"
+
+// Cooks images into KTX files the runtime uploads as they are: mips are
+// built here and color textures are compressed to BC1 or BC3. Files are
+// cooked in parallel on every core.
+//
+//   PracticeTextureCook --out=<dir> [--format=auto|bc1|bc3|rgba] [--linear]
+//                       [--no-mips] [--threads=N] <image>...
+//
+// auto picks BC1 for opaque images and BC3 for the rest. --linear is for
+// data like normal maps, which must not be filtered as sRGB.
+
+static const char *FormatName(ImageFormat format) {
+  switch (format) {
+  case kImageRgba8:
+    return "rgba8";
+  case kImageRgba16f:
+    return "rgba16f";
+  case kImageBc1:
+    return "bc1";
+  case kImageBc2:
+    return "bc2";
+  case kImageBc3:
+    return "bc3";
+  }
+  return "?";
+}
+
+int main(int argc, char *argv[]) {
+
+  CookOptions options;
+  std::string outDir;
+  int threads = (int)std::thread::hardware_concurrency();
+  std::vector<std::string> inputs;
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (std::strncmp(arg, "--out=", 6) == 0) {
+      outDir = arg + 6;
+    } else if (std::strncmp(arg, "--format=", 9) == 0) {
+      if (!ParseCookFormat(arg + 9, &options.mFormat)) {
+        std::cout << "Unknown format " << arg + 9 << std::endl;
+        return 1;
+      }
+    } else if (std::strcmp(arg, "--linear") == 0) {
+      options.mSrgb = false;
+    } else if (std::strcmp(arg, "--no-mips") == 0) {
+      options.mMips = false;
+    } else if (std::sscanf(arg, "--threads=%d", &threads) == 1) {
+    } else if (std::strncmp(arg, "--", 2) == 0) {
+      std::cout << "Unknown option " << arg << std::endl;
+      return 1;
+    } else {
+      inputs.push_back(arg);
+    }
+  }
+  if (outDir.empty() || inputs.empty()) {
+    std::cout << "usage: PracticeTextureCook --out=<dir> [options] <image>..."
+              << std::endl;
+    return 1;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(outDir, error);
+
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  std::mutex printMutex;
+  std::atomic<int> failed(0);
+  std::atomic<size_t> bytesIn(0);
+  std::atomic<size_t> bytesOut(0);
+
+  ThreadPool pool;
+  pool.Start(std::max(1, threads), "TextureCook");
+  for (const std::string &input : inputs) {
+    pool.Submit([&, input] {
+      std::filesystem::path outPath = std::filesystem::path(outDir) /
+                                      std::filesystem::path(input).stem();
+      outPath += ".ktx";
+
+      Image image;
+      std::string message;
+      size_t sourceSize = 0;
+      bool ok = LoadImage(input, &image, &message);
+      if (ok) {
+        sourceSize = ImageLevelSize(image.mFormat == kImageRgba16f
+                                        ? kImageRgba16f
+                                        : kImageRgba8,
+                                    image.Width(), image.Height());
+        ok = CookTexture(&image, options, &message) &&
+             SaveKtx(outPath.string(), image, &message);
+      }
+
+      std::lock_guard<std::mutex> lock(printMutex);
+      if (!ok) {
+        std::cout << input << ": " << message << std::endl;
+        ++failed;
+        return;
+      }
+      bytesIn += sourceSize;
+      bytesOut += image.mData.size();
+      std::cout << input << " -> " << outPath.string() << " ("
+                << image.Width() << "x" << image.Height() << ", "
+                << image.mLevels.size() << " levels, "
+                << FormatName(image.mFormat) << ")" << std::endl;
+    });
+  }
+  pool.Stop();
+
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << "Cooked " << inputs.size() - failed << " of " << inputs.size()
+            << " textures in " << seconds << " s on " << threads
+            << " threads, " << bytesIn / 1024 << " KB of pixels to "
+            << bytesOut / 1024 << " KB" << std::endl;
+  return failed > 0 ? 1 : 0;
+}